@@ -5,21 +5,62 @@
 
 #include "Area.h"
 #include "AreaOrderer.h"
+#include "AreaInsideIndex.h"
+#include "SpanIntersector.h"
 
+#include <algorithm>
 #include <map>
+#include <vector>
+#include <thread>
 
 double CArea::m_accuracy = 0.01;
 double CArea::m_units = 1.0;
 bool CArea::m_fit_arcs = true;
-double CArea::m_single_area_processing_length = 0.0;
-double CArea::m_processing_done = 0.0;
-bool CArea::m_please_abort = false;
-double CArea::m_MakeOffsets_increment = 0.0;
-double CArea::m_split_processing_length = 0.0;
-bool CArea::m_set_processing_length_in_split = false;
-double CArea::m_after_MakeOffsets_length = 0.0;
+CAreaProcessContext CArea::m_default_context;
+double &CArea::m_processing_done = CArea::m_default_context.m_processing_done;
+volatile bool &CArea::m_please_abort = CArea::m_default_context.m_please_abort;
 //static const double PI = 3.1415926535897932;
 
+CAreaProcessContext::CAreaProcessContext(CAreaProcessContext* parent):m_parent(parent), m_max_threads(0)
+{
+	Reset();
+}
+
+void CAreaProcessContext::Reset()
+{
+	m_processing_done = 0.0;
+	m_please_abort = false;
+	m_single_area_processing_length = 0.0;
+	m_after_MakeOffsets_length = 0.0;
+	m_MakeOffsets_increment = 0.0;
+	m_split_processing_length = 0.0;
+	m_set_processing_length_in_split = false;
+}
+
+bool CAreaProcessContext::Aborted()const
+{
+	for(const CAreaProcessContext* context = this; context; context = context->m_parent)
+	{
+		if(context->m_please_abort)return true;
+	}
+	return false;
+}
+
+void CAreaProcessContext::AddProgress(double length)
+{
+	// the brothers of this job may be adding to the parent at the same time
+	for(CAreaProcessContext* context = this; context; context = context->m_parent)
+	{
+		std::lock_guard<std::mutex> lock(context->m_mutex);
+		context->m_processing_done += length;
+	}
+}
+
+void CAreaProcessContext::SetProgress(double done)
+{
+	AddProgress(done - m_processing_done);
+}
+
 void CArea::append(const CCurve& curve)
 {
 	m_curves.push_back(curve);
@@ -51,16 +92,16 @@ Point CArea::NearestPoint(const Point& p)const
 	return best_point;
 }
 
-void CArea::GetBox(CBox2D &box)
+void CArea::GetBox(CBox2D &box)const
 {
-	for(std::list<CCurve>::iterator It = m_curves.begin(); It != m_curves.end(); It++)
+	for(std::list<CCurve>::const_iterator It = m_curves.begin(); It != m_curves.end(); It++)
 	{
-		CCurve& curve = *It;
+		const CCurve& curve = *It;
 		curve.GetBox(box);
 	}
 }
 
-void CArea::Reorder()
+void CArea::Reorder(CAreaProcessContext* context)
 {
 	// curves may have been added with wrong directions
 	// test all kurves to see which one are outsides and which are insides and 
@@ -74,44 +115,93 @@ void CArea::Reorder()
 	{
 		CCurve& curve = *It;
 		ao.Insert(&curve);
-		if(m_set_processing_length_in_split)
+		if(context && context->m_set_processing_length_in_split)
 		{
-			CArea::m_processing_done += (m_split_processing_length / m_curves.size());
+			context->AddProgress(context->m_split_processing_length / m_curves.size());
 		}
 	}
 
 	*this = ao.ResultArea();
 }
 
-class ZigZag
+// where a curve crosses a scanline
+class CZigCrossing
 {
 public:
-	CCurve zig;
-	CCurve zag;
-	ZigZag(const CCurve& Zig, const CCurve& Zag):zig(Zig), zag(Zag){}
+	double m_x;
+	int m_row;
+	unsigned int m_curve;
+	unsigned int m_edge; // from point m_edge to point m_edge + 1 of the curve
+	bool m_up; // the edge goes up, so the area is on its left when it is the right end of a row
+
+	CZigCrossing(double x, int row, unsigned int curve, unsigned int edge, bool up):m_x(x), m_row(row), m_curve(curve), m_edge(edge), m_up(up){}
 };
 
-static double stepover_for_pocket = 0.0;
-static std::list<ZigZag> zigzag_list_for_zigs;
-static std::list<CCurve> *curve_list_for_zigs = NULL;
-static bool rightward_for_zigs = true;
-static double sin_angle_for_zigs = 0.0;
-static double cos_angle_for_zigs = 0.0;
-static double sin_minus_angle_for_zigs = 0.0;
-static double cos_minus_angle_for_zigs = 0.0;
-static double one_over_units = 0.0;
+// makes the zig zag toolpath for one area. all the working values are kept in here, so several can be made at once
+// the area's curves are made into points once, then all the scanlines are crossed with them in one pass.
+// the rows are joined up by following the curves between the crossings, instead of intersecting a strip with the area for each row
+class CZigZagger
+{
+	CAreaProcessContext &m_context;
+	std::list<CCurve> &m_curve_list;
+	double m_stepover;
+	double m_sin_angle;
+	double m_cos_angle;
+	double m_sin_minus_angle;
+	double m_cos_minus_angle;
+	double m_one_over_units;
+	double m_y0; // the first scanline
+	int m_num_rows;
+	std::vector<Point> m_pts; // the points of the rotated curves, one curve after another, without the closing point
+	std::vector<unsigned int> m_curve_first_pt; // and the end of the last curve
+	std::vector<CZigCrossing> m_crossings; // in order round each curve
+	std::vector<unsigned int> m_curve_first_crossing; // and the end of the last curve
+
+	Point rotated_point(const Point &p)const;
+	Point unrotated_point(const Point &p)const;
+	CVertex rotated_vertex(const CVertex &v)const;
+	void rotate_area(CArea &a)const;
+	double row_y(int row)const{return m_y0 + row * m_stepover;}
+	Point crossing_point(unsigned int i)const{return Point(m_crossings[i].m_x, row_y(m_crossings[i].m_row));}
+	void add_curve_points(const CCurve& curve);
+	void add_edge_crossings(unsigned int curve_index, unsigned int edge, const Point& p0, const Point& p1);
+	unsigned int next_crossing(unsigned int i, bool forwards)const;
+	unsigned int up_crossing(unsigned int i)const{return next_crossing(i, m_crossings[i].m_up);}
+	unsigned int down_crossing(unsigned int i)const{return next_crossing(i, !m_crossings[i].m_up);}
+	int boundary_count(unsigned int from, bool forwards)const;
+	const Point& boundary_point(unsigned int from, bool forwards, int j)const;
+	double boundary_min_y(unsigned int from, bool forwards)const;
+	void add_point(CCurve& curve, const Point& p)const;
+	void add_boundary(CCurve& curve, unsigned int from, bool forwards, bool to_crossing)const;
+
+public:
+	CZigZagger(std::list<CCurve> &curve_list, const CAreaPocketParams &params, CAreaProcessContext &context);
+
+	void zigzag(const CArea &input_a);
+};
 
-static Point rotated_point(const Point &p)
+CZigZagger::CZigZagger(std::list<CCurve> &curve_list, const CAreaPocketParams &params, CAreaProcessContext &context):m_context(context), m_curve_list(curve_list), m_y0(0.0), m_num_rows(0)
 {
-	return Point(p.x * cos_angle_for_zigs - p.y * sin_angle_for_zigs, p.x * sin_angle_for_zigs + p.y * cos_angle_for_zigs);
+	double radians_angle = params.zig_angle * PI / 180;
+	m_sin_angle = sin(-radians_angle);
+	m_cos_angle = cos(-radians_angle);
+	m_sin_minus_angle = sin(radians_angle);
+	m_cos_minus_angle = cos(radians_angle);
+	m_stepover = params.stepover;
+	m_one_over_units = 1 / CArea::m_units;
+}
+
+Point CZigZagger::rotated_point(const Point &p)const
+{
+	return Point(p.x * m_cos_angle - p.y * m_sin_angle, p.x * m_sin_angle + p.y * m_cos_angle);
 }
     
-static Point unrotated_point(const Point &p)
+Point CZigZagger::unrotated_point(const Point &p)const
 {
-    return Point(p.x * cos_minus_angle_for_zigs - p.y * sin_minus_angle_for_zigs, p.x * sin_minus_angle_for_zigs + p.y * cos_minus_angle_for_zigs);
+    return Point(p.x * m_cos_minus_angle - p.y * m_sin_minus_angle, p.x * m_sin_minus_angle + p.y * m_cos_minus_angle);
 }
 
-static CVertex rotated_vertex(const CVertex &v)
+CVertex CZigZagger::rotated_vertex(const CVertex &v)const
 {
 	if(v.m_type)
 	{
@@ -120,16 +210,7 @@ static CVertex rotated_vertex(const CVertex &v)
     return CVertex(v.m_type, rotated_point(v.m_p), Point(0, 0));
 }
 
-static CVertex unrotated_vertex(const CVertex &v)
-{
-	if(v.m_type)
-	{
-		return CVertex(v.m_type, unrotated_point(v.m_p), unrotated_point(v.m_c));
-	}
-	return CVertex(v.m_type, unrotated_point(v.m_p), Point(0, 0));
-}
-
-static void rotate_area(CArea &a)
+void CZigZagger::rotate_area(CArea &a)const
 {
 	for(std::list<CCurve>::iterator It = a.m_curves.begin(); It != a.m_curves.end(); It++)
 	{
@@ -142,350 +223,347 @@ static void rotate_area(CArea &a)
 	}
 }
 
-void test_y_point(int i, const Point& p, Point& best_p, bool &found, int &best_index, double y, bool left_not_right)
+void CZigZagger::add_curve_points(const CCurve& input_curve)
 {
-	// only consider points at y
-	if(fabs(p.y - y) < 0.002 * one_over_units)
+	CCurve curve(input_curve);
+	curve.UnFitArcs();
+
+	unsigned int first = m_pts.size();
+	for(std::list<CVertex>::const_iterator VIt = curve.m_vertices.begin(); VIt != curve.m_vertices.end(); VIt++)
 	{
-		if(found)
-		{
-			// equal high point
-			if(left_not_right)
-			{
-				// use the furthest left point
-				if(p.x < best_p.x)
-				{
-					best_p = p;
-					best_index = i;
-				}
-			}
-			else
-			{
-				// use the furthest right point
-				if(p.x > best_p.x)
-				{
-					best_p = p;
-					best_index = i;
-				}
-			}
-		}
-		else
-		{
-			best_p = p;
-			best_index = i;
-			found = true;
-		}
+		const Point& p = VIt->m_p;
+		if(m_pts.size() > first && p == m_pts.back())continue;
+		m_pts.push_back(p);
 	}
+	if(m_pts.size() > first + 1 && m_pts.back() == m_pts[first])m_pts.pop_back();
+	if(m_pts.size() < first + 3)m_pts.resize(first); // not a closed curve
+
+	if(m_pts.size() > first)m_curve_first_pt.push_back(m_pts.size());
 }
 
-static void make_zig_curve(const CCurve& input_curve, double y0, double y)
+void CZigZagger::add_edge_crossings(unsigned int curve_index, unsigned int edge, const Point& p0, const Point& p1)
 {
-	CCurve curve(input_curve);
-
-	if(rightward_for_zigs)
-	{
-		if(curve.IsClockwise())
-			curve.Reverse();
+	// the edge crosses the scanlines from its lower end, up to, but not including its upper end
+	// so a point on a scanline is only counted once, or not at all if both edges go down from it
+	if(p0.y == p1.y)return;
+	bool up = p1.y > p0.y;
+	double y_low = up ? p0.y : p1.y;
+	double y_high = up ? p1.y : p0.y;
+
+	int first_row = (int)ceil((y_low - m_y0) / m_stepover) - 1;
+	if(first_row < 0)first_row = 0;
+	while(first_row < m_num_rows && row_y(first_row) < y_low)first_row++;
+	int end_row = first_row;
+	while(end_row < m_num_rows && row_y(end_row) < y_high)end_row++;
+
+	// in order along the edge
+	double dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+	for(int i = 0; i < end_row - first_row; i++)
+	{
+		int row = up ? (first_row + i) : (end_row - 1 - i);
+		m_crossings.push_back(CZigCrossing(p0.x + (row_y(row) - p0.y) * dxdy, row, curve_index, edge, up));
 	}
-	else
+}
+
+unsigned int CZigZagger::next_crossing(unsigned int i, bool forwards)const
+{
+	// the next crossing round the curve
+	unsigned int first = m_curve_first_crossing[m_crossings[i].m_curve];
+	unsigned int end = m_curve_first_crossing[m_crossings[i].m_curve + 1];
+	if(forwards)return (i + 1 == end) ? first : (i + 1);
+	return (i == first) ? (end - 1) : (i - 1);
+}
+
+void CZigZagger::add_point(CCurve& curve, const Point& p)const
+{
+	Point up = unrotated_point(p);
+	if(curve.m_vertices.size() > 0 && curve.m_vertices.back().m_p.dist(up) < 0.002 * m_one_over_units)return;
+	curve.m_vertices.push_back(CVertex(0, up, Point(0, 0)));
+}
+
+int CZigZagger::boundary_count(unsigned int from, bool forwards)const
+{
+	// how many of the curve's points there are between a crossing and the next one
+	unsigned int to = next_crossing(from, forwards);
+	const CZigCrossing &a = m_crossings[from];
+	const CZigCrossing &b = m_crossings[to];
+	int n = m_curve_first_pt[a.m_curve + 1] - m_curve_first_pt[a.m_curve];
+	if(forwards)return b.m_edge - a.m_edge + ((to <= from) ? n : 0);
+	return a.m_edge - b.m_edge + ((to >= from) ? n : 0);
+}
+
+const Point& CZigZagger::boundary_point(unsigned int from, bool forwards, int j)const
+{
+	const CZigCrossing &a = m_crossings[from];
+	int first = m_curve_first_pt[a.m_curve];
+	int n = m_curve_first_pt[a.m_curve + 1] - first;
+	if(forwards)return m_pts[first + (a.m_edge + 1 + j) % n];
+	return m_pts[first + ((int)a.m_edge - j + n) % n];
+}
+
+double CZigZagger::boundary_min_y(unsigned int from, bool forwards)const
+{
+	double min_y = row_y(m_crossings[from].m_row);
+	int count = boundary_count(from, forwards);
+	for(int j = 0; j < count; j++)
 	{
-		if(!curve.IsClockwise())
-			curve.Reverse();
+		double y = boundary_point(from, forwards, j).y;
+		if(y < min_y)min_y = y;
 	}
+	return min_y;
+}
 
-    // find a high point to start looking from
-	Point top_left;
-	int top_left_index;
-	bool top_left_found = false;
-	Point top_right;
-	int top_right_index;
-	bool top_right_found = false;
-	Point bottom_left;
-	int bottom_left_index;
-	bool bottom_left_found = false;
+void CZigZagger::add_boundary(CCurve& curve, unsigned int from, bool forwards, bool to_crossing)const
+{
+	// follows the curve from one crossing towards the next one
+	int count = boundary_count(from, forwards);
+	for(int j = 0; j < count; j++)add_point(curve, boundary_point(from, forwards, j));
+	if(to_crossing)add_point(curve, crossing_point(next_crossing(from, forwards)));
+}
 
-	int i =0;
-	for(std::list<CVertex>::const_iterator VIt = curve.m_vertices.begin(); VIt != curve.m_vertices.end(); VIt++, i++)
+class CrossingIsLeftOf
+{
+	const std::vector<CZigCrossing> &m_crossings;
+public:
+	CrossingIsLeftOf(const std::vector<CZigCrossing> &crossings):m_crossings(crossings){}
+	bool operator()(unsigned int i0, unsigned int i1)const
 	{
-		const CVertex& vertex = *VIt;
+		// at the same x, the one going down is the left end of a row
+		const CZigCrossing &c0 = m_crossings[i0];
+		const CZigCrossing &c1 = m_crossings[i1];
+		if(c0.m_x != c1.m_x)return c0.m_x < c1.m_x;
+		return !c0.m_up && c1.m_up;
+	}
+};
 
-		test_y_point(i, vertex.m_p, top_right, top_right_found, top_right_index, y, !rightward_for_zigs);
-		test_y_point(i, vertex.m_p, top_left, top_left_found, top_left_index, y, rightward_for_zigs);
-		test_y_point(i, vertex.m_p, bottom_left, bottom_left_found, bottom_left_index, y0, rightward_for_zigs);
+void CZigZagger::zigzag(const CArea &input_a)
+{
+	if(input_a.m_curves.size() == 0)
+	{
+		m_context.AddProgress(m_context.m_single_area_processing_length);
+		return;
 	}
+    
+	CArea a(input_a);
+    rotate_area(a);
+    
+    CBox2D b;
+	a.GetBox(b);
+    
+    double height = b.MaxY() - b.MinY();
+    m_num_rows = int(height / m_stepover + 1);
+	m_y0 = b.MinY();
 
-	int start_index = 0;
-	int end_index = 0;
-	int zag_end_index = 0;
+	if(m_context.Aborted())return;
 
-	if(bottom_left_found)start_index = bottom_left_index;
-	else if(top_left_found)start_index = top_left_index;
+	// cross all the scanlines with the curves, in one pass
+	m_curve_first_pt.push_back(0);
+	for(std::list<CCurve>::const_iterator It = a.m_curves.begin(); It != a.m_curves.end(); It++)
+		add_curve_points(*It);
 
-	if(top_right_found)
+	m_curve_first_crossing.push_back(0);
+	for(unsigned int c = 0; c + 1 < m_curve_first_pt.size(); c++)
 	{
-		end_index = top_right_index;
-		zag_end_index = top_left_index;
+		unsigned int first = m_curve_first_pt[c];
+		unsigned int n = m_curve_first_pt[c + 1] - first;
+		for(unsigned int i = 0; i < n; i++)
+			add_edge_crossings(c, i, m_pts[first + i], m_pts[first + (i + 1) % n]);
+		m_curve_first_crossing.push_back(m_crossings.size());
 	}
-	else
+
+	// sort the crossings into rows, then along each row
+	std::vector<unsigned int> row_first(m_num_rows + 1, 0);
+	for(unsigned int i = 0; i < m_crossings.size(); i++)row_first[m_crossings[i].m_row + 1]++;
+	for(int row = 0; row < m_num_rows; row++)row_first[row + 1] += row_first[row];
+	std::vector<unsigned int> row_crossings(m_crossings.size());
 	{
-		end_index = bottom_left_index;
-		zag_end_index =  bottom_left_index;
+		std::vector<unsigned int> row_next(row_first.begin(), row_first.end() - 1);
+		for(unsigned int i = 0; i < m_crossings.size(); i++)row_crossings[row_next[m_crossings[i].m_row]++] = i;
 	}
-	if(end_index <= start_index)end_index += (i-1);
-	if(zag_end_index <= start_index)zag_end_index += (i-1);
+	for(int row = 0; row < m_num_rows; row++)
+		std::sort(row_crossings.begin() + row_first[row], row_crossings.begin() + row_first[row + 1], CrossingIsLeftOf(m_crossings));
 
-    CCurve zig, zag;
-    
-    bool zig_started = false;
-    bool zig_finished = false;
-    bool zag_finished = false;
-    
-	int v_index = 0;
-	for(int i = 0; i < 2; i++)
+	if(m_context.Aborted())return;
+	m_context.AddProgress(0.2 * m_context.m_single_area_processing_length);
+
+	// go along each row, in alternate directions; the area is between pairs of crossings
+	unsigned int num_curves_before = m_curve_list.size();
+	// a row joins on to the row below, if the curve goes up from the end of the row below to the start of this row
+	std::vector<CCurve*> waiting(m_crossings.size(), (CCurve*)NULL); // the toolpath which will join on to a row starting at the crossing
+	double row_progress = 0.8 * m_context.m_single_area_processing_length / m_num_rows;
+	for(int row = 0; row < m_num_rows; row++)
 	{
-		// process the curve twice because we don't know where it will start
-		if(zag_finished)
-			break;
-		for(std::list<CVertex>::const_iterator VIt = curve.m_vertices.begin(); VIt != curve.m_vertices.end(); VIt++)
+		bool rightward = (row % 2) == 0;
+		for(unsigned int j = row_first[row]; j + 1 < row_first[row + 1]; j += 2)
 		{
-			if(i == 1 && VIt == curve.m_vertices.begin())
-			{
-				continue;
-			}
+			unsigned int start = row_crossings[rightward ? j : (j + 1)];
+			unsigned int end = row_crossings[rightward ? (j + 1) : j];
 
-			const CVertex& vertex = *VIt;
-
-			if(zig_finished)
+			CCurve* curve = waiting[start];
+			if(curve)
 			{
-				zag.m_vertices.push_back(unrotated_vertex(vertex));
-				if(v_index == zag_end_index)
-				{
-					zag_finished = true;
-					break;
-				}
-			}
-			else if(zig_started)
-			{
-				zig.m_vertices.push_back(unrotated_vertex(vertex));
-				if(v_index == end_index)
-				{
-					zig_finished = true;
-					if(v_index == zag_end_index)
-					{
-						zag_finished = true;
-						break;
-					}
-					zag.m_vertices.push_back(unrotated_vertex(vertex));
-				}
+				// follow the curve up from the end of the row below
+				unsigned int below = down_crossing(start);
+				add_boundary(*curve, below, m_crossings[below].m_up, true);
 			}
 			else
 			{
-				if(v_index == start_index)
+				m_curve_list.push_back(CCurve());
+				curve = &(m_curve_list.back());
+
+				// if the curve goes down from the start of the row, and comes back up to this row, it is the bottom of a dip; go round it first
+				// unless it is flat and comes back to the end of this row, like the bottom of the area on the first row
+				unsigned int below = down_crossing(start);
+				if(m_crossings[below].m_row == row && (below != end || boundary_min_y(start, !m_crossings[start].m_up) < row_y(row) - 0.002 * m_one_over_units))
 				{
-					zig.m_vertices.push_back(unrotated_vertex(vertex));
-					zig_started = true;
+					add_point(*curve, crossing_point(below));
+					add_boundary(*curve, below, m_crossings[start].m_up, true);
 				}
+				else add_point(*curve, crossing_point(start));
 			}
-			v_index++;
+
+			add_point(*curve, crossing_point(end));
+
+			// if the curve goes up from the end of the row, and comes back down to this row, it is the top of a bump; go over it, and finish
+			unsigned int above = up_crossing(end);
+			if(m_crossings[above].m_row == row + 1)waiting[above] = curve;
+			else add_boundary(*curve, end, m_crossings[end].m_up, false);
 		}
+
+		if(m_context.Aborted())return;
+		m_context.AddProgress(row_progress);
 	}
-        
-    if(zig_finished)
-		zigzag_list_for_zigs.push_back(ZigZag(zig, zag));
-}
 
-void make_zig(const CArea &a, double y0, double y)
-{
-	for(std::list<CCurve>::const_iterator It = a.m_curves.begin(); It != a.m_curves.end(); It++)
+	std::list<CCurve>::iterator It = m_curve_list.begin();
+	std::advance(It, num_curves_before);
+	while(It != m_curve_list.end())
 	{
-		const CCurve &curve = *It;
-		make_zig_curve(curve, y0, y);
+		CCurve& curve = *It;
+		if(curve.m_vertices.size() < 2)
+		{
+			// a row of no length, which didn't join on to anything
+			It = m_curve_list.erase(It);
+			continue;
+		}
+		if(CArea::m_fit_arcs)curve.FitArcs();
+		It++;
 	}
 }
-        
-std::list< std::list<ZigZag> > reorder_zig_list_list;
-        
-void add_reorder_zig(ZigZag &zigzag)
+
+// the areas of a split pocket, which the threads take in turn, and the toolpath made for each of them
+class CPocketJobs
 {
-    // look in existing lists
+	const CAreaPocketParams &m_params;
+	std::vector<const CArea*> m_areas;
+	std::vector< std::list<CCurve> > m_toolpaths;
+	std::vector<CAreaProcessContext*> m_contexts;
+	unsigned int m_next;
+	std::mutex m_mutex;
 
-	// see if the zag is part of an existing zig
-	if(zigzag.zag.m_vertices.size() > 1)
+	bool GetNext(unsigned int &index)
 	{
-		const Point& zag_e = zigzag.zag.m_vertices.front().m_p;
-		bool zag_removed = false;
-		for(std::list< std::list<ZigZag> >::iterator It = reorder_zig_list_list.begin(); It != reorder_zig_list_list.end() && !zag_removed; It++)
-		{
-			std::list<ZigZag> &zigzag_list = *It;
-			for(std::list<ZigZag>::iterator It2 = zigzag_list.begin(); It2 != zigzag_list.end() && !zag_removed; It2++)
-			{
-				const ZigZag& z = *It2;
-				for(std::list<CVertex>::const_iterator It3 = z.zig.m_vertices.begin(); It3 != z.zig.m_vertices.end() && !zag_removed; It3++)
-				{
-					const CVertex &v = *It3;
-					if((fabs(zag_e.x - v.m_p.x) < (0.002 * one_over_units)) && (fabs(zag_e.y - v.m_p.y) < (0.002 * one_over_units)))
-					{
-						// remove zag from zigzag
-						zigzag.zag.m_vertices.clear();
-						zag_removed = true;
-					}
-				}
-			}
-		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_next >= m_areas.size())return false;
+		index = m_next++;
+		return true;
 	}
 
-	// see if the zigzag can join the end of an existing list
-	const Point& zig_s = zigzag.zig.m_vertices.front().m_p;
-	for(std::list< std::list<ZigZag> >::iterator It = reorder_zig_list_list.begin(); It != reorder_zig_list_list.end(); It++)
+public:
+	CPocketJobs(const std::list<CArea> &areas, const CAreaPocketParams &params, CAreaProcessContext &context):m_params(params), m_next(0)
 	{
-		std::list<ZigZag> &zigzag_list = *It;
-		const ZigZag& last_zigzag = zigzag_list.back();
-        const Point& e = last_zigzag.zig.m_vertices.back().m_p;
-        if((fabs(zig_s.x - e.x) < (0.002 * one_over_units)) && (fabs(zig_s.y - e.y) < (0.002 * one_over_units)))
+		double single_area_length = 50.0 / areas.size();
+
+		// share the threads out between the jobs, for them to make their offsets on
+		unsigned int max_threads = context.m_max_threads;
+		if(max_threads == 0)max_threads = std::thread::hardware_concurrency();
+		unsigned int job_threads = max_threads / areas.size();
+		if(job_threads == 0)job_threads = 1;
+
+		for(std::list<CArea>::const_iterator It = areas.begin(); It != areas.end(); It++)
 		{
-            zigzag_list.push_back(zigzag);
-			return;
+			m_areas.push_back(&(*It));
+
+			// each job has its own progress and abort flag, but aborting the whole pocket aborts them all
+			CAreaProcessContext* job_context = new CAreaProcessContext(&context);
+			job_context->m_single_area_processing_length = single_area_length;
+			job_context->m_max_threads = job_threads;
+			m_contexts.push_back(job_context);
 		}
+		m_toolpaths.resize(m_areas.size());
 	}
-        
-    // else add a new list
-    std::list<ZigZag> zigzag_list;
-    zigzag_list.push_back(zigzag);
-    reorder_zig_list_list.push_back(zigzag_list);
-}
 
-void reorder_zigs()
-{
-	for(std::list<ZigZag>::iterator It = zigzag_list_for_zigs.begin(); It != zigzag_list_for_zigs.end(); It++)
+	~CPocketJobs()
 	{
-		ZigZag &zigzag = *It;
-        add_reorder_zig(zigzag);
+		for(unsigned int i = 0; i < m_contexts.size(); i++)delete m_contexts[i];
 	}
-        
-	zigzag_list_for_zigs.clear();
 
-	for(std::list< std::list<ZigZag> >::iterator It = reorder_zig_list_list.begin(); It != reorder_zig_list_list.end(); It++)
+	void Run()
 	{
-		std::list<ZigZag> &zigzag_list = *It;
-		if(zigzag_list.size() == 0)continue;
-
-		curve_list_for_zigs->push_back(CCurve());
-		for(std::list<ZigZag>::const_iterator It = zigzag_list.begin(); It != zigzag_list.end();)
+		unsigned int index;
+		while(GetNext(index))
 		{
-			const ZigZag &zigzag = *It;
-			for(std::list<CVertex>::const_iterator It2 = zigzag.zig.m_vertices.begin(); It2 != zigzag.zig.m_vertices.end(); It2++)
-			{
-				if(It2 == zigzag.zig.m_vertices.begin() && It != zigzag_list.begin())continue; // only add the first vertex if doing the first zig
-				const CVertex &v = *It2;
-				curve_list_for_zigs->back().m_vertices.push_back(v);
-			}
-
-			It++;
-			if(It == zigzag_list.end())
-			{
-				for(std::list<CVertex>::const_iterator It2 = zigzag.zag.m_vertices.begin(); It2 != zigzag.zag.m_vertices.end(); It2++)
-				{
-					if(It2 == zigzag.zag.m_vertices.begin())continue; // don't add the first vertex of the zag
-					const CVertex &v = *It2;
-					curve_list_for_zigs->back().m_vertices.push_back(v);
-				}
-			}
+			if(m_contexts[index]->Aborted())continue;
+			m_areas[index]->MakePocketToolpath(m_toolpaths[index], m_params, *m_contexts[index]);
 		}
 	}
-	reorder_zig_list_list.clear();
-}
 
-static void zigzag(const CArea &input_a)
-{
-	if(input_a.m_curves.size() == 0)
+	void GetToolpath(std::list<CCurve> &curve_list)
 	{
-		CArea::m_processing_done += CArea::m_single_area_processing_length;
-		return;
+		// join them in the order of the areas, so the result doesn't depend on which thread finished first
+		for(unsigned int i = 0; i < m_toolpaths.size(); i++)
+			curve_list.splice(curve_list.end(), m_toolpaths[i]);
 	}
-    
-    one_over_units = 1 / CArea::m_units;
-    
-	CArea a(input_a);
-    rotate_area(a);
-    
-    CBox2D b;
-	a.GetBox(b);
-    
-    double x0 = b.MinX() - 1.0;
-    double x1 = b.MaxX() + 1.0;
+};
 
-    double height = b.MaxY() - b.MinY();
-    int num_steps = int(height / stepover_for_pocket + 1);
-    double y = b.MinY();// + 0.1 * one_over_units;
-    Point null_point(0, 0);
-	rightward_for_zigs = true;
-
-	if(CArea::m_please_abort)return;
-
-	double step_percent_increment = 0.8 * CArea::m_single_area_processing_length / num_steps;
-
-	for(int i = 0; i<num_steps; i++)
-	{
-		double y0 = y;
-		y = y + stepover_for_pocket;
-		Point p0(x0, y0);
-		Point p1(x0, y);
-		Point p2(x1, y);
-		Point p3(x1, y0);
-		CCurve c;
-		c.m_vertices.push_back(CVertex(0, p0, null_point, 0));
-		c.m_vertices.push_back(CVertex(0, p1, null_point, 0));
-		c.m_vertices.push_back(CVertex(0, p2, null_point, 1));
-		c.m_vertices.push_back(CVertex(0, p3, null_point, 0));
-		c.m_vertices.push_back(CVertex(0, p0, null_point, 1));
-		CArea a2;
-		a2.m_curves.push_back(c);
-		a2.Intersect(a);
-		make_zig(a2, y0, y);
-		rightward_for_zigs = !rightward_for_zigs;
-		if(CArea::m_please_abort)return;
-		CArea::m_processing_done += step_percent_increment;
-	}
-
-	reorder_zigs();
-	CArea::m_processing_done += 0.2 * CArea::m_single_area_processing_length;
+static void RunPocketJobs(CPocketJobs* jobs)
+{
+	jobs->Run();
 }
 
 void CArea::SplitAndMakePocketToolpath(std::list<CCurve> &curve_list, const CAreaPocketParams &params)const
 {
-	CArea::m_processing_done = 0.0;
+	SplitAndMakePocketToolpath(curve_list, params, m_default_context);
+}
+
+void CArea::SplitAndMakePocketToolpath(std::list<CCurve> &curve_list, const CAreaPocketParams &params, CAreaProcessContext &context)const
+{
+	context.SetProgress(0.0);
 
-	double save_units = CArea::m_units;
-	CArea::m_units = 1.0;
 	std::list<CArea> areas;
-	m_split_processing_length = 50.0; // jump to 50 percent after split
-	m_set_processing_length_in_split = true;
-	Split(areas);
-	m_set_processing_length_in_split = false;
-	CArea::m_processing_done = m_split_processing_length;
-	CArea::m_units = save_units;
+	context.m_split_processing_length = 50.0; // jump to 50 percent after split
+	context.m_set_processing_length_in_split = true;
+	Split(areas, &context);
+	context.m_set_processing_length_in_split = false;
+	context.SetProgress(context.m_split_processing_length);
 
 	if(areas.size() == 0)return;
+	if(context.Aborted())return;
 
-	double single_area_length = 50.0 / areas.size();
+	CPocketJobs jobs(areas, params, context);
 
-	for(std::list<CArea>::iterator It = areas.begin(); It != areas.end(); It++)
-	{
-		CArea::m_single_area_processing_length = single_area_length;
-		CArea &ar = *It;
-		ar.MakePocketToolpath(curve_list, params);
-	}
+	unsigned int num_threads = context.m_max_threads;
+	if(num_threads == 0)num_threads = std::thread::hardware_concurrency();
+	if(num_threads > areas.size())num_threads = areas.size();
+
+	// the calling thread does jobs too
+	std::vector<std::thread> threads;
+	for(unsigned int i = 1; i < num_threads; i++)
+		threads.push_back(std::thread(RunPocketJobs, &jobs));
+	jobs.Run();
+	for(unsigned int i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	if(context.Aborted())return;
+	jobs.GetToolpath(curve_list);
 }
 
 void CArea::MakePocketToolpath(std::list<CCurve> &curve_list, const CAreaPocketParams &params)const
 {
-	double radians_angle = params.zig_angle * PI / 180;
-	sin_angle_for_zigs = sin(-radians_angle);
-	cos_angle_for_zigs = cos(-radians_angle);
-	sin_minus_angle_for_zigs = sin(radians_angle);
-	cos_minus_angle_for_zigs = cos(radians_angle);
-	stepover_for_pocket = params.stepover;
+	MakePocketToolpath(curve_list, params, m_default_context);
+}
 
+void CArea::MakePocketToolpath(std::list<CCurve> &curve_list, const CAreaPocketParams &params, CAreaProcessContext &context)const
+{
 	CArea a_offset = *this;
 	double current_offset = params.tool_radius + params.extra_offset;
 
@@ -493,32 +571,36 @@ void CArea::MakePocketToolpath(std::list<CCurve> &curve_list, const CAreaPocketP
 
 	if(params.mode == ZigZagPocketMode || params.mode == ZigZagThenSingleOffsetPocketMode)
 	{
-		curve_list_for_zigs = &curve_list;
-		zigzag(a_offset);
+		CZigZagger zig_zagger(curve_list, params, context);
+		zig_zagger.zigzag(a_offset);
 	}
 	else if(params.mode == SpiralPocketMode)
 	{
 		std::list<CArea> m_areas;
-		a_offset.Split(m_areas);
-		if(CArea::m_please_abort)return;
+		a_offset.Split(m_areas, &context);
+		if(context.Aborted())return;
 		if(m_areas.size() == 0)
 		{
-			CArea::m_processing_done += CArea::m_single_area_processing_length;
+			context.AddProgress(context.m_single_area_processing_length);
 			return;
 		}
 
-		CArea::m_single_area_processing_length /= m_areas.size();
+		context.m_single_area_processing_length /= m_areas.size();
 
 		for(std::list<CArea>::iterator It = m_areas.begin(); It != m_areas.end(); It++)
 		{
 			CArea &a2 = *It;
-			a2.MakeOnePocketCurve(curve_list, params);
+			a2.MakeOnePocketCurve(curve_list, params, context);
 		}
 	}
+	else if(params.mode == AdaptivePocketMode)
+	{
+		a_offset.MakeAdaptivePocketCurves(curve_list, params, context);
+	}
 
-	if(params.mode == SingleOffsetPocketMode || params.mode == ZigZagThenSingleOffsetPocketMode)
+	if(params.mode == SingleOffsetPocketMode || params.mode == ZigZagThenSingleOffsetPocketMode || params.mode == AdaptivePocketMode)
 	{
-		// add the single offset too
+		// add the single offset too, for the adaptive pocket it is the finishing pass
 		for(std::list<CCurve>::iterator It = a_offset.m_curves.begin(); It != a_offset.m_curves.end(); It++)
 		{
 			CCurve& curve = *It;
@@ -527,7 +609,7 @@ void CArea::MakePocketToolpath(std::list<CCurve> &curve_list, const CAreaPocketP
 	}
 }
 
-void CArea::Split(std::list<CArea> &m_areas)const
+void CArea::Split(std::list<CArea> &m_areas, CAreaProcessContext* context)const
 {
 	if(HolesLinked())
 	{
@@ -541,9 +623,9 @@ void CArea::Split(std::list<CArea> &m_areas)const
 	else
 	{
 		CArea a = *this;
-		a.Reorder();
+		a.Reorder(context);
 
-		if(CArea::m_please_abort)return;
+		if(context && context->Aborted())return;
 
 		for(std::list<CCurve>::const_iterator It = a.m_curves.begin(); It != a.m_curves.end(); It++)
 		{
@@ -586,8 +668,89 @@ eOverlapType GetOverlapType(const CCurve& c1, const CCurve& c2)
 	return GetOverlapType(a1, a2);
 }
 
+static bool BoxesOverlap(const CBox2D& b1, const CBox2D& b2)
+{
+	if(b1.m_minxy.x > b2.m_maxxy.x + Point::tolerance || b2.m_minxy.x > b1.m_maxxy.x + Point::tolerance)return false;
+	if(b1.m_minxy.y > b2.m_maxxy.y + Point::tolerance || b2.m_minxy.y > b1.m_maxxy.y + Point::tolerance)return false;
+	return true;
+}
+
+static bool CanTestByPoints(const CArea& a)
+{
+	// the booleans throw away curves with no area, so leave those to them
+	if(a.m_curves.size() == 0)return false;
+	for(std::list<CCurve>::const_iterator It = a.m_curves.begin(); It != a.m_curves.end(); It++)
+	{
+		const CCurve& curve = *It;
+		if(curve.m_vertices.size() < 2 || !curve.IsClosed())return false;
+		if(fabs(curve.GetArea()) < Point::tolerance * Point::tolerance)return false;
+	}
+	return true;
+}
+
+static void GetAreaSpans(const CArea& a, std::vector<Span> &spans)
+{
+	std::list<Span> span_list;
+	for(std::list<CCurve>::const_iterator It = a.m_curves.begin(); It != a.m_curves.end(); It++)
+	{
+		It->GetSpans(span_list);
+	}
+	spans.assign(span_list.begin(), span_list.end());
+}
+
+static int NumCurvesInside(const CArea& a, const CAreaInsideIndex& index)
+{
+	// counts the curves of a with a point inside the other area
+	// only used when no curves cross, so one point tells for the whole curve
+	int num_inside = 0;
+	for(std::list<CCurve>::const_iterator It = a.m_curves.begin(); It != a.m_curves.end(); It++)
+	{
+		const CCurve& curve = *It;
+		std::list<CVertex>::const_iterator VIt = curve.m_vertices.begin();
+		Point p0 = VIt->m_p;
+		VIt++;
+		if(index.IsInside(Span(p0, *VIt).MidParam(0.5)))num_inside++;
+	}
+	return num_inside;
+}
+
 eOverlapType GetOverlapType(const CArea& a1, const CArea& a2)
 {
+	if(CanTestByPoints(a1) && CanTestByPoints(a2))
+	{
+		CBox2D box1, box2;
+		a1.GetBox(box1);
+		a2.GetBox(box2);
+		if(!BoxesOverlap(box1, box2))return eSiblings;
+
+		std::vector<Span> spans1, spans2;
+		GetAreaSpans(a1, spans1);
+		GetAreaSpans(a2, spans2);
+		std::vector<CSpanIntersection> intersections;
+		IntersectSpans(spans1, spans2, intersections);
+
+		if(intersections.size() == 0)
+		{
+			// each curve is all inside, or all outside, the other area
+			// a1 is inside a2, if all its curves are inside a2 and none of a2's curves, such as its holes, are inside a1
+			int num_inside1 = NumCurvesInside(a1, CAreaInsideIndex(a2));
+			int num_inside2 = NumCurvesInside(a2, CAreaInsideIndex(a1));
+
+			if(num_inside2 == 0)
+			{
+				if(num_inside1 == 0)return eSiblings;
+				if(num_inside1 == (int)a1.m_curves.size())return eInside;
+			}
+			else if(num_inside1 == 0 && num_inside2 == (int)a2.m_curves.size())
+			{
+				return eOutside;
+			}
+			return eCrossing;
+		}
+
+		// curves which touch or cross are left to the booleans
+	}
+
 	CArea A1(a1);
 
 	A1.Subtract(a2);
@@ -615,24 +778,12 @@ eOverlapType GetOverlapType(const CArea& a1, const CArea& a2)
 
 bool IsInside(const Point& p, const CCurve& c)
 {
-	CArea a;
-	a.m_curves.push_back(c);
-	return IsInside(p, a);
+	return CAreaInsideIndex(c).IsInside(p);
 }
 
 bool IsInside(const Point& p, const CArea& a)
 {
-	CArea a2;
-	CCurve c;
-	c.m_vertices.push_back(CVertex(Point(p.x - 0.01, p.y - 0.01)));
-	c.m_vertices.push_back(CVertex(Point(p.x + 0.01, p.y - 0.01)));
-	c.m_vertices.push_back(CVertex(Point(p.x + 0.01, p.y + 0.01)));
-	c.m_vertices.push_back(CVertex(Point(p.x - 0.01, p.y + 0.01)));
-	c.m_vertices.push_back(CVertex(Point(p.x - 0.01, p.y - 0.01)));
-	a2.m_curves.push_back(c);
-	a2.Intersect(a);
-	if(fabs(a2.GetArea()) < 0.0004)return false;
-	return true;
+	return CAreaInsideIndex(a).IsInside(p);
 }
 
 void CArea::SpanIntersections(const Span& span, std::list<Point> &pts)const
@@ -672,22 +823,40 @@ void CArea::CurveIntersections(const CCurve& curve, std::list<Point> &pts)const
 	// this returns all the intersections of this area with the given curve, ordered along the curve
 	std::list<Span> spans;
 	curve.GetSpans(spans);
-	for(std::list<Span>::iterator It = spans.begin(); It != spans.end(); It++)
+	std::vector<Span> curve_spans(spans.begin(), spans.end());
+
+	spans.clear();
+	for(std::list<CCurve>::const_iterator It = m_curves.begin(); It != m_curves.end(); It++)
 	{
-		Span& span = *It;
-		std::list<Point> pts2;
-		SpanIntersections(span, pts2);
-		for(std::list<Point>::iterator It = pts2.begin(); It != pts2.end(); It++)
+		It->GetSpans(spans);
+	}
+	std::vector<Span> area_spans(spans.begin(), spans.end());
+
+	std::vector<CSpanIntersection> intersections;
+	IntersectSpans(curve_spans, area_spans, intersections);
+
+	// order them along the curve, by span, then along the span
+	std::multimap<std::pair<int, double>, Point> ordered_points;
+	for(std::vector<CSpanIntersection>::iterator It = intersections.begin(); It != intersections.end(); It++)
+	{
+		CSpanIntersection &intersection = *It;
+		double t;
+		if(curve_spans[intersection.m_a].On(intersection.m_p, &t))
 		{
-			Point &pt = *It;
-			if(pts.size() == 0)
-			{
-				pts.push_back(pt);
-			}
-			else
-			{
-				if(pt != pts.back())pts.push_back(pt);
-			}
+			ordered_points.insert(std::make_pair(std::make_pair(intersection.m_a, t), intersection.m_p));
+		}
+	}
+
+	for(std::multimap<std::pair<int, double>, Point>::iterator It = ordered_points.begin(); It != ordered_points.end(); It++)
+	{
+		Point &pt = It->second;
+		if(pts.size() == 0)
+		{
+			pts.push_back(pt);
+		}
+		else
+		{
+			if(pt != pts.back())pts.push_back(pt);
 		}
 	}
 }
@@ -717,11 +886,20 @@ void CArea::InsideCurves(const CCurve& curve, std::list<CCurve> &curves_inside)c
 	curve.ExtractSeparateCurves(pts, separate_curves);
 
 	//3. if the midpoint of a seperate curve lies in a1, then we return it.
+	std::vector<Point> mid_points;
 	for(std::list<CCurve>::iterator It = separate_curves.begin(); It != separate_curves.end(); It++)
 	{
 		CCurve &curve = *It;
 		double length = curve.Perim();
-		Point mid_point = curve.PerimToPoint(length * 0.5);
-		if(IsInside(mid_point, *this))curves_inside.push_back(curve);
+		mid_points.push_back(curve.PerimToPoint(length * 0.5));
+	}
+
+	std::vector<bool> inside;
+	CAreaInsideIndex(*this).IsInside(mid_points, inside);
+
+	unsigned int i = 0;
+	for(std::list<CCurve>::iterator It = separate_curves.begin(); It != separate_curves.end(); It++, i++)
+	{
+		if(inside[i])curves_inside.push_back(*It);
 	}
 }
@@ -7,12 +7,15 @@
 
 #include "Curve.h"
 
+#include <mutex>
+
 enum PocketMode
 {
 	SpiralPocketMode,
 	ZigZagPocketMode,
 	SingleOffsetPocketMode,
 	ZigZagThenSingleOffsetPocketMode,
+	AdaptivePocketMode, // never cuts further into the stock than the stepover, across the tool's direction, except where it goes down, and in gaps too narrow for that
 };
 
 struct CAreaPocketParams
@@ -35,6 +38,33 @@ struct CAreaPocketParams
 	}
 };
 
+// the progress and abort flag of one pocketing job, and the working values used to calculate the progress.
+// each job has its own, so several pockets can be made at the same time on different threads.
+// a job which is split into smaller jobs gives each of them a context with this one as the parent;
+// their progress is added to the parent's and aborting the parent aborts them too.
+class CAreaProcessContext
+{
+	CAreaProcessContext* m_parent;
+	std::mutex m_mutex; // for the children adding their progress
+
+public:
+	double m_processing_done; // 0.0 to 100.0, another thread may read this
+	volatile bool m_please_abort; // another thread sets this, to tell the job to finish with no result.
+	double m_single_area_processing_length;
+	double m_after_MakeOffsets_length;
+	double m_MakeOffsets_increment;
+	double m_split_processing_length;
+	bool m_set_processing_length_in_split;
+	unsigned int m_max_threads; // for SplitAndMakePocketToolpath and the spiral pocket's offsets; 0 to use all the processors, 1 to do everything on the calling thread
+
+	CAreaProcessContext(CAreaProcessContext* parent = NULL);
+
+	void Reset();
+	bool Aborted()const;
+	void AddProgress(double length);
+	void SetProgress(double done);
+};
+
 class CArea
 {
 public:
@@ -42,13 +72,9 @@ public:
 	static double m_accuracy;
 	static double m_units; // 1.0 for mm, 25.4 for inches. All points are multiplied by this before going to the engine
 	static bool m_fit_arcs;
-	static double m_processing_done; // 0.0 to 100.0, set inside MakeOnePocketCurve
-	static double m_single_area_processing_length;
-	static double m_after_MakeOffsets_length;
-	static double m_MakeOffsets_increment;
-	static double m_split_processing_length;
-	static bool m_set_processing_length_in_split;
-	static bool m_please_abort; // the user sets this from another thread, to tell MakeOnePocketCurve to finish with no result.
+	static CAreaProcessContext m_default_context; // used by the functions which aren't given a context
+	static double &m_processing_done; // m_default_context's, 0.0 to 100.0, set inside MakeOnePocketCurve
+	static volatile bool &m_please_abort; // m_default_context's, the user sets this from another thread, to tell MakeOnePocketCurve to finish with no result.
 
 	void append(const CCurve& curve);
 	void Subtract(const CArea& a2);
@@ -61,13 +87,17 @@ public:
 	void FitArcs();
 	unsigned int num_curves(){return m_curves.size();}
 	Point NearestPoint(const Point& p)const;
-	void GetBox(CBox2D &box);
-	void Reorder();
+	void GetBox(CBox2D &box)const;
+	void Reorder(CAreaProcessContext* context = NULL);
 	void MakePocketToolpath(std::list<CCurve> &toolpath, const CAreaPocketParams &params)const;
+	void MakePocketToolpath(std::list<CCurve> &toolpath, const CAreaPocketParams &params, CAreaProcessContext &context)const;
 	void SplitAndMakePocketToolpath(std::list<CCurve> &toolpath, const CAreaPocketParams &params)const;
+	void SplitAndMakePocketToolpath(std::list<CCurve> &toolpath, const CAreaPocketParams &params, CAreaProcessContext &context)const;
 	void MakeOnePocketCurve(std::list<CCurve> &curve_list, const CAreaPocketParams &params)const;
+	void MakeOnePocketCurve(std::list<CCurve> &curve_list, const CAreaPocketParams &params, CAreaProcessContext &context)const;
+	void MakeAdaptivePocketCurves(std::list<CCurve> &curve_list, const CAreaPocketParams &params, CAreaProcessContext &context)const;
 	static bool HolesLinked();
-	void Split(std::list<CArea> &m_areas)const;
+	void Split(std::list<CArea> &m_areas, CAreaProcessContext* context = NULL)const;
 	double GetArea(bool always_add = false)const;
 	void SpanIntersections(const Span& span, std::list<Point> &pts)const; 
 	void CurveIntersections(const CCurve& curve, std::list<Point> &pts)const; 
@@ -0,0 +1,704 @@
+// AreaAdaptive.cpp
+// Copyright 2011, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+// the adaptive pocket: the tool goes along the edge of the stock it hasn't cut yet, turning into it or away from it at each step,
+// so it never cuts further into the stock, across its direction, than the stepover.
+// the stock is kept on the tool's left, for climb milling, except for a pass which can only get at the stock with it on the right.
+// the stock is kept as a grid of cells, with a count of the uncut cells in each block of cells, so the blocks with nothing left in them are skipped
+
+#include "Area.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static const int MaxCells = 2000000; // the cells are made bigger for a big area
+static const int BlockBits = 3; // a block is 8 by 8 cells
+static const int BlockSize = 1 << BlockBits;
+static const unsigned char CellStock = 1; // not cut yet, and the tool can get to it
+static const unsigned char CellAllowed = 2; // the tool's centre can go anywhere in the cell
+static const int TurnSamples = 8; // directions tried, from turning fully into the stock to turning fully away from it
+static const int BisectSteps = 6;
+static const double MaxTurn = PI * 0.5; // the most the tool turns in one step
+
+// where an edge of the area crosses the middle of a row of cells
+class CAdaptiveCrossing
+{
+public:
+	int m_row;
+	double m_x;
+	int m_dir; // 1 if the edge goes up, -1 if it goes down
+
+	CAdaptiveCrossing(int row, double x, int dir):m_row(row), m_x(x), m_dir(dir){}
+	bool operator<(const CAdaptiveCrossing& c)const{return (m_row != c.m_row) ? (m_row < c.m_row) : (m_x < c.m_x);}
+};
+
+class CAdaptiveClearer
+{
+	CAreaProcessContext &m_context;
+	std::list<CCurve> &m_curve_list;
+	double m_radius; // the tool's
+	double m_width; // the most the tool cuts into the stock, across its direction
+	double m_step;
+	double m_h; // the width of a cell
+	double m_x0, m_y0; // the corner of the grid
+	int m_nx, m_ny;
+	int m_bnx, m_bny;
+	std::vector<unsigned char> m_cells;
+	std::vector<int> m_block_stock; // how many uncut cells there are in each block
+	std::vector<float> m_depth; // how many cells each allowed cell is from the nearest cell which isn't allowed
+	int m_stock_left;
+	double m_progress_per_cell;
+	CCurve* m_curve; // the curve being made, or NULL before the first one
+	Point m_pos;
+	Point m_dir;
+	int m_side; // 1 for the stock on the left of the tool, -1 for the stock on the right
+	int m_pass_cut; // cells cut since the last link
+	int m_idle_steps; // steps in a row which cut nothing
+	int m_max_idle_steps;
+
+	Point CellCentre(int i, int j)const{return Point(m_x0 + (i + 0.5) * m_h, m_y0 + (j + 0.5) * m_h);}
+	bool Allowed(const Point& p)const;
+	void GetCellRange(const Point& pmin, const Point& pmax, int &i0, int &j0, int &i1, int &j1)const;
+	void Fill(const CArea& area, unsigned char bit);
+	void MakeDepths();
+	int StockInDisk(const Point& c, const Point& dir, double* engagement)const;
+	int Cut(const Point& p0, const Point& p1);
+	void ClearCell(int index);
+	bool NearestStock(const Point& p, int &si, int &sj)const;
+	bool ClearPath(const Point& p0, const Point& p1)const;
+	bool FindClearStart(const Point& s, Point& start, Point& dir, int &side);
+	bool FindEntry(const Point& s, Point& entry)const;
+	bool TryTurn(double angle, Point& p, Point& dir, int &count)const;
+	bool Step(bool force);
+	void MoveTo(const Point& p);
+	void GoTo(const Point& p);
+	void SpiralOut();
+	bool Link(int &si, int &sj);
+
+public:
+	CAdaptiveClearer(std::list<CCurve> &curve_list, const CAreaPocketParams &params, CAreaProcessContext &context);
+
+	void Clear(const CArea &a_offset);
+};
+
+CAdaptiveClearer::CAdaptiveClearer(std::list<CCurve> &curve_list, const CAreaPocketParams &params, CAreaProcessContext &context):m_context(context), m_curve_list(curve_list), m_curve(NULL), m_pos(0, 0), m_dir(1, 0), m_side(1), m_pass_cut(0), m_idle_steps(0)
+{
+	m_radius = params.tool_radius;
+	m_width = params.stepover;
+}
+
+bool CAdaptiveClearer::Allowed(const Point& p)const
+{
+	int i = (int)floor((p.x - m_x0) / m_h);
+	int j = (int)floor((p.y - m_y0) / m_h);
+	if(i < 0 || j < 0 || i >= m_nx || j >= m_ny)return false;
+	return (m_cells[j * m_nx + i] & CellAllowed) != 0;
+}
+
+void CAdaptiveClearer::GetCellRange(const Point& pmin, const Point& pmax, int &i0, int &j0, int &i1, int &j1)const
+{
+	// the cells whose centres might be in the box, clipped to the grid
+	i0 = std::max(0, (int)floor((pmin.x - m_x0) / m_h));
+	j0 = std::max(0, (int)floor((pmin.y - m_y0) / m_h));
+	i1 = std::min(m_nx - 1, (int)floor((pmax.x - m_x0) / m_h));
+	j1 = std::min(m_ny - 1, (int)floor((pmax.y - m_y0) / m_h));
+}
+
+void CAdaptiveClearer::Fill(const CArea& area, unsigned char bit)
+{
+	// sets the bit in the cells whose centres are inside the area, a row at a time, between the crossings of the area's edges
+	std::vector<CAdaptiveCrossing> crossings;
+	for(std::list<CCurve>::const_iterator It = area.m_curves.begin(); It != area.m_curves.end(); It++)
+	{
+		CCurve curve(*It);
+		curve.UnFitArcs();
+		const Point* prev = NULL;
+		for(std::list<CVertex>::const_iterator VIt = curve.m_vertices.begin(); VIt != curve.m_vertices.end(); VIt++)
+		{
+			const Point& p = VIt->m_p;
+			if(prev && prev->y != p.y)
+			{
+				bool up = p.y > prev->y;
+				const Point& low = up ? *prev : p;
+				const Point& high = up ? p : *prev;
+				double dxdy = (high.x - low.x) / (high.y - low.y);
+				for(int row = std::max(0, (int)ceil((low.y - m_y0) / m_h - 0.5)); row < m_ny; row++)
+				{
+					double y = m_y0 + (row + 0.5) * m_h;
+					if(y < low.y)continue;
+					if(y >= high.y)break;
+					crossings.push_back(CAdaptiveCrossing(row, low.x + (y - low.y) * dxdy, up ? 1 : -1));
+				}
+			}
+			prev = &p;
+		}
+	}
+
+	std::sort(crossings.begin(), crossings.end());
+
+	int winding = 0;
+	for(unsigned int k = 0; k + 1 < crossings.size(); k++)
+	{
+		const CAdaptiveCrossing& c0 = crossings[k];
+		const CAdaptiveCrossing& c1 = crossings[k + 1];
+		winding += c0.m_dir;
+		if(c1.m_row != c0.m_row)
+		{
+			winding = 0;
+			continue;
+		}
+		if(winding == 0)continue;
+		int i0 = std::max(0, (int)ceil((c0.m_x - m_x0) / m_h - 0.5));
+		int i1 = std::min(m_nx, (int)ceil((c1.m_x - m_x0) / m_h - 0.5));
+		for(int i = i0; i < i1; i++)m_cells[c0.m_row * m_nx + i] |= bit;
+	}
+}
+
+void CAdaptiveClearer::MakeDepths()
+{
+	// a chamfer distance, forwards then backwards over the grid; the cells round the edge of the grid are never allowed
+	const float big = 1.0e30f;
+	const float diagonal = 1.41421356f;
+	m_depth.resize(m_cells.size());
+	for(unsigned int i = 0; i < m_cells.size(); i++)m_depth[i] = (m_cells[i] & CellAllowed) ? big : 0.0f;
+
+	for(int j = 1; j < m_ny - 1; j++)
+	{
+		for(int i = 1; i < m_nx - 1; i++)
+		{
+			float &d = m_depth[j * m_nx + i];
+			if(d == 0.0f)continue;
+			d = std::min(d, m_depth[j * m_nx + i - 1] + 1.0f);
+			d = std::min(d, m_depth[(j - 1) * m_nx + i] + 1.0f);
+			d = std::min(d, m_depth[(j - 1) * m_nx + i - 1] + diagonal);
+			d = std::min(d, m_depth[(j - 1) * m_nx + i + 1] + diagonal);
+		}
+	}
+
+	for(int j = m_ny - 2; j > 0; j--)
+	{
+		for(int i = m_nx - 2; i > 0; i--)
+		{
+			float &d = m_depth[j * m_nx + i];
+			if(d == 0.0f)continue;
+			d = std::min(d, m_depth[j * m_nx + i + 1] + 1.0f);
+			d = std::min(d, m_depth[(j + 1) * m_nx + i] + 1.0f);
+			d = std::min(d, m_depth[(j + 1) * m_nx + i + 1] + diagonal);
+			d = std::min(d, m_depth[(j + 1) * m_nx + i - 1] + diagonal);
+		}
+	}
+}
+
+int CAdaptiveClearer::StockInDisk(const Point& c, const Point& dir, double* engagement)const
+{
+	// how many uncut cells the tool would be cutting at c, and how far it would be cutting into them, across dir, with the stock on m_side
+	int count = 0;
+	double min_lateral = m_radius;
+	double r2 = m_radius * m_radius;
+	int i0, j0, i1, j1;
+	GetCellRange(c - Point(m_radius, m_radius), c + Point(m_radius, m_radius), i0, j0, i1, j1);
+
+	for(int bj = j0 >> BlockBits; bj <= (j1 >> BlockBits); bj++)
+	{
+		for(int bi = i0 >> BlockBits; bi <= (i1 >> BlockBits); bi++)
+		{
+			if(m_block_stock[bj * m_bnx + bi] == 0)continue;
+			int cj1 = std::min(j1, ((bj + 1) << BlockBits) - 1);
+			int ci1 = std::min(i1, ((bi + 1) << BlockBits) - 1);
+			for(int j = std::max(j0, bj << BlockBits); j <= cj1; j++)
+			{
+				for(int i = std::max(i0, bi << BlockBits); i <= ci1; i++)
+				{
+					if(!(m_cells[j * m_nx + i] & CellStock))continue;
+					Point v = CellCentre(i, j) - c;
+					if(v * v > r2)continue;
+					count++;
+					double lateral = (v * ~dir) * m_side;
+					if(lateral < min_lateral)min_lateral = lateral;
+				}
+			}
+		}
+	}
+
+	if(engagement)*engagement = (count > 0) ? (m_radius - min_lateral + 0.5 * m_h) : 0.0; // to the edge of the cell
+	return count;
+}
+
+void CAdaptiveClearer::ClearCell(int index)
+{
+	m_cells[index] &= ~CellStock;
+	int i = index % m_nx;
+	int j = index / m_nx;
+	m_block_stock[(j >> BlockBits) * m_bnx + (i >> BlockBits)]--;
+	m_stock_left--;
+}
+
+int CAdaptiveClearer::Cut(const Point& p0, const Point& p1)
+{
+	// takes the cells the tool goes over, going from p0 to p1, out of the stock
+	Point v = p1 - p0;
+	double len2 = v * v;
+	double r2 = m_radius * m_radius;
+	int i0, j0, i1, j1;
+	GetCellRange(Point(std::min(p0.x, p1.x) - m_radius, std::min(p0.y, p1.y) - m_radius), Point(std::max(p0.x, p1.x) + m_radius, std::max(p0.y, p1.y) + m_radius), i0, j0, i1, j1);
+
+	int cut = 0;
+	for(int bj = j0 >> BlockBits; bj <= (j1 >> BlockBits); bj++)
+	{
+		for(int bi = i0 >> BlockBits; bi <= (i1 >> BlockBits); bi++)
+		{
+			if(m_block_stock[bj * m_bnx + bi] == 0)continue;
+			int cj1 = std::min(j1, ((bj + 1) << BlockBits) - 1);
+			int ci1 = std::min(i1, ((bi + 1) << BlockBits) - 1);
+			for(int j = std::max(j0, bj << BlockBits); j <= cj1; j++)
+			{
+				for(int i = std::max(i0, bi << BlockBits); i <= ci1; i++)
+				{
+					int index = j * m_nx + i;
+					if(!(m_cells[index] & CellStock))continue;
+					Point w = CellCentre(i, j) - p0;
+					double t = (len2 > 0.0) ? ((w * v) / len2) : 0.0;
+					if(t < 0.0)t = 0.0;
+					else if(t > 1.0)t = 1.0;
+					Point d = w - v * t;
+					if(d * d > r2)continue;
+					ClearCell(index);
+					cut++;
+				}
+			}
+		}
+	}
+
+	m_context.AddProgress(cut * m_progress_per_cell);
+	return cut;
+}
+
+bool CAdaptiveClearer::NearestStock(const Point& p, int &si, int &sj)const
+{
+	// looks in rings of blocks round p, until the rings are further away than the nearest uncut cell found
+	if(m_stock_left <= 0)return false;
+
+	int pbi = std::min(m_bnx - 1, std::max(0, (int)floor((p.x - m_x0) / m_h) >> BlockBits));
+	int pbj = std::min(m_bny - 1, std::max(0, (int)floor((p.y - m_y0) / m_h) >> BlockBits));
+	double best = -1.0;
+	int max_ring = std::max(m_bnx, m_bny);
+
+	for(int ring = 0; ring <= max_ring; ring++)
+	{
+		double ring_dist = (ring - 1) * BlockSize * m_h;
+		if(best >= 0.0 && ring_dist > 0.0 && ring_dist * ring_dist > best)break;
+
+		for(int bj = pbj - ring; bj <= pbj + ring; bj++)
+		{
+			if(bj < 0 || bj >= m_bny)continue;
+			bool edge_row = (bj == pbj - ring || bj == pbj + ring);
+			for(int bi = pbi - ring; bi <= pbi + ring; bi += (edge_row ? 1 : 2 * ring))
+			{
+				if(bi >= 0 && bi < m_bnx && m_block_stock[bj * m_bnx + bi] > 0)
+				{
+					int cj1 = std::min(m_ny, (bj + 1) << BlockBits);
+					int ci1 = std::min(m_nx, (bi + 1) << BlockBits);
+					for(int j = bj << BlockBits; j < cj1; j++)
+					{
+						for(int i = bi << BlockBits; i < ci1; i++)
+						{
+							if(!(m_cells[j * m_nx + i] & CellStock))continue;
+							Point v = CellCentre(i, j) - p;
+							double d2 = v * v;
+							if(best < 0.0 || d2 < best)
+							{
+								best = d2;
+								si = i;
+								sj = j;
+							}
+						}
+					}
+				}
+				if(ring == 0)break;
+			}
+		}
+	}
+
+	return best >= 0.0;
+}
+
+bool CAdaptiveClearer::ClearPath(const Point& p0, const Point& p1)const
+{
+	// the tool can stay down going from p0 to p1, if it stays in the allowed cells and doesn't cut anything on the way
+	double len = p0.dist(p1);
+	if(len > 4 * m_radius)return false;
+	int n = (int)(len / m_h) + 1;
+	for(int i = 1; i <= n; i++)
+	{
+		Point p = p0 + (p1 - p0) * ((double)i / n);
+		if(!Allowed(p))return false;
+		if(StockInDisk(p, m_dir, NULL) > 0)return false;
+	}
+	return true;
+}
+
+bool CAdaptiveClearer::FindClearStart(const Point& s, Point& start, Point& dir, int &side)
+{
+	// a place for the tool near the uncut cell at s, where it doesn't cut anything, and a direction for its first step to cut without cutting too much.
+	// the nearest one to where the tool is, from the nearest ring of places round s which has one.
+	// failing that, the nearest place where it doesn't cut anything, for the first step to cut as little as it can from there, which is better than going down into the stock
+	const int num_tries = 24;
+	const int num_rings = 3;
+	const int num_dirs = 4;
+	Point pos = m_pos;
+	Point pos_dir = m_dir;
+	int pos_side = m_side;
+	double best = -1.0;
+	double best_clear = -1.0;
+	for(int ring = 0; ring < num_rings && best < 0.0; ring++)
+	{
+		for(int k = 0; k < num_tries; k++)
+		{
+			double a = 2 * PI * k / num_tries;
+			Point to_stock(-cos(a), -sin(a));
+			Point p = s - to_stock * (m_radius + 1.5 * m_h + ring * m_step);
+			if(!Allowed(p))continue;
+			if(StockInDisk(p, to_stock, NULL) > 0)continue;
+			double d = p.dist(pos);
+			if(best_clear < 0.0 || d < best_clear)
+			{
+				best_clear = d;
+				if(best < 0.0)
+				{
+					start = p;
+					dir = Point(to_stock.y, -to_stock.x);
+					side = 1;
+				}
+			}
+			if(best >= 0.0 && d >= best)continue;
+
+			// from going past s, with it on the left, to going straight at it; then the same with it on the right
+			m_pos = p;
+			for(m_side = 1; m_side >= -1; m_side -= 2)
+			{
+				int j = 0;
+				for(; j < num_dirs; j++)
+				{
+					m_dir = Point(to_stock.y, -to_stock.x) * m_side;
+					m_dir.Rotate(0.5 * PI * m_side * j / (num_dirs - 1));
+					Point step, step_dir;
+					int count;
+					if(TryTurn(0.0, step, step_dir, count) && count > 0)break;
+				}
+				if(j < num_dirs)
+				{
+					best = d;
+					start = p;
+					dir = m_dir;
+					side = m_side;
+					break;
+				}
+			}
+		}
+	}
+	m_pos = pos;
+	m_dir = pos_dir;
+	m_side = pos_side;
+	return best_clear >= 0.0;
+}
+
+bool CAdaptiveClearer::FindEntry(const Point& s, Point& entry)const
+{
+	// where to go down into the stock, near to the uncut cell at s; the place with the most room round it
+	int i0, j0, i1, j1;
+	GetCellRange(s - Point(m_radius, m_radius), s + Point(m_radius, m_radius), i0, j0, i1, j1);
+	double r2 = m_radius * m_radius;
+	float best = 0.0f;
+	for(int j = j0; j <= j1; j++)
+	{
+		for(int i = i0; i <= i1; i++)
+		{
+			float depth = m_depth[j * m_nx + i];
+			if(depth <= best)continue;
+			Point p = CellCentre(i, j);
+			Point v = p - s;
+			if(v * v > r2)continue;
+			best = depth;
+			entry = p;
+		}
+	}
+	return best > 0.0f;
+}
+
+bool CAdaptiveClearer::TryTurn(double angle, Point& p, Point& dir, int &count)const
+{
+	// false if the tool would go out of the allowed cells, or cut too far into the stock
+	dir = m_dir;
+	dir.Rotate(angle * m_side);
+	p = m_pos + dir * m_step;
+	if(!Allowed(p) || !Allowed(m_pos + dir * (m_step * 0.5)))return false;
+	double engagement;
+	count = StockInDisk(p, dir, &engagement);
+	return engagement <= m_width;
+}
+
+bool CAdaptiveClearer::Step(bool force)
+{
+	// turns as far towards the stock as it can, without cutting too far into it; returns false at the end of the pass
+	Point p, dir;
+	int count = 0;
+	double hi = MaxTurn;
+	double lo = hi;
+	bool found = false;
+	for(int k = 0; k <= TurnSamples; k++)
+	{
+		lo = MaxTurn - 2 * MaxTurn * k / TurnSamples;
+		if(TryTurn(lo, p, dir, count))
+		{
+			found = true;
+			break;
+		}
+		hi = lo;
+	}
+
+	if(found)
+	{
+		if(lo == MaxTurn && count == 0)return false; // there's no stock near enough
+
+		for(int i = 0; lo < hi && i < BisectSteps; i++)
+		{
+			double mid = (lo + hi) * 0.5;
+			Point mid_p, mid_dir;
+			int mid_count;
+			if(TryTurn(mid, mid_p, mid_dir, mid_count))
+			{
+				lo = mid;
+				p = mid_p;
+				dir = mid_dir;
+				count = mid_count;
+			}
+			else hi = mid;
+		}
+	}
+	else
+	{
+		// where the tool is in a gap narrower than it can go in without cutting too much, like a slot, go the way which cuts least
+		if(!force)return false;
+		double best = -1.0;
+		for(int k = 0; k < 2 * TurnSamples; k++)
+		{
+			Point try_dir = m_dir;
+			try_dir.Rotate(PI * k / TurnSamples);
+			Point try_p = m_pos + try_dir * m_step;
+			if(!Allowed(try_p) || !Allowed(m_pos + try_dir * (m_step * 0.5)))continue;
+			double engagement;
+			int try_count = StockInDisk(try_p, try_dir, &engagement);
+			if(try_count == 0)continue;
+			if(best < 0.0 || engagement < best)
+			{
+				best = engagement;
+				p = try_p;
+				dir = try_dir;
+				count = try_count;
+			}
+		}
+		if(best < 0.0)return false;
+	}
+
+	if(count == 0)
+	{
+		m_idle_steps++;
+		if(m_idle_steps > m_max_idle_steps)return false;
+	}
+	else m_idle_steps = 0;
+
+	m_dir = dir;
+	MoveTo(p);
+	return true;
+}
+
+void CAdaptiveClearer::MoveTo(const Point& p)
+{
+	m_curve->m_vertices.push_back(CVertex(p));
+	m_pass_cut += Cut(m_pos, p);
+	m_pos = p;
+}
+
+void CAdaptiveClearer::GoTo(const Point& p)
+{
+	// stays down, if it can go straight there without cutting anything, otherwise starts a new curve
+	if(m_curve && ClearPath(m_pos, p))
+	{
+		MoveTo(p);
+		return;
+	}
+
+	m_curve_list.push_back(CCurve());
+	m_curve = &(m_curve_list.back());
+	m_curve->m_vertices.push_back(CVertex(p));
+	m_pos = p;
+}
+
+void CAdaptiveClearer::SpiralOut()
+{
+	// goes clockwise round and out from where the tool went down, to make a round hole for it to start from, with the stock outside it on the left
+	int i = (int)floor((m_pos.x - m_x0) / m_h);
+	int j = (int)floor((m_pos.y - m_y0) / m_h);
+	double max_radius = std::min(m_radius, (m_depth[j * m_nx + i] - 1.0) * m_h);
+	Point centre = m_pos;
+	Point prev = m_pos;
+	m_dir = Point(1, 0);
+	m_side = 1;
+
+	double angle = 0.0;
+	while(true)
+	{
+		double radius = m_width * angle / (2 * PI);
+		angle += std::min(m_step / std::max(radius, m_width * 0.25), PI / 8);
+		radius = m_width * angle / (2 * PI);
+		if(radius > max_radius)break;
+		Point p = centre + Point(cos(-angle), sin(-angle)) * radius;
+		if(!Allowed(p))break;
+		MoveTo(p);
+		m_dir = p - prev;
+		m_dir.normalize();
+		prev = p;
+		if(m_context.Aborted())return;
+	}
+}
+
+bool CAdaptiveClearer::Link(int &si, int &sj)
+{
+	// goes to the nearest uncut stock, to start the next pass; returns false when there's none left
+	while(NearestStock(m_pos, si, sj))
+	{
+		Point s = CellCentre(si, sj);
+
+		Point start, dir;
+		int side;
+		if(FindClearStart(s, start, dir, side))
+		{
+			GoTo(start);
+			m_dir = dir;
+			m_side = side;
+			return true;
+		}
+
+		Point entry;
+		if(FindEntry(s, entry))
+		{
+			GoTo(entry);
+			SpiralOut();
+			return true;
+		}
+
+		// the tool can't start anywhere near it, so it is left for the finishing pass
+		// without this, the first pass would have no curve to add its moves to
+		ClearCell(sj * m_nx + si);
+		m_context.AddProgress(m_progress_per_cell);
+	}
+	return false;
+}
+
+void CAdaptiveClearer::Clear(const CArea &a_offset)
+{
+	if(a_offset.m_curves.size() == 0)
+	{
+		m_context.AddProgress(m_context.m_single_area_processing_length);
+		return;
+	}
+
+	CBox2D box;
+	a_offset.GetBox(box);
+	double width = box.MaxX() - box.MinX() + 2 * m_radius;
+	double height = box.MaxY() - box.MinY() + 2 * m_radius;
+
+	// small enough cells to measure the engagement to a quarter of the stepover, but no more than MaxCells of them
+	m_h = m_width * 0.25;
+	if(m_h < m_radius * 0.025)m_h = m_radius * 0.025;
+	if(m_h > m_radius * 0.1)m_h = m_radius * 0.1;
+	double num_cells = (width / m_h + 4) * (height / m_h + 4);
+	if(num_cells > MaxCells)m_h *= sqrt(num_cells / MaxCells);
+	m_step = std::max(2 * m_h, m_width * 0.5);
+	m_max_idle_steps = 2; // then it goes straight to the nearest stock
+
+	m_x0 = box.MinX() - m_radius - 2 * m_h;
+	m_y0 = box.MinY() - m_radius - 2 * m_h;
+	m_nx = (int)(width / m_h) + 4;
+	m_ny = (int)(height / m_h) + 4;
+	m_bnx = (m_nx + BlockSize - 1) >> BlockBits;
+	m_bny = (m_ny + BlockSize - 1) >> BlockBits;
+	m_cells.resize(m_nx * m_ny, 0);
+
+	// the tool's centre is kept far enough inside the area for it to go anywhere in a cell whose centre is inside
+	// and the stock is everything the tool can get to from there; what is left by the walls, the finishing pass takes off
+	CArea allowed = a_offset;
+	allowed.Offset(0.75 * m_h);
+	if(m_context.Aborted())return;
+	CArea stock = allowed;
+	stock.Offset(-m_radius);
+	if(m_context.Aborted())return;
+
+	Fill(allowed, CellAllowed);
+	Fill(stock, CellStock);
+	MakeDepths();
+
+	m_block_stock.resize(m_bnx * m_bny, 0);
+	m_stock_left = 0;
+	for(int j = 0; j < m_ny; j++)
+	{
+		for(int i = 0; i < m_nx; i++)
+		{
+			if(!(m_cells[j * m_nx + i] & CellStock))continue;
+			m_block_stock[(j >> BlockBits) * m_bnx + (i >> BlockBits)]++;
+			m_stock_left++;
+		}
+	}
+
+	if(m_context.Aborted())return;
+	m_context.AddProgress(0.1 * m_context.m_single_area_processing_length);
+	m_progress_per_cell = (m_stock_left > 0) ? (0.9 * m_context.m_single_area_processing_length / m_stock_left) : 0.0;
+
+	// start with the place with the most room round it
+	unsigned int deepest = std::max_element(m_depth.begin(), m_depth.end()) - m_depth.begin();
+	m_pos = CellCentre(deepest % m_nx, deepest / m_nx);
+
+	unsigned int num_curves_before = m_curve_list.size();
+	int si, sj;
+	while(Link(si, sj))
+	{
+		m_pass_cut = 0;
+		m_idle_steps = 0;
+		while(Step(m_pass_cut == 0))
+		{
+			if(m_context.Aborted())return;
+		}
+		if(m_context.Aborted())return;
+
+		// the tool can't get to this one
+		int index = sj * m_nx + si;
+		if(m_pass_cut == 0 && (m_cells[index] & CellStock))
+		{
+			ClearCell(index);
+			m_context.AddProgress(m_progress_per_cell);
+		}
+	}
+
+	std::list<CCurve>::iterator It = m_curve_list.begin();
+	std::advance(It, num_curves_before);
+	while(It != m_curve_list.end())
+	{
+		CCurve& curve = *It;
+		if(curve.m_vertices.size() < 2)
+		{
+			// went down, but didn't go anywhere
+			It = m_curve_list.erase(It);
+			continue;
+		}
+		if(CArea::m_fit_arcs)curve.FitArcs();
+		It++;
+	}
+}
+
+void CArea::MakeAdaptivePocketCurves(std::list<CCurve> &curve_list, const CAreaPocketParams &params, CAreaProcessContext &context)const
+{
+	CAdaptiveClearer clearer(curve_list, params, context);
+	clearer.Clear(*this);
+}
@@ -3,7 +3,10 @@
 // implements CArea methods using Angus Johnson's "Clipper"
 
 #include "Area.h"
+#define use_xyz // as clipper.cpp is built, for the arc numbers in Z
 #include "clipper.hpp"
+#include <algorithm>
+#include <map>
 using namespace ClipperLib;
 
 #define TPolygon Path
@@ -18,24 +21,89 @@ class DoubleAreaPoint
 {
 public:
 	double X, Y;
+	cInt Z; // the arcs the point is on, see AddArcToZ
 
-	DoubleAreaPoint(double x, double y){X = x; Y = y;}
-	DoubleAreaPoint(const IntPoint& p){X = (double)(p.X) / Clipper4Factor; Y = (double)(p.Y) / Clipper4Factor;}
-	IntPoint int_point(){return IntPoint((long64)(X * Clipper4Factor), (long64)(Y * Clipper4Factor));}
+	DoubleAreaPoint(double x, double y, cInt z = 0){X = x; Y = y; Z = z;}
+	DoubleAreaPoint(const IntPoint& p){X = (double)(p.X) / Clipper4Factor; Y = (double)(p.Y) / Clipper4Factor; Z = p.Z;}
+	IntPoint int_point(){return IntPoint((long64)(X * Clipper4Factor), (long64)(Y * Clipper4Factor), Z);}
 };
 
-static std::list<DoubleAreaPoint> pts_for_AddVertex;
+// the arcs which the flattened points came from, so that they can be put back into the result, rather than fitted again
+// each point's Z has the numbers of up to two arcs, which start at 1, in its low and high 32 bits
+// arcs with the same centre get the same number, so the join between them isn't kept, they may have different radii
+class CArcCentres
+{
+	std::map< std::pair<double, double>, cInt > m_numbers;
+
+public:
+	std::vector<Point> m_centres; // multiplied by CArea::m_units
+
+	cInt Add(const Point& c)
+	{
+		std::pair<std::map< std::pair<double, double>, cInt >::iterator, bool> inserted = m_numbers.insert(std::make_pair(std::make_pair(c.x, c.y), (cInt)(m_centres.size() + 1)));
+		if(inserted.second)m_centres.push_back(c);
+		return inserted.first->second;
+	}
+	const Point& Centre(cInt arc)const{return m_centres[(unsigned int)(arc - 1)];}
+};
+
+static cInt FirstArc(cInt z){return z & 0xffffffff;}
+static cInt SecondArc(cInt z){return (z >> 32) & 0xffffffff;}
+static bool ZHasArc(cInt z, cInt arc){return arc != 0 && (FirstArc(z) == arc || SecondArc(z) == arc);}
 
-static void AddPoint(const DoubleAreaPoint& p)
+static cInt AddArcToZ(cInt z, cInt arc)
 {
-	pts_for_AddVertex.push_back(p);
+	// if the point is already on two arcs, the new one is left out
+	if(arc == 0 || ZHasArc(z, arc))return z;
+	if(FirstArc(z) == 0)return z | arc;
+	if(SecondArc(z) == 0)return z | (arc << 32);
+	return z;
 }
 
-static void AddVertex(const CVertex& vertex, const CVertex* prev_vertex)
+static cInt AddArcsToZ(cInt z, cInt z_arcs)
 {
+	return AddArcToZ(AddArcToZ(z, FirstArc(z_arcs)), SecondArc(z_arcs));
+}
+
+static cInt CommonArcs(cInt z0, cInt z1)
+{
+	// the arcs which both points are on, so the line between them is on them too
+	cInt z = 0;
+	if(ZHasArc(z1, FirstArc(z0)))z = AddArcToZ(z, FirstArc(z0));
+	if(ZHasArc(z1, SecondArc(z0)))z = AddArcToZ(z, SecondArc(z0));
+	return z;
+}
+
+static void ZFillForIntersection(IntPoint& e1bot, IntPoint& e1top, IntPoint& e2bot, IntPoint& e2top, IntPoint& pt)
+{
+	// a new point where two edges cross is on the arcs of both edges
+	cInt z1 = CommonArcs(e1bot.Z, e1top.Z);
+	cInt z2 = CommonArcs(e2bot.Z, e2top.Z);
+	pt.Z = AddArcsToZ(z1, z2);
+}
+
+static int ArcSegments(double radius, double phit)
+{
+	// how many lines an arc is split into, to get an accuracy of CArea::m_accuracy
+	if(radius <= CArea::m_accuracy)return 1;
+	double dphi=2*acos((radius-CArea::m_accuracy)/radius);
+	int Segments=(int)ceil(fabs(phit)/dphi);
+	if (Segments < 1)
+		Segments=1;
+	if (Segments > 100)
+		Segments=100;
+	return Segments;
+}
+
+// the points are added to the given list, rather than to a static list, so that several threads can use the area functions at once
+// if arcs is given, the points of an arc are marked with a new arc number, which is returned
+static cInt AddVertex(const CVertex& vertex, const CVertex* prev_vertex, std::list<DoubleAreaPoint> &pts_for_AddVertex, double units = CArea::m_units, CArcCentres* arcs = NULL)
+{
+	cInt arc = 0;
+
 	if(vertex.m_type == 0 || prev_vertex == NULL)
 	{
-		AddPoint(DoubleAreaPoint(vertex.m_p.x * CArea::m_units, vertex.m_p.y * CArea::m_units));
+		pts_for_AddVertex.push_back(DoubleAreaPoint(vertex.m_p.x * units, vertex.m_p.y * units));
 	}
 	else
 	{
@@ -46,13 +114,19 @@ static void AddVertex(const CVertex& vertex, const CVertex* prev_vertex)
 		int i;
 		double ang1,ang2,phit;
 
-		dx = (prev_vertex->m_p.x - vertex.m_c.x) * CArea::m_units;
-		dy = (prev_vertex->m_p.y - vertex.m_c.y) * CArea::m_units;
+		if(arcs)
+		{
+			arc = arcs->Add(vertex.m_c * units);
+			if(pts_for_AddVertex.size() > 0)pts_for_AddVertex.back().Z = AddArcToZ(pts_for_AddVertex.back().Z, arc);
+		}
+
+		dx = (prev_vertex->m_p.x - vertex.m_c.x) * units;
+		dy = (prev_vertex->m_p.y - vertex.m_c.y) * units;
 
 		ang1=atan2(dy,dx);
 		if (ang1<0) ang1+=2.0*PI;
-		dx = (vertex.m_p.x - vertex.m_c.x) * CArea::m_units;
-		dy = (vertex.m_p.y - vertex.m_c.y) * CArea::m_units;
+		dx = (vertex.m_p.x - vertex.m_c.x) * units;
+		dy = (vertex.m_p.y - vertex.m_c.y) * units;
 		ang2=atan2(dy,dx);
 		if (ang2<0) ang2+=2.0*PI;
 
@@ -71,46 +145,36 @@ static void AddVertex(const CVertex& vertex, const CVertex* prev_vertex)
 				phit=-(ang2-ang1);
 		}
 
-		//what is the delta phi to get an accurancy of aber
 		double radius = sqrt(dx*dx + dy*dy);
-		dphi=2*acos((radius-CArea::m_accuracy)/radius);
-
-		//set the number of segments
-		if (phit > 0)
-			Segments=(int)ceil(phit/dphi);
-		else
-			Segments=(int)ceil(-phit/dphi);
-
-		if (Segments < 1)
-			Segments=1;
-		if (Segments > 100)
-			Segments=100;
-
+		Segments=ArcSegments(radius, phit);
 		dphi=phit/(Segments);
 
-		double px = prev_vertex->m_p.x * CArea::m_units;
-		double py = prev_vertex->m_p.y * CArea::m_units;
+		double px = prev_vertex->m_p.x * units;
+		double py = prev_vertex->m_p.y * units;
 
 		for (i=1; i<=Segments; i++)
 		{
-			dx = px - vertex.m_c.x * CArea::m_units;
-			dy = py - vertex.m_c.y * CArea::m_units;
+			dx = px - vertex.m_c.x * units;
+			dy = py - vertex.m_c.y * units;
 			phi=atan2(dy,dx);
 
-			double nx = vertex.m_c.x * CArea::m_units + radius * cos(phi-dphi);
-			double ny = vertex.m_c.y * CArea::m_units + radius * sin(phi-dphi);
+			double nx = vertex.m_c.x * units + radius * cos(phi-dphi);
+			double ny = vertex.m_c.y * units + radius * sin(phi-dphi);
 
-			AddPoint(DoubleAreaPoint(nx, ny));
+			pts_for_AddVertex.push_back(DoubleAreaPoint(nx, ny, arc));
 
 			px = nx;
 			py = ny;
 		}
 		}
 	}
+
+	return arc;
 }
 
-static void MakeLoop(const DoubleAreaPoint &pt0, const DoubleAreaPoint &pt1, const DoubleAreaPoint &pt2, double radius)
+static cInt MakeLoop(const DoubleAreaPoint &pt0, const DoubleAreaPoint &pt1, const DoubleAreaPoint &pt2, double radius, std::list<DoubleAreaPoint> &pts_for_AddVertex, CArcCentres &arcs)
 {
+	// returns the arc numbers to add to the point before the loop, if there wasn't one in the list yet
 	Point p0(pt0.X, pt0.Y);
 	Point p1(pt1.X, pt1.Y);
 	Point p2(pt2.X, pt2.Y);
@@ -127,18 +191,64 @@ static void MakeLoop(const DoubleAreaPoint &pt0, const DoubleAreaPoint &pt1, con
 	CVertex v1(arc_dir, p1 + right1 * radius, p1);
 	CVertex v2(0, p2 + right1 * radius, Point(0, 0));
 
-	double save_units = CArea::m_units;
-	CArea::m_units = 1.0;
+	bool was_empty = (pts_for_AddVertex.size() == 0);
+	std::list<DoubleAreaPoint>::iterator before_loop = pts_for_AddVertex.end();
+	if(!was_empty)before_loop--;
+
+	unsigned int size_before = pts_for_AddVertex.size();
+	AddVertex(v1, &v0, pts_for_AddVertex, 1.0);
+	AddVertex(v2, &v1, pts_for_AddVertex, 1.0);
+	bool one_segment_loop = (pts_for_AddVertex.size() - size_before <= 2);
+
+	// the offset of a span is on the span's arcs, with a larger or smaller radius
+	cInt z_before = CommonArcs(pt0.Z, pt1.Z);
+	cInt z_after = CommonArcs(pt1.Z, pt2.Z);
+	cInt z_both = CommonArcs(z_before, z_after);
+	cInt z_loop = z_both;
+	cInt z_loop_start = 0;
+	cInt z_loop_end = z_after;
+	if(z_both == 0)
+	{
+		if(one_segment_loop)
+		{
+			// a small corner, the line round it may be close enough to the arc before or after it
+			z_loop_start = z_after;
+			z_loop_end = AddArcsToZ(z_after, z_before);
+		}
+		else
+		{
+			// the loop is an arc of its own, around the corner, unless the arc before or after it goes on round it, at a tangent corner
+			cInt loop_arc = arcs.Add(p1);
+			z_loop = AddArcToZ(loop_arc, FirstArc(z_before ? z_before : z_after));
+			z_loop_start = z_loop;
+			z_loop_end = AddArcToZ(loop_arc, FirstArc(z_after ? z_after : z_before));
+		}
+		if(!was_empty)before_loop->Z = AddArcsToZ(before_loop->Z, z_loop_start);
+	}
 
-	AddVertex(v1, &v0);
-	AddVertex(v2, &v1);
+	std::list<DoubleAreaPoint>::iterator It = before_loop;
+	if(was_empty)It = pts_for_AddVertex.begin();
+	else It++;
+	for(; It != pts_for_AddVertex.end(); It++)
+	{
+		std::list<DoubleAreaPoint>::iterator Next = It;
+		Next++;
+		if(Next == pts_for_AddVertex.end())It->Z = z_after; // v2
+		else
+		{
+			It->Z = z_loop;
+			Next++;
+			if(Next == pts_for_AddVertex.end())It->Z = AddArcsToZ(z_loop_end, z_after); // the end of v1, where the offset span starts
+		}
+	}
 
-	CArea::m_units = save_units;
+	return was_empty ? z_loop_start : 0;
 }
 
-static void OffsetWithLoops(const TPolyPolygon &pp, TPolyPolygon &pp_new, double inwards_value)
+static void OffsetWithLoops(const TPolyPolygon &pp, TPolyPolygon &pp_new, double inwards_value, CArcCentres &arcs)
 {
 	Clipper c;
+	c.ZFillFunction(ZFillForIntersection);
 
 	bool inwards = (inwards_value > 0);
 	bool reverse = false;
@@ -159,6 +269,8 @@ static void OffsetWithLoops(const TPolyPolygon &pp, TPolyPolygon &pp_new, double
 		reverse = true;
 	}
 
+	std::list<DoubleAreaPoint> pts_for_AddVertex;
+
 	for(unsigned int i = 0; i < pp.size(); i++)
 	{
 		const TPolygon& p = pp[i];
@@ -167,19 +279,24 @@ static void OffsetWithLoops(const TPolyPolygon &pp, TPolyPolygon &pp_new, double
 
 		if(p.size() > 2)
 		{
+			cInt z_first_loop;
 			if(reverse)
 			{
-				for(unsigned int j = p.size()-1; j > 1; j--)MakeLoop(p[j], p[j-1], p[j-2], radius);
-				MakeLoop(p[1], p[0], p[p.size()-1], radius);
-				MakeLoop(p[0], p[p.size()-1], p[p.size()-2], radius);
+				z_first_loop = MakeLoop(p[p.size()-1], p[p.size()-2], p[p.size()-3], radius, pts_for_AddVertex, arcs);
+				for(unsigned int j = p.size()-2; j > 1; j--)MakeLoop(p[j], p[j-1], p[j-2], radius, pts_for_AddVertex, arcs);
+				MakeLoop(p[1], p[0], p[p.size()-1], radius, pts_for_AddVertex, arcs);
+				MakeLoop(p[0], p[p.size()-1], p[p.size()-2], radius, pts_for_AddVertex, arcs);
 			}
 			else
 			{
-				MakeLoop(p[p.size()-2], p[p.size()-1], p[0], radius);
-				MakeLoop(p[p.size()-1], p[0], p[1], radius);
-				for(unsigned int j = 2; j < p.size(); j++)MakeLoop(p[j-2], p[j-1], p[j], radius);
+				z_first_loop = MakeLoop(p[p.size()-2], p[p.size()-1], p[0], radius, pts_for_AddVertex, arcs);
+				MakeLoop(p[p.size()-1], p[0], p[1], radius, pts_for_AddVertex, arcs);
+				for(unsigned int j = 2; j < p.size(); j++)MakeLoop(p[j-2], p[j-1], p[j], radius, pts_for_AddVertex, arcs);
 			}
 
+			// the first loop starts at the last point
+			pts_for_AddVertex.back().Z = AddArcsToZ(pts_for_AddVertex.back().Z, z_first_loop);
+
 			TPolygon loopy_polygon;
 			loopy_polygon.reserve(pts_for_AddVertex.size());
 			for(std::list<DoubleAreaPoint>::iterator It = pts_for_AddVertex.begin(); It != pts_for_AddVertex.end(); It++)
@@ -220,7 +337,7 @@ static void OffsetWithLoops(const TPolyPolygon &pp, TPolyPolygon &pp_new, double
 	}
 }
 
-static void MakeObround(const Point &pt0, const CVertex &vt1, double radius)
+static void MakeObround(const Point &pt0, const CVertex &vt1, double radius, std::list<DoubleAreaPoint> &pts_for_AddVertex)
 {
 	Span span(pt0, vt1);
 	Point forward0 = span.GetVector(0.0);
@@ -236,22 +353,17 @@ static void MakeObround(const Point &pt0, const CVertex &vt1, double radius)
 	CVertex v3(-vt1.m_type, pt0 + right0 * -radius, vt1.m_c);
 	CVertex v4(1, pt0 + right0 * radius, pt0);
 
-	double save_units = CArea::m_units;
-	CArea::m_units = 1.0;
-
-	AddVertex(v0, NULL);
-	AddVertex(v1, &v0);
-	AddVertex(v2, &v1);
-	AddVertex(v3, &v2);
-	AddVertex(v4, &v3);
-
-	CArea::m_units = save_units;
+	AddVertex(v0, NULL, pts_for_AddVertex, 1.0);
+	AddVertex(v1, &v0, pts_for_AddVertex, 1.0);
+	AddVertex(v2, &v1, pts_for_AddVertex, 1.0);
+	AddVertex(v3, &v2, pts_for_AddVertex, 1.0);
+	AddVertex(v4, &v3, pts_for_AddVertex, 1.0);
 }
 
 static void OffsetSpansWithObrounds(const CArea& area, TPolyPolygon &pp_new, double radius)
 {
 	Clipper c;
-
+	std::list<DoubleAreaPoint> pts_for_AddVertex;
 
 	for(std::list<CCurve>::const_iterator It = area.m_curves.begin(); It != area.m_curves.end(); It++)
 	{
@@ -263,7 +375,7 @@ static void OffsetSpansWithObrounds(const CArea& area, TPolyPolygon &pp_new, dou
 			const CVertex& vertex = *It2;
 			if(prev_vertex)
 			{
-				MakeObround(prev_vertex->m_p, vertex, radius);
+				MakeObround(prev_vertex->m_p, vertex, radius, pts_for_AddVertex);
 
 				TPolygon loopy_polygon;
 				loopy_polygon.reserve(pts_for_AddVertex.size());
@@ -296,83 +408,196 @@ static void OffsetSpansWithObrounds(const CArea& area, TPolyPolygon &pp_new, dou
 	}
 }
 
-static void MakePolyPoly( const CArea& area, TPolyPolygon &pp, bool reverse = true ){
-	pp.clear();
-
-	for(std::list<CCurve>::const_iterator It = area.m_curves.begin(); It != area.m_curves.end(); It++)
+static void MakePoly(const CCurve& curve, TPolygon &p, CArcCentres &arcs)
+{
+	std::list<DoubleAreaPoint> pts_for_AddVertex;
+	const CVertex* prev_vertex = NULL;
+	cInt first_arc = 0;
+	for (std::list<CVertex>::const_iterator It2 = curve.m_vertices.begin(); It2 != curve.m_vertices.end(); It2++)
 	{
-		pts_for_AddVertex.clear();
-		const CCurve& curve = *It;
-		const CVertex* prev_vertex = NULL;
-		for(std::list<CVertex>::const_iterator It2 = curve.m_vertices.begin(); It2 != curve.m_vertices.end(); It2++)
+		const CVertex& vertex = *It2;
+		if (prev_vertex)
 		{
-			const CVertex& vertex = *It2;
-			if(prev_vertex)AddVertex(vertex, prev_vertex);
-			prev_vertex = &vertex;
+			cInt arc = AddVertex(vertex, prev_vertex, pts_for_AddVertex, CArea::m_units, &arcs);
+			if(prev_vertex == &curve.m_vertices.front())first_arc = arc;
 		}
+		prev_vertex = &vertex;
+	}
 
-		TPolygon p;
-		p.resize(pts_for_AddVertex.size());
-		if(reverse)
-		{
-			unsigned int i = pts_for_AddVertex.size() - 1;// clipper wants them the opposite way to CArea
-			for(std::list<DoubleAreaPoint>::iterator It = pts_for_AddVertex.begin(); It != pts_for_AddVertex.end(); It++, i--)
-			{
-				p[i] = It->int_point();
-			}
-		}
-		else
+	// the first arc starts at the last point
+	if(pts_for_AddVertex.size() > 0)pts_for_AddVertex.back().Z = AddArcToZ(pts_for_AddVertex.back().Z, first_arc);
+
+	p.resize(pts_for_AddVertex.size());
+	{
+		unsigned int i = 0;
+		for (std::list<DoubleAreaPoint>::iterator It = pts_for_AddVertex.begin(); It != pts_for_AddVertex.end(); It++, i++)
 		{
-			unsigned int i = 0;
-			for(std::list<DoubleAreaPoint>::iterator It = pts_for_AddVertex.begin(); It != pts_for_AddVertex.end(); It++, i++)
-			{
-				p[i] = It->int_point();
-			}
+			p[i] = It->int_point();
 		}
+	}
+}
 
+static void MakePolyPoly( const CArea& area, TPolyPolygon &pp, CArcCentres &arcs, bool reverse = true ){
+	pp.clear();
+
+	for(std::list<CCurve>::const_iterator It = area.m_curves.begin(); It != area.m_curves.end(); It++)
+	{
+		TPolygon p;
+		MakePoly(*It, p, arcs);
+		if(reverse)std::reverse(p.begin(), p.end());// clipper wants them the opposite way to CArea
 		pp.push_back(p);
 	}
 }
 
-static void MakePoly(const CCurve& curve, TPolygon &p)
+// a run of edges of a result polygon, which are all on one of the arcs, or are lines
+class CResultRun
 {
-	pts_for_AddVertex.clear();
-	const CVertex* prev_vertex = NULL;
-	for (std::list<CVertex>::const_iterator It2 = curve.m_vertices.begin(); It2 != curve.m_vertices.end(); It2++)
+public:
+	cInt m_arc; // 0 for lines
+	Point m_c;
+	int m_dir;
+	double m_angle;
+	double m_rmin, m_rmax, m_mid_min; // distances from the centre
+	unsigned int m_start, m_end; // points, counted from the start of the curve
+
+	CResultRun(unsigned int start):m_arc(0), m_dir(0), m_angle(0.0), m_rmin(0.0), m_rmax(0.0), m_mid_min(0.0), m_start(start), m_end(start){}
+
+	bool StartArc(cInt arc, const CArcCentres &arcs, const DoubleAreaPoint &a, const DoubleAreaPoint &b, double tolerance)
 	{
-		const CVertex& vertex = *It2;
-		if (prev_vertex)AddVertex(vertex, prev_vertex);
-		prev_vertex = &vertex;
+		m_arc = arc;
+		m_c = arcs.Centre(arc);
+		m_dir = 0;
+		m_angle = 0.0;
+		m_rmin = m_rmax = m_mid_min = Point(a.X, a.Y).dist(m_c);
+		if(Add(a, b, tolerance))return true;
+		m_arc = 0;
+		return false;
 	}
 
-	p.resize(pts_for_AddVertex.size());
+	bool Add(const DoubleAreaPoint &a, const DoubleAreaPoint &b, double tolerance)
 	{
-		unsigned int i = 0;
-		for (std::list<DoubleAreaPoint>::iterator It = pts_for_AddVertex.begin(); It != pts_for_AddVertex.end(); It++, i++)
+		// adds the edge from a to b to the arc, if it is on it and the arc stays no more than a half circle
+		if(!ZHasArc(CommonArcs(a.Z, b.Z), m_arc))return false;
+		Point va = Point(a.X, a.Y) - m_c;
+		Point vb = Point(b.X, b.Y) - m_c;
+		double cross = va ^ vb;
+		if(cross == 0.0)return false;
+		int dir = (cross > 0) ? 1 : -1;
+		if(m_dir != 0 && dir != m_dir)return false;
+		double angle = m_angle + atan2(fabs(cross), va * vb);
+		if(angle > PI + 0.001)return false;
+
+		double r = vb.length();
+		double rmin = (r < m_rmin) ? r : m_rmin;
+		double rmax = (r > m_rmax) ? r : m_rmax;
+		if(rmax - rmin > tolerance)return false;
+		double mid = ((va + vb) * 0.5).length();
+		double mid_min = (mid < m_mid_min) ? mid : m_mid_min;
+		if(rmax - mid_min > tolerance)return false;
+
+		m_dir = dir;
+		m_angle = angle;
+		m_rmin = rmin;
+		m_rmax = rmax;
+		m_mid_min = mid_min;
+		m_end++;
+		return true;
+	}
+
+};
+
+static void SetFromResult( CCurve& curve, const TPolygon& p, const CArcCentres* arcs, bool reverse = true )
+{
+	unsigned int n = p.size();
+	if(n == 0)return;
+	if(!CArea::m_fit_arcs)arcs = NULL;
+
+	// the points in the curve's direction, the curve starts and ends at q[0]
+	std::vector<IntPoint> q(n);
+	for(unsigned int j = 0; j < n; j++)q[j] = p[reverse ? ((n - j) % n) : j];
+
+	// start where no arc goes through, so an arc isn't split in two
+	unsigned int s = 0;
+	if(arcs)
+	{
+		for(unsigned int j = 0; j < n; j++)
 		{
-			p[i] = It->int_point();
+			cInt z_before = CommonArcs(q[(j + n - 1) % n].Z, q[j].Z);
+			cInt z_after = CommonArcs(q[j].Z, q[(j + 1) % n].Z);
+			if(CommonArcs(z_before, z_after) == 0)
+			{
+				s = j;
+				break;
+			}
 		}
 	}
-}
 
-static void SetFromResult( CCurve& curve, const TPolygon& p, bool reverse = true )
-{
-	for(unsigned int j = 0; j < p.size(); j++)
+	std::vector<DoubleAreaPoint> pts;
+	pts.reserve(n + 1);
+	for(unsigned int j = 0; j <= n; j++)pts.push_back(DoubleAreaPoint(q[(s + j) % n]));
+
+	// group the edges into arcs and lines
+	// the points of an arc came from the same arc, so they are only checked against it, with the tolerance FitArcs uses
+	double tolerance = CArea::m_accuracy * 1.4;
+	std::list<CResultRun> runs;
+	for(unsigned int j = 1; j <= n; j++)
 	{
-		const IntPoint &pt = p[j];
-		DoubleAreaPoint dp(pt);
-		CVertex vertex(0, Point(dp.X / CArea::m_units, dp.Y / CArea::m_units), Point(0.0, 0.0));
-		if(reverse)curve.m_vertices.push_front(vertex);
-		else curve.m_vertices.push_back(vertex);
+		const DoubleAreaPoint &a = pts[j - 1];
+		const DoubleAreaPoint &b = pts[j];
+
+		if(runs.size() > 0 && runs.back().m_arc != 0 && runs.back().Add(a, b, tolerance))continue;
+
+		bool arc_started = false;
+		if(arcs)
+		{
+			cInt z = CommonArcs(a.Z, b.Z);
+			if(j < n && ZHasArc(pts[j + 1].Z, SecondArc(z)) && !ZHasArc(pts[j + 1].Z, FirstArc(z)))z = SecondArc(z) | (FirstArc(z) << 32); // try the one which goes on first
+			cInt try_arcs[2] = {FirstArc(z), SecondArc(z)};
+			for(int i = 0; i < 2 && !arc_started; i++)
+			{
+				if(try_arcs[i] == 0)continue;
+				CResultRun run(j - 1);
+				if(run.StartArc(try_arcs[i], *arcs, a, b, tolerance))
+				{
+					runs.push_back(run);
+					arc_started = true;
+				}
+			}
+		}
+
+		if(!arc_started)
+		{
+			if(runs.size() == 0 || runs.back().m_arc != 0)runs.push_back(CResultRun(j - 1));
+			runs.back().m_end = j;
+		}
 	}
-	// make a copy of the first point at the end
-	if(reverse)curve.m_vertices.push_front(curve.m_vertices.back());
-	else curve.m_vertices.push_back(curve.m_vertices.front());
 
-	if(CArea::m_fit_arcs)curve.FitArcs();
+	// make the vertices
+	curve.m_vertices.push_back(CVertex(0, Point(pts[0].X / CArea::m_units, pts[0].Y / CArea::m_units), Point(0.0, 0.0)));
+	for(std::list<CResultRun>::iterator It = runs.begin(); It != runs.end(); It++)
+	{
+		CResultRun &run = *It;
+		if(run.m_arc)
+		{
+			const DoubleAreaPoint &end = pts[run.m_end];
+			Point end_p(end.X / CArea::m_units, end.Y / CArea::m_units);
+			curve.m_vertices.push_back(CVertex(run.m_dir, end_p, CentreBetween(curve.m_vertices.back().m_p, end_p, run.m_c / CArea::m_units)));
+		}
+		else
+		{
+			CCurve lines;
+			lines.m_vertices.push_back(curve.m_vertices.back());
+			for(unsigned int j = run.m_start + 1; j <= run.m_end; j++)
+				lines.m_vertices.push_back(CVertex(0, Point(pts[j].X / CArea::m_units, pts[j].Y / CArea::m_units), Point(0.0, 0.0)));
+			if(CArea::m_fit_arcs)lines.FitArcs();
+			std::list<CVertex>::iterator VIt = lines.m_vertices.begin();
+			for(VIt++; VIt != lines.m_vertices.end(); VIt++)
+				curve.m_vertices.push_back(*VIt);
+		}
+	}
 }
 
-static void SetFromResult( CArea& area, const TPolyPolygon& pp, bool reverse = true )
+static void SetFromResult( CArea& area, const TPolyPolygon& pp, const CArcCentres* arcs, bool reverse = true )
 {
 	// delete existing geometry
 	area.m_curves.clear();
@@ -383,53 +608,61 @@ static void SetFromResult( CArea& area, const TPolyPolygon& pp, bool reverse = t
 
 		area.m_curves.push_back(CCurve());
 		CCurve &curve = area.m_curves.back();
-		SetFromResult(curve, p, reverse);
+		SetFromResult(curve, p, arcs, reverse);
     }
 }
 
 void CArea::Subtract(const CArea& a2)
 {
 	Clipper c;
+	c.ZFillFunction(ZFillForIntersection);
+	CArcCentres arcs;
 	TPolyPolygon pp1, pp2;
-	MakePolyPoly(*this, pp1);
-	MakePolyPoly(a2, pp2);
+	MakePolyPoly(*this, pp1, arcs);
+	MakePolyPoly(a2, pp2, arcs);
 	c.AddPaths(pp1, ptSubject, true);
 	c.AddPaths(pp2, ptClip, true);
 	TPolyPolygon solution;
 	c.Execute(ctDifference, solution);
-	SetFromResult(*this, solution);
+	SetFromResult(*this, solution, &arcs);
 }
 
 void CArea::Intersect(const CArea& a2)
 {
 	Clipper c;
+	c.ZFillFunction(ZFillForIntersection);
+	CArcCentres arcs;
 	TPolyPolygon pp1, pp2;
-	MakePolyPoly(*this, pp1);
-	MakePolyPoly(a2, pp2);
+	MakePolyPoly(*this, pp1, arcs);
+	MakePolyPoly(a2, pp2, arcs);
 	c.AddPaths(pp1, ptSubject, true);
 	c.AddPaths(pp2, ptClip, true);
 	TPolyPolygon solution;
 	c.Execute(ctIntersection, solution);
-	SetFromResult(*this, solution);
+	SetFromResult(*this, solution, &arcs);
 }
 
 void CArea::Union(const CArea& a2)
 {
 	Clipper c;
+	c.ZFillFunction(ZFillForIntersection);
+	CArcCentres arcs;
 	TPolyPolygon pp1, pp2;
-	MakePolyPoly(*this, pp1);
-	MakePolyPoly(a2, pp2);
+	MakePolyPoly(*this, pp1, arcs);
+	MakePolyPoly(a2, pp2, arcs);
 	c.AddPaths(pp1, ptSubject, true);
 	c.AddPaths(pp2, ptClip, true);
 	TPolyPolygon solution;
 	c.Execute(ctUnion, solution);
-	SetFromResult(*this, solution);
+	SetFromResult(*this, solution, &arcs);
 }
 
 // static
 CArea CArea::UniteCurves(std::list<CCurve> &curves)
 {
 	Clipper c;
+	c.ZFillFunction(ZFillForIntersection);
+	CArcCentres arcs;
 
 	TPolyPolygon pp;
 
@@ -437,7 +670,7 @@ CArea CArea::UniteCurves(std::list<CCurve> &curves)
 	{
 		CCurve &curve = *It;
 		TPolygon p;
-		MakePoly(curve, p);
+		MakePoly(curve, p, arcs);
 		pp.push_back(p);
 	}
 
@@ -445,29 +678,32 @@ CArea CArea::UniteCurves(std::list<CCurve> &curves)
 	TPolyPolygon solution;
 	c.Execute(ctUnion, solution, ClipperLib::PolyFillType::pftNonZero, ClipperLib::PolyFillType::pftNonZero);
 	CArea area;
-	SetFromResult(area, solution);
+	SetFromResult(area, solution, &arcs);
 	return area;
 }
 
 void CArea::Xor(const CArea& a2)
 {
 	Clipper c;
+	c.ZFillFunction(ZFillForIntersection);
+	CArcCentres arcs;
 	TPolyPolygon pp1, pp2;
-	MakePolyPoly(*this, pp1);
-	MakePolyPoly(a2, pp2);
+	MakePolyPoly(*this, pp1, arcs);
+	MakePolyPoly(a2, pp2, arcs);
 	c.AddPaths(pp1, ptSubject, true);
 	c.AddPaths(pp2, ptClip, true);
 	TPolyPolygon solution;
 	c.Execute(ctXor, solution);
-	SetFromResult(*this, solution);
+	SetFromResult(*this, solution, &arcs);
 }
 
 void CArea::Offset(double inwards_value)
 {
+	CArcCentres arcs;
 	TPolyPolygon pp, pp2;
-	MakePolyPoly(*this, pp, false);
-	OffsetWithLoops(pp, pp2, inwards_value * m_units);
-	SetFromResult(*this, pp2, false);
+	MakePolyPoly(*this, pp, arcs, false);
+	OffsetWithLoops(pp, pp2, inwards_value * m_units, arcs);
+	SetFromResult(*this, pp2, &arcs, false);
 	this->Reorder();
 }
 
@@ -475,18 +711,18 @@ void CArea::Thicken(double value)
 {
 	TPolyPolygon pp;
 	OffsetSpansWithObrounds(*this, pp, value * m_units);
-	SetFromResult(*this, pp, false);
+	SetFromResult(*this, pp, NULL, false);
 	this->Reorder();
 }
 
 void UnFitArcs(CCurve &curve)
 {
-	pts_for_AddVertex.clear();
+	std::list<DoubleAreaPoint> pts_for_AddVertex;
 	const CVertex* prev_vertex = NULL;
 	for(std::list<CVertex>::const_iterator It2 = curve.m_vertices.begin(); It2 != curve.m_vertices.end(); It2++)
 	{
 		const CVertex& vertex = *It2;
-		AddVertex(vertex, prev_vertex);
+		AddVertex(vertex, prev_vertex, pts_for_AddVertex);
 		prev_vertex = &vertex;
 	}
 
@@ -0,0 +1,237 @@
+// AreaInsideIndex.cpp
+// Copyright 2011, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "AreaInsideIndex.h"
+#include "Area.h"
+
+#include <algorithm>
+
+double CAreaInsideIndex::CPiece::XAtY(double y)const
+{
+	if(m_arc)
+	{
+		double dy = y - m_c.y;
+		double d = m_radius * m_radius - dy * dy;
+		if(d < 0.0)d = 0.0;
+		return m_c.x + m_side * sqrt(d);
+	}
+
+	double t = (y - m_p0.y) / (m_p1.y - m_p0.y);
+	return m_p0.x + t * (m_p1.x - m_p0.x);
+}
+
+CAreaInsideIndex::CAreaInsideIndex(const CArea& area)
+{
+	for(std::list<CCurve>::const_iterator It = area.m_curves.begin(); It != area.m_curves.end(); It++)
+	{
+		AddCurve(*It);
+	}
+	MakeTree();
+}
+
+CAreaInsideIndex::CAreaInsideIndex(const CCurve& curve)
+{
+	AddCurve(curve);
+	MakeTree();
+}
+
+void CAreaInsideIndex::AddCurve(const CCurve& curve)
+{
+	std::list<Span> spans;
+	curve.GetSpans(spans);
+	for(std::list<Span>::iterator It = spans.begin(); It != spans.end(); It++)
+	{
+		AddSpan(*It);
+	}
+
+	// Clipper closes open curves, so do the same
+	if(curve.m_vertices.size() > 1 && !curve.IsClosed())AddSpan(Span(curve.m_vertices.back().m_p, CVertex(curve.m_vertices.front().m_p)));
+}
+
+void CAreaInsideIndex::AddSpan(const Span& span)
+{
+	const Point &p0 = span.m_p;
+	const Point &p1 = span.m_v.m_p;
+
+	if(span.m_v.m_type == 0)
+	{
+		CPiece piece;
+		piece.m_arc = false;
+		piece.m_p0 = p0;
+		piece.m_p1 = p1;
+		AddPiece(piece, p0, p1);
+		return;
+	}
+
+	// split the arc at the top and bottom of its circle
+	const Point &c = span.m_v.m_c;
+	double radius = p1.dist(c);
+	double sweep = span.IncludedAngle();
+	if(sweep == 0.0)return;
+	double a0 = atan2(p0.y - c.y, p0.x - c.x);
+	double a1 = a0 + sweep;
+
+	Point prev_p = p0;
+	double prev_a = a0;
+	if(span.m_v.m_type == 1)
+	{
+		for(int k = (int)floor((a0 - PI/2) / PI) + 1; PI/2 + k * PI < a1; k++)
+		{
+			double a = PI/2 + k * PI;
+			Point p(c.x, (k % 2 == 0) ? (c.y + radius) : (c.y - radius));
+			AddArcPiece(prev_p, p, c, radius, (cos((prev_a + a) * 0.5) >= 0.0) ? 1 : -1);
+			prev_p = p;
+			prev_a = a;
+		}
+	}
+	else
+	{
+		for(int k = (int)ceil((a0 - PI/2) / PI) - 1; PI/2 + k * PI > a1; k--)
+		{
+			double a = PI/2 + k * PI;
+			Point p(c.x, (k % 2 == 0) ? (c.y + radius) : (c.y - radius));
+			AddArcPiece(prev_p, p, c, radius, (cos((prev_a + a) * 0.5) >= 0.0) ? 1 : -1);
+			prev_p = p;
+			prev_a = a;
+		}
+	}
+	AddArcPiece(prev_p, p1, c, radius, (cos((prev_a + a1) * 0.5) >= 0.0) ? 1 : -1);
+}
+
+void CAreaInsideIndex::AddArcPiece(const Point& p0, const Point& p1, const Point& c, double radius, int side)
+{
+	CPiece piece;
+	piece.m_arc = true;
+	piece.m_c = c;
+	piece.m_radius = radius;
+	piece.m_side = side;
+	AddPiece(piece, p0, p1);
+}
+
+void CAreaInsideIndex::AddPiece(const CPiece& piece, const Point& p0, const Point& p1)
+{
+	m_box.Insert(p0);
+	m_box.Insert(p1);
+
+	// horizontal pieces are never crossed
+	if(p0.y == p1.y)return;
+
+	m_pieces.push_back(piece);
+	CPiece &new_piece = m_pieces.back();
+	new_piece.m_dir = (p1.y > p0.y) ? 1 : -1;
+	new_piece.m_ymin = (p1.y > p0.y) ? p0.y : p1.y;
+	new_piece.m_ymax = (p1.y > p0.y) ? p1.y : p0.y;
+}
+
+class CAreaInsideIndex::CMinLess
+{
+	const std::vector<CPiece> &m_pieces;
+public:
+	CMinLess(const std::vector<CPiece> &pieces):m_pieces(pieces){}
+	bool operator()(int a, int b)const{ return m_pieces[a].m_ymin < m_pieces[b].m_ymin; }
+};
+
+class CAreaInsideIndex::CMaxGreater
+{
+	const std::vector<CPiece> &m_pieces;
+public:
+	CMaxGreater(const std::vector<CPiece> &pieces):m_pieces(pieces){}
+	bool operator()(int a, int b)const{ return m_pieces[a].m_ymax > m_pieces[b].m_ymax; }
+};
+
+int CAreaInsideIndex::MakeNode(std::vector<int> &pieces)
+{
+	if(pieces.size() == 0)return -1;
+
+	// the middle of the middle piece, so at most half of the pieces go to each side
+	std::vector<double> mids(pieces.size());
+	for(unsigned int i = 0; i < pieces.size(); i++)
+	{
+		const CPiece &piece = m_pieces[pieces[i]];
+		mids[i] = (piece.m_ymin + piece.m_ymax) * 0.5;
+	}
+	std::nth_element(mids.begin(), mids.begin() + mids.size() / 2, mids.end());
+	double y = mids[mids.size() / 2];
+
+	std::vector<int> below, above, here;
+	for(unsigned int i = 0; i < pieces.size(); i++)
+	{
+		const CPiece &piece = m_pieces[pieces[i]];
+		if(piece.m_ymax < y)below.push_back(pieces[i]); // not <=, a piece only a rounding error high can have its middle at its top
+		else if(piece.m_ymin > y)above.push_back(pieces[i]);
+		else here.push_back(pieces[i]);
+	}
+
+	int n = m_nodes.size();
+	m_nodes.push_back(CNode());
+	m_nodes[n].m_y = y;
+	m_nodes[n].m_by_min = here;
+	std::sort(m_nodes[n].m_by_min.begin(), m_nodes[n].m_by_min.end(), CMinLess(m_pieces));
+	m_nodes[n].m_by_max = here;
+	std::sort(m_nodes[n].m_by_max.begin(), m_nodes[n].m_by_max.end(), CMaxGreater(m_pieces));
+
+	int below_node = MakeNode(below);
+	int above_node = MakeNode(above);
+	m_nodes[n].m_below = below_node;
+	m_nodes[n].m_above = above_node;
+
+	return n;
+}
+
+void CAreaInsideIndex::MakeTree()
+{
+	std::vector<int> pieces(m_pieces.size());
+	for(unsigned int i = 0; i < m_pieces.size(); i++)pieces[i] = i;
+	m_root = MakeNode(pieces);
+}
+
+int CAreaInsideIndex::WindingNumber(const Point& p)const
+{
+	// the tops and bottoms of the arcs are in the box, but not their sides
+	if(!m_box.m_valid || p.y < m_box.m_minxy.y || p.y > m_box.m_maxxy.y)return 0;
+
+	// add up the pieces crossing the line going from the point in the x direction
+	int winding = 0;
+	for(int n = m_root; n != -1;)
+	{
+		const CNode &node = m_nodes[n];
+		if(p.y < node.m_y)
+		{
+			for(std::vector<int>::const_iterator It = node.m_by_min.begin(); It != node.m_by_min.end(); It++)
+			{
+				const CPiece &piece = m_pieces[*It];
+				if(piece.m_ymin > p.y)break;
+				if(piece.XAtY(p.y) > p.x)winding += piece.m_dir;
+			}
+			n = node.m_below;
+		}
+		else
+		{
+			for(std::vector<int>::const_iterator It = node.m_by_max.begin(); It != node.m_by_max.end(); It++)
+			{
+				const CPiece &piece = m_pieces[*It];
+				if(piece.m_ymax <= p.y)break;
+				if(piece.XAtY(p.y) > p.x)winding += piece.m_dir;
+			}
+			n = node.m_above;
+		}
+	}
+
+	return winding;
+}
+
+bool CAreaInsideIndex::IsInside(const Point& p)const
+{
+	// the same even-odd rule as the Clipper intersection which used to be used
+	return (WindingNumber(p) % 2) != 0;
+}
+
+void CAreaInsideIndex::IsInside(const std::vector<Point> &pts, std::vector<bool> &inside)const
+{
+	inside.resize(pts.size());
+	for(unsigned int i = 0; i < pts.size(); i++)
+	{
+		inside[i] = IsInside(pts[i]);
+	}
+}
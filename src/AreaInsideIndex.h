@@ -0,0 +1,62 @@
+// AreaInsideIndex.h
+// Copyright 2011, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+#include <vector>
+#include "Curve.h"
+
+class CArea;
+
+// finds whether points are inside an area, by counting the crossings of the area's spans with a line from the point in the x direction.
+// the spans are split into pieces which only go up or only go down, and kept in an interval tree by their y range,
+// so only the pieces which cross the point's y are looked at.
+// make one of these for an area which is tested many times; it doesn't change if the area is changed afterwards.
+class CAreaInsideIndex
+{
+	class CPiece
+	{
+	public:
+		double m_ymin, m_ymax; // a point with m_ymin <= y < m_ymax crosses this piece
+		int m_dir; // 1 if the piece goes up, -1 if it goes down
+		bool m_arc;
+		Point m_p0, m_p1; // for a line
+		Point m_c; // for an arc
+		double m_radius;
+		int m_side; // 1 if the arc piece is to the right of its centre, -1 if to the left
+
+		double XAtY(double y)const;
+	};
+
+	class CNode
+	{
+	public:
+		double m_y; // all the pieces here cross this y
+		int m_below, m_above; // child nodes, or -1
+		std::vector<int> m_by_min; // the pieces here, in order of m_ymin
+		std::vector<int> m_by_max; // the pieces here, in reverse order of m_ymax
+	};
+
+	std::vector<CPiece> m_pieces;
+	std::vector<CNode> m_nodes;
+	int m_root;
+	CBox2D m_box;
+
+	class CMinLess;
+	class CMaxGreater;
+
+	void AddCurve(const CCurve& curve);
+	void AddSpan(const Span& span);
+	void AddArcPiece(const Point& p0, const Point& p1, const Point& c, double radius, int side);
+	void AddPiece(const CPiece& piece, const Point& p0, const Point& p1);
+	int MakeNode(std::vector<int> &pieces);
+	void MakeTree();
+
+public:
+	CAreaInsideIndex(const CArea& area);
+	CAreaInsideIndex(const CCurve& curve);
+
+	int WindingNumber(const Point& p)const; // anti-clockwise curves around the point add one, clockwise curves take one away
+	bool IsInside(const Point& p)const;
+	void IsInside(const std::vector<Point> &pts, std::vector<bool> &inside)const; // for many points at once
+};
@@ -0,0 +1,502 @@
+// AreaMedialAxis.cpp
+// Copyright 2011, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "AreaMedialAxis.h"
+#include "Area.h"
+
+#include <algorithm>
+#include <boost/polygon/point_data.hpp>
+#include <boost/polygon/segment_data.hpp>
+#include <boost/polygon/voronoi.hpp>
+
+typedef boost::polygon::voronoi_diagram<double> TVoronoiDiagram;
+
+// the voronoi builder works in integers, like Clipper
+static const double MedialAxisFactor = 10000.0;
+
+// offsets nearer than this to a vertex's distance are moved off it, so they don't go through the vertex, in mm
+static const double VertexClearance = 0.000001;
+
+class CMedialAxisPoint
+{
+public:
+	int m_x, m_y; // multiplied by CArea::m_units and MedialAxisFactor
+	int m_arc; // the arc the line to this point was split from, or -1
+
+	CMedialAxisPoint(const Point& p, int arc):m_arc(arc)
+	{
+		m_x = (int)floor(p.x * CArea::m_units * MedialAxisFactor + 0.5);
+		m_y = (int)floor(p.y * CArea::m_units * MedialAxisFactor + 0.5);
+	}
+
+	bool operator==(const CMedialAxisPoint& p)const{return m_x == p.m_x && m_y == p.m_y;}
+	Point GetPoint()const{return Point(m_x / MedialAxisFactor, m_y / MedialAxisFactor);}
+};
+
+CAreaMedialAxis::CAreaMedialAxis(const CArea& area)
+{
+	std::vector<int> xy;
+	for(std::list<CCurve>::const_iterator It = area.m_curves.begin(); It != area.m_curves.end(); It++)
+	{
+		AddCurve(*It, xy);
+	}
+	MakeDiagram(xy);
+}
+
+CAreaMedialAxis::CAreaMedialAxis(const CCurve& curve)
+{
+	std::vector<int> xy;
+	AddCurve(curve, xy);
+	MakeDiagram(xy);
+}
+
+void CAreaMedialAxis::AddCurve(const CCurve& curve, std::vector<int> &xy)
+{
+	if(curve.m_vertices.size() < 2)return;
+
+	// the point at the end of each line, round the curve
+	std::vector<CMedialAxisPoint> pts;
+	const CVertex* prev_vertex = NULL;
+	for(std::list<CVertex>::const_iterator It = curve.m_vertices.begin(); It != curve.m_vertices.end(); It++)
+	{
+		const CVertex& vertex = *It;
+		if(prev_vertex == NULL)
+		{
+		}
+		else if(vertex.m_type == 0 || vertex.m_p == prev_vertex->m_p)
+		{
+			pts.push_back(CMedialAxisPoint(vertex.m_p, -1));
+		}
+		else
+		{
+			// split the arc into lines, the same as for Clipper
+			CSplitArc arc;
+			arc.m_dir = vertex.m_type;
+			arc.m_c = vertex.m_c * CArea::m_units;
+			m_arcs.push_back(arc);
+
+			CCurve arc_curve;
+			arc_curve.append(prev_vertex->m_p);
+			arc_curve.append(vertex);
+			arc_curve.UnFitArcs();
+			std::list<CVertex>::iterator VIt = arc_curve.m_vertices.begin();
+			for(VIt++; VIt != arc_curve.m_vertices.end(); VIt++)
+				pts.push_back(CMedialAxisPoint(VIt->m_p, m_arcs.size() - 1));
+		}
+		prev_vertex = &vertex;
+	}
+
+	if(curve.m_vertices.front().m_p != curve.m_vertices.back().m_p)
+		pts.push_back(CMedialAxisPoint(curve.m_vertices.front().m_p, -1));
+
+	// remove the lines which are of no length after rounding; the first line goes from the last point to the first
+	std::vector<CMedialAxisPoint> unique_pts;
+	for(unsigned int i = 0; i < pts.size(); i++)
+	{
+		if(unique_pts.size() > 0 && pts[i] == unique_pts.back())continue;
+		unique_pts.push_back(pts[i]);
+	}
+	while(unique_pts.size() > 1 && unique_pts.front() == unique_pts.back())unique_pts.erase(unique_pts.begin());
+	if(unique_pts.size() < 3)return;
+
+	int first = m_lines.size();
+	int n = unique_pts.size();
+	for(int i = 0; i < n; i++)
+	{
+		const CMedialAxisPoint& p0 = unique_pts[(i + n - 1) % n];
+		const CMedialAxisPoint& p1 = unique_pts[i];
+		CLine line;
+		line.m_p0 = p0.GetPoint();
+		line.m_p1 = p1.GetPoint();
+		line.m_dir = line.m_p1 - line.m_p0;
+		line.m_dir.normalize();
+		line.m_prev = first + (i + n - 1) % n;
+		line.m_next = first + (i + 1) % n;
+		line.m_arc = p1.m_arc;
+		m_lines.push_back(line);
+
+		xy.push_back(p0.m_x);
+		xy.push_back(p0.m_y);
+		xy.push_back(p1.m_x);
+		xy.push_back(p1.m_y);
+	}
+}
+
+void CAreaMedialAxis::MakeDiagram(const std::vector<int> &xy)
+{
+	m_valid = false;
+	if(m_lines.size() == 0)return;
+
+	std::vector< boost::polygon::segment_data<int> > segments;
+	segments.reserve(m_lines.size());
+	for(unsigned int i = 0; i < m_lines.size(); i++)
+	{
+		const int* s = &xy[i * 4];
+		segments.push_back(boost::polygon::segment_data<int>(boost::polygon::point_data<int>(s[0], s[1]), boost::polygon::point_data<int>(s[2], s[3])));
+	}
+
+	TVoronoiDiagram vd;
+	boost::polygon::construct_voronoi(segments.begin(), segments.end(), &vd);
+	if(vd.num_cells() == 0 || vd.num_edges() == 0 || vd.num_vertices() == 0)return;
+
+	// copy the diagram, with indexes instead of pointers
+	const TVoronoiDiagram::cell_type* first_cell = &vd.cells()[0];
+	const TVoronoiDiagram::vertex_type* first_vertex = &vd.vertices()[0];
+	const TVoronoiDiagram::edge_type* first_edge = &vd.edges()[0];
+
+	m_cells.resize(vd.num_cells());
+	for(unsigned int i = 0; i < vd.num_cells(); i++)
+	{
+		const TVoronoiDiagram::cell_type& c = vd.cells()[i];
+		CCell& cell = m_cells[i];
+		cell.m_point = c.contains_point();
+		cell.m_line = c.source_index();
+		cell.m_prev = -1;
+		if(cell.m_point)
+		{
+			const CLine& line = m_lines[cell.m_line];
+			if(c.source_category() == boost::polygon::SOURCE_CATEGORY_SEGMENT_START_POINT)
+			{
+				cell.m_p = line.m_p0;
+				cell.m_prev = line.m_prev;
+			}
+			else
+			{
+				cell.m_p = line.m_p1;
+				cell.m_prev = cell.m_line;
+				cell.m_line = line.m_next;
+			}
+		}
+	}
+
+	m_vertices.resize(vd.num_vertices());
+	m_vertex_dist.resize(vd.num_vertices());
+	for(unsigned int i = 0; i < vd.num_vertices(); i++)
+	{
+		const TVoronoiDiagram::vertex_type& v = vd.vertices()[i];
+		m_vertices[i] = Point(v.x() / MedialAxisFactor, v.y() / MedialAxisFactor);
+		m_vertex_dist[i] = CellDist(m_cells[v.incident_edge()->cell() - first_cell], m_vertices[i]);
+	}
+
+	m_edges.resize(vd.num_edges());
+	for(unsigned int i = 0; i < vd.num_edges(); i++)
+	{
+		const TVoronoiDiagram::edge_type& e = vd.edges()[i];
+		CEdge& edge = m_edges[i];
+		edge.m_v0 = e.vertex0() ? (e.vertex0() - first_vertex) : -1;
+		edge.m_v1 = e.vertex1() ? (e.vertex1() - first_vertex) : -1;
+		edge.m_twin = e.twin() - first_edge;
+		edge.m_next = e.next() - first_edge;
+		edge.m_prev = e.prev() - first_edge;
+		edge.m_cell = e.cell() - first_cell;
+		edge.m_curved = e.is_curved();
+		edge.m_inside = false;
+	}
+
+	// the edges only meet the area's curves at their ends, so the middle of an edge says whether it is inside
+	for(unsigned int i = 0; i < m_edges.size(); i++)
+	{
+		CEdge& edge = m_edges[i];
+		if(edge.m_v0 < 0 || edge.m_v1 < 0)continue;
+		const CCell& cell = m_cells[edge.m_cell];
+		const CCell& twin_cell = m_cells[m_edges[edge.m_twin].m_cell];
+		Point mid = (m_vertices[edge.m_v0] + m_vertices[edge.m_v1]) * 0.5;
+		edge.m_inside = InsideCell(cell.m_point ? twin_cell : cell, mid);
+		if(edge.m_inside)
+		{
+			m_sorted_dist.push_back(m_vertex_dist[edge.m_v0]);
+			m_sorted_dist.push_back(m_vertex_dist[edge.m_v1]);
+		}
+	}
+	std::sort(m_sorted_dist.begin(), m_sorted_dist.end());
+
+	m_valid = true;
+}
+
+double CAreaMedialAxis::CellDist(const CCell& cell, const Point& p)const
+{
+	if(cell.m_point)return p.dist(cell.m_p);
+	const CLine& line = m_lines[cell.m_line];
+	return fabs((p - line.m_p0) * ~line.m_dir);
+}
+
+bool CAreaMedialAxis::InsideCell(const CCell& cell, const Point& p)const
+{
+	const CLine& line = m_lines[cell.m_line];
+	bool left = ((p - line.m_p0) * ~line.m_dir) > 0.0;
+	if(!cell.m_point)return left;
+
+	const CLine& prev = m_lines[cell.m_prev];
+	bool left_of_prev = ((p - prev.m_p0) * ~prev.m_dir) > 0.0;
+	if((prev.m_dir ^ line.m_dir) < 0.0)return left || left_of_prev; // an inside corner
+	return left && left_of_prev;
+}
+
+void CAreaMedialAxis::GetCrossings(int edge_index, double d, CCrossings& crossings)const
+{
+	// the distance along an edge only has one low point, so an offset crosses it once, twice or not at all
+	crossings.m_count = 0;
+	const CEdge& edge = m_edges[edge_index];
+	double d0 = m_vertex_dist[edge.m_v0];
+	double d1 = m_vertex_dist[edge.m_v1];
+	bool near0 = d0 < d;
+	bool near1 = d1 < d;
+	if(near0 && near1)return;
+
+	const Point& v0 = m_vertices[edge.m_v0];
+	const Point& v1 = m_vertices[edge.m_v1];
+	const CCell& cell = m_cells[edge.m_cell];
+	const CCell& twin_cell = m_cells[m_edges[edge.m_twin].m_cell];
+	const CCell* point_cell = cell.m_point ? &cell : (twin_cell.m_point ? &twin_cell : NULL);
+	const CCell& line_cell = cell.m_point ? twin_cell : cell;
+
+	// where the distance is d, as parameters from v0 to v1
+	double t0, t1;
+	double x0 = 0.0, x1 = 0.0, xp = 0.0, h = 0.0;
+	const CLine& line = m_lines[line_cell.m_line];
+	bool parabola = edge.m_curved && point_cell != NULL;
+
+	if(point_cell == NULL)
+	{
+		// between two lines the distance changes evenly
+		if(near0 == near1 || d1 == d0)return;
+		t0 = t1 = (d - d0) / (d1 - d0);
+	}
+	else if(parabola)
+	{
+		// measured along the line, the point is at xp and at height h above the line, the edge is the points as far from the point as from the line
+		x0 = (v0 - line.m_p0) * line.m_dir;
+		x1 = (v1 - line.m_p0) * line.m_dir;
+		xp = (point_cell->m_p - line.m_p0) * line.m_dir;
+		h = (point_cell->m_p - line.m_p0) * ~line.m_dir;
+		if(h <= 0.0 || fabs(x1 - x0) < VertexClearance)
+		{
+			if(near0 == near1 || d1 == d0)return;
+			parabola = false;
+			t0 = t1 = (d - d0) / (d1 - d0);
+		}
+		else
+		{
+			// at height d, the edge is d from the point
+			double r2 = h * (2 * d - h);
+			if(r2 < 0.0)
+			{
+				if(near0 == near1)return;
+				r2 = 0.0;
+			}
+			double r = sqrt(r2);
+			t0 = (xp - r - x0) / (x1 - x0);
+			t1 = (xp + r - x0) / (x1 - x0);
+			if(t0 > t1)std::swap(t0, t1);
+		}
+	}
+	else
+	{
+		// a straight edge, measured from the point
+		Point v = v1 - v0;
+		Point w = v0 - point_cell->m_p;
+		double a = v * v;
+		if(a < VertexClearance * VertexClearance)return;
+		double b = 2 * (w * v);
+		double c = w * w - d * d;
+		double disc = b * b - 4 * a * c;
+		if(disc < 0.0)
+		{
+			if(near0 == near1)return;
+			disc = 0.0;
+		}
+		double sq = sqrt(disc);
+		t0 = (-b - sq) / (2 * a);
+		t1 = (-b + sq) / (2 * a);
+	}
+
+	double t[2];
+	if(near0)
+	{
+		// going away
+		t[0] = t1;
+		crossings.m_count = 1;
+		crossings.m_in[0] = false;
+	}
+	else if(near1)
+	{
+		// coming nearer
+		t[0] = t0;
+		crossings.m_count = 1;
+		crossings.m_in[0] = true;
+	}
+	else
+	{
+		// dips below d in the middle
+		if(t0 <= 0.0 || t1 >= 1.0 || t0 >= t1)return;
+		t[0] = t0;
+		t[1] = t1;
+		crossings.m_count = 2;
+		crossings.m_in[0] = true;
+		crossings.m_in[1] = false;
+	}
+
+	for(int i = 0; i < crossings.m_count; i++)
+	{
+		if(t[i] < 0.0)t[i] = 0.0;
+		if(t[i] > 1.0)t[i] = 1.0;
+		if(parabola)
+		{
+			double x = x0 + t[i] * (x1 - x0);
+			double y = ((x - xp) * (x - xp) + h * h) / (2 * h);
+			crossings.m_p[i] = line.m_p0 + line.m_dir * x + ~line.m_dir * y;
+		}
+		else
+		{
+			crossings.m_p[i] = v0 + (v1 - v0) * t[i];
+		}
+		crossings.m_done[i] = false;
+	}
+}
+
+bool CAreaMedialAxis::TraceCurve(int edge, int index, std::vector<CCrossings> &crossings, CCurve& curve)const
+{
+	// go round the offset from cell to cell, with the area's curve on the right
+	std::vector<CVertex> vertices;
+	std::vector<int> arcs; // the arc each vertex's line was split from, or -1
+	vertices.push_back(CVertex(crossings[edge].m_p[index]));
+	arcs.push_back(-1);
+
+	int e = edge;
+	int k = index;
+	for(unsigned int steps = 0;; steps++)
+	{
+		if(steps > m_edges.size())return false;
+		crossings[e].m_done[k] = true;
+
+		// go backwards round the cell, to where the offset leaves it
+		int exit_e = e;
+		int exit_k = k - 1;
+		for(unsigned int walked = 0; exit_k < 0; walked++)
+		{
+			if(walked > m_edges.size())return false;
+			exit_e = m_edges[exit_e].m_prev;
+			exit_k = crossings[exit_e].m_count - 1;
+		}
+		if(crossings[exit_e].m_in[exit_k])return false;
+
+		const Point& p = crossings[exit_e].m_p[exit_k];
+		if(p.dist(vertices.back().m_p) > VertexClearance)
+		{
+			const CCell& cell = m_cells[m_edges[e].m_cell];
+			if(cell.m_point)
+			{
+				// round an inside corner, or round a point between two lines split from the same arc
+				vertices.push_back(CVertex(-1, p, CentreBetween(vertices.back().m_p, p, cell.m_p)));
+				int arc = m_lines[cell.m_line].m_arc;
+				arcs.push_back((m_lines[cell.m_prev].m_arc == arc) ? arc : -1);
+			}
+			else
+			{
+				vertices.push_back(CVertex(p));
+				arcs.push_back(m_lines[cell.m_line].m_arc);
+			}
+		}
+
+		// into the cell on the other side of the edge
+		e = m_edges[exit_e].m_twin;
+		k = crossings[e].m_count - 1 - exit_k;
+		if(e == edge && k == index)break;
+		if(crossings[e].m_done[k])return false;
+	}
+
+	curve.m_vertices.clear();
+	if(vertices.size() < 3)return true;
+	vertices.back().m_p = vertices.front().m_p;
+
+	// put the lines which were split from an arc back into arcs, of no more than a quarter of a circle
+	curve.m_vertices.push_back(CVertex(vertices[0].m_p / CArea::m_units));
+	for(unsigned int i = 1; i < vertices.size();)
+	{
+		const Point& start = vertices[i - 1].m_p;
+		int arc = arcs[i];
+		unsigned int j = i;
+		if(arc >= 0)
+		{
+			const Point& c = m_arcs[arc].m_c;
+			Point vs = start - c;
+			if((vertices[i].m_p - c) * vs <= 0.0)arc = -1;
+			else
+			{
+				while(j + 1 < vertices.size() && arcs[j + 1] == arc && (vertices[j + 1].m_p - c) * vs > 0.0)j++;
+			}
+		}
+
+		const CVertex& vertex = vertices[j];
+		if(arc >= 0)
+			curve.m_vertices.push_back(CVertex(m_arcs[arc].m_dir, vertex.m_p / CArea::m_units, CentreBetween(start, vertex.m_p, m_arcs[arc].m_c) / CArea::m_units));
+		else
+			curve.m_vertices.push_back(CVertex(vertex.m_type, vertex.m_p / CArea::m_units, vertex.m_c / CArea::m_units));
+		i = j + 1;
+	}
+
+	if(!CArea::m_fit_arcs)curve.UnFitArcs();
+	return true;
+}
+
+double CAreaMedialAxis::MaxDistance()const
+{
+	if(m_sorted_dist.size() == 0)return 0.0;
+	return m_sorted_dist.back() / CArea::m_units;
+}
+
+bool CAreaMedialAxis::GetOffset(double inwards_value, CArea& offset)const
+{
+	offset.m_curves.clear();
+	if(!m_valid)return false;
+	double d = inwards_value * CArea::m_units;
+	if(d <= 0.0)return false;
+
+	// keep off the vertices, where the offset would cross several edges at once
+	while(true)
+	{
+		std::vector<double>::const_iterator It = std::lower_bound(m_sorted_dist.begin(), m_sorted_dist.end(), d - VertexClearance);
+		if(It == m_sorted_dist.end() || *It > d + VertexClearance)break;
+		d = *It + VertexClearance * 2;
+	}
+
+	std::vector<CCrossings> crossings(m_edges.size());
+	for(unsigned int i = 0; i < m_edges.size(); i++)
+	{
+		const CEdge& edge = m_edges[i];
+		if((int)i > edge.m_twin)continue; // done with its twin
+
+		CCrossings& c = crossings[i];
+		c.m_count = 0;
+		if(edge.m_inside)GetCrossings(i, d, c);
+
+		// the twin crosses at the same places, the other way
+		CCrossings& twin = crossings[edge.m_twin];
+		twin.m_count = c.m_count;
+		for(int j = 0; j < c.m_count; j++)
+		{
+			twin.m_p[j] = c.m_p[c.m_count - 1 - j];
+			twin.m_in[j] = !c.m_in[c.m_count - 1 - j];
+			twin.m_done[j] = false;
+		}
+	}
+
+	for(unsigned int i = 0; i < m_edges.size(); i++)
+	{
+		for(int j = 0; j < crossings[i].m_count; j++)
+		{
+			if(!crossings[i].m_in[j] || crossings[i].m_done[j])continue;
+			CCurve curve;
+			if(!TraceCurve(i, j, crossings, curve))
+			{
+				offset.m_curves.clear();
+				return false;
+			}
+			if(curve.m_vertices.size() > 0)offset.m_curves.push_back(curve);
+		}
+	}
+
+	offset.Reorder();
+	return true;
+}
@@ -0,0 +1,88 @@
+// AreaMedialAxis.h
+// Copyright 2011, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+#include <vector>
+#include "Curve.h"
+
+class CArea;
+
+// the voronoi diagram of an area's spans, from which the area can be offset inwards by any distance, straight from the area,
+// without Clipper and without offsetting the offset before it.
+// the voronoi builder only takes points and lines, so arcs are split into lines first, and the lines' offsets are put back together as arcs.
+// the offsets go round the area's inside corners with exact arcs.
+// the diagram doesn't change once it is made, so several threads can get offsets from it at the same time.
+class CAreaMedialAxis
+{
+	class CLine
+	{
+	public:
+		Point m_p0, m_p1; // multiplied by CArea::m_units
+		Point m_dir; // unit vector from m_p0 to m_p1, the area is on its left
+		int m_prev, m_next; // the lines before and after this one, round its curve
+		int m_arc; // the arc this line was split from, or -1
+	};
+
+	class CSplitArc
+	{
+	public:
+		int m_dir; // 1 - anti-clockwise, -1 - clockwise
+		Point m_c; // multiplied by CArea::m_units
+	};
+
+	// the part of the plane nearer to one line, or to one point where two lines meet, than to anything else
+	class CCell
+	{
+	public:
+		bool m_point;
+		int m_line; // the cell's line, or for a point, the line going out of it
+		Point m_p; // for a point
+		int m_prev; // for a point, the line going into it
+	};
+
+	class CEdge
+	{
+	public:
+		int m_v0, m_v1; // -1 for the end at infinity
+		int m_twin; // the same edge, going the other way, round the cell on the other side
+		int m_next, m_prev; // round m_cell, anti-clockwise
+		int m_cell;
+		bool m_curved; // a parabola between a point and a line
+		bool m_inside; // inside the area; the offsets only cross these
+	};
+
+	// where an offset crosses an edge, in order along the edge
+	class CCrossings
+	{
+	public:
+		int m_count; // 0, 1 or 2
+		Point m_p[2];
+		bool m_in[2]; // true if the edge is going nearer to its cell's line or point
+		bool m_done[2];
+	};
+
+	std::vector<CLine> m_lines;
+	std::vector<CSplitArc> m_arcs;
+	std::vector<CCell> m_cells;
+	std::vector<CEdge> m_edges;
+	std::vector<Point> m_vertices; // multiplied by CArea::m_units
+	std::vector<double> m_vertex_dist; // how far each vertex is from the lines or points it is between
+	std::vector<double> m_sorted_dist; // the inside vertices' distances, in order
+	bool m_valid;
+
+	void AddCurve(const CCurve& curve, std::vector<int> &xy);
+	void MakeDiagram(const std::vector<int> &xy);
+	double CellDist(const CCell& cell, const Point& p)const;
+	bool InsideCell(const CCell& cell, const Point& p)const;
+	void GetCrossings(int edge, double d, CCrossings& crossings)const;
+	bool TraceCurve(int edge, int index, std::vector<CCrossings> &crossings, CCurve& curve)const;
+
+public:
+	CAreaMedialAxis(const CArea& area);
+	CAreaMedialAxis(const CCurve& curve);
+
+	bool Valid()const{return m_valid;} // false if there was nothing to make a diagram from
+	double MaxDistance()const; // the radius of the biggest circle which fits in the area; no offset is deeper than this
+	bool GetOffset(double inwards_value, CArea& offset)const; // returns false if the offset didn't join up, then use CArea::Offset
+};
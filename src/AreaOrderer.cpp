@@ -5,27 +5,87 @@
 #include "AreaOrderer.h"
 #include "Area.h"
 
-CAreaOrderer* CInnerCurves::area_orderer = NULL;
-
 CInnerCurves::CInnerCurves(CInnerCurves* pOuter, const CCurve* curve)
 {
 	m_pOuter = pOuter;
-	m_curve = curve;
+	m_widest_inner = 0.0;
 	m_unite_area = NULL;
+	SetCurve(curve);
 }
 
 CInnerCurves::~CInnerCurves()
 {
+	DeleteInners();
 	delete m_unite_area;
 }
 
+void CInnerCurves::DeleteInners()
+{
+	for(std::multimap<double, CInnerCurves*>::iterator It = m_inner_curves.begin(); It != m_inner_curves.end(); It++)
+		delete It->second;
+	m_inner_curves.clear();
+	m_widest_inner = 0.0;
+}
+
+void CInnerCurves::SetCurve(const CCurve* curve)
+{
+	m_curve = curve;
+	m_box = CBox2D();
+	if(m_curve)m_curve->GetBox(m_box);
+}
+
+void CInnerCurves::AddInner(CInnerCurves* c)
+{
+	m_inner_curves.insert(std::make_pair(c->m_box.MinX(), c));
+	if(c->m_box.Width() > m_widest_inner)m_widest_inner = c->m_box.Width();
+}
+
+void CInnerCurves::RemoveInner(CInnerCurves* c)
+{
+	for(std::multimap<double, CInnerCurves*>::iterator It = m_inner_curves.lower_bound(c->m_box.MinX()); It != m_inner_curves.end(); It++)
+	{
+		if(It->second == c)
+		{
+			m_inner_curves.erase(It);
+			return;
+		}
+	}
+}
+
+void CInnerCurves::GetOverlapping(const CBox2D& box, std::list<CInnerCurves*> &overlapping)const
+{
+	if(!box.m_valid)
+	{
+		// a curve with no spans; let GetOverlapType decide, as it did for every curve
+		for(std::multimap<double, CInnerCurves*>::const_iterator It = m_inner_curves.begin(); It != m_inner_curves.end(); It++)
+			overlapping.push_back(It->second);
+		return;
+	}
+
+	// the ones whose left is less than the widest box to the left of this box's left, up to this box's right
+	std::multimap<double, CInnerCurves*>::const_iterator It = m_inner_curves.lower_bound(box.MinX() - m_widest_inner - Point::tolerance);
+	std::multimap<double, CInnerCurves*>::const_iterator EndIt = m_inner_curves.upper_bound(box.MaxX() + Point::tolerance);
+	for(; It != EndIt; It++)
+	{
+		CInnerCurves* c = It->second;
+		if(c->m_box.MaxX() < box.MinX() - Point::tolerance)continue;
+		if(c->m_box.MinY() > box.MaxY() + Point::tolerance || box.MinY() > c->m_box.MaxY() + Point::tolerance)continue;
+		overlapping.push_back(c);
+	}
+}
+
 void CInnerCurves::Insert(const CCurve* pcurve)
 {
 	std::list<CInnerCurves*> outside_of_these;
 	std::list<CInnerCurves*> crossing_these;
 
-	// check all inner curves
-	for(std::set<CInnerCurves*>::iterator It = m_inner_curves.begin(); It != m_inner_curves.end(); It++)
+	CBox2D box;
+	pcurve->GetBox(box);
+	std::list<CInnerCurves*> overlapping;
+	GetOverlapping(box, overlapping);
+
+	// check the inner curves whose boxes overlap
+	for(std::list<CInnerCurves*>::iterator It = overlapping.begin(); It != overlapping.end(); It++)
 	{
 		CInnerCurves* c = *It;
 
@@ -51,15 +111,15 @@ void CInnerCurves::Insert(const CCurve* pcurve)
 
 	// add as a new inner
 	CInnerCurves* new_item = new CInnerCurves(this, pcurve);
-	this->m_inner_curves.insert(new_item);
+	AddInner(new_item);
 
 	for(std::list<CInnerCurves*>::iterator It = outside_of_these.begin(); It != outside_of_these.end(); It++)
 	{
 		// move items
 		CInnerCurves* c = *It;
 		c->m_pOuter = new_item;
-		new_item->m_inner_curves.insert(c);
-		this->m_inner_curves.erase(c);
+		new_item->AddInner(c);
+		RemoveInner(c);
 	}
 
 	for(std::list<CInnerCurves*>::iterator It = crossing_these.begin(); It != crossing_these.end(); It++)
@@ -67,7 +127,8 @@ void CInnerCurves::Insert(const CCurve* pcurve)
 		// unite these
 		CInnerCurves* c = *It;
 		new_item->Unite(c);
-		this->m_inner_curves.erase(c);
+		RemoveInner(c);
+		delete c;
 	}
 }
 
@@ -81,9 +142,9 @@ void CInnerCurves::GetArea(CArea &area, bool outside, bool use_curve)const
 
 	std::list<const CInnerCurves*> do_after;
 
-	for(std::set<CInnerCurves*>::const_iterator It = m_inner_curves.begin(); It != m_inner_curves.end(); It++)
+	for(std::multimap<double, CInnerCurves*>::const_iterator It = m_inner_curves.begin(); It != m_inner_curves.end(); It++)
 	{
-		const CInnerCurves* c = *It;
+		const CInnerCurves* c = It->second;
 		area.m_curves.push_back(*c->m_curve);
 		if(!outside)area.m_curves.back().Reverse();
 
@@ -100,22 +161,31 @@ void CInnerCurves::GetArea(CArea &area, bool outside, bool use_curve)const
 
 void CInnerCurves::Unite(const CInnerCurves* c)
 {
-	// unite all the curves in c, with this one
+	// unite all the curves in c, with this one and the curves inside it
 	CArea* new_area = new CArea();
-	new_area->m_curves.push_back(*m_curve);
-	delete m_unite_area;
-	m_unite_area = new_area;
+	GetArea(*new_area);
 
 	CArea a2;
 	c->GetArea(a2);
 
-	m_unite_area->Union(a2);
-	m_unite_area->Reorder();
+	new_area->Union(a2);
+	new_area->Reorder();
+
+	// the inner curves are all in the new area now; they may point into the old one, so delete them before deleting it
+	DeleteInners();
+	delete m_unite_area;
+	m_unite_area = new_area;
+
 	for(std::list<CCurve>::iterator It = m_unite_area->m_curves.begin(); It != m_unite_area->m_curves.end(); It++)
 	{
 		CCurve &curve = *It;
 		if(It == m_unite_area->m_curves.begin())
-			m_curve = &curve;
+		{
+			// its box has grown, so move it in the outer's order
+			if(m_pOuter)m_pOuter->RemoveInner(this);
+			SetCurve(&curve);
+			if(m_pOuter)m_pOuter->AddInner(this);
+		}
 		else
 		{
 			if(curve.IsClockwise())curve.Reverse();
@@ -129,10 +199,13 @@ CAreaOrderer::CAreaOrderer()
 	m_top_level = new CInnerCurves(NULL, NULL);
 }
 
-void CAreaOrderer::Insert(CCurve* pcurve)
+CAreaOrderer::~CAreaOrderer()
 {
-	CInnerCurves::area_orderer = this;
+	delete m_top_level;
+}
 
+void CAreaOrderer::Insert(CCurve* pcurve)
+{
 	// make them all anti-clockwise as they come in
 	if(pcurve->IsClockwise())pcurve->Reverse();
 
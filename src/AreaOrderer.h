@@ -4,22 +4,31 @@
 
 #pragma once
 #include <list>
-#include <set>
+#include <map>
+#include "Curve.h"
 
 class CArea;
-class CCurve;
 
 class CAreaOrderer;
 
+// the inner curves are kept in order of the left of their boxes, with the width of the widest box,
+// so a new curve is only tested against the curves whose boxes overlap its box; the others must be its siblings
 class CInnerCurves
 {
 	CInnerCurves* m_pOuter;
 	const CCurve* m_curve; // always empty if top level
-	std::set<CInnerCurves*> m_inner_curves;
+	CBox2D m_box; // the box of m_curve
+	std::multimap<double, CInnerCurves*> m_inner_curves; // by the left of their boxes
+	double m_widest_inner; // the widest box ever added to m_inner_curves
 	CArea *m_unite_area; // new curves made by uniting are stored here
 
+	void SetCurve(const CCurve* curve);
+	void AddInner(CInnerCurves* c);
+	void RemoveInner(CInnerCurves* c);
+	void GetOverlapping(const CBox2D& box, std::list<CInnerCurves*> &overlapping)const;
+	void DeleteInners();
+
 public:
-	static CAreaOrderer* area_orderer;
 	CInnerCurves(CInnerCurves* pOuter, const CCurve* curve);
 	~CInnerCurves();
 
@@ -34,6 +43,7 @@ public:
 	CInnerCurves* m_top_level;
 
 	CAreaOrderer();
+	~CAreaOrderer();
 
 	void Insert(CCurve* pcurve);
 	CArea ResultArea()const;
@@ -5,11 +5,13 @@
 // implements CArea::MakeOnePocketCurve
 
 #include "Area.h"
+#include "AreaMedialAxis.h"
 
 #include <map>
 #include <set>
+#include <thread>
 
-static const CAreaPocketParams* pocket_params = NULL;
+class CPocketCurveJob;
 
 class IslandAndOffset
 {
@@ -19,14 +21,14 @@ public:
 	std::list<CCurve> island_inners;
 	std::list<IslandAndOffset*> touching_offsets;
 
-	IslandAndOffset(const CCurve* Island)
+	IslandAndOffset(const CCurve* Island, double stepover)
 	{
 		island = Island;
 
 		offset.m_curves.push_back(*island);
 		offset.m_curves.back().Reverse();
 
-		offset.Offset(-pocket_params->stepover);
+		offset.Offset(-stepover);
 
 
 		if(offset.m_curves.size() > 1)
@@ -42,50 +44,133 @@ public:
 	}
 };
 
+// the offsets of a curve by each multiple of the stepover, got straight from the curve's medial axis, rather than each one from the one before.
+// they are made a few at a time, on threads, as the spiral gets to them
+class COffsetLevels
+{
+	CAreaMedialAxis m_medial_axis;
+	double m_stepover;
+	std::vector<CArea> m_levels; // m_levels[i] is the curve offset by (i + 1) * stepover
+	std::vector<int> m_ok; // 0 for a level the medial axis couldn't make
+	unsigned int m_num_levels; // how many can have anything in them
+
+	void MakeMoreLevels(CAreaProcessContext &context);
+
+public:
+	COffsetLevels(const CCurve& curve, double stepover);
+
+	bool GetInners(int level, const CCurve& curve, CAreaProcessContext &context, CArea& inners); // returns false if Clipper has to be used instead
+};
+
 class CurveTree
 {
-	static std::list<CurveTree*> to_do_list_for_MakeOffsets;
-	void MakeOffsets2();
-	static std::list<CurveTree*> islands_added;
+	void MakeOffsets2(CPocketCurveJob &job);
 
 public:
 	Point point_on_parent;
 	CCurve curve;
 	std::list<CurveTree*> inners;
 	std::list<const IslandAndOffset*> offset_islands;
+	COffsetLevels* offset_levels; // where curve came from, or NULL for a curve which isn't an offset of the one before
+	int level; // curve's level in offset_levels
 	CurveTree(const CCurve &c)
 	{
 		curve = c;
+		offset_levels = NULL;
+		level = -1;
 	}
 	~CurveTree(){}
 
-	void MakeOffsets();
+	void MakeOffsets(CPocketCurveJob &job);
 };
-std::list<CurveTree*> CurveTree::islands_added;
 
 class GetCurveItem
 {
 public:
 	CurveTree* curve_tree;
 	std::list<CVertex>::iterator EndIt;
-	static std::list<GetCurveItem> to_do_list;
 
 	GetCurveItem(CurveTree* ct, std::list<CVertex>::iterator EIt):curve_tree(ct), EndIt(EIt){}
 
-	void GetCurve(CCurve& output);
+	void GetCurve(CCurve& output, CPocketCurveJob &job);
 	CVertex& back(){std::list<CVertex>::iterator It = EndIt; It--; return *It;}
 };
 
-std::list<GetCurveItem> GetCurveItem::to_do_list;
-std::list<CurveTree*> CurveTree::to_do_list_for_MakeOffsets;
+// the working values of one MakeOnePocketCurve, instead of statics, so several pockets can be made at once
+class CPocketCurveJob
+{
+public:
+	const CAreaPocketParams &params;
+	CAreaProcessContext &context;
+	std::list<CurveTree*> to_do_list_for_MakeOffsets;
+	std::list<CurveTree*> islands_added;
+	std::list<GetCurveItem> get_curve_to_do_list;
+	std::list<COffsetLevels*> offset_levels;
+
+	CPocketCurveJob(const CAreaPocketParams &Params, CAreaProcessContext &Context):params(Params), context(Context){}
+	~CPocketCurveJob()
+	{
+		for(std::list<COffsetLevels*>::iterator It = offset_levels.begin(); It != offset_levels.end(); It++)delete *It;
+	}
+};
+
+COffsetLevels::COffsetLevels(const CCurve& curve, double stepover):m_medial_axis(curve), m_stepover(stepover), m_num_levels(0)
+{
+	if(m_medial_axis.Valid())m_num_levels = (unsigned int)(m_medial_axis.MaxDistance() / stepover);
+}
+
+static void MakeOffsetLevel(const CAreaMedialAxis* medial_axis, double inwards_value, CArea* offset, int* ok)
+{
+	*ok = medial_axis->GetOffset(inwards_value, *offset) ? 1 : 0;
+}
+
+void COffsetLevels::MakeMoreLevels(CAreaProcessContext &context)
+{
+	unsigned int num_threads = context.m_max_threads;
+	if(num_threads == 0)num_threads = std::thread::hardware_concurrency();
+	if(num_threads == 0)num_threads = 1;
+
+	unsigned int first = m_levels.size();
+	if(first >= m_num_levels)return;
+	unsigned int n = m_num_levels - first;
+	if(n > num_threads)n = num_threads;
+	m_levels.resize(first + n);
+	m_ok.resize(first + n, 0);
+
+	// the calling thread makes one too
+	std::vector<std::thread> threads;
+	for(unsigned int i = 1; i < n; i++)
+		threads.push_back(std::thread(MakeOffsetLevel, &m_medial_axis, (first + i + 1) * m_stepover, &m_levels[first + i], &m_ok[first + i]));
+	MakeOffsetLevel(&m_medial_axis, (first + 1) * m_stepover, &m_levels[first], &m_ok[first]);
+	for(unsigned int i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+bool COffsetLevels::GetInners(int level, const CCurve& curve, CAreaProcessContext &context, CArea& inners)
+{
+	// the next level's curves which are inside the given curve of this level
+	unsigned int next = level + 1;
+	if(next >= m_levels.size())MakeMoreLevels(context);
+	if(next >= m_num_levels)return m_medial_axis.Valid(); // too deep for anything to be in it
+	if(!m_ok[next])return false;
+
+	const CArea& next_level = m_levels[next];
+	for(std::list<CCurve>::const_iterator It = next_level.m_curves.begin(); It != next_level.m_curves.end(); It++)
+	{
+		const CCurve& inner = *It;
+		if(level < 0 || m_levels[level].m_curves.size() == 1 || IsInside(inner.m_vertices.front().m_p, curve))
+			inners.m_curves.push_back(inner);
+	}
+	return true;
+}
 
-void GetCurveItem::GetCurve(CCurve& output)
+void GetCurveItem::GetCurve(CCurve& output, CPocketCurveJob &job)
 {
 	// walk around the curve adding spans to output until we get to an inner's point_on_parent
 	// then add a line from the inner's point_on_parent to inner's start point, then GetCurve from inner
 
 	// add start point
-	if(CArea::m_please_abort)return;
+	if(job.context.Aborted())return;
 	output.m_vertices.insert(this->EndIt, CVertex(curve_tree->curve.m_vertices.front()));
 
 	std::list<CurveTree*> inners_to_visit;
@@ -118,10 +203,10 @@ void GetCurveItem::GetCurve(CCurve& output)
 				{
 					It2++;
 				}
-				if(CArea::m_please_abort)return;
+				if(job.context.Aborted())return;
 			}
 
-			if(CArea::m_please_abort)return;
+			if(job.context.Aborted())return;
 			for(std::multimap<double, CurveTree*>::iterator It2 = ordered_inners.begin(); It2 != ordered_inners.end(); It2++)
 			{
 				CurveTree& inner = *(It2->second);
@@ -129,13 +214,13 @@ void GetCurveItem::GetCurve(CCurve& output)
 				{
 					output.m_vertices.insert(this->EndIt, CVertex(vertex.m_type, inner.point_on_parent, vertex.m_c));
 				}
-				if(CArea::m_please_abort)return;
+				if(job.context.Aborted())return;
 
 				// vertex add after GetCurve
 				std::list<CVertex>::iterator VIt = output.m_vertices.insert(this->EndIt, CVertex(inner.point_on_parent));
 
 				//inner.GetCurve(output);
-				GetCurveItem::to_do_list.push_back(GetCurveItem(&inner, VIt));
+				job.get_curve_to_do_list.push_back(GetCurveItem(&inner, VIt));
 			}
 
 			if(back().m_p != vertex.m_p)output.m_vertices.insert(this->EndIt, vertex);
@@ -143,7 +228,7 @@ void GetCurveItem::GetCurve(CCurve& output)
 		prev_vertex = &vertex;
 	}
 
-	if(CArea::m_please_abort)return;
+	if(job.context.Aborted())return;
 	for(std::list<CurveTree*>::iterator It2 = inners_to_visit.begin(); It2 != inners_to_visit.end(); It2++)
 	{
 		CurveTree &inner = *(*It2);
@@ -151,13 +236,13 @@ void GetCurveItem::GetCurve(CCurve& output)
 		{
 			output.m_vertices.insert(this->EndIt, CVertex(inner.point_on_parent));
 		}
-		if(CArea::m_please_abort)return;
+		if(job.context.Aborted())return;
 
 		// vertex add after GetCurve
 		std::list<CVertex>::iterator VIt = output.m_vertices.insert(this->EndIt, CVertex(inner.point_on_parent));
 
 		//inner.GetCurve(output);
-		GetCurveItem::to_do_list.push_back(GetCurveItem(&inner, VIt));
+		job.get_curve_to_do_list.push_back(GetCurveItem(&inner, VIt));
 
 	}
 }
@@ -192,16 +277,27 @@ static Point GetNearestPoint(CurveTree* curve_tree, std::list<CurveTree*> &islan
 	return best_point;
 }
 
-void CurveTree::MakeOffsets2()
+void CurveTree::MakeOffsets2(CPocketCurveJob &job)
 {
 	// make offsets
 
-	if(CArea::m_please_abort)return;
+	if(job.context.Aborted())return;
+	if(offset_levels == NULL)
+	{
+		job.offset_levels.push_back(new COffsetLevels(curve, job.params.stepover));
+		offset_levels = job.offset_levels.back();
+		level = -1;
+	}
+
 	CArea smaller;
-	smaller.m_curves.push_back(curve);
-	smaller.Offset(pocket_params->stepover);
+	bool from_levels = offset_levels->GetInners(level, curve, job.context, smaller);
+	if(!from_levels)
+	{
+		smaller.m_curves.push_back(curve);
+		smaller.Offset(job.params.stepover);
+	}
 
-	if(CArea::m_please_abort)return;
+	if(job.context.Aborted())return;
 
 	// test islands
 	for(std::list<const IslandAndOffset*>::iterator It = offset_islands.begin(); It != offset_islands.end();)
@@ -212,14 +308,15 @@ void CurveTree::MakeOffsets2()
 			It++; // island is still inside
 		else
 		{
+			from_levels = false; // the islands change the shape, so the next offsets need a new medial axis
 			inners.push_back(new CurveTree(*island_and_offset->island));
-			islands_added.push_back(inners.back());
+			job.islands_added.push_back(inners.back());
 			inners.back()->point_on_parent = curve.NearestPoint(*island_and_offset->island);
-			if(CArea::m_please_abort)return;
+			if(job.context.Aborted())return;
 			Point island_point = island_and_offset->island->NearestPoint(inners.back()->point_on_parent);
-			if(CArea::m_please_abort)return;
+			if(job.context.Aborted())return;
 			inners.back()->curve.ChangeStart(island_point);
-			if(CArea::m_please_abort)return;
+			if(job.context.Aborted())return;
 
 			// add the island offset's inner curves
 			for(std::list<CCurve>::const_iterator It2 = island_and_offset->island_inners.begin(); It2 != island_and_offset->island_inners.end(); It2++)
@@ -227,12 +324,12 @@ void CurveTree::MakeOffsets2()
 				const CCurve& island_inner = *It2;
 				inners.back()->inners.push_back(new CurveTree(island_inner));
 				inners.back()->inners.back()->point_on_parent = inners.back()->curve.NearestPoint(island_inner);
-				if(CArea::m_please_abort)return;
+				if(job.context.Aborted())return;
 				Point island_point = island_inner.NearestPoint(inners.back()->inners.back()->point_on_parent);
-				if(CArea::m_please_abort)return;
+				if(job.context.Aborted())return;
 				inners.back()->inners.back()->curve.ChangeStart(island_point);
-				to_do_list_for_MakeOffsets.push_back(inners.back()->inners.back()); // do it later, in a while loop
-				if(CArea::m_please_abort)return;
+				job.to_do_list_for_MakeOffsets.push_back(inners.back()->inners.back()); // do it later, in a while loop
+				if(job.context.Aborted())return;
 			}
 
 			smaller.Subtract(island_and_offset->offset);
@@ -252,7 +349,7 @@ void CurveTree::MakeOffsets2()
 				IslandAndOffsetLink touching = touching_list.front();
 				touching_list.pop_front();
 				touching.add_to->inners.push_back(new CurveTree(*touching.island_and_offset->island));
-				islands_added.push_back(touching.add_to->inners.back());
+				job.islands_added.push_back(touching.add_to->inners.back());
 				touching.add_to->inners.back()->point_on_parent = touching.add_to->curve.NearestPoint(*touching.island_and_offset->island);
 				Point island_point = touching.island_and_offset->island->NearestPoint(touching.add_to->inners.back()->point_on_parent);
 				touching.add_to->inners.back()->curve.ChangeStart(island_point);
@@ -264,12 +361,12 @@ void CurveTree::MakeOffsets2()
 					const CCurve& island_inner = *It2;
 					touching.add_to->inners.back()->inners.push_back(new CurveTree(island_inner));
 					touching.add_to->inners.back()->inners.back()->point_on_parent = touching.add_to->inners.back()->curve.NearestPoint(island_inner);
-					if(CArea::m_please_abort)return;
+					if(job.context.Aborted())return;
 					Point island_point = island_inner.NearestPoint(touching.add_to->inners.back()->inners.back()->point_on_parent);
-					if(CArea::m_please_abort)return;
+					if(job.context.Aborted())return;
 					touching.add_to->inners.back()->inners.back()->curve.ChangeStart(island_point);
-					to_do_list_for_MakeOffsets.push_back(touching.add_to->inners.back()->inners.back()); // do it later, in a while loop
-					if(CArea::m_please_abort)return;
+					job.to_do_list_for_MakeOffsets.push_back(touching.add_to->inners.back()->inners.back()); // do it later, in a while loop
+					if(job.context.Aborted())return;
 				}
 
 				for(std::list<IslandAndOffset*>::const_iterator It2 = touching.island_and_offset->touching_offsets.begin(); It2 != touching.island_and_offset->touching_offsets.end(); It2++)
@@ -282,7 +379,7 @@ void CurveTree::MakeOffsets2()
 				}
 			}
 
-			if(CArea::m_please_abort)return;
+			if(job.context.Aborted())return;
 			It = offset_islands.erase(It);
 
 			for(std::set<const IslandAndOffset*>::iterator It2 = added.begin(); It2 != added.end(); It2++)
@@ -296,19 +393,32 @@ void CurveTree::MakeOffsets2()
 		}
 	}
 
-	CArea::m_processing_done += CArea::m_MakeOffsets_increment;
-	if(CArea::m_processing_done > CArea::m_after_MakeOffsets_length)CArea::m_processing_done = CArea::m_after_MakeOffsets_length;
+	double processing_done = job.context.m_processing_done + job.context.m_MakeOffsets_increment;
+	if(processing_done > job.context.m_after_MakeOffsets_length)processing_done = job.context.m_after_MakeOffsets_length;
+	job.context.SetProgress(processing_done);
 
 	std::list<CArea> separate_areas;
-	smaller.Split(separate_areas);
-	if(CArea::m_please_abort)return;
+	if(from_levels)
+	{
+		// the offsets of one curve are all separate curves with nothing inside them
+		for(std::list<CCurve>::iterator It = smaller.m_curves.begin(); It != smaller.m_curves.end(); It++)
+		{
+			separate_areas.push_back(CArea());
+			separate_areas.back().m_curves.push_back(*It);
+		}
+	}
+	else
+	{
+		smaller.Split(separate_areas);
+	}
+	if(job.context.Aborted())return;
 	for(std::list<CArea>::iterator It = separate_areas.begin(); It != separate_areas.end(); It++)
 	{
 		CArea& separate_area = *It;
 		CCurve& first_curve = separate_area.m_curves.front();
 
 		CurveTree* nearest_curve_tree = NULL;
-		Point near_point = GetNearestPoint(this, islands_added, first_curve, &nearest_curve_tree);
+		Point near_point = GetNearestPoint(this, job.islands_added, first_curve, &nearest_curve_tree);
 
 		nearest_curve_tree->inners.push_back(new CurveTree(first_curve));
 
@@ -317,31 +427,36 @@ void CurveTree::MakeOffsets2()
 			const IslandAndOffset* island_and_offset = *It;
 			if(GetOverlapType(island_and_offset->offset, separate_area) == eInside)
 				nearest_curve_tree->inners.back()->offset_islands.push_back(island_and_offset);
-			if(CArea::m_please_abort)return;
+			if(job.context.Aborted())return;
 		}
 
 		nearest_curve_tree->inners.back()->point_on_parent = near_point;
+		if(from_levels)
+		{
+			nearest_curve_tree->inners.back()->offset_levels = offset_levels;
+			nearest_curve_tree->inners.back()->level = level + 1;
+		}
 
-		if(CArea::m_please_abort)return;
+		if(job.context.Aborted())return;
 		Point first_curve_point = first_curve.NearestPoint(nearest_curve_tree->inners.back()->point_on_parent);
-		if(CArea::m_please_abort)return;
+		if(job.context.Aborted())return;
 		nearest_curve_tree->inners.back()->curve.ChangeStart(first_curve_point);
-		if(CArea::m_please_abort)return;
-		to_do_list_for_MakeOffsets.push_back(nearest_curve_tree->inners.back()); // do it later, in a while loop
-		if(CArea::m_please_abort)return;
+		if(job.context.Aborted())return;
+		job.to_do_list_for_MakeOffsets.push_back(nearest_curve_tree->inners.back()); // do it later, in a while loop
+		if(job.context.Aborted())return;
 	}
 }
 
-void CurveTree::MakeOffsets()
+void CurveTree::MakeOffsets(CPocketCurveJob &job)
 {
-	to_do_list_for_MakeOffsets.push_back(this);
-	islands_added.clear();
+	job.to_do_list_for_MakeOffsets.push_back(this);
+	job.islands_added.clear();
 
-	while(to_do_list_for_MakeOffsets.size() > 0)
+	while(job.to_do_list_for_MakeOffsets.size() > 0)
 	{
-		CurveTree* curve_tree = to_do_list_for_MakeOffsets.front();
-		to_do_list_for_MakeOffsets.pop_front();
-		curve_tree->MakeOffsets2();
+		CurveTree* curve_tree = job.to_do_list_for_MakeOffsets.front();
+		job.to_do_list_for_MakeOffsets.pop_front();
+		curve_tree->MakeOffsets2(job);
 	}
 }
 
@@ -401,27 +516,6 @@ void recur(std::list<CArea> &arealist, const CArea& a1, const CAreaPocketParams
 	}
 }
 
-static CArea make_obround(const Point& p0, const Point& p1, double radius)
-{
-    Point dir = p1 - p0;
-    dir.normalize();
-    Point right(dir.y, -dir.x);
-    CArea obround;
-    CCurve c;
-	if(fabs(radius) < 0.0000001)radius = (radius > 0.0) ? 0.002 : (-0.002);
-    Point vt0 = p0 + right * radius;
-    Point vt1 = p1 + right * radius;
-    Point vt2 = p1 - right * radius;
-    Point vt3 = p0 - right * radius;
-	c.append(vt0);
-    c.append(vt1);
-    c.append(CVertex(1, vt2, p1));
-    c.append(vt3);
-    c.append(CVertex(1, vt0, p0));
-    obround.append(c);
-    return obround;
-}
-    
 void MarkOverlappingOffsetIslands(std::list<IslandAndOffset> &offset_islands)
 {
 	for(std::list<IslandAndOffset>::iterator It1 = offset_islands.begin(); It1 != offset_islands.end(); It1++)
@@ -444,7 +538,12 @@ void MarkOverlappingOffsetIslands(std::list<IslandAndOffset> &offset_islands)
 
 void CArea::MakeOnePocketCurve(std::list<CCurve> &curve_list, const CAreaPocketParams &params)const
 {
-	if(CArea::m_please_abort)return;
+	MakeOnePocketCurve(curve_list, params, m_default_context);
+}
+
+void CArea::MakeOnePocketCurve(std::list<CCurve> &curve_list, const CAreaPocketParams &params, CAreaProcessContext &context)const
+{
+	if(context.Aborted())return;
 #if 0  // simple offsets with feed or rapid joins
 	CArea area_for_feed_possible = *this;
 
@@ -487,10 +586,10 @@ void CArea::MakeOnePocketCurve(std::list<CCurve> &curve_list, const CAreaPocketP
 		}
 	}
 #else
-	pocket_params = &params;
+	CPocketCurveJob job(params, context);
 	if(m_curves.size() == 0)
 	{
-		CArea::m_processing_done += CArea::m_single_area_processing_length;
+		context.AddProgress(context.m_single_area_processing_length);
 		return;
 	}
 	CurveTree top_level(m_curves.front());
@@ -502,36 +601,36 @@ void CArea::MakeOnePocketCurve(std::list<CCurve> &curve_list, const CAreaPocketP
 		const CCurve& c = *It;
 		if(It != m_curves.begin())
 		{
-			IslandAndOffset island_and_offset(&c);
+			IslandAndOffset island_and_offset(&c, params.stepover);
 			offset_islands.push_back(island_and_offset);
 			top_level.offset_islands.push_back(&(offset_islands.back()));
-			if(m_please_abort)return;
+			if(context.Aborted())return;
 		}
 	}
 
 	MarkOverlappingOffsetIslands(offset_islands);
 
-	CArea::m_processing_done += CArea::m_single_area_processing_length * 0.1;
+	context.AddProgress(context.m_single_area_processing_length * 0.1);
 
-	double MakeOffsets_processing_length = CArea::m_single_area_processing_length * 0.8;
-	CArea::m_after_MakeOffsets_length = CArea::m_processing_done + MakeOffsets_processing_length;
+	double MakeOffsets_processing_length = context.m_single_area_processing_length * 0.8;
+	context.m_after_MakeOffsets_length = context.m_processing_done + MakeOffsets_processing_length;
 	double guess_num_offsets = sqrt(GetArea(true)) * 0.5 / params.stepover;
-	CArea::m_MakeOffsets_increment = MakeOffsets_processing_length / guess_num_offsets;
+	context.m_MakeOffsets_increment = MakeOffsets_processing_length / guess_num_offsets;
 
-	top_level.MakeOffsets();
-	if(CArea::m_please_abort)return;
-	CArea::m_processing_done = CArea::m_after_MakeOffsets_length;
+	top_level.MakeOffsets(job);
+	if(context.Aborted())return;
+	context.SetProgress(context.m_after_MakeOffsets_length);
 
 	curve_list.push_back(CCurve());
 	CCurve& output = curve_list.back();
 
-	GetCurveItem::to_do_list.push_back(GetCurveItem(&top_level, output.m_vertices.end()));
+	job.get_curve_to_do_list.push_back(GetCurveItem(&top_level, output.m_vertices.end()));
 
-	while(GetCurveItem::to_do_list.size() > 0)
+	while(job.get_curve_to_do_list.size() > 0)
 	{
-		GetCurveItem item = GetCurveItem::to_do_list.front();
-		item.GetCurve(output);
-		GetCurveItem::to_do_list.pop_front();
+		GetCurveItem item = job.get_curve_to_do_list.front();
+		item.GetCurve(output, job);
+		job.get_curve_to_do_list.pop_front();
 	}
 
 	// delete curve_trees non-recursively
@@ -551,7 +650,7 @@ void CArea::MakeOnePocketCurve(std::list<CCurve> &curve_list, const CAreaPocketP
 		delete curve_tree;
 	}
 
-	CArea::m_processing_done += CArea::m_single_area_processing_length * 0.1;
+	context.AddProgress(context.m_single_area_processing_length * 0.1);
 #endif
 }
 
@@ -66,7 +66,7 @@ CAutoSave::~CAutoSave()
  */
 void CAutoSave::Notify()
 {
-	wxGetApp().SaveXMLFile( m_backup_file_name.c_str() );
+	wxGetApp().SaveBinaryFile( m_backup_file_name.c_str() );
 
 } // End Notify() method
 
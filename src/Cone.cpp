@@ -156,6 +156,11 @@ void CCone::MakeTransformedShape(const gp_Trsf &mat)
 	m_shape = BRepPrimAPI_MakeCone(m_pos, m_r1, m_r2, m_height).Shape();
 }
 
+void CCone::MoveParameters(const gp_Trsf &mat)
+{
+	m_pos.Transform(mat);
+}
+
 wxString CCone::StretchedName(){ return _("Stretched Cone");}
 
 void CCone::GetProperties(std::list<Property *> *list)
@@ -12,6 +12,7 @@ protected:
 
 	// CShape's virtual functions
 	void MakeTransformedShape(const gp_Trsf &mat);
+	void MoveParameters(const gp_Trsf &mat);
 	wxString StretchedName();
 
 public:
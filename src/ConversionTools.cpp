@@ -800,6 +800,8 @@ void MakeEdgesToSketch::Run(){
 		switch(object->GetType()){
 			case EdgeType:
 				{
+					CShape* body = ((CEdge*)object)->GetParentBody();
+					if(body)body->WaitForMesh(); // the edge gets remeshed
 					ConvertEdgeToSketch2(((CEdge*)object)->Edge(), sketch, FaceToSketchTool::deviation);
 				}
 				break;
@@ -29,6 +29,7 @@ public:
 	long GetMarkingMask()const{return MARKING_FILTER_COORDINATE_SYSTEM;}
 	void glCommands(bool select, bool marked, bool no_color);
 	void GetBox(CBox &box);
+	bool PickWithoutBox(){return true;}
 	const wxChar* GetTypeString(void)const{return _("Coordinate System");}
 	const wxChar* GetShortString(void)const{return m_title.c_str();}
 	bool CanEditString(void)const{return true;}
@@ -80,6 +80,11 @@ void CCuboid::MakeTransformedShape(const gp_Trsf &mat)
 	m_shape = BRepPrimAPI_MakeBox(m_pos, m_x, m_y, m_z).Shape();
 }
 
+void CCuboid::MoveParameters(const gp_Trsf &mat)
+{
+	m_pos.Transform(mat);
+}
+
 wxString CCuboid::StretchedName(){ return _("Stretched Cuboid");}
 
 void CCuboid::GetProperties(std::list<Property *> *list)
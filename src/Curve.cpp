@@ -354,13 +354,13 @@ Point CCurve::NearestPoint(const CCurve& c, double *d)const
 	return best_point;
 }
 
-void CCurve::GetBox(CBox2D &box)
+void CCurve::GetBox(CBox2D &box)const
 {
 	Point prev_p = Point(0, 0);
 	bool prev_p_valid = false;
-	for(std::list<CVertex>::iterator It = m_vertices.begin(); It != m_vertices.end(); It++)
+	for(std::list<CVertex>::const_iterator It = m_vertices.begin(); It != m_vertices.end(); It++)
 	{
-		CVertex& vertex = *It;
+		const CVertex& vertex = *It;
 		if(prev_p_valid)
 		{
 			Span(prev_p, vertex).GetBox(box);
@@ -426,6 +426,9 @@ void CCurve::ChangeStart(const Point &p) {
 	int start_span;
 	bool closed = IsClosed();
 
+	// already starting there; going round from it would add a second lap
+	if(closed && p == m_vertices.front().m_p)return;
+
 	for(int i = 0; i < (closed ? 2:1); i++)
 	{
 		const Point *prev_p = NULL;
@@ -922,11 +925,21 @@ void CCurve::CurveIntersections(const CCurve& c, std::list<Point> &pts)const
 
 void CCurve::SpanIntersections(const Span& s, std::list<Point> &pts)const
 {
+	CBox2D s_box;
+	s.GetBox(s_box);
+
 	std::list<Span> spans;
 	GetSpans(spans);
 	for(std::list<Span>::iterator It = spans.begin(); It != spans.end(); It++)
 	{
 		Span& span = *It;
+
+		// only intersect the spans whose boxes overlap
+		CBox2D box;
+		span.GetBox(box);
+		if(box.m_minxy.x > s_box.m_maxxy.x + Point::tolerance || s_box.m_minxy.x > box.m_maxxy.x + Point::tolerance)continue;
+		if(box.m_minxy.y > s_box.m_maxxy.y + Point::tolerance || s_box.m_minxy.y > box.m_maxxy.y + Point::tolerance)continue;
+
 		std::list<Point> pts2;
 		span.Intersect(s, pts2);
 		for(std::list<Point>::iterator It = pts2.begin(); It != pts2.end(); It++)
@@ -1080,7 +1093,7 @@ static Point QuadrantEndPoint(int i)
 	}
 }
 
-void Span::GetBox(CBox2D &box)
+void Span::GetBox(CBox2D &box)const
 {
 	box.Insert(m_p);
 	box.Insert(m_v.m_p);
@@ -74,6 +74,11 @@ void CCylinder::MakeTransformedShape(const gp_Trsf &mat)
 	m_shape = MakeCylinder(m_pos, m_radius, m_height);
 }
 
+void CCylinder::MoveParameters(const gp_Trsf &mat)
+{
+	m_pos.Transform(mat);
+}
+
 wxString CCylinder::StretchedName(){ return _("Stretched Cylinder");}
 
 void CCylinder::GetProperties(std::list<Property *> *list)
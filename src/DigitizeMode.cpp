@@ -22,15 +22,18 @@
 
 #include "DigitizeMode.h"
 #include "Drawing.h"
+#include "SnapCache.h"
 
 DigitizeMode::DigitizeMode(){
 	point_or_window = new PointOrWindow(false);
+	m_snap_cache = new CSnapCache;
 	m_doing_a_main_loop = false;
 	m_callback = NULL;
 }
 
 DigitizeMode::~DigitizeMode(void){
 	delete point_or_window;
+	delete m_snap_cache;
 }
 
 static wxString digitize_title_coords_string;
@@ -176,104 +179,56 @@ bool DigitizeMode::OnModeChange(void){
 DigitizedPoint DigitizeMode::digitize1(const wxPoint &input_point){
 	gp_Lin ray = wxGetApp().m_current_viewport->m_view_point.SightLine(input_point);
 	std::list<DigitizedPoint> compare_list;
-	MarkedObjectManyOfSame marked_object;
+	std::list<CSnapObject*> snap_objects;
 	if(wxGetApp().digitize_end || wxGetApp().digitize_inters || wxGetApp().digitize_centre || wxGetApp().digitize_midpoint || wxGetApp().digitize_nearest || wxGetApp().digitize_tangent){
-		point_or_window->SetWithPoint(input_point);
-		wxGetApp().m_marked_list->ignore_coords_only = true;
-		wxGetApp().m_marked_list->ObjectsInWindow(point_or_window->box_chosen, &marked_object);
-		wxGetApp().m_marked_list->ignore_coords_only = false;
+		wxPoint gl_point(input_point.x, wxGetApp().m_current_viewport->GetViewportSize().GetHeight() - input_point.y);
+		m_snap_cache->GetObjectsNear(wxGetApp().m_current_viewport->m_view_point, gl_point, 10, snap_objects);
 	}
 	if(wxGetApp().digitize_end){
-		if(marked_object.m_map.size()>0){
-			HeeksObj* object = marked_object.GetFirstOfBottomOnly();
-			while(object){
-				std::list<GripData> vl;
-				object->GetGripperPositionsTransformed(&vl, true);
-				std::list<gp_Pnt> plist;
-				convert_gripdata_to_pnts(vl, plist);
-				for(std::list<gp_Pnt>::iterator It = plist.begin(); It != plist.end(); It++)
-				{
-					gp_Pnt& pnt = *It;
-					compare_list.push_back(DigitizedPoint(pnt, DigitizeEndofType));
-				}
-				object = marked_object.Increment();
+		for(std::list<CSnapObject*>::iterator It = snap_objects.begin(); It != snap_objects.end(); It++){
+			CSnapObject* snap_object = *It;
+			for(std::list<gp_Pnt>::iterator It2 = snap_object->m_ends.begin(); It2 != snap_object->m_ends.end(); It2++)
+			{
+				compare_list.push_back(DigitizedPoint(*It2, DigitizeEndofType));
 			}
 		}
 	}
 	if(wxGetApp().digitize_inters){
-		if(marked_object.m_map.size()>0){
-			std::list<HeeksObj*> object_list;
-			HeeksObj* object = marked_object.GetFirstOfBottomOnly();
-			while(object){
-				object_list.push_back(object);
-				object = marked_object.Increment();
-			}
-
-			if(object_list.size() > 1)
+		for(std::list<CSnapObject*>::iterator It = snap_objects.begin(); It != snap_objects.end(); It++){
+			CSnapObject* snap_object = *It;
+			for(std::list<CSnapIntersection>::iterator It2 = snap_object->m_intersections.begin(); It2 != snap_object->m_intersections.end(); It2++)
 			{
-				for(std::list<HeeksObj*>::iterator It = object_list.begin(); It != object_list.end(); It++)
-				{
-					HeeksObj* object = *It;
-					std::list<HeeksObj*>::iterator It2 = It;
-					It2++;
-					for(; It2 != object_list.end(); It2++)
-					{
-						HeeksObj* object2 = *It2;
-						std::list<double> rl;
-						if(object->Intersects(object2, &rl))
-						{
-							std::list<gp_Pnt> plist;
-							convert_doubles_to_pnts(rl, plist);
-							for(std::list<gp_Pnt>::iterator It = plist.begin(); It != plist.end(); It++)
-							{
-								gp_Pnt& pnt = *It;
-								compare_list.push_back(DigitizedPoint(pnt, DigitizeIntersType));
-							}
-						}
-					}
-				}
+				compare_list.push_back(DigitizedPoint(It2->m_point, DigitizeIntersType));
 			}
 		}
 	}
 	if(wxGetApp().digitize_midpoint){
-		if(marked_object.m_map.size()>0){
-			HeeksObj* object = marked_object.GetFirstOfBottomOnly();
-			while(object){
-				double p[3];
-				if(object->GetMidPoint(p)){
-					compare_list.push_back(DigitizedPoint(make_point(p), DigitizeMidpointType));
-				}
-				object = marked_object.Increment();
+		for(std::list<CSnapObject*>::iterator It = snap_objects.begin(); It != snap_objects.end(); It++){
+			CSnapObject* snap_object = *It;
+			for(std::list<gp_Pnt>::iterator It2 = snap_object->m_mids.begin(); It2 != snap_object->m_mids.end(); It2++)
+			{
+				compare_list.push_back(DigitizedPoint(*It2, DigitizeMidpointType));
 			}
 		}
 	}
+	double ray_start[3], ray_direction[3];
+	extract(ray.Location(), ray_start);
+	extract(ray.Direction(), ray_direction);
 	if(wxGetApp().digitize_nearest){
-		if(marked_object.m_map.size()>0){
-			HeeksObj* object = marked_object.GetFirstOfEverything();
-			while(object){
-				double ray_start[3], ray_direction[3];
-				extract(ray.Location(), ray_start);
-				extract(ray.Direction(), ray_direction);
-				double p[3];
-				if(object->FindNearPoint(ray_start, ray_direction, p)){
-					compare_list.push_back(DigitizedPoint(make_point(p), DigitizeNearestType));
-				}
-				object = marked_object.Increment();
+		for(std::list<CSnapObject*>::iterator It = snap_objects.begin(); It != snap_objects.end(); It++){
+			HeeksObj* object = (*It)->m_object;
+			double p[3];
+			if(object->FindNearPoint(ray_start, ray_direction, p)){
+				compare_list.push_back(DigitizedPoint(make_point(p), DigitizeNearestType));
 			}
 		}
 	}
 	if(wxGetApp().digitize_tangent){
-		if(marked_object.m_map.size()>0){
-			HeeksObj* object = marked_object.GetFirstOfEverything();
-			while(object){
-				double ray_start[3], ray_direction[3];
-				extract(ray.Location(), ray_start);
-				extract(ray.Direction(), ray_direction);
-				double p[3];
-				if(object->FindPossTangentPoint(ray_start, ray_direction, p)){
-					compare_list.push_back(DigitizedPoint(make_point(p), DigitizeTangentType, object));
-				}
-				object = marked_object.Increment();
+		for(std::list<CSnapObject*>::iterator It = snap_objects.begin(); It != snap_objects.end(); It++){
+			HeeksObj* object = (*It)->m_object;
+			double p[3];
+			if(object->FindPossTangentPoint(ray_start, ray_direction, p)){
+				compare_list.push_back(DigitizedPoint(make_point(p), DigitizeTangentType, object));
 			}
 		}
 	}
@@ -302,25 +257,28 @@ DigitizedPoint DigitizeMode::digitize1(const wxPoint &input_point){
 		}
 	}
 	if(wxGetApp().digitize_centre && (min_dist == -1 || min_dist * wxGetApp().GetPixelScale()>5)){
-		gp_Pnt pos;
-		for(HeeksObj* object = marked_object.GetFirstOfEverything(); object != NULL; object = marked_object.Increment()){
-			double p[3], p2[3];
-			int num = object->GetCentrePoints(p, p2);
-			if(num == 1)
+		// use the centre of the object under the mouse
+		double best_object_dist = -1;
+		for(std::list<CSnapObject*>::iterator It = snap_objects.begin(); It != snap_objects.end(); It++){
+			CSnapObject* snap_object = *It;
+			if(snap_object->m_centres.size() == 0)continue;
+			double object_dist = 0.0;
+			double p[3];
+			if(snap_object->m_object->FindNearPoint(ray_start, ray_direction, p))
 			{
-				compare_list.push_back(DigitizedPoint(make_point(p), DigitizeCentreType));
+				object_dist = ray.Distance(make_point(p));
+				if(object_dist * wxGetApp().GetPixelScale() > 5)continue;
 			}
-			else if(num == 2)
+			if(best_object_dist >= 0 && object_dist >= best_object_dist)continue;
+
+			gp_Pnt centre = snap_object->m_centres.front();
+			for(std::list<gp_Pnt>::iterator It2 = snap_object->m_centres.begin(); It2 != snap_object->m_centres.end(); It2++)
 			{
-				double dist1 = ray.Distance(make_point(p));
-				double dist2 = ray.Distance(make_point(p2));
-				compare_list.push_back(DigitizedPoint(make_point((dist1 < dist2) ? p:p2), DigitizeCentreType));
+				if(ray.Distance(*It2) < ray.Distance(centre))centre = *It2;
 			}
-			else
-				continue;
-
+			compare_list.push_back(DigitizedPoint(centre, DigitizeCentreType));
 			best_digitized_point = &(compare_list.back());
-			break;
+			best_object_dist = object_dist;
 		}
 	}
 	DigitizedPoint point;
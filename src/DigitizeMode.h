@@ -9,10 +9,12 @@
 
 class CViewPoint;
 class PointOrWindow;
+class CSnapCache;
 
 class DigitizeMode:public CInputMode{
 private:
 	PointOrWindow *point_or_window;
+	CSnapCache *m_snap_cache;
 	DigitizedPoint lbutton_point;
 	std::set<HeeksObj*> m_only_coords_set;
 
@@ -23,6 +23,15 @@ CEdge::CEdge(const TopoDS_Edge &edge):m_topods_edge(edge), m_vertex0(NULL), m_ve
 CEdge::~CEdge(){
 }
 
+void CEdge::MoveWithBody(const TopLoc_Location &loc){
+	// the parent body has been moved by its location
+	m_topods_edge.Move(loc);
+	Evaluate(m_start_u, &m_start_x, &m_start_tangent_x);
+	double t[3];
+	Evaluate(m_end_u, &m_end_x, t);
+	m_midpoint_calculated = false;
+}
+
 const wxBitmap &CEdge::GetIcon()
 {
 	static wxBitmap* icon = NULL;
@@ -35,11 +44,13 @@ void CEdge::glCommands(bool select, bool marked, bool no_color){
 		wxGetApp().glColorEnsuringContrast(HeeksColor(0, 0, 0));
 	}
 
-	if(m_owner && m_owner->m_owner && m_owner->m_owner->GetType() == SolidType)
+	CShape* body = GetParentBody();
+	if(body)
 	{
 		// triangulate a face on the edge first
 		if(this->m_faces.size() > 0)
 		{
+			body->WaitForMesh();
 			TopLoc_Location fL;
 			Handle_Poly_Triangulation facing = BRep_Tool::Triangulation(m_faces.front()->Face(),fL);
 
@@ -192,6 +203,8 @@ public:
 	wxString BitmapPath(){return _T("edge2sketch");}
 	void Run(){
 		CSketch* new_object = new CSketch();
+		CShape* body = edge_for_tools->GetParentBody();
+		if(body)body->WaitForMesh(); // the edge gets remeshed
 		ConvertEdgeToSketch2(edge_for_tools->Edge(), new_object, FaceToSketchTool::deviation);
 		wxGetApp().Add(new_object, NULL);
 	}
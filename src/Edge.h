@@ -61,6 +61,7 @@ public:
 	bool GetEndPoint(double* pos);
 
 	const TopoDS_Edge &Edge(){return m_topods_edge;}
+	void MoveWithBody(const TopLoc_Location &loc);
 	//void Blend(double radius);
  	void Blend(double radius,bool chamfer_not_fillet);
 	CFace* GetFirstFace();
@@ -37,8 +37,10 @@ CFace::~CFace(){
 
 void CFace::glCommands(bool select, bool marked, bool no_color){
 	bool owned_by_solid = false;
-	if(GetParentBody()) {
+	CShape* body = GetParentBody();
+	if(body) {
 		// using existing BRepMesh::Mesh
+		body->WaitForMesh();
 		// use solid's colour
 		owned_by_solid = true;
 
@@ -68,15 +70,6 @@ void CFace::glCommands(bool select, bool marked, bool no_color){
 	}
 }
 
-CFace* FaceForBoxCallback;
-
-void box_callback(const double* x, const double* n)
-{
-	FaceForBoxCallback->m_box.Insert(x[0],x[1],x[2]);
-	FaceForBoxCallback->m_box.Insert(x[3],x[4],x[5]);
-	FaceForBoxCallback->m_box.Insert(x[6],x[7],x[8]);
-}
-
 const wxBitmap &CFace::GetIcon()
 {
 	static wxBitmap* icon = NULL;
@@ -85,16 +78,15 @@ const wxBitmap &CFace::GetIcon()
 }
 
 void CFace::GetBox(CBox &box){
-//	if(!m_box.m_valid)
+	// from the geometry, so it doesn't need the mesh, which may be being made on another thread
+	Bnd_Box bnd_box;
+	BRepBndLib::Add(m_topods_face, bnd_box, Standard_False);
+	m_box = CBox();
+	if(!bnd_box.IsVoid())
 	{
-		// there must be a better way than re-using the render code
-		// Get triangulation
-		if(GetParentBody() == NULL){
-			MeshFace(m_topods_face,.01);
-		}
-
-		FaceForBoxCallback = this;
-		DrawFace(m_topods_face,box_callback,false);
+		double x0, y0, z0, x1, y1, z1;
+		bnd_box.Get(x0, y0, z0, x1, y1, z1);
+		m_box = CBox(x0, y0, z0, x1, y1, z1);
 	}
 
 	box.Insert(m_box);
@@ -109,9 +101,22 @@ void CFace::ModifyByMatrix(const double *m){
 	}
 }
 
+void CFace::MoveWithBody(const TopLoc_Location &loc){
+	// the parent body has been moved by its location
+	m_topods_face.Move(loc);
+	for(std::list<CLoop*>::iterator It = m_loops.begin(); It != m_loops.end(); It++)
+	{
+		CLoop* loop = *It;
+		loop->m_topods_wire.Move(loc);
+	}
+	m_box = CBox();
+}
+
 void CFace::GetTriangles(void(*callbackfunc)(const double* x, const double* n), double cusp, bool just_one_average_normal){
-	if(GetParentBody()) {
+	CShape* body = GetParentBody();
+	if(body) {
 		// using existing BRepMesh::Mesh
+		body->WaitForMesh();
 	}
 	else {
 		MeshFace(m_topods_face,1/cusp);
@@ -207,6 +212,8 @@ static CFace* face_for_tools = NULL;
 
 void FaceToSketchTool::Run(){
 	CSketch* new_object = new CSketch();
+	CShape* body = face_for_tools->GetParentBody();
+	if(body)body->WaitForMesh(); // the edges get remeshed
 	ConvertFaceToSketch2(face_for_tools->Face(), new_object, deviation);
 	wxGetApp().AddUndoably(new_object, NULL, NULL);
 }
@@ -45,6 +45,7 @@ public:
 	void GetTriangles(void(*callbackfunc)(const double* x, const double* n), double cusp, bool just_one_average_normal = false);
 	double Area()const;
 	void ModifyByMatrix(const double* m);
+	void MoveWithBody(const TopLoc_Location &loc);
 	void WriteXML(TiXmlNode *root);
 	void GetProperties(std::list<Property *> *list);
 	bool UsesID(){return true;}
@@ -0,0 +1,449 @@
+// GCodeRead.cpp
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+#include "stdafx.h"
+
+#include "GCodeRead.h"
+#include "NCCode.h"
+#include "OutputCanvas.h"
+#include "MappedFile.h"
+
+#include <wx/progdlg.h>
+#include <wx/stopwatch.h>
+
+class GCodeWord
+{
+public:
+	char m_letter; // upper case
+	double m_value;
+	GCodeWord(char letter, double value):m_letter(letter), m_value(value){}
+};
+
+static const char* ReadNumber(const char* p, const char* end, double &value)
+{
+	// reads a number like "-1.5" or ".5", without sscanf or streams, which are slow and depend on the locale
+	// returns the character after the number, or NULL if there isn't one
+	while (p < end && (*p == ' ' || *p == '\t'))p++;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	double mantissa = 0.0;
+	double divisor = 1.0;
+	bool digits = false;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+	{
+		mantissa = mantissa * 10 + (*p - '0');
+		digits = true;
+	}
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			divisor *= 10;
+			digits = true;
+		}
+	}
+	if (!digits)return NULL;
+
+	value = mantissa / divisor;
+	if (negative)value = -value;
+	return p;
+}
+
+static ColorEnum GetWordColor(char letter, double value)
+{
+	switch(letter)
+	{
+	case 'N':
+		return ColorBlockType;
+	case 'O':
+		return ColorProgramType;
+	case 'G':
+		if(value == 0.0)return ColorRapidType;
+		if(value == 1.0 || value == 2.0 || value == 3.0)return ColorFeedType;
+		return ColorPrepType;
+	case 'M':
+		return ColorMiscType;
+	case 'T':
+		return ColorToolType;
+	default:
+		return ColorAxisType;
+	}
+}
+
+static void GetPlaneAxes(int plane, int &a, int &b, int &c)
+{
+	// a to b is anti-clockwise, looking down c
+	switch(plane)
+	{
+	case 18:
+		a = 2; b = 0; c = 1;
+		break;
+	case 19:
+		a = 1; b = 2; c = 0;
+		break;
+	default:
+		a = 0; b = 1; c = 2;
+		break;
+	}
+}
+
+static bool CentreFromRadius(const double* s, const double* e, int a, int b, double r, int dir, double* centre)
+{
+	// the centre, relative to the start, of an arc given by its radius; a negative radius means the arc is more than half a circle
+	double dx = e[a] - s[a];
+	double dy = e[b] - s[b];
+	double d = sqrt(dx * dx + dy * dy);
+	if(d < 0.000000001)return false;
+
+	double h2 = r * r - d * d / 4;
+	double h = (h2 > 0.0) ? sqrt(h2) : 0.0;
+
+	// anti-clockwise arcs of less than half a circle have their centre on the left
+	double side = (r > 0.0) ? dir : -dir;
+	centre[0] = centre[1] = centre[2] = 0.0;
+	centre[a] = dx / 2 - side * h * dy / d;
+	centre[b] = dy / 2 + side * h * dx / d;
+	return true;
+}
+
+static ColouredPath& GetPath(CNCCodeBlock* block, ColorEnum color_type)
+{
+	// moves of the same colour, one after the other, go in one path
+	if(block->m_line_strips.size() == 0 || block->m_line_strips.back().m_color_type != color_type)
+	{
+		block->m_line_strips.push_back(ColouredPath());
+		block->m_line_strips.back().m_color_type = color_type;
+	}
+	return block->m_line_strips.back();
+}
+
+CGCodeRead::CGCodeRead():m_motion(0), m_plane(17), m_absolute(true), m_arc_absolute(false), m_retract_to_r(false), m_units(1.0), m_feed(0.0), m_tool_number(0), m_cycle_z(0.0), m_cycle_r(0.0)
+{
+	m_x[0] = m_x[1] = m_x[2] = 0.0;
+}
+
+void CGCodeRead::AddLine(CNCCodeBlock* block, bool rapid, const double* x)
+{
+	PathLine* line = new PathLine;
+	memcpy(line->m_x, x, 3*sizeof(double));
+	line->m_tool_number = m_tool_number;
+	line->m_feed = m_feed;
+	GetPath(block, rapid ? ColorRapidType : ColorFeedType).m_points.push_back(line);
+	memcpy(m_x, x, 3*sizeof(double));
+}
+
+void CGCodeRead::AddArc(CNCCodeBlock* block, const double* x, const double* centre, int dir)
+{
+	int a, b, c;
+	GetPlaneAxes(m_plane, a, b, c);
+
+	if(fabs(centre[a]) < 0.000000001 && fabs(centre[b]) < 0.000000001)
+	{
+		AddLine(block, false, x);
+		return;
+	}
+
+	if(m_plane == 17)
+	{
+		PathArc* arc = new PathArc;
+		memcpy(arc->m_x, x, 3*sizeof(double));
+		arc->m_c[0] = centre[0];
+		arc->m_c[1] = centre[1];
+		arc->m_radius = sqrt(centre[0] * centre[0] + centre[1] * centre[1]);
+		arc->m_dir = dir;
+		arc->m_tool_number = m_tool_number;
+		arc->m_feed = m_feed;
+		GetPath(block, ColorFeedType).m_points.push_back(arc);
+		memcpy(m_x, x, 3*sizeof(double));
+		return;
+	}
+
+	// PathArc is only in the XY plane, so arcs in the other planes are split into lines, the same way PathArc::Interpolate does
+	double s[3];
+	memcpy(s, m_x, 3*sizeof(double));
+	double sx = -centre[a];
+	double sy = -centre[b];
+	double ex = x[a] - s[a] - centre[a];
+	double ey = x[b] - s[b] - centre[b];
+	double rs = sqrt(sx * sx + sy * sy);
+	double re = sqrt(ex * ex + ey * ey);
+	double start_angle = atan2(sy, sx);
+	double end_angle = atan2(ey, ex);
+	if(dir == 1){
+		if(end_angle <= start_angle)end_angle += 2 * M_PI;
+	}
+	else{
+		if(start_angle <= end_angle)start_angle += 2 * M_PI;
+	}
+
+	int n = CNCCode::s_arc_interpolation_count;
+	if(n < 1)n = 1;
+	for(int i = 1; i <= n; i++)
+	{
+		double p[3];
+		if(i == n)
+		{
+			memcpy(p, x, 3*sizeof(double));
+		}
+		else
+		{
+			double angle = start_angle + ((end_angle - start_angle) * i) / n;
+			double r = rs + ((re - rs) * i) / n;
+			p[a] = s[a] + centre[a] + r * cos(angle);
+			p[b] = s[b] + centre[b] + r * sin(angle);
+			p[c] = s[c] + ((x[c] - s[c]) * i) / n;
+		}
+		AddLine(block, false, p);
+	}
+}
+
+CNCCodeBlock* CGCodeRead::ReadBlock(const char* line, const char* end)
+{
+	while(end > line && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))end--;
+	if(end == line)return NULL;
+
+	CNCCodeBlock* block = new CNCCodeBlock;
+	block->m_from_pos = CNCCode::pos;
+
+	// split the line into coloured text, keeping the spaces, and make a list of the words
+	std::vector<GCodeWord> words;
+	for(const char* p = line; p < end;)
+	{
+		const char* start = p;
+		while(p < end && (*p == ' ' || *p == '\t'))p++;
+
+		ColorEnum color_type = ColorDefaultType;
+		char letter = (char)toupper((unsigned char)*p);
+		if(*p == '(')
+		{
+			while(p < end && *p != ')')p++;
+			if(p < end)p++;
+			color_type = ColorCommentType;
+		}
+		else if(*p == ';')
+		{
+			p = end;
+			color_type = ColorCommentType;
+		}
+		else if(*p == '%')
+		{
+			p++;
+			color_type = ColorProgramType;
+		}
+		else if(letter >= 'A' && letter <= 'Z')
+		{
+			double value;
+			const char* number_end = ReadNumber(p + 1, end, value);
+			if(number_end)
+			{
+				p = number_end;
+				words.push_back(GCodeWord(letter, value));
+				color_type = GetWordColor(letter, value);
+			}
+			else
+			{
+				// a word with a parameter or an expression, like X#1 or X[#1 + 2], which isn't evaluated
+				for(p++; p < end && *p != ' ' && *p != '\t' && *p != '('; p++);
+				color_type = ColorVariableType;
+			}
+		}
+		else if(*p == '#')
+		{
+			// a parameter setting, like #1 = 2
+			for(p++; p < end && *p != '(' && !isalpha((unsigned char)*p); p++);
+			color_type = ColorVariableType;
+		}
+		else
+		{
+			p++;
+		}
+
+		ColouredText text;
+		text.m_str = wxString::FromUTF8(start, p - start);
+		text.m_color_type = color_type;
+		block->m_text.push_back(text);
+		CNCCode::pos += text.m_str.Len();
+	}
+	CNCCode::pos++;
+	block->m_to_pos = CNCCode::pos;
+
+	// the modes first, so the units and distance modes apply to the coordinates on the same line
+	bool no_motion = false; // for commands which use the coordinates for something else
+	for(std::vector<GCodeWord>::iterator It = words.begin(); It != words.end(); It++)
+	{
+		if(It->m_letter != 'G')continue;
+		int code = (int)floor(It->m_value * 10 + 0.5);
+		switch(code)
+		{
+		case 0: m_motion = 0; break;
+		case 10: m_motion = 1; break;
+		case 20: m_motion = 2; break;
+		case 30: m_motion = 3; break;
+		case 170: m_plane = 17; break;
+		case 180: m_plane = 18; break;
+		case 190: m_plane = 19; break;
+		case 200: m_units = 25.4; break;
+		case 210: m_units = 1.0; break;
+		case 800: m_motion = 0; break;
+		case 900: m_absolute = true; break;
+		case 901: m_arc_absolute = true; break;
+		case 910: m_absolute = false; break;
+		case 911: m_arc_absolute = false; break;
+		case 980: m_retract_to_r = false; break;
+		case 990: m_retract_to_r = true; break;
+		case 40: // dwell
+		case 100: // set offsets
+		case 280: // go home
+		case 300: // go to second home
+		case 520: // set local coordinate system
+		case 920: // set position
+			no_motion = true;
+			break;
+		default:
+			if(code >= 810 && code <= 890 && code % 10 == 0)m_motion = code / 10;
+			break;
+		}
+	}
+
+	double x[3];
+	memcpy(x, m_x, 3*sizeof(double));
+	bool has_x[3] = {false, false, false};
+	double ijk[3] = {0.0, 0.0, 0.0};
+	bool has_ijk[3] = {false, false, false};
+	double r = 0.0;
+	bool has_r = false;
+	for(std::vector<GCodeWord>::iterator It = words.begin(); It != words.end(); It++)
+	{
+		double value = It->m_value * m_units;
+		switch(It->m_letter)
+		{
+		case 'X':
+		case 'Y':
+		case 'Z':
+			{
+				int i = It->m_letter - 'X';
+				x[i] = m_absolute ? value : (x[i] + value);
+				has_x[i] = true;
+			}
+			break;
+		case 'I':
+		case 'J':
+		case 'K':
+			ijk[It->m_letter - 'I'] = value;
+			has_ijk[It->m_letter - 'I'] = true;
+			break;
+		case 'R':
+			r = value;
+			has_r = true;
+			break;
+		case 'F':
+			m_feed = value;
+			break;
+		case 'T':
+			m_tool_number = (int)(It->m_value);
+			break;
+		}
+	}
+
+	if(no_motion || !(has_x[0] || has_x[1] || has_x[2]))return block;
+
+	if(m_motion >= 81 && m_motion <= 89)
+	{
+		// a drilling cycle; Z is the depth and R is the retract height, until they are given again
+		if(has_x[2])m_cycle_z = x[2];
+		if(has_r)m_cycle_r = m_absolute ? r : (m_x[2] + r);
+		double start_z = m_x[2];
+		double p[3] = {x[0], x[1], start_z};
+		AddLine(block, true, p);
+		if(m_cycle_r < start_z)
+		{
+			p[2] = m_cycle_r;
+			AddLine(block, true, p);
+		}
+		p[2] = m_cycle_z;
+		AddLine(block, false, p);
+		p[2] = (m_retract_to_r || m_cycle_r > start_z) ? m_cycle_r : start_z;
+		AddLine(block, true, p);
+	}
+	else if(m_motion == 2 || m_motion == 3)
+	{
+		int dir = (m_motion == 3) ? 1 : -1;
+		double centre[3] = {0.0, 0.0, 0.0};
+		bool centre_found = true;
+		if(has_r)
+		{
+			int a, b, c;
+			GetPlaneAxes(m_plane, a, b, c);
+			centre_found = CentreFromRadius(m_x, x, a, b, r, dir, centre);
+		}
+		else
+		{
+			for(int i = 0; i < 3; i++)
+			{
+				if(has_ijk[i])centre[i] = m_arc_absolute ? (ijk[i] - m_x[i]) : ijk[i];
+			}
+		}
+
+		if(centre_found)AddArc(block, x, centre, dir);
+		else AddLine(block, false, x);
+	}
+	else
+	{
+		AddLine(block, m_motion == 0, x);
+	}
+
+	return block;
+}
+
+bool CGCodeRead::Read(const wxChar* filepath, CNCCode* nc_code)
+{
+	CMappedFile file(filepath);
+	if(!file.IsOk())
+	{
+		wxMessageBox(wxString(_("Couldn't open file")) + _T(" - ") + filepath);
+		return false;
+	}
+
+	wxProgressDialog progress(_("Backplot"), filepath, 1000, NULL, wxPD_APP_MODAL | wxPD_CAN_ABORT | wxPD_ELAPSED_TIME | wxPD_AUTO_HIDE);
+	wxStopWatch stop_watch;
+	long time_shown = 0;
+
+	CNCCode::pos = 0;
+	const char* data = file.Data();
+	const char* end = data + file.Size();
+	bool cancelled = false;
+	unsigned int lines_read = 0;
+	for(const char* line = data; line < end && !cancelled;)
+	{
+		const char* line_end = (const char*)memchr(line, '\n', end - line);
+		if(line_end == NULL)line_end = end;
+
+		CNCCodeBlock* block = ReadBlock(line, line_end);
+		if(block)
+		{
+			nc_code->m_blocks.push_back(block);
+			block->m_owner = nc_code;
+		}
+		line = (line_end < end) ? (line_end + 1) : end;
+
+		lines_read++;
+		if((lines_read & 0x3ff) == 0 && stop_watch.Time() - time_shown > 500)
+		{
+			// show the blocks read so far
+			time_shown = stop_watch.Time();
+			wxGetApp().Repaint();
+			if(!progress.Update((int)((1000.0 * (line - data)) / file.Size())))cancelled = true;
+		}
+	}
+
+	nc_code->SetTextCtrl(wxGetApp().m_output_canvas->m_textCtrl);
+
+	return true;
+}
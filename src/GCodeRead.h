@@ -0,0 +1,33 @@
+// GCodeRead.h
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+
+class CNCCode;
+class CNCCodeBlock;
+
+// reads a G-code file straight into a CNCCode object, to backplot it without python and an xml file
+class CGCodeRead
+{
+	double m_x[3]; // current position, in mm
+	int m_motion; // 0 - rapid, 1 - feed, 2 - clockwise arc, 3 - anti-clockwise arc, 81 to 89 - drilling cycle
+	int m_plane; // 17 - XY, 18 - ZX, 19 - YZ
+	bool m_absolute; // false after G91
+	bool m_arc_absolute; // true after G90.1, when I, J and K give the centre, not the centre relative to the start
+	bool m_retract_to_r; // true after G99, drilling cycles go back up to R, not to where they started
+	double m_units; // 25.4 after G20
+	double m_feed; // mm per minute
+	int m_tool_number;
+	double m_cycle_z; // drilling cycle depth
+	double m_cycle_r; // drilling cycle retract height
+
+	void AddLine(CNCCodeBlock* block, bool rapid, const double* x);
+	void AddArc(CNCCodeBlock* block, const double* x, const double* centre, int dir); // centre is relative to the start
+
+public:
+	CGCodeRead();
+
+	bool Read(const wxChar* filepath, CNCCode* nc_code); // shows the blocks read so far, every half a second; returns false if the file couldn't be opened
+	CNCCodeBlock* ReadBlock(const char* line, const char* end); // returns NULL for an empty line
+};
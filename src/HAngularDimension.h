@@ -43,6 +43,7 @@ public:
 	void glCommands(bool select, bool marked, bool no_color);
 	bool DrawAfterOthers(){return true;}
 	void GetBox(CBox &box);
+	bool PickWithoutBox(){return true;}
 	const wxChar* GetTypeString(void)const{return _("Dimension");}
 	HeeksObj *MakeACopy(void)const;
 	const wxBitmap &GetIcon();
@@ -21,6 +21,7 @@ bool HeeksDxfRead::m_ignore_errors = false;
 bool HeeksDxfRead::m_read_points = false;
 wxString HeeksDxfRead::m_layer_name_suffixes_to_discard = _T("_DOT,_DOTSMALL,_DOTBLANK,_OBLIQUE,_CLOSEDBLANK");
 bool HeeksDxfRead::m_add_uninstanced_blocks = false;
+bool HeeksDxfRead::m_relink_sketches = false;
 
 HeeksDxfRead::HeeksDxfRead(const wxChar* filepath, bool undoable) : CDxfRead(Ttc(filepath)), m_undoable(undoable)
 {
@@ -31,6 +32,7 @@ HeeksDxfRead::HeeksDxfRead(const wxChar* filepath, bool undoable) : CDxfRead(Ttc
 	config.Read(_T("DxfReadPoints"), &m_read_points);
 	config.Read(_T("LayerNameSuffixesToDiscard"), m_layer_name_suffixes_to_discard);
 	config.Read(_T("DxfAddUninstancedBlocks"), &m_add_uninstanced_blocks);
+	config.Read(_T("DxfRelinkSketches"), &m_relink_sketches);
 
 	m_current_block = NULL;
 	extract(gp_Trsf(), m_ucs_matrix);
@@ -483,6 +485,7 @@ void HeeksDxfRead::AddGraphics()
 
 	if (m_make_as_sketch)
 	{
+		std::list<CSketch*> sketches;
 		for (Sketches_t::const_iterator l_itSketch = m_sketches.begin(); l_itSketch != m_sketches.end(); l_itSketch++)
 		{
 			CSketch *pSketch = (CSketch *)(l_itSketch->second);
@@ -490,10 +493,18 @@ void HeeksDxfRead::AddGraphics()
 			{
 				((CSketch *)l_itSketch->second)->OnEditString( l_itSketch->first.c_str() );
 				l_itSketch->second->ModifyByMatrix(m_ucs_matrix);
-				if(m_undoable)wxGetApp().AddUndoably(l_itSketch->second, NULL, NULL );
-				else wxGetApp().Add( l_itSketch->second, NULL );
+				sketches.push_back(pSketch);
 			} // End if - then
 		}
+
+		// link the layers' objects end to end, before they are added
+		if (m_relink_sketches)CSketch::ReLinkSketches(sketches);
+
+		for (std::list<CSketch*>::iterator It = sketches.begin(); It != sketches.end(); It++)
+		{
+			if(m_undoable)wxGetApp().AddUndoably(*It, NULL, NULL );
+			else wxGetApp().Add( *It, NULL );
+		}
 	}
 }
 
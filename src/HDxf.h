@@ -61,6 +61,7 @@ public:
 	static bool m_read_points;
 	static wxString m_layer_name_suffixes_to_discard;
 	static bool m_add_uninstanced_blocks;
+	static bool m_relink_sketches;
 
 	// CDxfRead's virtual functions
 	void OnReadUCS(const double* ucs_point);
@@ -19,6 +19,7 @@ public:
 	long GetMarkingMask()const{return MARKING_FILTER_ILINE;}
 	void glCommands(bool select, bool marked, bool no_color);
 	void GetBox(CBox &box);
+	bool PickWithoutBox(){return true;}
 	const wxChar* GetTypeString(void)const{return _("Infinite Line");}
 	HeeksObj *MakeACopy(void)const;
 	const wxBitmap &GetIcon();
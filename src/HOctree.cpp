@@ -7,10 +7,21 @@
 #include "GraphicsCanvas.h"
 #include "OctCube.h"
 #include "OctSphere.h"
+#include "OctSweptTool.h"
+#include "NCCode.h"
 #include "PropertyInt.h"
 
-HOctree::HOctree(const CBox& box) :m_octree(box)
+HOctree::HOctree(const CBox& box, int level) :m_octree(box, level), m_stock_box(box), m_level(m_octree.GetMaxLevel())
 {
+	MakeStock();
+}
+
+void HOctree::MakeStock()
+{
+	const CBox& box = m_stock_box;
+	m_octree = COctree(box, m_level);
+	m_level = m_octree.GetMaxLevel();
+
 	double x25 = box.MinX() + box.Width() * 0.01;
 	double x75 = box.MinX() + box.Width() * 0.99;
 	double y25 = box.MinY() + box.Height() * 0.01;
@@ -49,6 +60,8 @@ const HOctree& HOctree::operator=(const HOctree &b)
 	HeeksObj::operator =(b);
 
 	m_octree = b.m_octree;
+	m_stock_box = b.m_stock_box;
+	m_level = b.m_level;
 
 	return *this;
 }
@@ -91,11 +104,18 @@ void HOctree::GetGripperPositions(std::list<GripData> *list, bool just_for_endof
 
 void HOctree::GetProperties(std::list<Property *> *list)
 {
+	list->push_back(new PropertyInt(this, _("level"), &m_level));
 	list->push_back(new PropertyInt(this, _("triangle_count"), (const int*)&m_octree.m_triangle_count ));
 
 	HeeksObj::GetProperties(list);
 }
 
+void HOctree::OnApplyProperties()
+{
+	// the level changes the whole tree, so the stock is made again
+	MakeStock();
+}
+
 void HOctree::WriteXML(TiXmlNode *root)
 {
 
@@ -113,6 +133,43 @@ HeeksObj* HOctree::ReadFromXMLElement(TiXmlElement* pElem)
 	return new_object;
 }
 
+void HOctree::CutNCCode(CNCCode* nc_code, const std::map<int, COctCutter> &cutters, const COctCutter &default_cutter)
+{
+	// arcs are cut along chords which stay within half an element of the arc
+	CBox ele_box;
+	m_octree.GetBox(m_octree.GetMaxLevel(), 0, ele_box);
+	double tolerance = ele_box.Width();
+	if (ele_box.Height() < tolerance)tolerance = ele_box.Height();
+	if (ele_box.Depth() < tolerance)tolerance = ele_box.Depth();
+	tolerance *= 0.5;
+
+	// the moves carry on from the previous block's last point, as they do for drawing
+	const PathObject* prev_po = NULL;
+	for (std::list<CNCCodeBlock*>::iterator It = nc_code->m_blocks.begin(); It != nc_code->m_blocks.end(); It++)
+	{
+		CNCCodeBlock* block = *It;
+		for (std::list<ColouredPath>::iterator PathIt = block->m_line_strips.begin(); PathIt != block->m_line_strips.end(); PathIt++)
+		{
+			ColouredPath& path = *PathIt;
+			for (std::list<PathObject*>::iterator PointIt = path.m_points.begin(); PointIt != path.m_points.end(); PointIt++)
+			{
+				PathObject* po = *PointIt;
+				if (prev_po)
+				{
+					std::map<int, COctCutter>::const_iterator FindIt = cutters.find(po->m_tool_number);
+					const COctCutter &cutter = (FindIt == cutters.end()) ? default_cutter : FindIt->second;
+
+					if (po->GetType() == PathObject::eArc)
+						m_octree.AddRemoveSolid(false, COctSweptArc(prev_po, (const PathArc*)po, cutter, tolerance));
+					else
+						m_octree.AddRemoveSolid(false, COctSweptLine(geoff_geometry::Point3d(prev_po->m_x), geoff_geometry::Point3d(po->m_x), cutter));
+				}
+				prev_po = po;
+			}
+		}
+	}
+}
+
 
 	void RenderTest()
 	{
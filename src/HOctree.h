@@ -7,13 +7,20 @@
 #include "IdNamedObj.h"
 #include "HeeksColor.h"
 #include "Octree.h"
+#include "OctSweptTool.h"
+
+class CNCCode;
 
 class HOctree : public IdNamedObj{
 private:
 	COctree m_octree;
+	CBox m_stock_box;
+	int m_level; // the octree's deepest level, a property, so the user can ask for a finer stock
+
+	void MakeStock(); // remakes the octree at m_level, without any cuts
 
 public:
-	HOctree(const CBox& box);
+	HOctree(const CBox& box, int level = DEFAULT_OCTREE_LEVEL);
 	~HOctree(void);
 	HOctree(const HOctree &p);
 
@@ -31,9 +38,14 @@ public:
 	void GetGripperPositions(std::list<GripData> *list, bool just_for_endof);
 	void GetProperties(std::list<Property *> *list);
 	void CopyFrom(const HeeksObj* object){ operator=(*((HOctree*)object)); }
+	void OnApplyProperties();
 	void WriteXML(TiXmlNode *root);
 
 	static HeeksObj* ReadFromXMLElement(TiXmlElement* pElem);
+
+	// cuts away the stock along every move of the NC code, rapids included
+	// the cutter is found from the move's tool number, the default cutter is used for tools not in the map
+	void CutNCCode(CNCCode* nc_code, const std::map<int, COctCutter> &cutters, const COctCutter &default_cutter);
 };
 
 
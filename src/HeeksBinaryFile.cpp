@@ -0,0 +1,127 @@
+// HeeksBinaryFile.cpp
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+#include "stdafx.h"
+
+#include "HeeksBinaryFile.h"
+
+static const char magic[8] = {'H', 'E', 'E', 'K', 'S', 'B', 'I', 'N'};
+static const size_t header_size = 16; // magic, version, number of chunks
+static const size_t table_entry_size = 24; // type, index, offset, size
+
+// numbers are written least significant byte first, whatever the machine
+static void WriteNumber(std::string &s, unsigned long long n, int bytes)
+{
+	for(int i = 0; i < bytes; i++)
+	{
+		s.push_back((char)(n & 0xff));
+		n >>= 8;
+	}
+}
+
+static unsigned long long ReadNumber(const char* p, int bytes)
+{
+	unsigned long long n = 0;
+	for(int i = bytes - 1; i >= 0; i--)
+	{
+		n = (n << 8) | (unsigned char)(p[i]);
+	}
+	return n;
+}
+
+void CHeeksBinaryWriter::AddChunk(const char* type, int index, const std::string& data)
+{
+	m_chunks.push_back(CChunk());
+	CChunk &chunk = m_chunks.back();
+	memcpy(chunk.m_type, type, 4);
+	chunk.m_index = index;
+	chunk.m_data = data;
+}
+
+bool CHeeksBinaryWriter::Write(const wxChar* filepath)const
+{
+	std::string header(magic, 8);
+	WriteNumber(header, HEEKS_BINARY_FILE_VERSION, 4);
+	WriteNumber(header, m_chunks.size(), 4);
+
+	unsigned long long offset = header_size + table_entry_size * m_chunks.size();
+	for(std::list<CChunk>::const_iterator It = m_chunks.begin(); It != m_chunks.end(); It++)
+	{
+		const CChunk &chunk = *It;
+		header.append(chunk.m_type, 4);
+		WriteNumber(header, (unsigned int)(chunk.m_index), 4);
+		WriteNumber(header, offset, 8);
+		WriteNumber(header, chunk.m_data.size(), 8);
+		offset += chunk.m_data.size();
+	}
+
+#ifdef __WXMSW__
+	ofstream ofs(filepath, ios::binary);
+#else
+	ofstream ofs(Ttc(filepath), ios::binary);
+#endif
+	if(!ofs)return false;
+
+	ofs.write(header.data(), header.size());
+	for(std::list<CChunk>::const_iterator It = m_chunks.begin(); It != m_chunks.end(); It++)
+	{
+		ofs.write(It->m_data.data(), It->m_data.size());
+	}
+
+	return !(!ofs);
+}
+
+bool CHeeksBinaryReader::CChunk::IsType(const char* type)const
+{
+	return memcmp(m_type, type, 4) == 0;
+}
+
+CHeeksBinaryReader::CHeeksBinaryReader(const wxChar* filepath):m_file(filepath), m_ok(false)
+{
+	if(!m_file.IsOk() || m_file.Size() < header_size)return;
+	const char* data = m_file.Data();
+	size_t size = m_file.Size();
+	if(memcmp(data, magic, 8) != 0)return;
+
+	// files from a newer version might not be understood
+	if(ReadNumber(data + 8, 4) > HEEKS_BINARY_FILE_VERSION)return;
+
+	unsigned long long num_chunks = ReadNumber(data + 12, 4);
+	if(num_chunks > (size - header_size) / table_entry_size)return;
+
+	m_chunks.resize((size_t)num_chunks);
+	const char* p = data + header_size;
+	for(size_t i = 0; i < m_chunks.size(); i++, p += table_entry_size)
+	{
+		CChunk &chunk = m_chunks[i];
+		memcpy(chunk.m_type, p, 4);
+		chunk.m_index = (int)(ReadNumber(p + 4, 4));
+		unsigned long long offset = ReadNumber(p + 8, 8);
+		unsigned long long chunk_size = ReadNumber(p + 16, 8);
+		if(offset > size || chunk_size > size - offset)return;
+		chunk.m_data = data + offset;
+		chunk.m_size = (size_t)chunk_size;
+		m_chunk_map.insert(std::make_pair(std::make_pair(std::string(chunk.m_type, 4), chunk.m_index), i));
+	}
+
+	m_ok = true;
+}
+
+bool CHeeksBinaryReader::IsBinaryFile(const wxChar* filepath)
+{
+	char start[8];
+#ifdef __WXMSW__
+	ifstream ifs(filepath, ios::binary);
+#else
+	ifstream ifs(Ttc(filepath), ios::binary);
+#endif
+	if(!ifs.read(start, 8))return false;
+	return memcmp(start, magic, 8) == 0;
+}
+
+const CHeeksBinaryReader::CChunk* CHeeksBinaryReader::FindChunk(const char* type, int index)const
+{
+	std::map<std::pair<std::string, int>, size_t>::const_iterator FindIt = m_chunk_map.find(std::make_pair(std::string(type, 4), index));
+	if(FindIt == m_chunk_map.end())return NULL;
+	return &(m_chunks[FindIt->second]);
+}
@@ -0,0 +1,61 @@
+// HeeksBinaryFile.h
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+
+#include "MappedFile.h"
+
+// the binary .heeks file is made of chunks, each with a four letter type, an index and its data
+// "OBJX" chunks have the XML for one object each, "SHPS" has the index map for the solids, "BREP" chunks have one solid each, in OpenCASCADE's binary format, and "ISHP" chunks have one shape each which instances share, in the same format
+// there is a table of the chunks at the start, so the reader can go straight to a chunk, and chunks which aren't asked for are never read
+// old .heeks files, which are XML, are told apart from these by the first bytes
+
+#define HEEKS_BINARY_FILE_VERSION 1
+
+class CHeeksBinaryWriter
+{
+	class CChunk
+	{
+	public:
+		char m_type[4];
+		int m_index;
+		std::string m_data;
+	};
+
+	std::list<CChunk> m_chunks;
+
+public:
+	void AddChunk(const char* type, int index, const std::string& data);
+	bool Write(const wxChar* filepath)const;
+};
+
+class CHeeksBinaryReader
+{
+public:
+	class CChunk
+	{
+	public:
+		char m_type[4];
+		int m_index;
+		const char* m_data;
+		size_t m_size;
+
+		bool IsType(const char* type)const;
+	};
+
+private:
+	CMappedFile m_file;
+	std::vector<CChunk> m_chunks;
+	std::map<std::pair<std::string, int>, size_t> m_chunk_map; // type and index to position in m_chunks
+	bool m_ok;
+
+public:
+	CHeeksBinaryReader(const wxChar* filepath);
+
+	static bool IsBinaryFile(const wxChar* filepath);
+
+	bool IsOk()const{ return m_ok; } // false if the file isn't a binary .heeks file, or is damaged
+	const std::vector<CChunk>& Chunks()const{ return m_chunks; }
+	const CChunk* FindChunk(const char* type, int index)const;
+};
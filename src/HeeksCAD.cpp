@@ -59,6 +59,8 @@
 #include "Face.h"
 #include "ViewPoint.h"
 #include "MarkedList.h"
+#include "PickTree.h"
+#include "ShapeMesher.h"
 #include "Observer.h"
 #include "TransformTool.h"
 #include "Grid.h"
@@ -86,11 +88,13 @@
 #include "HeeksConfig.h"
 #include "Group.h"
 #include "AutoSave.h"
+#include "HeeksBinaryFile.h"
 #include <wx/progdlg.h>
 #include "OrientationModifier.h"
 #include "MenuSeparator.h"
 #include "HGear.h"
 #include "HArea.h"
+#include "Instance.h"
 #include "History.h"
 #include "RemoveOrAddTool.h"
 #include "Observer.h"
@@ -191,6 +195,14 @@ HeeksCADapp::HeeksCADapp(): ObjList()
 	m_doing_rollback = false;
 	mouse_wheel_forward_away = true;
 	m_mouse_move_highlighting = true;
+	m_pick_with_box_tree = true;
+	m_cull_objects_out_of_view = true;
+	m_min_pixels_to_draw = 1.0;
+	m_num_objects_drawn = 0;
+	m_num_objects_culled = 0;
+	m_num_objects_too_small = 0;
+	m_mesh_solids_in_background = true;
+	m_shape_mesher = NULL;
 	ctrl_does_rotate = false;
 	m_ruler = new HRuler();
 	m_show_ruler = false;
@@ -238,6 +250,7 @@ HeeksCADapp::HeeksCADapp(): ObjList()
 	m_revolve_angle = 360.0;
 	m_fit_arcs_on_solid_outline = false;
 	m_stl_save_as_binary = true;
+	m_heeks_save_as_binary = true;
 	m_mouse_move_highlighting = true;
 	m_highlight_color = HeeksColor(128, 255, 0);
 
@@ -257,7 +270,7 @@ HeeksCADapp::HeeksCADapp(): ObjList()
 	m_settings_restored = false;
 
 	// cnc constructor code
-	m_nc_code = new CNCCode;
+	m_nc_code = NULL;
 	m_icon_texture_number = 0;
 	m_settings_restored = false;
 
@@ -430,7 +443,12 @@ bool HeeksCADapp::OnInit()
 	config.Read(_T("InputUsesModalDialog"), &m_input_uses_modal_dialog, true);
 	config.Read(_T("DraggingMovesObjects"), &m_dragging_moves_objects, true);
 	config.Read(_T("STLSaveBinary"), &m_stl_save_as_binary, true);
+	config.Read(_T("HeeksSaveBinary"), &m_heeks_save_as_binary, true);
 	config.Read(_T("MouseMoveHighlighting"), &m_mouse_move_highlighting, true);
+	config.Read(_T("PickWithBoxTree"), &m_pick_with_box_tree, true);
+	config.Read(_T("CullObjectsOutOfView"), &m_cull_objects_out_of_view, true);
+	config.Read(_T("MinPixelsToDraw"), &m_min_pixels_to_draw, 1.0);
+	config.Read(_T("MeshSolidsInBackground"), &m_mesh_solids_in_background, true);
 	{
 		int color = HeeksColor(128, 255, 0).COLORREF_color();
 		config.Read(_T("HighlightColor"), &color);
@@ -442,6 +460,7 @@ bool HeeksCADapp::OnInit()
 	config.Read(_T("SvgUnite"), &m_svg_unite, true);
 	
 	HDimension::ReadFromConfig(config);
+	CNCStats::ReadFromConfig(config);
 
 	m_ruler->ReadFromConfig(config);
 
@@ -616,8 +635,13 @@ void HeeksCADapp::WriteConfig()
 	config.Write(_T("FitArcsOnSolidOutline"), m_fit_arcs_on_solid_outline);
 	config.Write(_T("SolidViewMode"), (int)m_solid_view_mode);
 	config.Write(_T("STLSaveBinary"), m_stl_save_as_binary);
+	config.Write(_T("HeeksSaveBinary"), m_heeks_save_as_binary);
 
 	config.Write(_T("MouseMoveHighlighting"), m_mouse_move_highlighting);
+	config.Write(_T("PickWithBoxTree"), m_pick_with_box_tree);
+	config.Write(_T("CullObjectsOutOfView"), m_cull_objects_out_of_view);
+	config.Write(_T("MinPixelsToDraw"), m_min_pixels_to_draw);
+	config.Write(_T("MeshSolidsInBackground"), m_mesh_solids_in_background);
 	config.Write(_T("HighlightColor"), m_highlight_color.COLORREF_color());
 	config.Write(_T("StlSolidRandomColors"), m_stl_solid_random_colors);
 
@@ -625,6 +649,7 @@ void HeeksCADapp::WriteConfig()
 	config.Write(_T("SvgUnite"), m_svg_unite);
 	
 	HDimension::WriteToConfig(config);
+	CNCStats::WriteToConfig(config);
 
 	m_ruler->WriteToConfig(config);
 
@@ -642,6 +667,10 @@ int HeeksCADapp::OnExit(){
 
     WriteConfig();
 
+	// stop the meshing threads
+	delete m_shape_mesher;
+	m_shape_mesher = NULL;
+
 	delete history;
 	history = NULL;
 
@@ -746,6 +775,59 @@ void HeeksCADapp::Reset(){
 static bool undoably_for_ReadSTEPFileFromXMLElement = false;
 static HeeksObj* paste_into_for_ReadSTEPFileFromXMLElement = NULL;
 
+static void ReadIndexMap(TiXmlElement* pElem, std::map<int, CShapeData> &index_map)
+{
+	// loop through all the child elements, looking for index_pair items
+	for(TiXmlElement* pairElem = TiXmlHandle(pElem).FirstChildElement().Element(); pairElem; pairElem = pairElem->NextSiblingElement())
+	{
+		std::string pair_name(pairElem->Value());
+		if(pair_name == std::string("index_pair"))
+		{
+			int index = -1;
+			CShapeData shape_data;
+
+			// get the attributes
+			for(TiXmlAttribute* a = pairElem->FirstAttribute(); a; a = a->Next())
+			{
+				std::string attr_name(a->Name());
+				if(attr_name == std::string("index")){index = a->IntValue();}
+				else if(attr_name == std::string("id")){shape_data.m_id = a->IntValue();}
+				else if(attr_name == std::string("title")){shape_data.m_title.assign(Ctt(a->Value()));}
+				else if(attr_name == std::string("title_from_id")){shape_data.m_title_made_from_id = (a->IntValue() != 0);}
+				else if(attr_name == std::string("solid_type")){shape_data.m_solid_type = (SolidTypeEnum)(a->IntValue());}
+				else if(attr_name == std::string("vis")){shape_data.m_visible = (a->IntValue() != 0);}
+				else shape_data.m_xml_element.SetAttribute(a->Name(), a->Value());
+			}
+
+			// get face ids
+			for(TiXmlElement* faceElem = TiXmlHandle(pairElem).FirstChildElement("face").Element(); faceElem; faceElem = faceElem->NextSiblingElement("face"))
+			{
+				int id = 0;
+				faceElem->Attribute("id", &id);
+				shape_data.m_face_ids.push_back(id);
+			}
+
+			// get edge ids
+			for(TiXmlElement* edgeElem = TiXmlHandle(pairElem).FirstChildElement("edge").Element(); edgeElem; edgeElem = edgeElem->NextSiblingElement("edge"))
+			{
+				int id = 0;
+				edgeElem->Attribute("id", &id);
+				shape_data.m_edge_ids.push_back(id);
+			}
+
+			// get vertex ids
+			for(TiXmlElement* vertexElem = TiXmlHandle(pairElem).FirstChildElement("vertex").Element(); vertexElem; vertexElem = vertexElem->NextSiblingElement("vertex"))
+			{
+				int id = 0;
+				vertexElem->Attribute("id", &id);
+				shape_data.m_vertex_ids.push_back(id);
+			}
+
+			if(index != -1)index_map.insert(std::pair<int, CShapeData>(index, shape_data));
+		}
+	}
+}
+
 static HeeksObj* ReadSTEPFileFromXMLElement(TiXmlElement* pElem)
 {
 	std::map<int, CShapeData> index_map;
@@ -756,55 +838,7 @@ static HeeksObj* ReadSTEPFileFromXMLElement(TiXmlElement* pElem)
 		std::string subname(subElem->Value());
 		if(subname == std::string("index_map"))
 		{
-			// loop through all the child elements, looking for index_pair items
-			for(TiXmlElement* subsubElem = TiXmlHandle(subElem).FirstChildElement().Element(); subsubElem; subsubElem = subsubElem->NextSiblingElement())
-			{
-				std::string subsubname(subsubElem->Value());
-				if(subsubname == std::string("index_pair"))
-				{
-					int index = -1;
-					CShapeData shape_data;
-
-					// get the attributes
-					for(TiXmlAttribute* a = subsubElem->FirstAttribute(); a; a = a->Next())
-					{
-						std::string attr_name(a->Name());
-						if(attr_name == std::string("index")){index = a->IntValue();}
-						else if(attr_name == std::string("id")){shape_data.m_id = a->IntValue();}
-						else if(attr_name == std::string("title")){shape_data.m_title.assign(Ctt(a->Value()));}
-						else if(attr_name == std::string("title_from_id")){shape_data.m_title_made_from_id = (a->IntValue() != 0);}
-						else if(attr_name == std::string("solid_type")){shape_data.m_solid_type = (SolidTypeEnum)(a->IntValue());}
-						else if(attr_name == std::string("vis")){shape_data.m_visible = (a->IntValue() != 0);}
-						else shape_data.m_xml_element.SetAttribute(a->Name(), a->Value());
-					}
-
-					// get face ids
-					for(TiXmlElement* faceElem = TiXmlHandle(subsubElem).FirstChildElement("face").Element(); faceElem; faceElem = faceElem->NextSiblingElement("face"))
-					{
-						int id = 0;
-						faceElem->Attribute("id", &id);
-						shape_data.m_face_ids.push_back(id);
-					}
-
-					// get edge ids
-					for(TiXmlElement* edgeElem = TiXmlHandle(subsubElem).FirstChildElement("edge").Element(); edgeElem; edgeElem = edgeElem->NextSiblingElement("edge"))
-					{
-						int id = 0;
-						edgeElem->Attribute("id", &id);
-						shape_data.m_edge_ids.push_back(id);
-					}
-
-					// get vertex ids
-					for(TiXmlElement* vertexElem = TiXmlHandle(subsubElem).FirstChildElement("vertex").Element(); vertexElem; vertexElem = vertexElem->NextSiblingElement("vertex"))
-					{
-						int id = 0;
-						vertexElem->Attribute("id", &id);
-						shape_data.m_vertex_ids.push_back(id);
-					}
-
-					if(index != -1)index_map.insert(std::pair<int, CShapeData>(index, shape_data));
-				}
-			}
+			ReadIndexMap(subElem, index_map);
 		}
 		else if(subname == std::string("file_text"))
 		{
@@ -884,6 +918,8 @@ void HeeksCADapp::InitializeXMLFunctions()
 		xml_read_fn_map.insert( std::pair< std::string, HeeksObj*(*)(TiXmlElement* pElem) > ( "OrientationModifier", COrientationModifier::ReadFromXMLElement ) );
 		xml_read_fn_map.insert( std::pair< std::string, HeeksObj*(*)(TiXmlElement* pElem) > ( "Gear", HGear::ReadFromXMLElement ) );
 		xml_read_fn_map.insert(std::pair< std::string, HeeksObj*(*)(TiXmlElement* pElem) >("Area", HArea::ReadFromXMLElement));
+		xml_read_fn_map.insert(std::pair< std::string, HeeksObj*(*)(TiXmlElement* pElem) >("Instance", CInstance::ReadFromXMLElement));
+		xml_read_fn_map.insert(std::pair< std::string, HeeksObj*(*)(TiXmlElement* pElem) >("InstanceShape", CInstance::ReadShapeFromXMLElement));
 	}
 }
 
@@ -965,6 +1001,59 @@ void HeeksCADapp::ObjectReadBaseXML(HeeksObj *object, TiXmlElement* element)
 	}
 }
 
+void HeeksCADapp::AddOpenedObjects(const std::list<HeeksObj*> &objects, HeeksObj* paste_into, HeeksObj* paste_before)
+{
+	if(objects.size() > 0)
+	{
+		HeeksObj* add_to = this;
+		if(paste_into)add_to = paste_into;
+		for(std::list<HeeksObj*>::const_iterator It = objects.begin(); It != objects.end(); It++)
+		{
+			HeeksObj* object = *It;
+			object->ReloadPointers();
+
+			while(1)
+			{
+				if(add_to->CanAdd(object) && object->CanAddTo(add_to))
+				{
+					if(object->OneOfAKind())
+					{
+						bool one_found = false;
+						for(HeeksObj* child = add_to->GetFirstChild(); child; child = add_to->GetNextChild())
+						{
+							if(child->GetType() == object->GetType())
+							{
+								child->CopyFrom(object);
+								one_found = true;
+								break;
+							}
+						}
+						if(!one_found)
+						{
+							add_to->Add(object, paste_before);
+							if(m_inPaste)WasAdded(object);
+						}
+					}
+					else
+					{
+						add_to->Add(object, paste_before);
+						if(m_inPaste)WasAdded(object);
+					}
+					break;
+				}
+				else if(paste_into == NULL)
+				{
+					// can't add normally, look for preferred paste target
+					add_to = object->PreferredPasteTarget();
+					if(add_to == NULL || add_to == this)// already tried
+						break;
+				}
+				else break;
+			}
+		}
+	}
+}
+
 void HeeksCADapp::OpenXMLFile(const wxChar *filepath, HeeksObj* paste_into, HeeksObj* paste_before, bool undoably, bool show_error)
 {
 	TiXmlDocument doc(Ttc(filepath));
@@ -1009,55 +1098,71 @@ void HeeksCADapp::OpenXMLFile(const wxChar *filepath, HeeksObj* paste_into, Heek
 		}
 	}
 
-	if(objects.size() > 0)
+	AddOpenedObjects(objects, paste_into, paste_before);
+	CInstance::EndReading();
+	setlocale(LC_NUMERIC, oldlocale);
+
+	CGroup::MoveSolidsToGroupsById(this);
+}
+
+void HeeksCADapp::OpenBinaryFile(const wxChar *filepath, HeeksObj* paste_into, HeeksObj* paste_before, bool undoably, bool show_error)
+{
+	CHeeksBinaryReader reader(filepath);
+	if(!reader.IsOk())
 	{
-		HeeksObj* add_to = this;
-		if(paste_into)add_to = paste_into;
-		for(std::list<HeeksObj*>::const_iterator It = objects.begin(); It != objects.end(); It++)
+		if(show_error)
 		{
-			HeeksObj* object = *It;
-			object->ReloadPointers();
+			wxString msg(filepath);
+			msg << wxT(": ") << _("not a valid HeeksCAD file");
+			wxMessageBox(msg);
+		}
+		return;
+	}
 
-			while(1)
+	char oldlocale[1000];
+	strcpy(oldlocale, setlocale(LC_NUMERIC, "C"));
+
+	// the instances' shapes, which their XML refers to
+	CInstance::ReadShapesBinary(reader);
+
+	// each object's XML is in its own chunk
+	std::list<HeeksObj*> objects;
+	const std::vector<CHeeksBinaryReader::CChunk> &chunks = reader.Chunks();
+	for(std::vector<CHeeksBinaryReader::CChunk>::const_iterator It = chunks.begin(); It != chunks.end(); It++)
+	{
+		const CHeeksBinaryReader::CChunk &chunk = *It;
+		if(!chunk.IsType("OBJX"))continue;
+
+		TiXmlDocument doc;
+		doc.Parse(std::string(chunk.m_data, chunk.m_size).c_str());
+		for(TiXmlElement* pElem = doc.FirstChildElement(); pElem; pElem = pElem->NextSiblingElement())
+		{
+			HeeksObj* object = ReadXMLElement(pElem);
+			if(object)
 			{
-				if(add_to->CanAdd(object) && object->CanAddTo(add_to))
-				{
-					if(object->OneOfAKind())
-					{
-						bool one_found = false;
-						for(HeeksObj* child = add_to->GetFirstChild(); child; child = add_to->GetNextChild())
-						{
-							if(child->GetType() == object->GetType())
-							{
-								child->CopyFrom(object);
-								one_found = true;
-								break;
-							}
-						}
-						if(!one_found)
-						{
-							add_to->Add(object, paste_before);
-							if(m_inPaste)WasAdded(object);
-						}
-					}
-					else
-					{
-						add_to->Add(object, paste_before);
-						if(m_inPaste)WasAdded(object);
-					}
-					break;
-				}
-				else if(paste_into == NULL)
-				{
-					// can't add normally, look for preferred paste target
-					add_to = object->PreferredPasteTarget();
-					if(add_to == NULL || add_to == this)// already tried
-						break;
-				}
-				else break;
+				objects.push_back(object);
 			}
 		}
 	}
+
+	AddOpenedObjects(objects, paste_into, paste_before);
+	CInstance::EndReading();
+
+	// the solids are read straight from their BRep chunks
+	const CHeeksBinaryReader::CChunk* shapes_chunk = reader.FindChunk("SHPS", 0);
+	if(shapes_chunk)
+	{
+		TiXmlDocument doc;
+		doc.Parse(std::string(shapes_chunk->m_data, shapes_chunk->m_size).c_str());
+		TiXmlElement* pElem = doc.FirstChildElement("index_map");
+		if(pElem)
+		{
+			std::map<int, CShapeData> index_map;
+			ReadIndexMap(pElem, index_map);
+			CShape::ImportSolidsBinary(reader, undoably, &index_map, paste_into);
+		}
+	}
+
 	setlocale(LC_NUMERIC, oldlocale);
 
 	CGroup::MoveSolidsToGroupsById(this);
@@ -1231,7 +1336,10 @@ bool HeeksCADapp::OpenFile(const wxChar *filepath, bool import_not_open, HeeksOb
 		m_file_open_or_import_type = FileOpenTypeHeeks;
 		if(import_not_open)
 			m_file_open_or_import_type = FileImportTypeHeeks;
-		OpenXMLFile(filepath, paste_into, paste_before, history_started);
+		if(CHeeksBinaryReader::IsBinaryFile(filepath))
+			OpenBinaryFile(filepath, paste_into, paste_before, history_started);
+		else
+			OpenXMLFile(filepath, paste_into, paste_before, history_started);
 	}
 	else if(m_fileopen_handlers.find(extension) != m_fileopen_handlers.end())
 	{
@@ -1739,6 +1847,57 @@ void HeeksCADapp::SavePyFile(const std::list<HeeksObj*>& objects, const wxChar *
 	}
 }
 
+static void WriteIndexMap(TiXmlNode* root, std::map<int, CShapeData> &index_map)
+{
+	TiXmlElement *index_map_element = new TiXmlElement( "index_map" );
+	root->LinkEndChild( index_map_element );
+	for(std::map<int, CShapeData>::iterator It = index_map.begin(); It != index_map.end(); It++)
+	{
+		TiXmlElement *index_pair_element = new TiXmlElement( "index_pair" );
+		index_map_element->LinkEndChild( index_pair_element );
+		int index = It->first;
+		CShapeData& shape_data = It->second;
+		index_pair_element->SetAttribute("index", index);
+		index_pair_element->SetAttribute("id", shape_data.m_id);
+		index_pair_element->SetAttribute("title", Ttc(shape_data.m_title));
+		index_pair_element->SetAttribute("title_from_id", (shape_data.m_title_made_from_id?1:0));
+		index_pair_element->SetAttribute("vis", shape_data.m_visible ? 1:0);
+		if(shape_data.m_solid_type != SOLID_TYPE_UNKNOWN)index_pair_element->SetAttribute("solid_type", shape_data.m_solid_type);
+		// get the CShapeData attributes
+		for(TiXmlAttribute* a = shape_data.m_xml_element.FirstAttribute(); a; a = a->Next())
+		{
+			index_pair_element->SetAttribute(a->Name(), a->Value());
+		}
+
+		// write the face ids
+		for(std::list<int>::iterator It = shape_data.m_face_ids.begin(); It != shape_data.m_face_ids.end(); It++)
+		{
+			int id = *It;
+			TiXmlElement *face_id_element = new TiXmlElement( "face" );
+			index_pair_element->LinkEndChild( face_id_element );
+			face_id_element->SetAttribute("id", id);
+		}
+
+		// write the edge ids
+		for(std::list<int>::iterator It = shape_data.m_edge_ids.begin(); It != shape_data.m_edge_ids.end(); It++)
+		{
+			int id = *It;
+			TiXmlElement *edge_id_element = new TiXmlElement( "edge" );
+			index_pair_element->LinkEndChild( edge_id_element );
+			edge_id_element->SetAttribute("id", id);
+		}
+
+		// write the vertex ids
+		for(std::list<int>::iterator It = shape_data.m_vertex_ids.begin(); It != shape_data.m_vertex_ids.end(); It++)
+		{
+			int id = *It;
+			TiXmlElement *vertex_id_element = new TiXmlElement( "vertex" );
+			index_pair_element->LinkEndChild( vertex_id_element );
+			vertex_id_element->SetAttribute("id", id);
+		}
+	}
+}
+
 void HeeksCADapp::SaveXMLFile(const std::list<HeeksObj*>& objects, const wxChar *filepath, bool for_clipboard)
 {
 	// write an xml file
@@ -1757,6 +1916,9 @@ void HeeksCADapp::SaveXMLFile(const std::list<HeeksObj*>& objects, const wxChar
 		doc.LinkEndChild( root );
 	}
 
+	// the instances' shapes, each once, before the instances which refer to them
+	CInstance::WriteShapes(objects, root);
+
 	// loop through all the objects writing them
 	CShape::m_solids_found = false;
 	for(std::list<HeeksObj*>::const_iterator It = objects.begin(); It != objects.end(); It++)
@@ -1781,55 +1943,7 @@ void HeeksCADapp::SaveXMLFile(const std::list<HeeksObj*>& objects, const wxChar
 		root->LinkEndChild( step_file_element );
 
 		// write the index map as a child of step_file
-		{
-			TiXmlElement *index_map_element = new TiXmlElement( "index_map" );
-			step_file_element->LinkEndChild( index_map_element );
-			for(std::map<int, CShapeData>::iterator It = index_map.begin(); It != index_map.end(); It++)
-			{
-				TiXmlElement *index_pair_element = new TiXmlElement( "index_pair" );
-				index_map_element->LinkEndChild( index_pair_element );
-				int index = It->first;
-				CShapeData& shape_data = It->second;
-				index_pair_element->SetAttribute("index", index);
-				index_pair_element->SetAttribute("id", shape_data.m_id);
-				index_pair_element->SetAttribute("title", Ttc(shape_data.m_title));
-				index_pair_element->SetAttribute("title_from_id", (shape_data.m_title_made_from_id?1:0));
-				index_pair_element->SetAttribute("vis", shape_data.m_visible ? 1:0);
-				if(shape_data.m_solid_type != SOLID_TYPE_UNKNOWN)index_pair_element->SetAttribute("solid_type", shape_data.m_solid_type);
-				// get the CShapeData attributes
-				for(TiXmlAttribute* a = shape_data.m_xml_element.FirstAttribute(); a; a = a->Next())
-				{
-					index_pair_element->SetAttribute(a->Name(), a->Value());
-				}
-
-				// write the face ids
-				for(std::list<int>::iterator It = shape_data.m_face_ids.begin(); It != shape_data.m_face_ids.end(); It++)
-				{
-					int id = *It;
-					TiXmlElement *face_id_element = new TiXmlElement( "face" );
-					index_pair_element->LinkEndChild( face_id_element );
-					face_id_element->SetAttribute("id", id);
-				}
-
-				// write the edge ids
-				for(std::list<int>::iterator It = shape_data.m_edge_ids.begin(); It != shape_data.m_edge_ids.end(); It++)
-				{
-					int id = *It;
-					TiXmlElement *edge_id_element = new TiXmlElement( "edge" );
-					index_pair_element->LinkEndChild( edge_id_element );
-					edge_id_element->SetAttribute("id", id);
-				}
-
-				// write the vertex ids
-				for(std::list<int>::iterator It = shape_data.m_vertex_ids.begin(); It != shape_data.m_vertex_ids.end(); It++)
-				{
-					int id = *It;
-					TiXmlElement *vertex_id_element = new TiXmlElement( "vertex" );
-					index_pair_element->LinkEndChild( vertex_id_element );
-					vertex_id_element->SetAttribute("id", id);
-				}
-			}
-		}
+		WriteIndexMap(step_file_element, index_map);
 
 		// write the step file as a string attribute of step_file
 		ifstream ifs(Ttc(temp_file.GetFullPath().c_str()));
@@ -1855,6 +1969,46 @@ void HeeksCADapp::SaveXMLFile(const std::list<HeeksObj*>& objects, const wxChar
 	doc.SaveFile( Ttc(filepath) );
 }
 
+void HeeksCADapp::SaveBinaryFile(const std::list<HeeksObj*>& objects, const wxChar *filepath)
+{
+	CHeeksBinaryWriter writer;
+
+	// write the instances' shapes, each once, to their own chunks
+	CInstance::WriteShapesBinary(objects, writer);
+
+	// write each object's XML to its own chunk
+	CShape::m_solids_found = false;
+	int i = 0;
+	for(std::list<HeeksObj*>::const_iterator It = objects.begin(); It != objects.end(); It++)
+	{
+		HeeksObj* object = *It;
+		TiXmlDocument doc;
+		object->WriteXML(&doc);
+		if(doc.FirstChild() == NULL)continue; // solids don't write any XML
+
+		TiXmlPrinter printer;
+		printer.SetStreamPrinting();
+		doc.Accept(&printer);
+		writer.AddChunk("OBJX", i, std::string(printer.CStr(), printer.Size()));
+		i++;
+	}
+
+	// write each solid to a chunk in OpenCASCADE's binary format, and the index map for them
+	if(CShape::m_solids_found){
+		std::map<int, CShapeData> index_map;
+		CShape::ExportSolidsBinary(objects, writer, &index_map);
+
+		TiXmlDocument doc;
+		WriteIndexMap(&doc, index_map);
+		TiXmlPrinter printer;
+		printer.SetStreamPrinting();
+		doc.Accept(&printer);
+		writer.AddChunk("SHPS", 0, std::string(printer.CStr(), printer.Size()));
+	}
+
+	writer.Write(filepath);
+}
+
 bool HeeksCADapp::SaveFile(const wxChar *filepath, bool use_dialog, bool update_recent_file_list, bool set_app_caption)
 {
 	if(use_dialog){
@@ -1876,7 +2030,10 @@ bool HeeksCADapp::SaveFile(const wxChar *filepath, bool use_dialog, bool update_
 			(*callbackfunc)(false);
 		}
 
-		SaveXMLFile(filepath);
+		if(m_heeks_save_as_binary)
+			SaveBinaryFile(m_objects, filepath);
+		else
+			SaveXMLFile(filepath);
 	}
 	else if(wf.EndsWith(_T(".dxf")))
 	{
@@ -1993,11 +2150,24 @@ void HeeksCADapp::glCommandsAll(const CViewPoint &view_point)
 
 	std::list<HeeksObj*> after_others_objects;
 
+	// find which objects could be seen, from the box tree
+	std::set<HeeksObj*> in_view;
+	m_num_objects_drawn = 0;
+	m_num_objects_culled = 0;
+	m_num_objects_too_small = 0;
+	if(m_cull_objects_out_of_view)m_marked_list->m_pick_tree->ObjectsInView(view_point, m_min_pixels_to_draw, in_view, m_num_objects_too_small);
+
 	for(std::list<HeeksObj*>::iterator It=m_objects.begin(); It!=m_objects.end() ;It++)
 	{
 		HeeksObj* object = *It;
 		if(object->OnVisibleLayer() && object->m_visible)
 		{
+			if(m_cull_objects_out_of_view && in_view.find(object) == in_view.end())
+			{
+				m_num_objects_culled++;
+				continue;
+			}
+			m_num_objects_drawn++;
 			if(object->DrawAfterOthers())after_others_objects.push_back(object);
 			else
 			{
@@ -2069,6 +2239,10 @@ void HeeksCADapp::glCommandsAll(const CViewPoint &view_point)
 			{
 				screen_text2.Append(help_str);
 			}
+			if(m_cull_objects_out_of_view)
+			{
+				screen_text2.Append(wxString::Format(_T("\n%s %u, %s %u ( %u %s )"), _("objects drawn"), m_num_objects_drawn, _("culled"), m_num_objects_culled, m_num_objects_too_small, _("too small")));
+			}
 		}
 		render_screen_text(screen_text1, screen_text2, false);
 	}
@@ -2114,6 +2288,12 @@ double HeeksCADapp::GetPixelScale(void){
 	return m_current_viewport->m_view_point.m_pixel_scale;
 }
 
+CShapeMesher* HeeksCADapp::GetShapeMesher()
+{
+	if(m_shape_mesher == NULL)m_shape_mesher = new CShapeMesher;
+	return m_shape_mesher;
+}
+
 bool HeeksCADapp::IsModified(void){
 	if(history->IsModified())return true;
 
@@ -3222,7 +3402,11 @@ void HeeksCADapp::GetOptions(std::list<Property *> *list)
 	view_options->m_list.push_back(new PropertyCheck(NULL, _("dragging moves objects"), &m_dragging_moves_objects ));
 	view_options->m_list.push_back(new PropertyCheck(NULL, _("highlight items under mouse"), &m_mouse_move_highlighting));
 	view_options->m_list.push_back(new PropertyColor(NULL, _("highlight color"), &m_highlight_color));
+	view_options->m_list.push_back(new PropertyCheck(NULL, _("only render objects near the mouse when picking"), &m_pick_with_box_tree));
+	view_options->m_list.push_back(new PropertyCheck(NULL, _("only draw objects in the view"), &m_cull_objects_out_of_view));
+	view_options->m_list.push_back(new PropertyDouble(NULL, _("don't draw objects smaller than ( pixels )"), &m_min_pixels_to_draw));
 	view_options->m_list.push_back(new PropertyCheckWithKillGlLists(this, _("stl solid random colors"), &m_stl_solid_random_colors));
+	view_options->m_list.push_back(new PropertyCheck(NULL, _("mesh solids in the background"), &m_mesh_solids_in_background));
 
 	list->push_back(view_options);
 
@@ -3258,6 +3442,8 @@ void HeeksCADapp::GetOptions(std::list<Property *> *list)
 	drawing->m_list.push_back(new PropertyCheck(NULL, _("Fit arcs on solid outline"), &m_fit_arcs_on_solid_outline));
 	list->push_back(drawing);
 
+	CNCStats::GetOptions(list);
+
 	for(std::list<Plugin>::iterator It = m_loaded_libraries.begin(); It != m_loaded_libraries.end(); It++){
 		wxDynamicLibrary* shared_library = It->dynamic_library;
 		list_for_GetOptions = list;
@@ -3299,8 +3485,13 @@ void HeeksCADapp::GetOptions(std::list<Property *> *list)
 	dxf_options->m_list.push_back(new PropertyCheckWithConfig(NULL, _("read points"), &HeeksDxfRead::m_read_points, _T("DxfReadPoints")));
 	dxf_options->m_list.push_back(new PropertyStringWithConfig(NULL, _("Layer Name Suffixes To Discard"), &HeeksDxfRead::m_layer_name_suffixes_to_discard, _T("LayerNameSuffixesToDiscard")));
 	dxf_options->m_list.push_back(new PropertyCheckWithConfig(NULL, _("add uninstanced blocks"), &HeeksDxfRead::m_add_uninstanced_blocks, _T("DxfAddUninstancedBlocks")));
+	dxf_options->m_list.push_back(new PropertyCheckWithConfig(NULL, _("relink sketches"), &HeeksDxfRead::m_relink_sketches, _T("DxfRelinkSketches")));
 	file_options->m_list.push_back(dxf_options);
 
+	PropertyList* heeks_options = new PropertyList(_("HEEKS"));
+	heeks_options->m_list.push_back( new PropertyCheck(NULL, _("save binary, instead of XML"), &m_heeks_save_as_binary ));
+	file_options->m_list.push_back(heeks_options);
+
 	PropertyList* stl_options = new PropertyList(_("STL"));
 	stl_options->m_list.push_back(new PropertyDouble(NULL, _("stl save facet tolerance"), &m_stl_facet_tolerance ));
 	stl_options->m_list.push_back( new PropertyCheck(NULL, _("STL save binary"), &m_stl_save_as_binary ));
@@ -4690,6 +4881,7 @@ wxString HeeksCADType(const int type)
         case OrientationModifierType:   return(_("OrientationModifier"));
         case HoleType:   return(_("Hole"));
         case HolePositionsType:   return(_("Positions"));
+        case InstanceType:   return(_("Instance"));
         case ObjectMaximumType:   return(_("ObjectMaximum"));
         default:    return(_T("")); // Indicate that this routine could not find a conversion.
     } // End switch
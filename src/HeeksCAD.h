@@ -40,6 +40,7 @@ class HRuler;
 class wxConfigBase;
 class wxAuiManager;
 class CAutoSave;
+class CShapeMesher;
 #ifdef USING_RIBBON
 class wxRibbonBar;
 class wxRibbonPage;
@@ -181,7 +182,16 @@ public:
 	bool m_allow_opengl_stippling;
 	SolidViewMode m_solid_view_mode;
 	bool m_stl_save_as_binary;
+	bool m_heeks_save_as_binary; // .heeks files are saved in the chunked binary format, rather than XML
 	bool m_mouse_move_highlighting;
+	bool m_pick_with_box_tree; // only render the objects whose boxes are near the mouse, when picking
+	bool m_cull_objects_out_of_view; // only draw the objects whose boxes are in the graphics window
+	double m_min_pixels_to_draw; // don't draw objects whose boxes are smaller than this on the screen
+	unsigned int m_num_objects_drawn; // counts from the last time glCommandsAll was called
+	unsigned int m_num_objects_culled;
+	unsigned int m_num_objects_too_small; // the ones culled for being smaller than m_min_pixels_to_draw
+	bool m_mesh_solids_in_background; // draw solids as boxes until their meshes have been made on other threads
+	CShapeMesher* m_shape_mesher;
 	HeeksColor m_highlight_color;
 	bool m_stl_solid_random_colors;
 	double m_iges_sewing_tolerance;
@@ -333,6 +343,7 @@ public:
 	void ClearHistory(void);
 	void glCommandsAll(const CViewPoint &view_point);
 	double GetPixelScale(void);
+	CShapeMesher* GetShapeMesher();
 	void DoMoveOrCopyDropDownMenu(wxWindow *wnd, const wxPoint &point, MarkedObject* marked_object, HeeksObj* paste_into, HeeksObj* paste_before);
 	void GetDropDownTools(std::list<Tool*> &f_list, const wxPoint &point, MarkedObject* marked_object, bool dont_use_point_for_functions, bool control_pressed);
 	void DoDropDownMenu(wxWindow *wnd, const wxPoint &point, MarkedObject* marked_object, bool dont_use_point_for_functions, bool control_pressed);
@@ -356,6 +367,8 @@ public:
 	void ObjectReadBaseXML(HeeksObj *object, TiXmlElement* element);
 	void InitializeXMLFunctions();
 	void OpenXMLFile(const wxChar *filepath,HeeksObj* paste_into = NULL, HeeksObj* paste_before = NULL, bool undoably = false, bool show_error = true);
+	void OpenBinaryFile(const wxChar *filepath,HeeksObj* paste_into = NULL, HeeksObj* paste_before = NULL, bool undoably = false, bool show_error = true);
+	void AddOpenedObjects(const std::list<HeeksObj*> &objects, HeeksObj* paste_into, HeeksObj* paste_before);
 	static void OpenSVGFile(const wxChar *filepath);
 	static void OpenSTLFile(const wxChar *filepath);
 	static void OpenDXFFile(const wxChar *filepath);
@@ -373,6 +386,8 @@ public:
 	void SavePyFile(const std::list<HeeksObj*>& objects, const wxChar *filepath, double facet_tolerance = -1.0);
 	void SaveXMLFile(const std::list<HeeksObj*>& objects, const wxChar *filepath, bool for_clipboard = false);
 	void SaveXMLFile(const wxChar *filepath){SaveXMLFile(m_objects, filepath);}
+	void SaveBinaryFile(const std::list<HeeksObj*>& objects, const wxChar *filepath);
+	void SaveBinaryFile(const wxChar *filepath){SaveBinaryFile(m_objects, filepath);}
 	bool SaveFile(const wxChar *filepath, bool use_dialog = false, bool update_recent_file_list = true, bool set_app_caption = true);
 	void AddUndoably(HeeksObj *object, HeeksObj* owner, HeeksObj* prev_object = NULL);
 	void AddUndoably(const std::list<HeeksObj*>& list, HeeksObj* owner);
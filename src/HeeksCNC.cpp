@@ -18,6 +18,7 @@
 #include "ToolImage.h"
 #include "OutputCanvas.h"
 #include "NCCode.h"
+#include "GCodeRead.h"
 #include "strconv.h"
 #include "Tool.h"
 #include "HeeksFrame.h"
@@ -101,6 +102,11 @@ void OnBuildTexture()
 	if (t)wxGetApp().m_icon_texture_number = *t;
 }
 
+static void OpenGCodeFile(const wxChar *filepath)
+{
+	wxGetApp().BackplotGCode(filepath);
+}
+
 void HeeksCADapp::OnCNCStartUp()
 {
 #if !defined WXUSINGDLL
@@ -166,6 +172,16 @@ void HeeksCADapp::OnCNCStartUp()
 	// add object reading functions
 	wxGetApp().RegisterReadXMLfunction("nccode", CNCCode::ReadFromXMLElement);
 
+	// open G-code files by backplotting them
+	{
+		std::list<wxString> extensions;
+		extensions.push_back(_T("nc"));
+		extensions.push_back(_T("ngc"));
+		extensions.push_back(_T("tap"));
+		extensions.push_back(_T("gcode"));
+		wxGetApp().RegisterFileOpenHandler(extensions, OpenGCodeFile);
+	}
+
 	// icons
 	wxGetApp().RegisterOnBuildTexture(OnBuildTexture);
 
@@ -182,6 +198,42 @@ void HeeksCADapp::OnCNCNewOrOpen(bool open, int res)
 	} // End if - then
 }
 
+void HeeksCADapp::BackplotGCode(const wxString& output_file)
+{
+	wxBusyCursor busy_cursor;
+
+	// read the G-code straight into a new nc code object, which is drawn as it is read
+	CNCCode* nc_code = new CNCCode;
+	Add(nc_code, NULL);
+
+	CGCodeRead reader;
+	bool read = reader.Read(output_file.c_str(), nc_code);
+	Remove(nc_code);
+	if(!read)
+	{
+		delete nc_code;
+		return;
+	}
+
+	// there is only one nc code object, so it replaces the one there was, undoably, like a file import does
+	HeeksObj* old_nc_code = NULL;
+	for(HeeksObj* object = GetFirstChild(); object; object = GetNextChild())
+	{
+		if(object->GetType() == NCCodeType)
+		{
+			old_nc_code = object;
+			break;
+		}
+	}
+
+	StartHistory();
+	if(old_nc_code)DeleteUndoably(old_nc_code);
+	AddUndoably(nc_code, NULL, NULL);
+	EndHistory();
+
+	Repaint();
+}
+
 void HeeksCADapp::OnFrameDelete()
 {
 	wxAuiManager* aui_manager = wxGetApp().m_frame->m_aui_manager;
@@ -55,6 +55,7 @@ enum{
 	ImageType,
 	XmlType,
 	OctreeType,
+	InstanceType,
 	ObjectMaximumType,
 };
 
@@ -119,6 +120,7 @@ public:
 	virtual void glCommands(bool select, bool marked, bool no_color){};
 	virtual void Draw(wxDC& dc){} // for printing
 	virtual bool DrawAfterOthers(){return false;}
+	virtual bool PickWithoutBox(){return false;} // return true if GetBox doesn't contain everything drawn, for example things drawn at a fixed size on the screen
 	virtual void GetBox(CBox &box){}
 	virtual const wxChar* GetShortString(void)const{return NULL;}
 	virtual const wxChar* GetTypeString(void)const{return _("Unknown");}
@@ -0,0 +1,440 @@
+// Instance.cpp
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+#include "stdafx.h"
+#include "Instance.h"
+#include "Shape.h"
+#include "MarkedList.h"
+#include "Tool.h"
+#include "HeeksBinaryFile.h"
+#include <BRep_Builder.hxx>
+
+// the drawing solids, by their shape's TopoDS_TShape, so copies of the same solid share one, while there are any instances of it
+static std::map<const Standard_Transient*, std::weak_ptr<CShape> > drawing_solids;
+
+// the index of each shape being saved, so instances sharing a shape have it written once
+static std::map<const Standard_Transient*, int> shape_indexes;
+
+// the shapes read from the file being opened, by those indexes
+static std::map<int, TopoDS_Shape> read_shapes;
+
+static std::shared_ptr<CShape> DrawingSolid(const TopoDS_Shape &shape, const wxChar* title, const HeeksColor& col, float opacity)
+{
+	// shape mustn't have a location
+	const Standard_Transient* key = shape.TShape().operator->();
+
+	std::map<const Standard_Transient*, std::weak_ptr<CShape> >::iterator FindIt = drawing_solids.find(key);
+	if(FindIt != drawing_solids.end())
+	{
+		std::shared_ptr<CShape> drawing_solid = FindIt->second.lock();
+		if(drawing_solid && drawing_solid->m_color == col && drawing_solid->GetOpacity() == opacity)return drawing_solid;
+	}
+
+	// forget the ones which aren't used any more
+	for(std::map<const Standard_Transient*, std::weak_ptr<CShape> >::iterator It = drawing_solids.begin(); It != drawing_solids.end();)
+	{
+		if(It->second.expired())drawing_solids.erase(It++);
+		else It++;
+	}
+
+	HeeksObj* object = CShape::MakeObject(shape, title, SOLID_TYPE_UNKNOWN, col, opacity);
+	if(object == NULL)return std::shared_ptr<CShape>();
+	if(!CShape::IsTypeAShape(object->GetType()))
+	{
+		delete object;
+		return std::shared_ptr<CShape>();
+	}
+
+	std::shared_ptr<CShape> drawing_solid((CShape*)object);
+	drawing_solids[key] = drawing_solid;
+	return drawing_solid;
+}
+
+CInstance::CInstance(std::shared_ptr<CShape> solid, const gp_Trsf &trsf):m_solid(solid), m_trsf(trsf)
+{
+}
+
+const TopoDS_Shape &CInstance::SharedShape()const
+{
+	return m_solid->Shape();
+}
+
+TopoDS_Shape CInstance::PlacedShape()const
+{
+	// a location, if it can be, or a transformed copy for a mirror
+	return BRepBuilderAPI_Transform(m_solid->Shape(), m_trsf, Standard_False).Shape();
+}
+
+HeeksObj* CInstance::MakeRealCopy()const
+{
+	HeeksObj* new_object = m_solid->MakeACopy();
+	double m[16];
+	extract(m_trsf, m);
+	new_object->ModifyByMatrix(m);
+	return new_object;
+}
+
+void CInstance::glCommands(bool select, bool marked, bool no_color)
+{
+	double m[16];
+	extract_transposed(m_trsf, m);
+	glPushMatrix();
+	glMultMatrixd(m);
+
+	// a mirror turns the triangles over
+	bool mirrored = m_trsf.IsNegative();
+	GLint front_face = GL_CCW;
+	if(mirrored)
+	{
+		glGetIntegerv(GL_FRONT_FACE, &front_face);
+		glFrontFace(front_face == GL_CCW ? GL_CW : GL_CCW);
+	}
+
+	// the solid's own display lists, which have the solid's faces' picking colours in, so not for picking
+	if(select)m_solid->glFacesForPicking();
+	else m_solid->glCommands(false, marked, no_color);
+
+	if(mirrored)glFrontFace(front_face);
+
+	glPopMatrix();
+}
+
+void CInstance::GetBox(CBox &box)
+{
+	CBox solid_box;
+	m_solid->GetBox(solid_box);
+	if(!solid_box.m_valid)return;
+
+	for(int i = 0; i < 8; i++)
+	{
+		double p[3];
+		solid_box.vert(i, p);
+		gp_Pnt v = make_point(p).Transformed(m_trsf);
+		box.Insert(v.X(), v.Y(), v.Z());
+	}
+}
+
+void CInstance::KillGLLists(void)
+{
+	// the other instances of the solid will make them again
+	m_solid->KillGLLists();
+}
+
+const wxBitmap &CInstance::GetIcon()
+{
+	static wxBitmap* icon = NULL;
+	if(icon == NULL)icon = new wxBitmap(wxImage(wxGetApp().GetResFolder() + _T("/icons/solid.png")));
+	return *icon;
+}
+
+void CInstance::ModifyByMatrix(const double *m)
+{
+	m_trsf = make_matrix(m) * m_trsf;
+}
+
+static const gp_Trsf* trsf_for_triangles = NULL;
+static void(*callbackfunc_for_triangles)(const double* x, const double* n) = NULL;
+static bool just_one_average_normal_for_triangles = true;
+
+static void transformed_triangle(const double* x, const double* n)
+{
+	double tx[9];
+	double tn[9];
+	int num_normals = just_one_average_normal_for_triangles ? 1 : 3;
+
+	for(int i = 0; i < 3; i++)
+	{
+		gp_Pnt p = gp_Pnt(x[i*3], x[i*3+1], x[i*3+2]).Transformed(*trsf_for_triangles);
+		tx[i*3] = p.X();
+		tx[i*3+1] = p.Y();
+		tx[i*3+2] = p.Z();
+	}
+
+	for(int i = 0; i < num_normals; i++)
+	{
+		gp_Vec v = gp_Vec(n[i*3], n[i*3+1], n[i*3+2]).Transformed(*trsf_for_triangles);
+		tn[i*3] = v.X();
+		tn[i*3+1] = v.Y();
+		tn[i*3+2] = v.Z();
+	}
+
+	if(trsf_for_triangles->IsNegative())
+	{
+		// a mirror turns the triangle over, so swap two corners to keep it anticlockwise
+		for(int j = 0; j < 3; j++)
+		{
+			std::swap(tx[3+j], tx[6+j]);
+			if(num_normals == 3)std::swap(tn[3+j], tn[6+j]);
+		}
+	}
+
+	(*callbackfunc_for_triangles)(tx, tn);
+}
+
+void CInstance::GetTriangles(void(*callbackfunc)(const double* x, const double* n), double cusp, bool just_one_average_normal)
+{
+	trsf_for_triangles = &m_trsf;
+	callbackfunc_for_triangles = callbackfunc;
+	just_one_average_normal_for_triangles = just_one_average_normal;
+	m_solid->GetTriangles(transformed_triangle, cusp, just_one_average_normal);
+}
+
+void CInstance::WriteXML(TiXmlNode *root)
+{
+	TiXmlElement * element;
+	element = new TiXmlElement( "Instance" );
+	root->LinkEndChild( element );
+	element->SetAttribute("title", Ttc(m_solid->m_title.c_str()));
+	element->SetAttribute("col", m_solid->m_color.COLORREF_color());
+	element->SetDoubleAttribute("opacity", m_solid->GetOpacity());
+
+	double m[16];
+	extract(m_trsf, m);
+
+	element->SetDoubleAttribute("m0", m[0] );
+	element->SetDoubleAttribute("m1", m[1] );
+	element->SetDoubleAttribute("m2", m[2] );
+	element->SetDoubleAttribute("m3", m[3] );
+	element->SetDoubleAttribute("m4", m[4] );
+	element->SetDoubleAttribute("m5", m[5] );
+	element->SetDoubleAttribute("m6", m[6] );
+	element->SetDoubleAttribute("m7", m[7] );
+	element->SetDoubleAttribute("m8", m[8] );
+	element->SetDoubleAttribute("m9", m[9] );
+	element->SetDoubleAttribute("ma", m[10]);
+	element->SetDoubleAttribute("mb", m[11]);
+
+	// the shape was written by WriteShapes or WriteShapesBinary
+	std::map<const Standard_Transient*, int>::iterator FindIt = shape_indexes.find(m_solid->Shape().TShape().operator->());
+	if(FindIt != shape_indexes.end())element->SetAttribute("shape", FindIt->second);
+
+	WriteBaseXML(element);
+}
+
+// static member function
+HeeksObj* CInstance::ReadFromXMLElement(TiXmlElement* pElem)
+{
+	double m[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+	wxString title;
+	HeeksColor col;
+	double opacity = 1.0;
+	int shape_index = 0;
+
+	// get the attributes
+	for(TiXmlAttribute* a = pElem->FirstAttribute(); a; a = a->Next())
+	{
+		std::string name(a->Name());
+		if(name == "title"){title = Ctt(a->Value());}
+		else if(name == "col"){col = HeeksColor((long)(a->IntValue()));}
+		else if(name == "opacity"){opacity = a->DoubleValue();}
+		else if(name == "shape"){shape_index = a->IntValue();}
+		else if(name == "m0"){m[0] = a->DoubleValue();}
+		else if(name == "m1"){m[1] = a->DoubleValue();}
+		else if(name == "m2"){m[2] = a->DoubleValue();}
+		else if(name == "m3"){m[3] = a->DoubleValue();}
+		else if(name == "m4"){m[4] = a->DoubleValue();}
+		else if(name == "m5"){m[5] = a->DoubleValue();}
+		else if(name == "m6"){m[6] = a->DoubleValue();}
+		else if(name == "m7"){m[7] = a->DoubleValue();}
+		else if(name == "m8"){m[8] = a->DoubleValue();}
+		else if(name == "m9"){m[9] = a->DoubleValue();}
+		else if(name == "ma"){m[10]= a->DoubleValue();}
+		else if(name == "mb"){m[11]= a->DoubleValue();}
+	}
+
+	// the shape was read before the instances
+	std::map<int, TopoDS_Shape>::iterator FindIt = read_shapes.find(shape_index);
+	if(FindIt == read_shapes.end())return NULL;
+	std::shared_ptr<CShape> solid = DrawingSolid(FindIt->second, title.c_str(), col, (float)opacity);
+	if(!solid)return NULL;
+
+	CInstance* new_object = new CInstance(solid, make_matrix(m));
+	new_object->ReadBaseXML(pElem);
+
+	return new_object;
+}
+
+bool CInstance::DrawAfterOthers()
+{
+	return m_solid->DrawAfterOthers();
+}
+
+// static
+bool CInstance::CanInstance(HeeksObj* object)
+{
+	return object->GetType() == SolidType || object->GetType() == InstanceType;
+}
+
+// static
+CInstance* CInstance::MakeInstance(HeeksObj* object, const gp_Trsf &trsf)
+{
+	if(object->GetType() == InstanceType)
+	{
+		// an instance of the same shape, rather than of the instance
+		CInstance* instance = (CInstance*)object;
+		return new CInstance(instance->m_solid, trsf * instance->m_trsf);
+	}
+
+	// the solid's location goes in the instance's matrix
+	CShape* solid = (CShape*)object;
+	return new CInstance(DrawingSolid(solid->Shape().Located(TopLoc_Location()), solid->m_title.c_str(), solid->m_color, solid->GetOpacity()), trsf * solid->Shape().Location().Transformation());
+}
+
+static void AddShapesToWrite(HeeksObj* object, std::list<TopoDS_Shape> &shapes)
+{
+	if(object->GetType() == InstanceType)
+	{
+		const TopoDS_Shape &shape = ((CInstance*)object)->SharedShape();
+		const Standard_Transient* key = shape.TShape().operator->();
+		if(shape_indexes.find(key) == shape_indexes.end())
+		{
+			shapes.push_back(shape);
+			shape_indexes.insert(std::make_pair(key, (int)shapes.size()));
+		}
+	}
+
+	if(object->GetType() == GroupType)
+	{
+		for(HeeksObj* o = object->GetFirstChild(); o; o = object->GetNextChild())
+		{
+			AddShapesToWrite(o, shapes);
+		}
+	}
+}
+
+static void GetShapesToWrite(const std::list<HeeksObj*>& objects, std::list<TopoDS_Shape> &shapes)
+{
+	shape_indexes.clear();
+	for(std::list<HeeksObj*>::const_iterator It = objects.begin(); It != objects.end(); It++)
+	{
+		AddShapesToWrite(*It, shapes);
+	}
+}
+
+// static
+void CInstance::WriteShapes(const std::list<HeeksObj*>& objects, TiXmlNode *root)
+{
+	std::list<TopoDS_Shape> shapes;
+	GetShapesToWrite(objects, shapes);
+
+	int i = 1;
+	for(std::list<TopoDS_Shape>::iterator It = shapes.begin(); It != shapes.end(); It++, i++)
+	{
+		TiXmlElement * element;
+		element = new TiXmlElement( "InstanceShape" );
+		root->LinkEndChild( element );
+		element->SetAttribute("index", i);
+
+		// the shape, as BRep text
+		std::ostringstream ss;
+		BRepTools::Write(*It, ss);
+		TiXmlText *text = new TiXmlText(ss.str().c_str());
+		text->SetCDATA(true);
+		element->LinkEndChild( text );
+	}
+}
+
+// static
+void CInstance::WriteShapesBinary(const std::list<HeeksObj*>& objects, CHeeksBinaryWriter& writer)
+{
+	std::list<TopoDS_Shape> shapes;
+	GetShapesToWrite(objects, shapes);
+
+	int i = 1;
+	for(std::list<TopoDS_Shape>::iterator It = shapes.begin(); It != shapes.end(); It++, i++)
+	{
+		// in OpenCASCADE's binary format, like the solids
+		std::ostringstream oss(ios::binary);
+		BinTools_ShapeSet shape_set;
+		shape_set.Add(*It);
+		shape_set.Write(oss);
+		shape_set.Write(*It, oss);
+		writer.AddChunk("ISHP", i, oss.str());
+	}
+}
+
+// static member function
+HeeksObj* CInstance::ReadShapeFromXMLElement(TiXmlElement* pElem)
+{
+	int index = 0;
+	pElem->Attribute("index", &index);
+	const char* text = pElem->GetText();
+	if(text == NULL)return NULL;
+
+	TopoDS_Shape shape;
+	BRep_Builder builder;
+	std::istringstream ss(text);
+	BRepTools::Read(shape, ss, builder);
+	if(!shape.IsNull())read_shapes[index] = shape;
+
+	// it isn't an object
+	return NULL;
+}
+
+// static
+void CInstance::ReadShapesBinary(const CHeeksBinaryReader& reader)
+{
+	const std::vector<CHeeksBinaryReader::CChunk> &chunks = reader.Chunks();
+	for(std::vector<CHeeksBinaryReader::CChunk>::const_iterator It = chunks.begin(); It != chunks.end(); It++)
+	{
+		const CHeeksBinaryReader::CChunk &chunk = *It;
+		if(!chunk.IsType("ISHP"))continue;
+
+		TopoDS_Shape shape;
+		try
+		{
+			std::istringstream iss(std::string(chunk.m_data, chunk.m_size), ios::binary);
+			BinTools_ShapeSet shape_set;
+			shape_set.Read(iss);
+			shape_set.Read(shape, iss, shape_set.NbShapes());
+		}
+		catch(Standard_Failure)
+		{
+			continue;
+		}
+		if(!shape.IsNull())read_shapes[chunk.m_index] = shape;
+	}
+}
+
+// static
+void CInstance::EndReading()
+{
+	read_shapes.clear();
+}
+
+static CInstance* instance_for_tools = NULL;
+
+class MakeRealCopiesTool:public Tool{
+public:
+	void Run(){
+		// this instance and any other marked instances
+		std::list<CInstance*> instances;
+		instances.push_back(instance_for_tools);
+		for(std::list<HeeksObj*>::const_iterator It = wxGetApp().m_marked_list->list().begin(); It != wxGetApp().m_marked_list->list().end(); It++)
+		{
+			HeeksObj* object = *It;
+			if(object != instance_for_tools && object->GetType() == InstanceType)instances.push_back((CInstance*)object);
+		}
+		wxGetApp().m_marked_list->Clear(true);
+
+		wxGetApp().StartHistory();
+		for(std::list<CInstance*>::iterator It = instances.begin(); It != instances.end(); It++)
+		{
+			CInstance* instance = *It;
+			HeeksObj* new_object = instance->MakeRealCopy();
+			wxGetApp().AddUndoably(new_object, instance->m_owner, NULL);
+			wxGetApp().DeleteUndoably(instance);
+		}
+		wxGetApp().EndHistory();
+	}
+	const wxChar* GetTitle(){return _("Make Real Copies");}
+	wxString BitmapPath(){return _T("copy");}
+};
+
+static MakeRealCopiesTool make_real_copies_tool;
+
+void CInstance::GetTools(std::list<Tool*>* t_list, const wxPoint* p)
+{
+	instance_for_tools = this;
+	if(!wxGetApp().m_no_creation_mode)t_list->push_back(&make_real_copies_tool);
+}
@@ -0,0 +1,55 @@
+// Instance.h
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+
+#include "HeeksObj.h"
+
+class CShape;
+class CHeeksBinaryWriter;
+class CHeeksBinaryReader;
+
+// a copy of a solid which doesn't copy its mesh, but shares the solid's TopoDS_Shape and draws it with its own matrix, so the shape is only meshed once.
+// the shape is drawn by a solid which isn't in the document, with its own display lists, which the instances of the same solid share.
+// it doesn't refer to the solid it was copied from, so it stays where it is, whatever is done to that solid.
+// the copy tools make these for solids; "Make Real Copies" turns them into solids.
+// when saved, each shared shape is written once, before the objects, and the instances refer to it by its index.
+class CInstance: public HeeksObj{
+	std::shared_ptr<CShape> m_solid; // the shape without its location, which m_trsf includes
+
+public:
+	gp_Trsf m_trsf; // from m_solid to the instance
+
+	CInstance(std::shared_ptr<CShape> solid, const gp_Trsf &trsf);
+
+	const TopoDS_Shape &SharedShape()const; // without a location
+	TopoDS_Shape PlacedShape()const; // the shape where the instance is, for exporting
+	HeeksObj* MakeRealCopy()const;
+
+	// HeeksObj's virtual functions
+	int GetType()const{return InstanceType;}
+	long GetMarkingMask()const{return MARKING_FILTER_SOLID;}
+	void glCommands(bool select, bool marked, bool no_color);
+	void GetBox(CBox &box);
+	void KillGLLists(void);
+	const wxChar* GetTypeString(void)const{return _("Instance");}
+	HeeksObj *MakeACopy(void)const{return new CInstance(*this);}
+	const wxBitmap &GetIcon();
+	void ModifyByMatrix(const double *m);
+	void GetTriangles(void(*callbackfunc)(const double* x, const double* n), double cusp, bool just_one_average_normal = true);
+	void CopyFrom(const HeeksObj* object){operator=(*((CInstance*)object));}
+	void WriteXML(TiXmlNode *root);
+	bool UsesID(){return true;}
+	bool DrawAfterOthers();
+	void GetTools(std::list<Tool*>* t_list, const wxPoint* p);
+
+	static HeeksObj* ReadFromXMLElement(TiXmlElement* pElem);
+	static void WriteShapes(const std::list<HeeksObj*>& objects, TiXmlNode *root); // before the objects
+	static void WriteShapesBinary(const std::list<HeeksObj*>& objects, CHeeksBinaryWriter& writer);
+	static HeeksObj* ReadShapeFromXMLElement(TiXmlElement* pElem); // an "InstanceShape", which isn't an object, but is kept for the instances after it
+	static void ReadShapesBinary(const CHeeksBinaryReader& reader); // before the objects
+	static void EndReading(); // forgets the shapes read
+	static bool CanInstance(HeeksObj* object);
+	static CInstance* MakeInstance(HeeksObj* object, const gp_Trsf &trsf); // object must be one which CanInstance
+};
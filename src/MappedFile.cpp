@@ -0,0 +1,63 @@
+// MappedFile.cpp
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+#include "stdafx.h"
+
+#include "MappedFile.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef WIN32
+CMappedFile::CMappedFile(const wxChar* filepath):m_data(NULL), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(NULL)
+{
+	m_file = CreateFile(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(m_file == INVALID_HANDLE_VALUE)return;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)return;
+
+	m_mapping = CreateFileMapping(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(m_mapping == NULL)return;
+
+	m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if(m_data)m_size = (size_t)(size.QuadPart);
+}
+
+CMappedFile::~CMappedFile()
+{
+	if(m_data)UnmapViewOfFile(m_data);
+	if(m_mapping)CloseHandle(m_mapping);
+	if(m_file != INVALID_HANDLE_VALUE)CloseHandle(m_file);
+}
+#else
+CMappedFile::CMappedFile(const wxChar* filepath):m_data(NULL), m_size(0), m_file(-1)
+{
+	m_file = open(Ttc(filepath), O_RDONLY);
+	if(m_file == -1)return;
+
+	struct stat st;
+	if(fstat(m_file, &st) != 0 || st.st_size == 0)return;
+
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+	if(data == MAP_FAILED)return;
+
+	// the file is read from start to end
+	madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+	m_data = (const char*)data;
+	m_size = (size_t)(st.st_size);
+}
+
+CMappedFile::~CMappedFile()
+{
+	if(m_data)munmap((void*)m_data, m_size);
+	if(m_file != -1)close(m_file);
+}
+#endif
@@ -0,0 +1,29 @@
+// MappedFile.h
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+
+// a whole file mapped into memory for reading, so big files can be parsed without copying them through a stream
+class CMappedFile
+{
+	const char* m_data;
+	size_t m_size;
+#ifdef WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_file;
+#endif
+
+	CMappedFile(const CMappedFile&); // not copyable
+	const CMappedFile& operator=(const CMappedFile&);
+
+public:
+	CMappedFile(const wxChar* filepath);
+	~CMappedFile();
+
+	bool IsOk()const{ return m_data != NULL; } // false if the file couldn't be opened, or is empty
+	const char* Data()const{ return m_data; }
+	size_t Size()const{ return m_size; }
+};
@@ -17,11 +17,14 @@
 #include "SolidTools.h"
 #include "MenuSeparator.h"
 #include "Picking.h"
+#include "PickTree.h"
+#include "Ruler.h"
 using namespace std;
 
 MarkedList::MarkedList(){
 	gripping = false;
 	point_or_window = new PointOrWindow(true);
+	m_pick_tree = new CPickTree;
 	gripper_marked_list_changed = false;
 	ignore_coords_only = false;
 	m_filter = -1;
@@ -29,6 +32,7 @@ MarkedList::MarkedList(){
 
 MarkedList::~MarkedList(void){
 	delete point_or_window;
+	delete m_pick_tree;
 	std::list<Gripper*>::iterator It;
 	for(It = move_grips.begin(); It != move_grips.end(); It++){
 		Gripper* gripper = *It;
@@ -111,7 +115,60 @@ void MarkedList::GrippersGLCommands(bool select, bool no_color){
 	}
 }
 
+bool MarkedList::RenderForPicking(const wxRect &window)
+{
+	// returns false if nothing was drawn
+	if(!wxGetApp().m_pick_with_box_tree)
+	{
+		wxGetApp().glCommands(true, false, true);
+		GrippersGLCommands(true, true);
+		return true;
+	}
+
+	// only render the objects whose boxes are in the window
+	std::list<HeeksObj*> objects;
+	m_pick_tree->ObjectsInWindow(wxGetApp().m_frame->m_graphics->m_view_point, window, objects);
+
+	bool drawn = false;
+	for(std::list<HeeksObj*>::iterator It = objects.begin(); It != objects.end(); It++)
+	{
+		HeeksObj* object = *It;
+		if(object->OnVisibleLayer() && object->m_visible)
+		{
+			SetPickingColor(object->GetIndex());
+			object->glCommands(true, ObjectMarked(object), true);
+			drawn = true;
+		}
+	}
+
+	if(wxGetApp().m_show_ruler)
+	{
+		SetPickingColor(wxGetApp().m_ruler->GetIndex());
+		wxGetApp().m_ruler->glCommands(true, false, true);
+		drawn = true;
+	}
+
+	if(size() > 0)
+	{
+		GrippersGLCommands(true, true);
+		drawn = true;
+	}
+
+	return drawn;
+}
+
 void MarkedList::ObjectsInWindow( wxRect window, MarkedObject* marked_object, bool single_picking){
+	if (window.width < 0)
+	{
+		window.x += window.width;
+		window.width = abs(window.width);
+	}
+	if (window.height < 0)
+	{
+		window.y += window.height;
+		window.height = abs(window.height);
+	}
+
 	// render everything with unique colors
 
 	wxGetApp().m_frame->m_graphics->SetCurrent();
@@ -138,25 +195,14 @@ void MarkedList::ObjectsInWindow( wxRect window, MarkedObject* marked_object, bo
 	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
 	glEnable(GL_COLOR_MATERIAL);
 
-	wxGetApp().glCommands(true, false, true);
-
-	GrippersGLCommands(true, true);
+	bool drawn = RenderForPicking(window);
 
 	glDisable(GL_DEPTH_TEST);
 	glDisable(GL_POLYGON_OFFSET_FILL);
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	glDisable(GL_COLOR_MATERIAL);
 
-	if (window.width < 0)
-	{
-		window.x += window.width;
-		window.width = abs(window.width);
-	}
-	if (window.height < 0)
-	{
-		window.y += window.height;
-		window.height = abs(window.height);
-	}
+	if(!drawn)return; // nothing near the window, so no need to read the pixels
 
 	unsigned int pixel_size = 4 * window.width * window.height;
 	unsigned char* pixels = (unsigned char*)malloc(pixel_size);
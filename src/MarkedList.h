@@ -10,6 +10,7 @@
 
 class Gripper;
 class PointOrWindow;
+class CPickTree;
 
 class MarkedList{
 private:
@@ -24,9 +25,11 @@ private:
 	void render_move_grips(bool select, bool no_color);
 	void OnChangedAdded(HeeksObj* object);
 	void OnChangedRemoved(HeeksObj* object);
+	bool RenderForPicking(const wxRect &window);
 
 public:
 	PointOrWindow *point_or_window;
+	CPickTree *m_pick_tree;
 	bool gripping;
 	std::list<Gripper*> move_grips;
 	bool gripper_marked_list_changed;
@@ -33,6 +33,7 @@
 
 #include <memory>
 #include <sstream>
+#include <algorithm>
 
 int CNCCode::s_arc_interpolation_count = 20;
 
@@ -61,6 +62,7 @@ void ColouredText::ReadFromXMLElement(TiXmlElement* element)
 // static
 double PathObject::m_current_x[3] = {0, 0, 0};
 double PathObject::m_prev_x[3] = {0, 0, 0};
+double PathObject::m_current_feed = 0.0;
 
 void PathObject::WriteBaseXML(TiXmlElement *pElem)
 {
@@ -69,6 +71,7 @@ void PathObject::WriteBaseXML(TiXmlElement *pElem)
 	pElem->SetDoubleAttribute("x", m_x[0]);
 	pElem->SetDoubleAttribute("y", m_x[1]);
 	pElem->SetDoubleAttribute("z", m_x[2]);
+	if(m_feed > 0.0)pElem->SetDoubleAttribute("feed", m_feed);
 
 } // End WriteXML() method
 
@@ -80,8 +83,10 @@ void PathObject::ReadFromXMLElement(TiXmlElement* pElem)
 	if(pElem->Attribute("x", &x))m_current_x[0] = x * CNCCodeBlock::multiplier;
 	if(pElem->Attribute("y", &x))m_current_x[1] = x * CNCCodeBlock::multiplier;
 	if(pElem->Attribute("z", &x))m_current_x[2] = x * CNCCodeBlock::multiplier;
+	if(pElem->Attribute("feed", &x))m_current_feed = x * CNCCodeBlock::multiplier;
 
 	memcpy(m_x, m_current_x, 3*sizeof(double));
+	m_feed = m_current_feed;
 
 	if (pElem->Attribute("tool_number"))
 	{
@@ -526,6 +531,7 @@ HeeksObj* CNCCodeBlock::ReadFromXMLElement(TiXmlElement* element)
 void CNCCodeBlock::AppendText(wxString& str)
 {
 	if(m_text.size() == 0)return;
+	m_formatted = false; // the new text has no style yet
 
 	for(std::list<ColouredText>::iterator It = m_text.begin(); It != m_text.end(); It++)
 	{
@@ -557,6 +563,166 @@ void CNCCodeBlock::FormatText(wxTextCtrl *textCtrl, bool highlighted, bool force
 	m_formatted = true;
 }
 
+void CNCToolpath::Clear()
+{
+	m_x.clear();
+	m_color_type.clear();
+	m_tool_number.clear();
+	m_feed.clear();
+	m_block.clear();
+	m_arc.clear();
+	m_arc_c.clear();
+	m_arc_dir.clear();
+	m_block_first_move.clear();
+}
+
+static void AddToolpathVertex(std::vector<float> &vertices, const double* x)
+{
+	vertices.push_back((float)x[0]);
+	vertices.push_back((float)x[1]);
+	vertices.push_back((float)x[2]);
+}
+
+static void AddToolpathVertex(std::vector<float> &vertices, const gp_Pnt &p)
+{
+	vertices.push_back((float)p.X());
+	vertices.push_back((float)p.Y());
+	vertices.push_back((float)p.Z());
+}
+
+static void AddToolpathColor(std::vector<unsigned char> &colors, const HeeksColor &col)
+{
+	// for both ends of a line
+	for(int i = 0; i < 2; i++)
+	{
+		colors.push_back(col.red);
+		colors.push_back(col.green);
+		colors.push_back(col.blue);
+	}
+}
+
+void CNCToolpath::AddBlocks(std::list<CNCCodeBlock*>::iterator begin, std::list<CNCCodeBlock*>::iterator end)
+{
+	// take off the end of the last block, to put it back after the new blocks
+	if(m_block_first_move.size() > 0)m_block_first_move.pop_back();
+
+	unsigned int block_index = m_block_first_move.size();
+	for(std::list<CNCCodeBlock*>::iterator It = begin; It != end; It++, block_index++)
+	{
+		CNCCodeBlock* block = *It;
+		block->m_block_index = block_index;
+		m_block_first_move.push_back(m_block.size());
+
+		for(std::list<ColouredPath>::iterator PathIt = block->m_line_strips.begin(); PathIt != block->m_line_strips.end(); PathIt++)
+		{
+			ColouredPath& path = *PathIt;
+			for(std::list< PathObject* >::iterator PointIt = path.m_points.begin(); PointIt != path.m_points.end(); PointIt++)
+			{
+				PathObject* po = *PointIt;
+				m_x.insert(m_x.end(), po->m_x, po->m_x + 3);
+				m_color_type.push_back((unsigned char)path.m_color_type);
+				m_tool_number.push_back(po->m_tool_number);
+				m_feed.push_back((float)po->m_feed);
+				m_block.push_back(block_index);
+
+				if(po->GetType() == PathObject::eArc)
+				{
+					PathArc* arc = (PathArc*)po;
+					m_arc.push_back(m_arc_dir.size());
+					m_arc_c.insert(m_arc_c.end(), arc->m_c, arc->m_c + 3);
+					m_arc_dir.push_back((signed char)arc->m_dir);
+				}
+				else
+				{
+					m_arc.push_back(-1);
+				}
+			}
+		}
+	}
+
+	m_block_first_move.push_back(m_block.size());
+}
+
+void CNCToolpath::GetLines(unsigned int first_block, unsigned int end_block, std::vector<float> &vertices, std::vector<unsigned char> &colors)const
+{
+	if(end_block <= first_block)return;
+
+	// the arcs are split into lines again each time, rather than keeping the lines
+	PathLine prev_po;
+	PathArc arc;
+	for(unsigned int i = m_block_first_move[first_block]; i < m_block_first_move[end_block]; i++)
+	{
+		// the first move is from nowhere
+		if(i == 0)continue;
+
+		const double* x = &m_x[i * 3];
+		const double* prev_x = &m_x[(i - 1) * 3];
+		const HeeksColor &col = CNCCode::Color((ColorEnum)m_color_type[i]);
+
+		if(m_arc[i] == -1)
+		{
+			AddToolpathVertex(vertices, prev_x);
+			AddToolpathVertex(vertices, x);
+			AddToolpathColor(colors, col);
+			continue;
+		}
+
+		memcpy(prev_po.m_x, prev_x, 3 * sizeof(double));
+		memcpy(arc.m_x, x, 3 * sizeof(double));
+		memcpy(arc.m_c, &m_arc_c[m_arc[i] * 3], 3 * sizeof(double));
+		arc.m_dir = m_arc_dir[m_arc[i]];
+
+		// the points start with the arc's start point
+		std::list<gp_Pnt> points = arc.Interpolate(&prev_po, CNCCode::s_arc_interpolation_count);
+		const gp_Pnt* p0 = NULL;
+		for(std::list<gp_Pnt>::iterator PIt = points.begin(); PIt != points.end(); PIt++)
+		{
+			if(p0)
+			{
+				AddToolpathVertex(vertices, *p0);
+				AddToolpathVertex(vertices, *PIt);
+				AddToolpathColor(colors, col);
+			}
+			p0 = &(*PIt);
+		}
+	}
+}
+
+void CNCToolpath::GetPickingLines(std::list<CNCCodeBlock*> &blocks, std::vector<float> &vertices, std::vector<unsigned char> &colors)const
+{
+	unsigned int block_index = 0;
+	for(std::list<CNCCodeBlock*>::iterator It = blocks.begin(); It != blocks.end(); It++, block_index++)
+	{
+		unsigned int first_vertex = vertices.size() / 3;
+		GetLines(block_index, block_index + 1, vertices, colors);
+
+		unsigned int name = (*It)->GetIndex();
+		for(unsigned int i = first_vertex; i < vertices.size() / 3; i++)
+		{
+			colors[i * 3] = name & 0xff;
+			colors[i * 3 + 1] = (name & 0xff00) >> 8;
+			colors[i * 3 + 2] = (name & 0xff0000) >> 16;
+		}
+	}
+}
+
+// static
+void CNCToolpath::glDrawLines(const std::vector<float> &vertices, const std::vector<unsigned char>* colors)
+{
+	if(vertices.size() == 0)return;
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, &vertices[0]);
+	if(colors)
+	{
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(3, GL_UNSIGNED_BYTE, 0, &(*colors)[0]);
+	}
+	glDrawArrays(GL_LINES, 0, (GLsizei)(vertices.size() / 3));
+	if(colors)glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
 long CNCCode::pos = 0;
 // static
 PathObject* CNCCode::prev_po = NULL;
@@ -675,7 +841,7 @@ void CNCCode::GetOptions(std::list<Property *> *list)
 #endif
 }
 
-CNCCode::CNCCode() :m_highlighted_block(NULL), m_gl_list(0), m_select_gl_list(0), m_user_edited(false)
+CNCCode::CNCCode() :m_highlighted_block(NULL), m_gl_list(0), m_select_gl_list(0), m_stats_valid(false), m_user_edited(false)
 {
 	HeeksConfig config;
 	config.Read(_T("CNCCode_ArcInterpolationCount"), &CNCCode::s_arc_interpolation_count, 20);
@@ -683,6 +849,7 @@ CNCCode::CNCCode() :m_highlighted_block(NULL), m_gl_list(0), m_select_gl_list(0)
 
 CNCCode::~CNCCode()
 {
+	if(wxGetApp().m_nc_code == this)wxGetApp().m_nc_code = NULL;
 	Clear();
 }
 
@@ -707,6 +874,9 @@ void CNCCode::Clear()
 		delete block;
 	}
 	m_blocks.clear();
+	m_text_blocks.clear();
+	m_toolpath.Clear();
+	m_stats_valid = false;
 	DestroyGLLists();
 	m_box = CBox();
 	m_highlighted_block = NULL;
@@ -714,27 +884,39 @@ void CNCCode::Clear()
 
 void CNCCode::glCommands(bool select, bool marked, bool no_color)
 {
+	UpdateToolpath();
+
 	int* plist = select ? &m_select_gl_list : &m_gl_list;
 	if (*plist)
 	{
 		glCallList(*plist);
 	}
 	else{
+		// the lines are only kept until they are compiled; when selecting, each vertex has the colour of its block's index
+		std::vector<float> vertices;
+		std::vector<unsigned char> colors;
+		if(select)m_toolpath.GetPickingLines(m_blocks, vertices, colors);
+		else m_toolpath.GetLines(0, m_toolpath.GetNumBlocks(), vertices, colors);
+
 		*plist = glGenLists(1);
 		glNewList(*plist, GL_COMPILE_AND_EXECUTE);
 
 		// render all the blocks
-		CNCCode::prev_po = NULL;
-
-		for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
-		{
-			CNCCodeBlock* block = *It;
-			SetPickingColor(block->GetIndex());
-			block->glCommands(select, block == m_highlighted_block, no_color);
-		}
+		CNCToolpath::glDrawLines(vertices, (no_color && !select) ? NULL : &colors);
 
 		glEndList();
 	}
+
+	if(!select && m_highlighted_block && m_highlighted_block->m_block_index >= 0)
+	{
+		// draw the highlighted block again, over the top, so only its lines are made when it changes
+		glLineWidth(3);
+		std::vector<float> vertices;
+		std::vector<unsigned char> colors;
+		m_toolpath.GetLines(m_highlighted_block->m_block_index, m_highlighted_block->m_block_index + 1, vertices, colors);
+		CNCToolpath::glDrawLines(vertices, no_color ? NULL : &colors);
+		glLineWidth(1);
+	}
 }
 
 void CNCCode::GetBox(CBox &box)
@@ -760,12 +942,23 @@ void on_set_arc_interpolation_count(int value, HeeksObj*object)
 
 void CNCCode::GetProperties(std::list<Property *> *list)
 {
+	CalculateStats();
+	m_stats.GetProperties(list);
+
 #if 0 // to do
 	list->push_back(new PropertyInt(_("Arc Interpolation Count"), CNCCode::s_arc_interpolation_count, this, on_set_arc_interpolation_count));
 	HeeksObj::GetProperties(list);
 #endif
 }
 
+void CNCCode::CalculateStats()
+{
+	UpdateToolpath();
+	if(m_stats_valid && !m_stats.OptionsChanged())return;
+	m_stats.Calculate(m_blocks, m_toolpath);
+	m_stats_valid = true;
+}
+
 void CNCCode::GetTools(std::list<Tool*>* t_list, const wxPoint* p)
 {
 	HeeksObj::GetTools(t_list, p);
@@ -817,7 +1010,6 @@ void CNCCode::SetClickMarkPoint(MarkedObject* marked_object, const double* ray_s
 					SetHighlightedBlock((CNCCodeBlock*)object);
 					int from_pos = m_highlighted_block->m_from_pos;
 					int to_pos = m_highlighted_block->m_to_pos;
-					DestroyGLLists();
 					wxGetApp().m_output_canvas->m_textCtrl->ShowPosition(from_pos);
 					wxGetApp().m_output_canvas->m_textCtrl->SetSelection(from_pos, to_pos);
 				}
@@ -834,6 +1026,7 @@ HeeksObj* CNCCode::ReadFromXMLElement(TiXmlElement* element)
 
 	CNCCodeBlock::multiplier = 1.0;
 	PathObject::m_current_x[0] = PathObject::m_current_x[1] = PathObject::m_current_x[2]  = 0.0;
+	PathObject::m_current_feed = 0.0;
 
 	// loop through all the objects
 	for(TiXmlElement* pElem = TiXmlHandle(element).FirstChildElement().Element() ; pElem;	pElem = pElem->NextSiblingElement())
@@ -873,6 +1066,21 @@ void CNCCode::DestroyGLLists(void)
 	}
 }
 
+void CNCCode::UpdateToolpath()
+{
+	unsigned int num_blocks = m_blocks.size();
+	if(num_blocks < m_toolpath.GetNumBlocks())m_toolpath.Clear();
+	if(m_toolpath.m_block_first_move.size() > 0 && num_blocks == m_toolpath.GetNumBlocks())return;
+
+	std::list<CNCCodeBlock*>::iterator It = m_blocks.end();
+	for(unsigned int i = m_toolpath.GetNumBlocks(); i < num_blocks; i++)It--;
+	m_toolpath.AddBlocks(It, m_blocks.end());
+	m_stats_valid = false;
+
+	DestroyGLLists();
+	m_box = CBox();
+}
+
 void CNCCode::SetTextCtrl(wxTextCtrl *textCtrl)
 {
 	textCtrl->Clear();
@@ -885,51 +1093,48 @@ void CNCCode::SetTextCtrl(wxTextCtrl *textCtrl)
 	textCtrl->SetDefaultStyle(ta);
 
 	wxString str;
+	m_text_blocks.clear();
+	if(m_blocks.size() > 0)str.reserve(m_blocks.back()->m_to_pos);
 	for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
 	{
 		CNCCodeBlock* block = *It;
 		block->AppendText(str);
+		if(block->m_text.size() > 0)m_text_blocks.push_back(block);
 	}
 	textCtrl->SetValue(str);
 
-#ifndef WIN32
-	// for Windows, this is done in COutputTextCtrl::OnPaint
-	for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
-	{
-		CNCCodeBlock* block = *It;
-		block->FormatText(textCtrl, block == m_highlighted_block, false);
-	}
-#endif
+	// the blocks are only formatted when they are scrolled into view, by COutputTextCtrl
+	wxGetApp().m_nc_code = this;
 
 	textCtrl->Thaw();
 }
 
+static bool BlockFromBefore(const CNCCodeBlock* block, long pos){return block->m_from_pos < pos;}
+static bool BlockToBefore(long pos, const CNCCodeBlock* block){return pos < block->m_to_pos;}
+
 void CNCCode::FormatBlocks(wxTextCtrl *textCtrl, int i0, int i1)
 {
 	textCtrl->Freeze();
-	for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
+	for(std::vector<CNCCodeBlock*>::iterator It = std::lower_bound(m_text_blocks.begin(), m_text_blocks.end(), (long)i0, BlockFromBefore); It != m_text_blocks.end(); It++)
 	{
 		CNCCodeBlock* block = *It;
-		if (i0 <= block->m_from_pos && block->m_from_pos <= i1)
-			block->FormatText(textCtrl, block == m_highlighted_block, false);
+		if (block->m_from_pos > i1)break;
+		block->FormatText(textCtrl, block == m_highlighted_block, false);
 	}
 	textCtrl->Thaw();
 }
 
-void CNCCode::HighlightBlock(long pos)
+CNCCodeBlock* CNCCode::GetBlockAtPos(long pos)
 {
-	SetHighlightedBlock(NULL);
+	// the first block which ends after pos
+	std::vector<CNCCodeBlock*>::iterator It = std::upper_bound(m_text_blocks.begin(), m_text_blocks.end(), pos, BlockToBefore);
+	if(It == m_text_blocks.end())return NULL;
+	return *It;
+}
 
-	for(std::list<CNCCodeBlock*>::iterator It = m_blocks.begin(); It != m_blocks.end(); It++)
-	{
-		CNCCodeBlock* block = *It;
-		if(pos < block->m_to_pos)
-		{
-			SetHighlightedBlock(block);
-			break;
-		}
-	}
-	DestroyGLLists();
+void CNCCode::HighlightBlock(long pos)
+{
+	SetHighlightedBlock(GetBlockAtPos(pos));
 }
 
 
@@ -14,11 +14,13 @@
 #include "HeeksObj.h"
 #include "HeeksColor.h"
 #include "HeeksCNCTypes.h"
+#include "NCStats.h"
 
 #include <TopoDS_Shape.hxx>
 #include <gp_Pnt.hxx>
 
 #include <list>
+#include <vector>
 
 enum ColorEnum{
 	ColorDefaultType,
@@ -58,9 +60,11 @@ public:
 
 	static double m_current_x[3];
 	static double m_prev_x[3];
+	static double m_current_feed;
 	double m_x[3];
 	int m_tool_number;
-	PathObject(){m_x[0] = m_x[1] = m_x[2] = 0.0;}
+	double m_feed; // 0 if not known
+	PathObject():m_feed(0.0){m_x[0] = m_x[1] = m_x[2] = 0.0;}
 	virtual int GetType() = 0; // 0 - line, 1 - arc
 	virtual void GetBox(CBox &box,const PathObject* prev_po){box.Insert(m_x);}
 
@@ -136,9 +140,10 @@ public:
 	std::list<ColouredText> m_text;
 	std::list<ColouredPath> m_line_strips;
 	long m_from_pos, m_to_pos; // position of block in text ctrl
+	int m_block_index; // position of block in CNCCode::m_blocks, set when the toolpath is made
 	static double multiplier;
 
-	CNCCodeBlock():m_from_pos(-1), m_to_pos(-1), m_formatted(false) {}
+	CNCCodeBlock():m_from_pos(-1), m_to_pos(-1), m_block_index(-1), m_formatted(false) {}
 
 	void WriteNCCode(wxTextFile &f, double ox, double oy);
 
@@ -156,6 +161,35 @@ private:
 	bool m_formatted;
 };
 
+// the moves of all the blocks packed into arrays
+// the lines to draw are made from these, into vertex arrays which are only kept while the display lists are compiled
+class CNCToolpath
+{
+public:
+	// for each move
+	std::vector<double> m_x; // end point, 3 for each move
+	std::vector<unsigned char> m_color_type; // ColorRapidType, ColorFeedType...
+	std::vector<int> m_tool_number;
+	std::vector<float> m_feed;
+	std::vector<unsigned int> m_block;
+	std::vector<int> m_arc; // index into the arc arrays, -1 for a line
+
+	// for each arc
+	std::vector<double> m_arc_c; // centre relative to the start point, 3 for each arc
+	std::vector<signed char> m_arc_dir; // 1 - anti-clockwise, -1 - clockwise
+
+	// block i has moves m_block_first_move[i] to m_block_first_move[i+1] - 1
+	std::vector<unsigned int> m_block_first_move;
+
+	unsigned int GetNumBlocks()const{return m_block_first_move.size() == 0 ? 0 : m_block_first_move.size() - 1;}
+	unsigned int GetNumMoves()const{return m_block.size();}
+	void Clear();
+	void AddBlocks(std::list<CNCCodeBlock*>::iterator begin, std::list<CNCCodeBlock*>::iterator end);
+	void GetLines(unsigned int first_block, unsigned int end_block, std::vector<float> &vertices, std::vector<unsigned char> &colors)const; // 2 vertices for each line, with the line's colour for each vertex
+	void GetPickingLines(std::list<CNCCodeBlock*> &blocks, std::vector<float> &vertices, std::vector<unsigned char> &colors)const; // with each block's index for its colour
+	static void glDrawLines(const std::vector<float> &vertices, const std::vector<unsigned char>* colors);
+};
+
 class CNCCode:public HeeksObj
 {
 public:
@@ -175,15 +209,19 @@ public:
 	static HeeksColor& Color(ColorEnum i) { return m_colors[i]; }
 
 	std::list<CNCCodeBlock*> m_blocks;
+	std::vector<CNCCodeBlock*> m_text_blocks; // the blocks with some text, in order, to find blocks from positions in the text ctrl
+	CNCToolpath m_toolpath;
+	CNCStats m_stats;
 	int m_gl_list;
 	int m_select_gl_list;
+	bool m_stats_valid; // false when blocks have been added to the toolpath since m_stats was calculated
 	CBox m_box;
 	bool m_user_edited; // set, if the user has edited the nc code
 	static PathObject* prev_po;
 	static int s_arc_interpolation_count;	// How many lines to represent an arc for the glCommands() method?
 
 	CNCCode();
-	CNCCode(const CNCCode &p):m_highlighted_block(NULL), m_gl_list(0) {operator=(p);}
+	CNCCode(const CNCCode &p):m_highlighted_block(NULL), m_gl_list(0), m_select_gl_list(0), m_stats_valid(false) {operator=(p);}
 	virtual ~CNCCode();
 
 	const CNCCode &operator=(const CNCCode &p);
@@ -211,8 +249,11 @@ public:
 	static void GetOptions(std::list<Property *> *list);
 
 	void DestroyGLLists(void); // not void KillGLLists(void), because I don't want the display list recreated on the Redraw button
+	void UpdateToolpath(); // adds any blocks added since it was last called to the toolpath
+	void CalculateStats(); // sets m_stats from the toolpath, if the toolpath or the cycle time options have changed
 	void SetTextCtrl(wxTextCtrl *textCtrl);
 	void FormatBlocks(wxTextCtrl *textCtrl, int i0, int i1);
+	CNCCodeBlock* GetBlockAtPos(long pos); // returns NULL if pos is after the end of the text
 	void HighlightBlock(long pos);
 	void SetHighlightedBlock(CNCCodeBlock* block);
 };
@@ -0,0 +1,390 @@
+// NCStats.cpp
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+#include "stdafx.h"
+
+#include "NCStats.h"
+#include "NCCode.h"
+#include "HeeksConfig.h"
+#include "PropertyDouble.h"
+#include "PropertyList.h"
+#include "PropertyString.h"
+
+#include <map>
+
+double CNCStats::s_rapid_rate = 5000.0;
+double CNCStats::s_default_feed_rate = 1000.0;
+double CNCStats::s_acceleration = 500.0;
+double CNCStats::s_jerk = 10000.0;
+double CNCStats::s_junction_deviation = 0.02;
+double CNCStats::s_tool_change_time = 10.0;
+
+static wxString TimeString(double seconds)
+{
+	int s = (int)(seconds + 0.5);
+	return wxString::Format(_T("%d:%02d:%02d"), s / 3600, (s / 60) % 60, s % 60);
+}
+
+static wxString LengthString(double length)
+{
+	return wxString::Format(_T("%.1f"), length / wxGetApp().m_view_units);
+}
+
+void CNCStatsItem::GetProperties(std::list<Property *> *list)const
+{
+	list->push_back(new PropertyStringReadOnly(_("cut length"), LengthString(m_cut_length)));
+	list->push_back(new PropertyStringReadOnly(_("rapid length"), LengthString(m_rapid_length)));
+	list->push_back(new PropertyStringReadOnly(_("cut time"), TimeString(m_cut_time)));
+	list->push_back(new PropertyStringReadOnly(_("rapid time"), TimeString(m_rapid_time)));
+}
+
+// a move, with its arc made into its length, its direction at each end and its speed limit
+class StatsMove
+{
+public:
+	double m_length;
+	double m_v; // the fastest it can go, mm per second
+	double m_start_dir[3], m_end_dir[3];
+	bool m_rapid;
+	int m_tool_number;
+	int m_operation;
+};
+
+static double Length(const double* v)
+{
+	return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+static bool MakeStatsMove(const CNCToolpath &toolpath, unsigned int i, StatsMove &move)
+{
+	// move i goes from the end of move i-1; returns false for a move of no length
+	const double* s = &toolpath.m_x[(i - 1) * 3];
+	const double* e = &toolpath.m_x[i * 3];
+	double d[3] = {e[0] - s[0], e[1] - s[1], e[2] - s[2]};
+
+	move.m_rapid = (toolpath.m_color_type[i] == ColorRapidType);
+	move.m_tool_number = toolpath.m_tool_number[i];
+	if(move.m_rapid)move.m_v = CNCStats::s_rapid_rate / 60;
+	else
+	{
+		double feed = toolpath.m_feed[i] > 0.0 ? toolpath.m_feed[i] : CNCStats::s_default_feed_rate;
+		move.m_v = (feed < CNCStats::s_rapid_rate ? feed : CNCStats::s_rapid_rate) / 60;
+	}
+
+	int arc = toolpath.m_arc[i];
+	if(arc >= 0)
+	{
+		// like PathArc::Interpolate, an arc in the XY plane, with the radius going from its start radius to its end radius
+		const double* c = &toolpath.m_arc_c[arc * 3];
+		int dir = toolpath.m_arc_dir[arc];
+		double sx = -c[0];
+		double sy = -c[1];
+		double ex = -c[0] + d[0];
+		double ey = -c[1] + d[1];
+		double rs = sqrt(sx * sx + sy * sy);
+		double re = sqrt(ex * ex + ey * ey);
+		if(rs > 0.000001 && re > 0.000001)
+		{
+			double start_angle = atan2(sy, sx);
+			double end_angle = atan2(ey, ex);
+			if(dir == 1){
+				if(end_angle < start_angle)end_angle += 6.283185307179;
+			}
+			else{
+				if(start_angle < end_angle)start_angle += 6.283185307179;
+			}
+			double sweep = fabs(end_angle - start_angle);
+			if(sweep == 0.0)sweep = 6.283185307179; // a full circle
+
+			double r = (rs + re) * 0.5;
+			double xy_length = sweep * r;
+			move.m_length = sqrt(xy_length * xy_length + d[2] * d[2]);
+			if(move.m_length < 0.000001)return false;
+
+			// the tangents, going round the arc, with the helix's climb
+			double ts[2] = {-sy * dir / rs, sx * dir / rs};
+			double te[2] = {-ey * dir / re, ex * dir / re};
+			double fxy = xy_length / move.m_length;
+			move.m_start_dir[0] = ts[0] * fxy;
+			move.m_start_dir[1] = ts[1] * fxy;
+			move.m_start_dir[2] = d[2] / move.m_length;
+			move.m_end_dir[0] = te[0] * fxy;
+			move.m_end_dir[1] = te[1] * fxy;
+			move.m_end_dir[2] = move.m_start_dir[2];
+
+			// going round the arc needs the acceleration v * v / r
+			if(CNCStats::s_acceleration > 0.0)
+			{
+				double v = sqrt(CNCStats::s_acceleration * r);
+				if(v < move.m_v)move.m_v = v;
+			}
+			return true;
+		}
+	}
+
+	move.m_length = Length(d);
+	if(move.m_length < 0.000001)return false;
+	for(int j = 0; j < 3; j++)move.m_start_dir[j] = move.m_end_dir[j] = d[j] / move.m_length;
+	return true;
+}
+
+static double JunctionSpeed(const StatsMove &m0, const StatsMove &m1)
+{
+	// the speed the corner between two moves can be taken at, cutting it by no more than the junction deviation
+	if(m0.m_tool_number != m1.m_tool_number)return 0.0;
+
+	double v = (m0.m_v < m1.m_v) ? m0.m_v : m1.m_v;
+	double cos_theta = -(m0.m_end_dir[0] * m1.m_start_dir[0] + m0.m_end_dir[1] * m1.m_start_dir[1] + m0.m_end_dir[2] * m1.m_start_dir[2]);
+	if(cos_theta > 0.999999)return 0.0; // going back the way it came
+	if(cos_theta < -0.999999)return v; // straight on
+
+	double sin_half_theta = sqrt(0.5 * (1.0 - cos_theta));
+	double vj = sqrt(CNCStats::s_acceleration * CNCStats::s_junction_deviation * sin_half_theta / (1.0 - sin_half_theta));
+	return (vj < v) ? vj : v;
+}
+
+static double RampTime(double dv)
+{
+	// the time to change speed by dv; with a jerk limit the acceleration ramps up and down
+	if(dv <= 0.0)return 0.0;
+	double a = CNCStats::s_acceleration;
+	double j = CNCStats::s_jerk;
+	if(j <= 0.0)return dv / a;
+	if(dv >= a * a / j)return dv / a + a / j;
+	return 2.0 * sqrt(dv / j);
+}
+
+static double RampLength(double v0, double v1)
+{
+	// the speed profile is symmetrical, so the average speed is half way between
+	return (v0 + v1) * 0.5 * RampTime(fabs(v1 - v0));
+}
+
+static double MoveTime(double length, double v0, double v, double v1)
+{
+	// the time for a move starting at v0 and ending at v1, not going faster than v
+	double d = RampLength(v0, v) + RampLength(v, v1);
+	if(d <= length)return RampTime(v - v0) + RampTime(v - v1) + (length - d) / v;
+
+	// it doesn't get up to full speed, find the top speed it does get to
+	double lo = (v0 > v1) ? v0 : v1;
+	if(RampLength(v0, lo) + RampLength(lo, v1) >= length)return 2.0 * length / (v0 + v1);
+	double hi = v;
+	for(int i = 0; i < 40; i++)
+	{
+		double mid = (lo + hi) * 0.5;
+		if(RampLength(v0, mid) + RampLength(mid, v1) > length)hi = mid;
+		else lo = mid;
+	}
+	return RampTime(lo - v0) + RampTime(lo - v1);
+}
+
+static wxString GetComment(const CNCCodeBlock* block)
+{
+	wxString comment;
+	for(std::list<ColouredText>::const_iterator It = block->m_text.begin(); It != block->m_text.end(); It++)
+	{
+		const ColouredText &text = *It;
+		if(text.m_color_type == ColorCommentType)comment += text.m_str;
+	}
+	comment.Trim(false);
+	comment.Trim(true);
+	if(comment.StartsWith(_T("(")) || comment.StartsWith(_T(";")))comment = comment.Mid(1);
+	if(comment.EndsWith(_T(")")))comment.RemoveLast();
+	comment.Trim(false);
+	comment.Trim(true);
+	return comment;
+}
+
+void CNCStats::Clear()
+{
+	m_total = CNCStatsItem(_("total"), 0);
+	m_tools.clear();
+	m_operations.clear();
+	m_tool_changes = 0;
+	m_cycle_time = 0.0;
+}
+
+void CNCStats::GetOptionValues(double* values)
+{
+	values[0] = s_rapid_rate;
+	values[1] = s_default_feed_rate;
+	values[2] = s_acceleration;
+	values[3] = s_jerk;
+	values[4] = s_junction_deviation;
+	values[5] = s_tool_change_time;
+}
+
+bool CNCStats::OptionsChanged()const
+{
+	double values[6];
+	GetOptionValues(values);
+	for(int i = 0; i < 6; i++)
+	{
+		if(values[i] != m_options_used[i])return true;
+	}
+	return false;
+}
+
+void CNCStats::Calculate(const std::list<CNCCodeBlock*> &blocks, const CNCToolpath &toolpath)
+{
+	Clear();
+	GetOptionValues(m_options_used);
+
+	// find the operation of each block; a comment starts a new operation, or names one with no moves yet
+	unsigned int num_blocks = toolpath.GetNumBlocks();
+	std::vector<int> block_operation(num_blocks, -1);
+	bool operation_has_moves = false;
+	unsigned int block_index = 0;
+	for(std::list<CNCCodeBlock*>::const_iterator It = blocks.begin(); It != blocks.end() && block_index < num_blocks; It++, block_index++)
+	{
+		const CNCCodeBlock* block = *It;
+		unsigned int first_move = toolpath.m_block_first_move[block_index];
+		if(first_move == toolpath.m_block_first_move[block_index + 1])
+		{
+			wxString comment = GetComment(block);
+			if(comment.Len() > 0)
+			{
+				if(m_operations.size() > 0 && !operation_has_moves)m_operations.back().m_title = comment;
+				else
+				{
+					m_operations.push_back(CNCStatsItem(comment, 0));
+					operation_has_moves = false;
+				}
+			}
+		}
+		else
+		{
+			if(m_operations.size() == 0)m_operations.push_back(CNCStatsItem(_("start"), 0));
+			if(!operation_has_moves)m_operations.back().m_tool_number = toolpath.m_tool_number[first_move];
+			operation_has_moves = true;
+		}
+		block_operation[block_index] = (int)m_operations.size() - 1;
+	}
+	if(m_operations.size() > 0 && !operation_has_moves)m_operations.pop_back();
+
+	// count the tool changes and make the moves, the first move is where the program starts from
+	unsigned int num_moves = toolpath.GetNumMoves();
+	std::vector<StatsMove> moves;
+	moves.reserve(num_moves);
+	for(unsigned int i = 0; i < num_moves; i++)
+	{
+		int tool_number = toolpath.m_tool_number[i];
+		if((i == 0) ? (tool_number != 0) : (tool_number != toolpath.m_tool_number[i - 1]))m_tool_changes++;
+		if(i == 0)continue;
+
+		StatsMove move;
+		if(!MakeStatsMove(toolpath, i, move))continue;
+		move.m_operation = block_operation[toolpath.m_block[i]];
+		moves.push_back(move);
+	}
+
+	// the speed at the start of each move, and a stop at the end
+	// the corners limit the speeds, then going backwards, then forwards, a move can't change the speed more than its length allows
+	std::vector<double> speed(moves.size() + 1, 0.0);
+	if(s_acceleration > 0.0)
+	{
+		for(unsigned int i = 1; i < moves.size(); i++)speed[i] = JunctionSpeed(moves[i - 1], moves[i]);
+		for(unsigned int i = moves.size(); i > 0; i--)
+		{
+			double v = sqrt(speed[i] * speed[i] + 2 * s_acceleration * moves[i - 1].m_length);
+			if(v < speed[i - 1])speed[i - 1] = v;
+		}
+		for(unsigned int i = 0; i < moves.size(); i++)
+		{
+			double v = sqrt(speed[i] * speed[i] + 2 * s_acceleration * moves[i].m_length);
+			if(v < speed[i + 1])speed[i + 1] = v;
+		}
+	}
+
+	// add up the lengths and times
+	std::map<int, unsigned int> tool_index;
+	for(unsigned int i = 0; i < moves.size(); i++)
+	{
+		const StatsMove &move = moves[i];
+		double t = (s_acceleration > 0.0) ? MoveTime(move.m_length, speed[i], move.m_v, speed[i + 1]) : move.m_length / move.m_v;
+
+		std::map<int, unsigned int>::iterator FindIt = tool_index.find(move.m_tool_number);
+		if(FindIt == tool_index.end())
+		{
+			FindIt = tool_index.insert(std::make_pair(move.m_tool_number, (unsigned int)m_tools.size())).first;
+			m_tools.push_back(CNCStatsItem(wxString::Format(_("tool %d"), move.m_tool_number), move.m_tool_number));
+		}
+
+		CNCStatsItem* items[3] = {&m_total, &m_tools[FindIt->second], (move.m_operation >= 0) ? &m_operations[move.m_operation] : NULL};
+		for(int j = 0; j < 3; j++)
+		{
+			if(items[j] == NULL)continue;
+			if(move.m_rapid)
+			{
+				items[j]->m_rapid_length += move.m_length;
+				items[j]->m_rapid_time += t;
+			}
+			else
+			{
+				items[j]->m_cut_length += move.m_length;
+				items[j]->m_cut_time += t;
+			}
+		}
+	}
+
+	m_cycle_time = m_total.GetTime() + m_tool_changes * s_tool_change_time;
+}
+
+void CNCStats::GetProperties(std::list<Property *> *list)const
+{
+	list->push_back(new PropertyStringReadOnly(_("cycle time"), TimeString(m_cycle_time)));
+	list->push_back(new PropertyStringReadOnly(_("tool changes"), wxString::Format(_T("%d"), m_tool_changes)));
+	m_total.GetProperties(list);
+
+	PropertyList* tools = new PropertyList(_("tools"));
+	for(std::vector<CNCStatsItem>::const_iterator It = m_tools.begin(); It != m_tools.end(); It++)
+	{
+		PropertyList* tool = new PropertyList(It->m_title.c_str());
+		It->GetProperties(&(tool->m_list));
+		tools->m_list.push_back(tool);
+	}
+	list->push_back(tools);
+
+	PropertyList* operations = new PropertyList(_("operations"));
+	for(std::vector<CNCStatsItem>::const_iterator It = m_operations.begin(); It != m_operations.end(); It++)
+	{
+		PropertyList* operation = new PropertyList(It->m_title.c_str());
+		operation->m_list.push_back(new PropertyStringReadOnly(_("tool"), wxString::Format(_T("%d"), It->m_tool_number)));
+		It->GetProperties(&(operation->m_list));
+		operations->m_list.push_back(operation);
+	}
+	list->push_back(operations);
+}
+
+void CNCStats::GetOptions(std::list<Property *> *list)
+{
+	PropertyList* cycle_time = new PropertyList(_("cycle time estimate"));
+	cycle_time->m_list.push_back(new PropertyDouble(NULL, _("rapid rate ( mm per minute )"), &s_rapid_rate));
+	cycle_time->m_list.push_back(new PropertyDouble(NULL, _("feed rate if not given ( mm per minute )"), &s_default_feed_rate));
+	cycle_time->m_list.push_back(new PropertyDouble(NULL, _("acceleration ( mm per second squared, 0 for none )"), &s_acceleration));
+	cycle_time->m_list.push_back(new PropertyDouble(NULL, _("jerk ( mm per second cubed, 0 for none )"), &s_jerk));
+	cycle_time->m_list.push_back(new PropertyDouble(NULL, _("junction deviation ( mm )"), &s_junction_deviation));
+	cycle_time->m_list.push_back(new PropertyDouble(NULL, _("tool change time ( seconds )"), &s_tool_change_time));
+	list->push_back(cycle_time);
+}
+
+void CNCStats::ReadFromConfig(HeeksConfig& config)
+{
+	config.Read(_T("CycleTimeRapidRate"), &s_rapid_rate, 5000.0);
+	config.Read(_T("CycleTimeDefaultFeedRate"), &s_default_feed_rate, 1000.0);
+	config.Read(_T("CycleTimeAcceleration"), &s_acceleration, 500.0);
+	config.Read(_T("CycleTimeJerk"), &s_jerk, 10000.0);
+	config.Read(_T("CycleTimeJunctionDeviation"), &s_junction_deviation, 0.02);
+	config.Read(_T("CycleTimeToolChangeTime"), &s_tool_change_time, 10.0);
+}
+
+void CNCStats::WriteToConfig(HeeksConfig& config)
+{
+	config.Write(_T("CycleTimeRapidRate"), s_rapid_rate);
+	config.Write(_T("CycleTimeDefaultFeedRate"), s_default_feed_rate);
+	config.Write(_T("CycleTimeAcceleration"), s_acceleration);
+	config.Write(_T("CycleTimeJerk"), s_jerk);
+	config.Write(_T("CycleTimeJunctionDeviation"), s_junction_deviation);
+	config.Write(_T("CycleTimeToolChangeTime"), s_tool_change_time);
+}
@@ -0,0 +1,63 @@
+// NCStats.h
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+
+#include <list>
+#include <vector>
+
+class CNCCodeBlock;
+class CNCToolpath;
+class HeeksConfig;
+class Property;
+
+// lengths and estimated times for a tool, or an operation, or the whole program
+class CNCStatsItem
+{
+public:
+	wxString m_title;
+	int m_tool_number;
+	double m_cut_length, m_rapid_length; // mm
+	double m_cut_time, m_rapid_time; // seconds
+
+	CNCStatsItem(const wxString& title, int tool_number):m_title(title), m_tool_number(tool_number), m_cut_length(0.0), m_rapid_length(0.0), m_cut_time(0.0), m_rapid_time(0.0){}
+
+	double GetTime()const{return m_cut_time + m_rapid_time;}
+	void GetProperties(std::list<Property *> *list)const;
+};
+
+// a pass over the toolpath of a CNCCode, which adds up the lengths of the moves and estimates the time they take,
+// with the speed limited by the feed rate, the acceleration, the jerk and how sharp the corners are
+class CNCStats
+{
+	double m_options_used[6]; // the machine's values it was calculated with
+
+	static void GetOptionValues(double* values);
+
+public:
+	CNCStatsItem m_total;
+	std::vector<CNCStatsItem> m_tools; // in the order the tools are first used
+	std::vector<CNCStatsItem> m_operations; // an operation starts at each comment, between moves
+	int m_tool_changes;
+	double m_cycle_time; // seconds, the total time with the tool changes
+
+	// the machine
+	static double s_rapid_rate; // mm per minute
+	static double s_default_feed_rate; // mm per minute, for feed moves without a feed rate
+	static double s_acceleration; // mm per second per second
+	static double s_jerk; // mm per second per second per second, 0 for no jerk limit
+	static double s_junction_deviation; // mm, how far from the corner the machine is allowed to cut it
+	static double s_tool_change_time; // seconds
+
+	CNCStats():m_total(_("total"), 0), m_tool_changes(0), m_cycle_time(0.0){}
+
+	void Clear();
+	void Calculate(const std::list<CNCCodeBlock*> &blocks, const CNCToolpath &toolpath);
+	void GetProperties(std::list<Property *> *list)const;
+	bool OptionsChanged()const; // since it was calculated
+
+	static void GetOptions(std::list<Property *> *list);
+	static void ReadFromConfig(HeeksConfig& config);
+	static void WriteToConfig(HeeksConfig& config);
+};
@@ -4,6 +4,10 @@
 #include "Box.h"
 #include "Octree.h"
 
+#ifdef OCTREE_USES_SSE2
+#include <emmintrin.h>
+#endif
+
 COctCube::COctCube(const CBox& box)
 {
 	m_box = box;
@@ -20,11 +24,40 @@ int COctCube::Inside(const CBox& box)const
 	return 0;
 }
 
-void COctCube::SetElementsColor(COctEle& ele)const
+void COctCube::Inside(const COctChildBoxes& boxes, int* inside)const
+{
+#ifdef OCTREE_USES_SSE2
+	// two children at a time
+	for (int i = 0; i < 8; i += 2)
+	{
+		__m128d contains = _mm_castsi128_pd(_mm_set1_epi32(-1));
+		__m128d intersects = contains;
+		for (int j = 0; j < 3; j++)
+		{
+			__m128d bmin = _mm_loadu_pd(&boxes.m_min[j][i]);
+			__m128d bmax = _mm_loadu_pd(&boxes.m_max[j][i]);
+			__m128d cmin = _mm_set1_pd(m_box.m_x[j]);
+			__m128d cmax = _mm_set1_pd(m_box.m_x[j + 3]);
+			contains = _mm_and_pd(contains, _mm_and_pd(_mm_cmpge_pd(bmin, cmin), _mm_cmple_pd(bmax, cmax)));
+			intersects = _mm_and_pd(intersects, _mm_and_pd(_mm_cmple_pd(bmin, cmax), _mm_cmpge_pd(bmax, cmin)));
+		}
+		int contains_mask = _mm_movemask_pd(contains);
+		int intersects_mask = _mm_movemask_pd(intersects);
+		for (int k = 0; k < 2; k++)
+		{
+			inside[i + k] = ((contains_mask >> k) & 1) ? 2 : (((intersects_mask >> k) & 1) ? 1 : 0);
+		}
+	}
+#else
+	COctSolid::Inside(boxes, inside);
+#endif
+}
+
+void COctCube::SetElementsColor(const CBox& box, COctEle& ele)const
 {
 	double v[3], v2[3];
 	double c[3], c2[3];
-	ele.m_box.Centre(c);
+	box.Centre(c);
 	m_box.Centre(c2);
 	for (int i = 0; i < 3; i++)
 	{
@@ -46,7 +79,7 @@ void COctCube::SetElementsColor(COctEle& ele)const
 		ele.m_color_b += rand() % 12;
 	}
 
-	double size = ele.m_box.Width() * 0.5;
+	double size = box.Width() * 0.5;
 
 	if (vv.getx() + size > vv2.getx())
 	{
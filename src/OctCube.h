@@ -12,5 +12,6 @@ public:
 
 	// CSolid's virtual functions
 	int Inside(const CBox& box)const;
-	void SetElementsColor(COctEle& ele)const;
+	void Inside(const COctChildBoxes& boxes, int* inside)const;
+	void SetElementsColor(const CBox& box, COctEle& ele)const;
 };
\ No newline at end of file
@@ -6,6 +6,7 @@ class CBox;
 #include "Box.h"
 
 class COctEle;
+class COctChildBoxes;
 
 class COctSolid
 {
@@ -13,5 +14,6 @@ public:
 	COctSolid(){}
 
 	virtual int Inside(const CBox& box)const{ return 0; } // return 2 if completely inside, return 1 if some inside, return 0 if not at all inside
-	virtual void SetElementsColor(COctEle& ele)const{}
+	virtual void Inside(const COctChildBoxes& boxes, int* inside)const; // the same for all 8 children of an element at once; override this to do them together
+	virtual void SetElementsColor(const CBox& box, COctEle& ele)const{}
 };
\ No newline at end of file
@@ -4,6 +4,10 @@
 #include "Box.h"
 #include "Octree.h"
 
+#ifdef OCTREE_USES_SSE2
+#include <emmintrin.h>
+#endif
+
 COctSphere::COctSphere(const geoff_geometry::Point3d& c, double r)
 {
 	m_c = c;
@@ -44,15 +48,48 @@ int COctSphere::Inside(const CBox& box)const
 	return 0;
 }
 
+void COctSphere::Inside(const COctChildBoxes& boxes, int* inside)const
+{
+#ifdef OCTREE_USES_SSE2
+	double c[3] = { m_c.x, m_c.y, m_c.z };
+	__m128d r2 = _mm_set1_pd(m_r * m_r);
+	__m128d zero = _mm_setzero_pd();
+
+	// two children at a time
+	for (int i = 0; i < 8; i += 2)
+	{
+		__m128d near_d2 = zero; // squared distance to the nearest point of the box
+		__m128d far_d2 = zero; // squared distance to the furthest corner of the box
+		for (int j = 0; j < 3; j++)
+		{
+			__m128d cj = _mm_set1_pd(c[j]);
+			__m128d to_min = _mm_sub_pd(_mm_loadu_pd(&boxes.m_min[j][i]), cj);
+			__m128d to_max = _mm_sub_pd(cj, _mm_loadu_pd(&boxes.m_max[j][i]));
+			__m128d outside = _mm_add_pd(_mm_max_pd(to_min, zero), _mm_max_pd(to_max, zero));
+			near_d2 = _mm_add_pd(near_d2, _mm_mul_pd(outside, outside));
+			far_d2 = _mm_add_pd(far_d2, _mm_max_pd(_mm_mul_pd(to_min, to_min), _mm_mul_pd(to_max, to_max)));
+		}
+		int touching_mask = _mm_movemask_pd(_mm_cmplt_pd(near_d2, r2));
+		int all_in_mask = _mm_movemask_pd(_mm_cmple_pd(far_d2, r2));
+		for (int k = 0; k < 2; k++)
+		{
+			inside[i + k] = ((touching_mask >> k) & 1) ? (((all_in_mask >> k) & 1) ? 2 : 1) : 0;
+		}
+	}
+#else
+	COctSolid::Inside(boxes, inside);
+#endif
+}
+
 bool COctSphere::Inside(const geoff_geometry::Point3d& p)const
 {
 	return p.Dist(m_c) <= m_r;
 }
 
-void COctSphere::SetElementsColor(COctEle& ele)const
+void COctSphere::SetElementsColor(const CBox& box, COctEle& ele)const
 {
 	double bc[3];
-	ele.m_box.Centre(bc);
+	box.Centre(bc);
 	geoff_geometry::Vector3d v(geoff_geometry::Point3d(bc), m_c);
 	v.Normalize();
 	double d = (v.getx() + v.gety() + v.getz()) / 2.2;
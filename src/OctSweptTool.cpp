@@ -0,0 +1,250 @@
+// OctSweptTool.cpp
+
+#include "stdafx.h"
+#include "OctSweptTool.h"
+#include "Octree.h"
+#include "NCCode.h"
+
+COctCutter::COctCutter(double diameter, double corner_radius, double length)
+{
+	m_radius = fabs(diameter) / 2;
+	m_corner_radius = fabs(corner_radius);
+	if (m_corner_radius > m_radius)m_corner_radius = m_radius;
+	m_length = length;
+	if (m_length < 2 * m_corner_radius)m_length = 2 * m_corner_radius;
+}
+
+COctSweptLine::COctSweptLine(const geoff_geometry::Point3d& s, const geoff_geometry::Point3d& e, const COctCutter& cutter)
+{
+	m_s = s;
+	m_e = e;
+	m_core_radius = cutter.m_radius - cutter.m_corner_radius;
+	m_corner_radius = cutter.m_corner_radius;
+	m_core_bottom = cutter.m_corner_radius;
+	m_core_top = cutter.m_length - cutter.m_corner_radius;
+
+	m_box.Insert(s.x - cutter.m_radius, s.y - cutter.m_radius, s.z);
+	m_box.Insert(s.x + cutter.m_radius, s.y + cutter.m_radius, s.z + cutter.m_length);
+	m_box.Insert(e.x - cutter.m_radius, e.y - cutter.m_radius, e.z);
+	m_box.Insert(e.x + cutter.m_radius, e.y + cutter.m_radius, e.z + cutter.m_length);
+}
+
+double COctSweptLine::CoreDistance(const geoff_geometry::Point3d& p, double t)const
+{
+	// distance from p to the cylinder, with the tool tip at the given fraction along the line
+	double dx = p.x - (m_s.x + (m_e.x - m_s.x) * t);
+	double dy = p.y - (m_s.y + (m_e.y - m_s.y) * t);
+	double h = p.z - (m_s.z + (m_e.z - m_s.z) * t);
+
+	double dh = sqrt(dx * dx + dy * dy) - m_core_radius;
+	if (dh < 0.0)dh = 0.0;
+	double dv = 0.0;
+	if (h < m_core_bottom)dv = m_core_bottom - h;
+	else if (h > m_core_top)dv = h - m_core_top;
+
+	return sqrt(dh * dh + dv * dv);
+}
+
+double COctSweptLine::NearestT(const geoff_geometry::Point3d& p)const
+{
+	// the fraction along the line where the cylinder is nearest to p
+	double vx = m_e.x - m_s.x;
+	double vy = m_e.y - m_s.y;
+	double vz = m_e.z - m_s.z;
+	double len_xy_sq = vx * vx + vy * vy;
+
+	if (fabs(vz) < 1.0e-09)
+	{
+		// a horizontal move; nearest where the axis is nearest
+		if (len_xy_sq < 1.0e-18)return 0.0;
+		double t = ((p.x - m_s.x) * vx + (p.y - m_s.y) * vy) / len_xy_sq;
+		if (t < 0.0)return 0.0;
+		if (t > 1.0)return 1.0;
+		return t;
+	}
+
+	if (len_xy_sq < 1.0e-18)
+	{
+		// a plunge or a retract; nearest where p is between the heights of the cylinder
+		double h = p.z - m_s.z;
+		double target = h;
+		if (target < m_core_bottom)target = m_core_bottom;
+		else if (target > m_core_top)target = m_core_top;
+		double t = (h - target) / vz;
+		if (t < 0.0)return 0.0;
+		if (t > 1.0)return 1.0;
+		return t;
+	}
+
+	// a ramp; the distance is convex along the line, so do a golden section search
+	const double golden = 0.6180339887498949;
+	double a = 0.0, b = 1.0;
+	double t1 = b - golden * (b - a);
+	double t2 = a + golden * (b - a);
+	double d1 = CoreDistance(p, t1);
+	double d2 = CoreDistance(p, t2);
+	for (int i = 0; i < 40; i++)
+	{
+		if (d1 <= d2)
+		{
+			b = t2;
+			t2 = t1;
+			d2 = d1;
+			t1 = b - golden * (b - a);
+			d1 = CoreDistance(p, t1);
+		}
+		else
+		{
+			a = t1;
+			t1 = t2;
+			d1 = d2;
+			t2 = a + golden * (b - a);
+			d2 = CoreDistance(p, t2);
+		}
+	}
+	return (a + b) / 2;
+}
+
+double COctSweptLine::Distance(const geoff_geometry::Point3d& p)const
+{
+	return CoreDistance(p, NearestT(p)) - m_corner_radius;
+}
+
+int COctSweptLine::Inside(const CBox& box)const
+{
+	if (!m_box.Intersects(box))
+		return 0;
+
+	double c[3];
+	box.Centre(c);
+	if (Distance(geoff_geometry::Point3d(c)) > box.Radius())
+		return 0;
+
+	// the swept solid is convex, so the box is inside it if all the corners are
+	for (int i = 0; i < 8; i++)
+	{
+		double x[3];
+		box.vert(i, x);
+		if (Inside(geoff_geometry::Point3d(x)) == false)
+			return 1;
+	}
+	return 2;
+}
+
+void COctSweptLine::SetElementsColor(const CBox& box, COctEle& ele)const
+{
+	// shade by the direction from the element to the nearest point of the cylinder, like the sphere does
+	double bc[3];
+	box.Centre(bc);
+	geoff_geometry::Point3d c(bc);
+	double t = NearestT(c);
+	geoff_geometry::Point3d tip(m_s.x + (m_e.x - m_s.x) * t, m_s.y + (m_e.y - m_s.y) * t, m_s.z + (m_e.z - m_s.z) * t);
+
+	geoff_geometry::Point3d n = c;
+	double dx = c.x - tip.x;
+	double dy = c.y - tip.y;
+	double dxy = sqrt(dx * dx + dy * dy);
+	if (dxy > m_core_radius)
+	{
+		n.x = tip.x + dx * m_core_radius / dxy;
+		n.y = tip.y + dy * m_core_radius / dxy;
+	}
+	double h = c.z - tip.z;
+	if (h < m_core_bottom)n.z = tip.z + m_core_bottom;
+	else if (h > m_core_top)n.z = tip.z + m_core_top;
+
+	geoff_geometry::Vector3d v(c, n);
+	v.Normalize(); // leaves it zero if the element is in the middle of the cylinder
+	double d = (v.getx() + v.gety() + v.getz()) / 2.2;
+	if (!COctEle::add)d = -d;
+
+	ele.m_color_r = 128 + d * 104;
+	ele.m_color_g = 128 + d * 104;
+	ele.m_color_b = 128 + d * 104;
+
+	if (COctEle::texture)
+	{
+		ele.m_color_r += rand() % 12;
+		ele.m_color_g += rand() % 12;
+		ele.m_color_b += rand() % 12;
+	}
+}
+
+COctSweptArc::COctSweptArc(const PathObject* prev_po, const PathArc* arc, const COctCutter& cutter, double tolerance)
+{
+	// find the angle swept, the same way as PathArc::Interpolate does
+	double sx = -arc->m_c[0];
+	double sy = -arc->m_c[1];
+	double ex = -arc->m_c[0] + arc->m_x[0] - prev_po->m_x[0];
+	double ey = -arc->m_c[1] + arc->m_x[1] - prev_po->m_x[1];
+	double r = sqrt(sx * sx + sy * sy);
+	double re = sqrt(ex * ex + ey * ey);
+	if (re > r)r = re;
+
+	double start_angle = atan2(sy, sx);
+	double end_angle = atan2(ey, ex);
+	if (arc->m_dir == 1){
+		if (end_angle < start_angle)end_angle += 6.283185307179;
+	}
+	else{
+		if (start_angle < end_angle)start_angle += 6.283185307179;
+	}
+	double sweep = fabs(end_angle - start_angle);
+	if (start_angle == end_angle)sweep = 6.283185307179;
+
+	// the biggest step along the arc which keeps the chord within the tolerance
+	double max_step = 1.5707963267949;
+	if (tolerance < r)
+	{
+		double step = 2 * acos(1 - tolerance / r);
+		if (step < max_step)max_step = step;
+	}
+	unsigned int n = (unsigned int)ceil(sweep / max_step);
+	if (n < 1)n = 1;
+
+	std::list<gp_Pnt> points = arc->Interpolate(prev_po, n);
+	gp_Pnt prev = points.front();
+	for (std::list<gp_Pnt>::iterator It = points.begin(); It != points.end(); It++)
+	{
+		if (It == points.begin())continue;
+		const gp_Pnt& p = *It;
+		m_lines.push_back(COctSweptLine(geoff_geometry::Point3d(prev.X(), prev.Y(), prev.Z()), geoff_geometry::Point3d(p.X(), p.Y(), p.Z()), cutter));
+		m_box.Insert(m_lines.back().GetBox());
+		prev = p;
+	}
+}
+
+int COctSweptArc::Inside(const CBox& box)const
+{
+	if (!m_box.Intersects(box))
+		return 0;
+
+	int inside = 0;
+	for (std::vector<COctSweptLine>::const_iterator It = m_lines.begin(); It != m_lines.end(); It++)
+	{
+		int i = It->Inside(box);
+		if (i == 2)return 2;
+		if (i == 1)inside = 1;
+	}
+	return inside;
+}
+
+void COctSweptArc::SetElementsColor(const CBox& box, COctEle& ele)const
+{
+	// colour it from the nearest of the straight moves
+	double bc[3];
+	box.Centre(bc);
+	geoff_geometry::Point3d c(bc);
+	const COctSweptLine* nearest = NULL;
+	double best_d = 0.0;
+	for (std::vector<COctSweptLine>::const_iterator It = m_lines.begin(); It != m_lines.end(); It++)
+	{
+		double d = It->Distance(c);
+		if (nearest == NULL || d < best_d)
+		{
+			nearest = &(*It);
+			best_d = d;
+		}
+	}
+	if (nearest)nearest->SetElementsColor(box, ele);
+}
@@ -0,0 +1,64 @@
+// OctSweptTool.h
+// solids made by moving a milling cutter along the moves of an NC program, for cutting away the stock in an octree
+
+#pragma once
+
+#include "OctSolid.h"
+#include "geometry.h"
+#include "Box.h"
+#include <vector>
+
+class PathObject;
+class PathArc;
+
+// the shape of a cutter, with its tip at the tool position, pointing down the z axis
+// a flat cutter has a corner radius of 0, a ball cutter has a corner radius of half the diameter, a bull-nose cutter is anything between
+class COctCutter
+{
+public:
+	double m_radius;
+	double m_corner_radius;
+	double m_length; // the height of the part of the cutter which can remove material
+
+	COctCutter(double diameter, double corner_radius, double length);
+};
+
+// a cutter moved along a straight line
+// the cutter is a cylinder of radius ( radius - corner radius ) grown by the corner radius, so the swept solid is convex
+class COctSweptLine : public COctSolid
+{
+	geoff_geometry::Point3d m_s, m_e; // the tool tip at the start and end
+	double m_core_radius; // the radius of the cylinder which gets grown by the corner radius
+	double m_corner_radius;
+	double m_core_bottom, m_core_top; // heights of the cylinder above the tool tip
+	CBox m_box;
+
+	double CoreDistance(const geoff_geometry::Point3d& p, double t)const;
+	double NearestT(const geoff_geometry::Point3d& p)const;
+
+public:
+	COctSweptLine(const geoff_geometry::Point3d& s, const geoff_geometry::Point3d& e, const COctCutter& cutter);
+
+	// CSolid's virtual functions
+	int Inside(const CBox& box)const;
+	void SetElementsColor(const CBox& box, COctEle& ele)const;
+
+	double Distance(const geoff_geometry::Point3d& p)const; // from the surface of the swept solid, 0 or less if inside it
+	bool Inside(const geoff_geometry::Point3d& p)const{ return Distance(p) <= 0.0; }
+	const CBox& GetBox()const{ return m_box; }
+};
+
+// a cutter moved along an arc, or a helix if the arc changes height
+// made from straight moves along the chords of the arc, no further from the arc than the given tolerance
+class COctSweptArc : public COctSolid
+{
+	std::vector<COctSweptLine> m_lines;
+	CBox m_box;
+
+public:
+	COctSweptArc(const PathObject* prev_po, const PathArc* arc, const COctCutter& cutter, double tolerance);
+
+	// CSolid's virtual functions
+	int Inside(const CBox& box)const;
+	void SetElementsColor(const CBox& box, COctEle& ele)const;
+};
@@ -13,372 +13,639 @@
 bool extensions_initialized = false;
 OpenGLClass *OpenGL = NULL;
 ColorShaderClass* ColorShader = NULL;
-bool buffer_made = false;
 
-int oct_ele_count = 0;
+COctree::COctree(const CBox& box, int max_level) :m_box(box), m_max_level(max_level), m_triangle_count(0)
+{
+	if (m_max_level < 1)m_max_level = 1;
+	if (m_max_level > MAX_OCTREE_LEVEL)m_max_level = MAX_OCTREE_LEVEL;
+	m_chunk_level = m_max_level - OCTREE_CHUNK_LEVELS;
+	if (m_chunk_level < 0)m_chunk_level = 0;
+	m_eles.push_back(COctEle());
+#ifndef OCTREE_USES_VERTEX_BUFFERS
+	m_display_list = 0;
+#endif
+}
+
+COctree::COctree(const COctree& o)
+{
+#ifndef OCTREE_USES_VERTEX_BUFFERS
+	m_display_list = 0;
+#endif
+	operator=(o);
+}
 
-COctree::COctree(const CBox& box) :COctEle(box, 0)
+COctree::~COctree()
 {
-	m_inside = false;
+	for (std::map<OctCode, COctChunk>::iterator It = m_chunks.begin(); It != m_chunks.end(); It++)
+	{
+		if (It->second.m_buffer_id != 0)m_dead_buffers.push_back(It->second.m_buffer_id);
+	}
 #ifdef OCTREE_USES_VERTEX_BUFFERS
+	if (OpenGL != NULL && m_dead_buffers.size() > 0)OpenGL->glDeleteBuffers(m_dead_buffers.size(), &m_dead_buffers[0]);
 #else
-	m_display_list = 0;
+	if (m_display_list)glDeleteLists(m_display_list, 1);
 #endif
 }
 
-void COctEle::Split()
+const COctree& COctree::operator=(const COctree& o)
 {
-	if ((m_level < MAX_OCTTREE_LEVEL) && (m_children[0] == NULL))
+	// the buffers of this are deleted next time it is rendered, the copied chunks make their own
+	for (std::map<OctCode, COctChunk>::iterator It = m_chunks.begin(); It != m_chunks.end(); It++)
 	{
-		double mid[3];
-		for (int i = 0; i < 3; i++)
+		if (It->second.m_buffer_id != 0)m_dead_buffers.push_back(It->second.m_buffer_id);
+	}
+
+	m_box = o.m_box;
+	m_max_level = o.m_max_level;
+	m_eles = o.m_eles;
+	m_free_blocks = o.m_free_blocks;
+	m_chunk_level = o.m_chunk_level;
+	m_chunks = o.m_chunks;
+	m_dirty_chunks = o.m_dirty_chunks;
+	m_triangle_count = o.m_triangle_count;
+#ifndef OCTREE_USES_VERTEX_BUFFERS
+	if (m_display_list)
+	{
+		glDeleteLists(m_display_list, 1);
+		m_display_list = 0;
+	}
+#endif
+
+	return *this;
+}
+
+static void DecodeMorton(int level, OctCode code, unsigned int* ijk)
+{
+	ijk[0] = ijk[1] = ijk[2] = 0;
+	for (int i = 0; i < level; i++)
+	{
+		ijk[0] |= (unsigned int)((code >> (i * 3 + 2)) & 1) << i;
+		ijk[1] |= (unsigned int)((code >> (i * 3 + 1)) & 1) << i;
+		ijk[2] |= (unsigned int)((code >> (i * 3)) & 1) << i;
+	}
+}
+
+void COctree::GetBox(int level, OctCode code, CBox &box)const
+{
+	// the faces are calculated from whole numbers of cells, so brothers and cousins share exactly the same faces
+	unsigned int ijk[3];
+	DecodeMorton(level, code, ijk);
+	double cells = (double)(1 << level);
+	box.m_valid = true;
+	for (int i = 0; i < 3; i++)
+	{
+		double length = m_box.m_x[i + 3] - m_box.m_x[i];
+		box.m_x[i] = m_box.m_x[i] + length * ijk[i] / cells;
+		box.m_x[i + 3] = m_box.m_x[i] + length * (ijk[i] + 1) / cells;
+	}
+}
+
+void COctree::GetChildBoxes(int level, OctCode code, COctChildBoxes &boxes)const
+{
+	unsigned int ijk[3];
+	DecodeMorton(level, code, ijk);
+	double cells = (double)(1 << (level + 1));
+	for (int i = 0; i < 3; i++)
+	{
+		double length = m_box.m_x[i + 3] - m_box.m_x[i];
+		double x[3];
+		for (int j = 0; j < 3; j++)x[j] = m_box.m_x[i] + length * (ijk[i] * 2 + j) / cells;
+		int bit = 2 - i;
+		for (int child = 0; child < 8; child++)
 		{
-			mid[i] = (m_box.m_x[i] + m_box.m_x[i + 3]) * 0.5;
+			int b = (child >> bit) & 1;
+			boxes.m_min[i][child] = x[b];
+			boxes.m_max[i][child] = x[b + 1];
 		}
+	}
+}
+
+void COctChildBoxes::GetBox(int child, CBox &box)const
+{
+	box.m_valid = true;
+	for (int i = 0; i < 3; i++)
+	{
+		box.m_x[i] = m_min[i][child];
+		box.m_x[i + 3] = m_max[i][child];
+	}
+}
+
+void COctSolid::Inside(const COctChildBoxes& boxes, int* inside)const
+{
+	for (int i = 0; i < 8; i++)
+	{
+		CBox box;
+		boxes.GetBox(i, box);
+		inside[i] = Inside(box);
+	}
+}
+
+unsigned int COctree::AllocateBlock()
+{
+	if (m_free_blocks.size() > 0)
+	{
+		unsigned int block = m_free_blocks.back();
+		m_free_blocks.pop_back();
+		return block;
+	}
+	unsigned int block = m_eles.size();
+	m_eles.resize(m_eles.size() + 8);
+	return block;
+}
 
-		m_children[0] = new COctEle(CBox(m_box.m_x[0], m_box.m_x[1], m_box.m_x[2], mid[0], mid[1], mid[2]), m_level + 1);
-		m_children[1] = new COctEle(CBox(m_box.m_x[0], m_box.m_x[1], mid[2], mid[0], mid[1], m_box.m_x[5]), m_level + 1);
-		m_children[2] = new COctEle(CBox(m_box.m_x[0], mid[1], m_box.m_x[2], mid[0], m_box.m_x[4], mid[2]), m_level + 1);
-		m_children[3] = new COctEle(CBox(m_box.m_x[0], mid[1], mid[2], mid[0], m_box.m_x[4], m_box.m_x[5]), m_level + 1);
-		m_children[4] = new COctEle(CBox(mid[0], m_box.m_x[1], m_box.m_x[2], m_box.m_x[3], mid[1], mid[2]), m_level + 1);
-		m_children[5] = new COctEle(CBox(mid[0], m_box.m_x[1], mid[2], m_box.m_x[3], mid[1], m_box.m_x[5]), m_level + 1);
-		m_children[6] = new COctEle(CBox(mid[0], mid[1], m_box.m_x[2], m_box.m_x[3], m_box.m_x[4], mid[2]), m_level + 1);
-		m_children[7] = new COctEle(CBox(mid[0], mid[1], mid[2], m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]), m_level + 1);
+void COctree::Split(unsigned int ele)
+{
+	if (m_eles[ele].m_children == 0)
+	{
+		// careful, this can move the elements
+		unsigned int block = AllocateBlock();
+		COctEle &e = m_eles[ele];
+		e.m_children = block;
 
 		for (int i = 0; i < 8; i++)
 		{
-			m_children[i]->m_inside = m_inside;
-			m_children[i]->m_color_r = rand() % 128;
-			m_children[i]->m_color_g = rand() % 128;
-			m_children[i]->m_color_b = rand() % 128;
+			COctEle &child = m_eles[block + i];
+			child.m_children = 0;
+			child.m_inside = e.m_inside;
+			child.m_color_r = e.m_color_r; // the surface looks the same until the children are changed
+			child.m_color_g = e.m_color_g;
+			child.m_color_b = e.m_color_b;
 		}
 	}
 }
 
-void COctEle::DeleteChildren()
+void COctree::DeleteChildren(unsigned int ele)
 {
-	if (m_children[0] != NULL)
+	unsigned int block = m_eles[ele].m_children;
+	if (block != 0)
 	{
 		for (int i = 0; i < 8; i++)
 		{
-			delete m_children[i];
+			DeleteChildren(block + i);
 		}
-		m_children[0] = NULL;
+		m_free_blocks.push_back(block);
+		m_eles[ele].m_children = 0;
 	}
 }
 
-void COctEle::AddRemoveSolid(const COctSolid& s)
+void COctree::AddRemoveSolid(unsigned int ele, int level, OctCode code, int inside, const COctSolid& s)
 {
-	if ((m_children[0] == NULL) && (m_inside == add))
+	if ((m_eles[ele].m_children == 0) && (m_eles[ele].m_inside == COctEle::add))
 	{
 		// if already in or out
 		return;
 	}
 
-	int inside = s.Inside(m_box);
-
 	if (inside == 2)
 	{
-		DeleteChildren();
-		m_inside = add;
-		m_color_r = rand() % 128;
-		m_color_g = rand() % 128;
-		m_color_b = rand() % 128;
+		DeleteChildren(ele);
+		COctEle &e = m_eles[ele];
+		e.m_inside = COctEle::add;
+		if (COctEle::texture)
+		{
+			e.m_color_r = rand() % 128;
+			e.m_color_g = rand() % 128;
+			e.m_color_b = rand() % 128;
+		}
+		else
+		{
+			// one colour, so the faces of neighbouring elements merge
+			e.m_color_r = 128;
+			e.m_color_g = 128;
+			e.m_color_b = 128;
+		}
+		ElementChanged(level, code);
 	}
 	else if (inside == 1)
 	{
-		if (m_level < MAX_OCTTREE_LEVEL)
+		if (level < m_max_level)
 		{
-			Split();
+			Split(ele);
+
+			// classify all the children at once
+			COctChildBoxes boxes;
+			GetChildBoxes(level, code, boxes);
+			int child_inside[8];
+			s.Inside(boxes, child_inside);
+
+			unsigned int block = m_eles[ele].m_children;
 			for (int i = 0; i < 8; i++)
 			{
-				m_children[i]->AddRemoveSolid(s);
+				AddRemoveSolid(block + i, level + 1, (code << 3) | i, child_inside[i], s);
 			}
 		}
 		else
 		{
-			m_inside = add || m_inside;
-			s.SetElementsColor(*this);
+			COctEle &e = m_eles[ele];
+			e.m_inside = COctEle::add || e.m_inside;
+			CBox box;
+			GetBox(level, code, box);
+			s.SetElementsColor(box, e);
+			ElementChanged(level, code);
 		}
 	}
 }
 
-static int triangle_count = 0;
-
-#ifdef OCTREE_USES_VERTEX_BUFFERS
-#define VERTEX_LIST_SIZE 27000000
-#define BUFFER_SIZE 2700000
-COctEle::VertexType* vertex_list = NULL;
-int vertex_count = 0;
-#endif
-
-void COctEle::Render(bool no_color)
+static OctCode EncodeMorton(int level, const unsigned int* ijk)
 {
-	if (m_children[0] != NULL)
+	OctCode code = 0;
+	for (int i = 0; i < level; i++)
 	{
-		for (int i = 0; i < 8; i++)
-			m_children[i]->Render(no_color);
-	}
-	else
-	{
-		if (m_inside && m_level == MAX_OCTTREE_LEVEL)
-		{
-			// render a cube
-#ifdef OCTREE_USES_VERTEX_BUFFERS
-			if (vertex_count > 7000000)return;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[1], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[1], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[1], m_box.m_x[5]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[1], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[1], m_box.m_x[5]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[1], m_box.m_x[5]); vertex_count++;
-
-			// right
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[1], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[4], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]); vertex_count++;
-
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[1], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[1], m_box.m_x[5]); vertex_count++;
-
-			// left
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[4], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[1], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[1], m_box.m_x[5]); vertex_count++;
-
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[4], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[4], m_box.m_x[5]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[1], m_box.m_x[5]); vertex_count++;
-
-			// back
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[4], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[4], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[4], m_box.m_x[5]); vertex_count++;
-
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[4], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[4], m_box.m_x[5]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]); vertex_count++;
-
-			// top
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[1], m_box.m_x[5]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[1], m_box.m_x[5]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]); vertex_count++;
-
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[1], m_box.m_x[5]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[4], m_box.m_x[5]); vertex_count++;
-
-			// bottom
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[4], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[4], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[1], m_box.m_x[2]); vertex_count++;
-
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[4], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[3], m_box.m_x[1], m_box.m_x[2]); vertex_count++;
-			vertex_list[vertex_count] = VertexType(m_box.m_x[0], m_box.m_x[1], m_box.m_x[2]); vertex_count++;
-#else
-			if (!no_color)glColor3ub(this->m_color_r, m_color_g, m_color_b);
-			glBegin(GL_TRIANGLES);
-			// front
-			glVertex3d(m_box.m_x[0], m_box.m_x[1], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[1], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[1], m_box.m_x[5]);
-
-			glVertex3d(m_box.m_x[0], m_box.m_x[1], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[1], m_box.m_x[5]);
-			glVertex3d(m_box.m_x[0], m_box.m_x[1], m_box.m_x[5]);
-
-			// right
-			glVertex3d(m_box.m_x[3], m_box.m_x[1], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[4], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]);
-
-			glVertex3d(m_box.m_x[3], m_box.m_x[1], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[1], m_box.m_x[5]);
-
-			// left
-			glVertex3d(m_box.m_x[0], m_box.m_x[4], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[0], m_box.m_x[1], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[0], m_box.m_x[1], m_box.m_x[5]);
-
-			glVertex3d(m_box.m_x[0], m_box.m_x[4], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[0], m_box.m_x[4], m_box.m_x[5]);
-			glVertex3d(m_box.m_x[0], m_box.m_x[1], m_box.m_x[5]);
-
-			// back
-			glVertex3d(m_box.m_x[3], m_box.m_x[4], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[0], m_box.m_x[4], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[0], m_box.m_x[4], m_box.m_x[5]);
-
-			glVertex3d(m_box.m_x[3], m_box.m_x[4], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[0], m_box.m_x[4], m_box.m_x[5]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]);
-
-			// top
-			glVertex3d(m_box.m_x[0], m_box.m_x[1], m_box.m_x[5]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[1], m_box.m_x[5]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]);
-
-			glVertex3d(m_box.m_x[0], m_box.m_x[1], m_box.m_x[5]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[4], m_box.m_x[5]);
-			glVertex3d(m_box.m_x[0], m_box.m_x[4], m_box.m_x[5]);
-
-			// bottom
-			glVertex3d(m_box.m_x[0], m_box.m_x[4], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[4], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[1], m_box.m_x[2]);
-
-			glVertex3d(m_box.m_x[0], m_box.m_x[4], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[3], m_box.m_x[1], m_box.m_x[2]);
-			glVertex3d(m_box.m_x[0], m_box.m_x[1], m_box.m_x[2]);
-
-			glEnd();
-#endif
-			triangle_count += 12;
-		}
+		code |= (OctCode)((ijk[0] >> i) & 1) << (i * 3 + 2);
+		code |= (OctCode)((ijk[1] >> i) & 1) << (i * 3 + 1);
+		code |= (OctCode)((ijk[2] >> i) & 1) << (i * 3);
 	}
+	return code;
+}
 
+static unsigned int ColorKey(const COctEle& e)
+{
+	// never 0, which means no face
+	return 0x1000000 | ((unsigned int)e.m_color_r << 16) | ((unsigned int)e.m_color_g << 8) | e.m_color_b;
 }
 
-//static 
-//int COctEle::m_child_order[8][8] = {
-//	{ 6, 2, 5, 7, 1, 3, 4, 0 },
-//	{ 2, 1, 3, 6, 0, 5, 7, 4 },
-//	{ 5, 1, 4, 6, 0, 2, 7, 3 },
-//	{ 1, 0, 2, 5, 3, 4, 6, 7 },
-//	{ 7, 3, 4, 6, 0, 2, 5, 1 },
-//	{ 3, 0, 2, 7, 1, 4, 6, 5 },
-//	{ 4, 0, 5, 7, 1, 3, 6, 2 },
-//	{ 0, 1, 3, 4, 2, 5, 7, 6 },
-//};
+void COctree::ElementChanged(int level, OctCode code)
+{
+	unsigned int ijk[3];
+	DecodeMorton(level, code, ijk);
+	int chunk_cells = m_max_level - m_chunk_level;
+	int lo[3], hi[3];
 
-//int m_type;//  0 +x+y+z  1 +x+y-z  2 +x-y+z  3 +x-y-z  4 -x+y+z  5 -x+y-z  6 -x-y+z  7 -x-y-z
+	if (level >= m_chunk_level)
+	{
+		// its chunk, and the chunks next to it if it is at the side of its chunk
+		int shift = m_max_level - level;
+		unsigned int mask = (1 << chunk_cells) - 1;
+		int c[3];
+		bool at_lo[3], at_hi[3];
+		for (int i = 0; i < 3; i++)
+		{
+			unsigned int first = ijk[i] << shift;
+			unsigned int last = ((ijk[i] + 1) << shift) - 1;
+			c[i] = first >> chunk_cells;
+			at_lo[i] = (first & mask) == 0;
+			at_hi[i] = (last & mask) == mask;
+		}
+		MarkChunks(c, c);
+		for (int i = 0; i < 3; i++)
+		{
+			int n[3] = { c[0], c[1], c[2] };
+			n[i] = c[i] - 1;
+			if (at_lo[i])MarkChunks(n, n);
+			n[i] = c[i] + 1;
+			if (at_hi[i])MarkChunks(n, n);
+		}
+		return;
+	}
 
-int COctEle::m_child_order[8][8] = {
-	{0, 2, 1, 4, 6, 5, 3, 7},
-	{1, 3, 5, 0, 2, 4, 7, 6},
-	{2, 6, 0, 3, 1, 7, 4, 5},
-	{3, 2, 7, 1, 5, 6, 0, 4},
-	{4, 0, 6, 5, 1, 7, 2, 3},
-	{5, 1, 7, 4, 3, 6, 0, 2},
-	{6, 2, 4, 7, 3, 5, 0, 1},
-	{7, 3, 5, 6, 1, 2, 4, 0},
-};
+	// a whole block of chunks is now all in or all out, so only the chunks at its sides can have any surface
+	int d = m_chunk_level - level;
+	std::map<OctCode, COctChunk>::iterator It = m_chunks.lower_bound(code << (3 * d));
+	std::map<OctCode, COctChunk>::iterator EndIt = m_chunks.lower_bound((code + 1) << (3 * d));
+	while (It != EndIt)
+	{
+		std::map<OctCode, COctChunk>::iterator ThisIt = It;
+		It++;
+		RemoveChunk(ThisIt);
+	}
 
-COctEle::COctEle(const CBox& box, int level) : m_box(box), m_level(level), m_inside(false), m_color_r(0), m_color_g(0), m_color_b(0)
-{
-	oct_ele_count++;
-	m_children[0] = NULL; // mark the first child as NULL to show there are no children yet
+	for (int i = 0; i < 3; i++)
+	{
+		lo[i] = ijk[i] << d;
+		hi[i] = ((ijk[i] + 1) << d) - 1;
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		int box_lo[3] = { lo[0], lo[1], lo[2] };
+		int box_hi[3] = { hi[0], hi[1], hi[2] };
+		box_lo[i] = lo[i] - 1;
+		box_hi[i] = lo[i];
+		MarkChunks(box_lo, box_hi);
+		box_lo[i] = hi[i];
+		box_hi[i] = hi[i] + 1;
+		MarkChunks(box_lo, box_hi);
+	}
 }
 
-COctEle::~COctEle()
+void COctree::MarkChunks(const int* lo, const int* hi)
 {
-	if (m_children[0])
+	// mark all the chunks from lo to hi, in chunk units, which are inside the octree
+	int chunks = 1 << m_chunk_level;
+	int l[3], h[3];
+	for (int i = 0; i < 3; i++)
 	{
-		for (int i = 0; i < 8; i++)
-			delete m_children[i];
+		l[i] = (lo[i] < 0) ? 0 : lo[i];
+		h[i] = (hi[i] >= chunks) ? (chunks - 1) : hi[i];
+		if (l[i] > h[i])return;
 	}
-}
 
-bool COctEle::texture = true;
-bool COctEle::add = true;
+	unsigned int ijk[3];
+	for (int i = l[0]; i <= h[0]; i++)
+	{
+		ijk[0] = i;
+		for (int j = l[1]; j <= h[1]; j++)
+		{
+			ijk[1] = j;
+			for (int k = l[2]; k <= h[2]; k++)
+			{
+				ijk[2] = k;
+				m_dirty_chunks.insert(EncodeMorton(m_chunk_level, ijk));
+			}
+		}
+	}
+}
 
-void COctree::AddRemoveSolid(bool add_remove, const COctSolid& s)
+void COctree::RemoveChunk(std::map<OctCode, COctChunk>::iterator It)
 {
-	COctEle::add = add_remove;
-	COctEle::AddRemoveSolid(s);
+	if (It->second.m_buffer_id != 0)m_dead_buffers.push_back(It->second.m_buffer_id);
+	m_chunks.erase(It);
 }
 
-#ifdef OCTREE_USES_VERTEX_BUFFERS
+void COctree::AddFace(int level, const unsigned int* ijk, int dir, unsigned int color, FaceGrids &grids, const unsigned int* origin)const
+{
+	// fill the squares of the face of the element at ijk, in the given direction
+	int axis = dir / 2;
+	bool positive = (dir % 2) == 1;
+	int u = (axis + 1) % 3;
+	int v = (axis + 2) % 3;
+	int shift = m_max_level - level;
+	unsigned int n = 1 << (m_max_level - m_chunk_level);
+
+	unsigned int plane = (positive ? (ijk[axis] + 1) : ijk[axis]) << shift;
+	std::vector<unsigned int> &grid = grids[std::make_pair(dir, plane)];
+	if (grid.size() == 0)grid.resize(n * n, 0);
+
+	unsigned int u0 = (ijk[u] << shift) - origin[u];
+	unsigned int u1 = ((ijk[u] + 1) << shift) - origin[u];
+	unsigned int v0 = (ijk[v] << shift) - origin[v];
+	unsigned int v1 = ((ijk[v] + 1) << shift) - origin[v];
+	for (unsigned int j = v0; j < v1; j++)
+	{
+		for (unsigned int i = u0; i < u1; i++)
+			grid[j * n + i] = color;
+	}
+}
 
-bool COctree::MakeBuffer()
+void COctree::AddFaces(int level, OctCode code, int dir, const COctEle& e, FaceGrids &grids, const unsigned int* origin)const
 {
-#if 1
-	return false;
-#else
-	vertex_list = new VertexType[VERTEX_LIST_SIZE];
-	if (!vertex_list)
+	// add the parts of the face of an inside element which are next to outside
+	int axis = dir / 2;
+	bool positive = (dir % 2) == 1;
+	unsigned int ijk[3];
+	DecodeMorton(level, code, ijk);
+	unsigned int color = ColorKey(e);
+
+	unsigned int cells = 1 << level;
+	if ((positive && ijk[axis] == cells - 1) || (!positive && ijk[axis] == 0))
 	{
-		return false;
+		// at the side of the octree
+		AddFace(level, ijk, dir, color, grids, origin);
+		return;
 	}
 
-	triangle_count = 0;
-	vertex_count = 0;
-	COctEle::Render(false);
+	unsigned int nijk[3] = { ijk[0], ijk[1], ijk[2] };
+	if (positive)nijk[axis]++;
+	else nijk[axis]--;
+	OctCode ncode = EncodeMorton(level, nijk);
 
-	m_triangle_count = triangle_count;
-	
-		unsigned int* indices;
+	// find the neighbour, or the bigger element it is in
+	unsigned int ne = 0;
+	for (int l = 0; l < level && m_eles[ne].m_children != 0; l++)
+	{
+		ne = m_eles[ne].m_children + (unsigned int)((ncode >> (3 * (level - l - 1))) & 7);
+	}
 
+	if (m_eles[ne].m_children == 0)
+	{
+		if (!m_eles[ne].m_inside)AddFace(level, ijk, dir, color, grids, origin);
+		return;
+	}
 
-		// Set the number of vertices in the vertex array.
+	AddExposedFaces(ne, level, ncode, dir, color, grids, origin);
+}
 
-		// Set the number of indices in the index array.
-		m_indexCount = vertex_count;
+void COctree::AddExposedFaces(unsigned int ne, int level, OctCode ncode, int dir, unsigned int color, FaceGrids &grids, const unsigned int* origin)const
+{
+	// the neighbour is split, so only the parts of the face next to its outside children are exposed
+	int axis = dir / 2;
+	bool positive = (dir % 2) == 1;
+	int bit = 2 - axis;
+	unsigned int side = positive ? 0 : 1; // the children touching the face
 
-		// Create the index array.
-		indices = new unsigned int[m_indexCount];
-		if (!indices)
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		if (((i >> bit) & 1) != side)continue;
+		unsigned int child = m_eles[ne].m_children + i;
+		OctCode child_code = (ncode << 3) | i;
+		if (m_eles[child].m_children != 0)
 		{
-			return false;
+			AddExposedFaces(child, level + 1, child_code, dir, color, grids, origin);
 		}
-
-		// Load the vertex array with data.
-
-		
-		for (int i = 0; i < vertex_count; i++)
+		else if (!m_eles[child].m_inside)
 		{
-			indices[i] = i;
+			// the part of the face is the face of the same sized element on this side
+			unsigned int ijk[3];
+			DecodeMorton(level + 1, child_code, ijk);
+			if (positive)ijk[axis]--;
+			else ijk[axis]++;
+			AddFace(level + 1, ijk, dir, color, grids, origin);
 		}
+	}
+}
+
+void COctree::AddChunkFaces(unsigned int ele, int level, OctCode code, FaceGrids &grids, const unsigned int* origin)const
+{
+	const COctEle &e = m_eles[ele];
+	if (e.m_children != 0)
+	{
+		for (int i = 0; i < 8; i++)
+			AddChunkFaces(e.m_children + i, level + 1, (code << 3) | i, grids, origin);
+	}
+	else if (e.m_inside)
+	{
+		for (int dir = 0; dir < 6; dir++)
+			AddFaces(level, code, dir, e, grids, origin);
+	}
+}
 
-		// Allocate an OpenGL vertex array object.
-		OpenGL->glGenVertexArrays(1, &m_vertexArrayId);
+void COctree::MeshChunk(OctCode chunk_code)
+{
+	std::map<OctCode, COctChunk>::iterator FindIt = m_chunks.find(chunk_code);
+	if (FindIt != m_chunks.end())RemoveChunk(FindIt);
 
-		// Bind the vertex array object to store all the buffers and vertex attributes we create here.
-		OpenGL->glBindVertexArray(m_vertexArrayId);
+	int chunk_cells = m_max_level - m_chunk_level;
+	unsigned int n = 1 << chunk_cells;
+	unsigned int origin[3];
+	DecodeMorton(m_chunk_level, chunk_code, origin);
+	for (int i = 0; i < 3; i++)origin[i] <<= chunk_cells;
 
-		// Generate an ID for the vertex buffer.
-		OpenGL->glGenBuffers(10, m_vertexBufferId);
+	FaceGrids grids;
 
-		COctEle::VertexType* pvertex_list = vertex_list;
-		unsigned int* pindices = indices;
+	// find the element which is the chunk, or the bigger element it is in
+	unsigned int ele = 0;
+	int level = 0;
+	while (level < m_chunk_level && m_eles[ele].m_children != 0)
+	{
+		ele = m_eles[ele].m_children + (unsigned int)((chunk_code >> (3 * (m_chunk_level - level - 1))) & 7);
+		level++;
+	}
 
-		for (int i = 0; i < 10; i++)
+	if (level < m_chunk_level)
+	{
+		// all in or all out; treat it as one element the size of the chunk
+		if (m_eles[ele].m_inside)
 		{
-			// Bind the vertex buffer and load the vertex (position and color) data into the vertex buffer.
-			OpenGL->glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferId);
-			OpenGL->glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(VertexType), vertex_list, GL_STATIC_DRAW);
+			for (int dir = 0; dir < 6; dir++)
+				AddFaces(m_chunk_level, chunk_code, dir, m_eles[ele], grids, origin);
+		}
+	}
+	else
+	{
+		AddChunkFaces(ele, level, chunk_code, grids, origin);
+	}
 
-			// Enable the two vertex array attributes.
-			OpenGL->glEnableVertexAttribArray(0);  // Vertex position.
-			OpenGL->glEnableVertexAttribArray(1);  // Vertex color.
+	if (grids.size() == 0)
+		return;
 
-			// Specify the location and format of the position portion of the vertex buffer.
-			OpenGL->glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferId);
-			OpenGL->glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(VertexType), 0);
+	COctChunk &chunk = m_chunks[chunk_code];
+	double cells = (double)(1 << m_max_level);
+	double scale[3];
+	for (int i = 0; i < 3; i++)scale[i] = (m_box.m_x[i + 3] - m_box.m_x[i]) / cells;
 
-			// Specify the location and format of the color portion of the vertex buffer.
-			OpenGL->glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferId);
-			OpenGL->glVertexAttribPointer(1, 3, GL_FLOAT, false, sizeof(VertexType), (unsigned char*)NULL + (3 * sizeof(float)));
+	// merge the squares of each plane into rectangles of the same colour
+	for (FaceGrids::iterator It = grids.begin(); It != grids.end(); It++)
+	{
+		int dir = It->first.first;
+		unsigned int plane = It->first.second;
+		std::vector<unsigned int> &grid = It->second;
+		int axis = dir / 2;
+		bool positive = (dir % 2) == 1;
+		int u = (axis + 1) % 3;
+		int v = (axis + 2) % 3;
+
+		for (unsigned int j = 0; j < n; j++)
+		{
+			for (unsigned int i = 0; i < n;)
+			{
+				unsigned int color = grid[j * n + i];
+				if (color == 0)
+				{
+					i++;
+					continue;
+				}
+
+				unsigned int w = 1;
+				while (i + w < n && grid[j * n + i + w] == color)w++;
+				unsigned int h = 1;
+				for (; j + h < n; h++)
+				{
+					bool same = true;
+					for (unsigned int k = i; k < i + w; k++)
+					{
+						if (grid[(j + h) * n + k] != color)
+						{
+							same = false;
+							break;
+						}
+					}
+					if (!same)break;
+				}
+				for (unsigned int jj = j; jj < j + h; jj++)
+				{
+					for (unsigned int k = i; k < i + w; k++)
+						grid[jj * n + k] = 0;
+				}
+
+				// two triangles, anti-clockwise from outside
+				double p[4][3];
+				unsigned int corner_u[4] = { i, i + w, i + w, i };
+				unsigned int corner_v[4] = { j, j, j + h, j + h };
+				for (int c = 0; c < 4; c++)
+				{
+					p[c][axis] = m_box.m_x[axis] + scale[axis] * plane;
+					p[c][u] = m_box.m_x[u] + scale[u] * (origin[u] + corner_u[c]);
+					p[c][v] = m_box.m_x[v] + scale[v] * (origin[v] + corner_v[c]);
+				}
+				int order[6] = { 0, 1, 2, 0, 2, 3 };
+				if (!positive)
+				{
+					order[1] = 2; order[2] = 1;
+					order[4] = 3; order[5] = 2;
+				}
+				float r = ((color >> 16) & 0xff) / 255.0f;
+				float g = ((color >> 8) & 0xff) / 255.0f;
+				float b = (color & 0xff) / 255.0f;
+				for (int c = 0; c < 6; c++)
+				{
+					VertexType vt((float)p[order[c]][0], (float)p[order[c]][1], (float)p[order[c]][2]);
+					vt.r = r;
+					vt.g = g;
+					vt.b = b;
+					chunk.m_vertices.push_back(vt);
+				}
+
+				i += w;
+			}
+		}
+	}
+}
 
-			// Generate an ID for the index buffer.
-			OpenGL->glGenBuffers(1, &m_indexBufferId);
+void COctree::UpdateMesh()
+{
+	if (m_dirty_chunks.size() == 0)
+		return;
 
-			// Bind the index buffer and load the index data into it.
-			OpenGL->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferId);
-			OpenGL->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexCount* sizeof(unsigned int), indices, GL_STATIC_DRAW);
-		}
+	for (std::set<OctCode>::iterator It = m_dirty_chunks.begin(); It != m_dirty_chunks.end(); It++)
+		MeshChunk(*It);
+	m_dirty_chunks.clear();
 
-		// Now that the buffers have been loaded we can release the array data.
-		delete[] indices;
-		indices = 0;
+	unsigned int vertex_count = 0;
+	for (std::map<OctCode, COctChunk>::iterator It = m_chunks.begin(); It != m_chunks.end(); It++)
+		vertex_count += It->second.m_vertices.size();
+	m_triangle_count = vertex_count / 3;
 
-		return true;
-#endif
+#ifndef OCTREE_USES_VERTEX_BUFFERS
+	if (m_display_list)
+	{
+		glDeleteLists(m_display_list, 1);
+		m_display_list = 0;
 	}
 #endif
+}
+
+//static 
+//int COctEle::m_child_order[8][8] = {
+//	{ 6, 2, 5, 7, 1, 3, 4, 0 },
+//	{ 2, 1, 3, 6, 0, 5, 7, 4 },
+//	{ 5, 1, 4, 6, 0, 2, 7, 3 },
+//	{ 1, 0, 2, 5, 3, 4, 6, 7 },
+//	{ 7, 3, 4, 6, 0, 2, 5, 1 },
+//	{ 3, 0, 2, 7, 1, 4, 6, 5 },
+//	{ 4, 0, 5, 7, 1, 3, 6, 2 },
+//	{ 0, 1, 3, 4, 2, 5, 7, 6 },
+//};
+
+//int m_type;//  0 +x+y+z  1 +x+y-z  2 +x-y+z  3 +x-y-z  4 -x+y+z  5 -x+y-z  6 -x-y+z  7 -x-y-z
+
+int COctEle::m_child_order[8][8] = {
+	{0, 2, 1, 4, 6, 5, 3, 7},
+	{1, 3, 5, 0, 2, 4, 7, 6},
+	{2, 6, 0, 3, 1, 7, 4, 5},
+	{3, 2, 7, 1, 5, 6, 0, 4},
+	{4, 0, 6, 5, 1, 7, 2, 3},
+	{5, 1, 7, 4, 3, 6, 0, 2},
+	{6, 2, 4, 7, 3, 5, 0, 1},
+	{7, 3, 5, 6, 1, 2, 4, 0},
+};
+
+bool COctEle::texture = false; // the random colours stop the squares merging into rectangles, so there are many more triangles
+bool COctEle::add = true;
+
+void COctree::AddRemoveSolid(bool add_remove, const COctSolid& s)
+{
+	COctEle::add = add_remove;
+	AddRemoveSolid(0, 0, 0, s.Inside(m_box), s);
+}
 
 void COctree::Render(bool no_color)
 {
@@ -408,30 +675,42 @@ void COctree::Render(bool no_color)
 
 	}
 
-	if (!buffer_made)
+	if (m_dead_buffers.size() > 0)
 	{
-		buffer_made = true;
-		bool result = MakeBuffer();
+		OpenGL->glDeleteBuffers(m_dead_buffers.size(), &m_dead_buffers[0]);
+		m_dead_buffers.clear();
 	}
-	//float worldMatrix[16];
-	//float viewMatrix[16];
-	//float projectionMatrix[16];
+#endif
 
-	//OpenGL->GetWorldMatrix(worldMatrix);
-	//OpenGL->GetWorldMatrix(viewMatrix);
-	//OpenGL->GetProjectionMatrix(projectionMatrix);
+	UpdateMesh();
 
-	// Set the color shader as the current shader program and set the matrices that it will use for rendering.
-	//ColorShader->SetShader(OpenGL);
-	//ColorShader->SetShaderParameters(OpenGL, worldMatrix, viewMatrix, projectionMatrix);
+#ifdef OCTREE_USES_VERTEX_BUFFERS
+	// draw each chunk from its own buffer, only uploading the chunks which were meshed again
+	glEnableClientState(GL_VERTEX_ARRAY);
+	if (!no_color)glEnableClientState(GL_COLOR_ARRAY);
 
-	// Render the model using the color shader.
+	for (std::map<OctCode, COctChunk>::iterator It = m_chunks.begin(); It != m_chunks.end(); It++)
+	{
+		COctChunk &chunk = It->second;
+		if (chunk.m_buffer_id == 0)
+		{
+			OpenGL->glGenBuffers(1, &chunk.m_buffer_id);
+			OpenGL->glBindBuffer(GL_ARRAY_BUFFER, chunk.m_buffer_id);
+			OpenGL->glBufferData(GL_ARRAY_BUFFER, chunk.m_vertices.size() * sizeof(VertexType), &chunk.m_vertices[0], GL_STATIC_DRAW);
+		}
+		else
+		{
+			OpenGL->glBindBuffer(GL_ARRAY_BUFFER, chunk.m_buffer_id);
+		}
 
-	// Bind the vertex array object that stored all the information about the vertex and index buffers.
-	OpenGL->glBindVertexArray(m_vertexArrayId);
+		glVertexPointer(3, GL_FLOAT, sizeof(VertexType), 0);
+		if (!no_color)glColorPointer(3, GL_FLOAT, sizeof(VertexType), (unsigned char*)NULL + (3 * sizeof(float)));
+		glDrawArrays(GL_TRIANGLES, 0, chunk.m_vertices.size());
+	}
 
-	// Render the vertex buffer using the index buffer.
-	glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0);
+	OpenGL->glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if (!no_color)glDisableClientState(GL_COLOR_ARRAY);
 #else
 	if (m_display_list)
 	{
@@ -441,9 +720,17 @@ void COctree::Render(bool no_color)
 		m_display_list = glGenLists(1);
 		glNewList(m_display_list, GL_COMPILE_AND_EXECUTE);
 
-		triangle_count = 0;
-		COctEle::Render(false);
-		m_triangle_count = triangle_count;
+		glBegin(GL_TRIANGLES);
+		for (std::map<OctCode, COctChunk>::iterator It = m_chunks.begin(); It != m_chunks.end(); It++)
+		{
+			const std::vector<VertexType> &vertices = It->second.m_vertices;
+			for (std::vector<VertexType>::const_iterator VIt = vertices.begin(); VIt != vertices.end(); VIt++)
+			{
+				glColor3f(VIt->r, VIt->g, VIt->b);
+				glVertex3f(VIt->x, VIt->y, VIt->z);
+			}
+		}
+		glEnd();
 
 		glEndList();
 	}
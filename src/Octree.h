@@ -4,7 +4,9 @@
 
 #include <fstream>
 #include <list>
+#include <map>
 #include <set>
+#include <vector>
 #include "Box.h"
 #include "geometry.h"
 
@@ -12,10 +14,20 @@ class CTri;
 class COctSolid;
 class COctEle;
 
-#define MAX_OCTTREE_LEVEL 8
+#define DEFAULT_OCTREE_LEVEL 8 // deeper levels are much slower and bigger, so they are only used when asked for
+#define MAX_OCTREE_LEVEL 21 // a Morton code has 3 bits per level and must fit in 64 bits
+#define OCTREE_CHUNK_LEVELS 5 // the surface is meshed in chunks of up to 32 x 32 x 32 elements of the deepest level
 #define OCTREE_USES_VERTEX_BUFFERS
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCTREE_USES_SSE2
+#endif
+
+typedef unsigned long long OctCode; // Morton code, 3 bits per level, x y z, with x the highest bit
+
 
+// an element of the octree. they are kept in the octree's pool, in blocks of 8 brothers,
+// so an element only has the index of its first child, and its box comes from its level and Morton code
 class COctEle
 {
 public:
@@ -27,7 +39,6 @@ public:
 		OCTELE_BOOLEAN_XOR,
 	};
 
-#ifdef OCTREE_USES_VERTEX_BUFFERS
 	struct VertexType
 	{
 		float x, y, z;
@@ -35,43 +46,86 @@ public:
 		VertexType(float X, float Y, float Z){ x = X; y = Y; z = Z; r = 0.0; g = 1.0; b = 0.0; }
 		VertexType(){}
 	};
-#endif
 
-	CBox m_box;
-	int m_level;
-	COctEle* m_children[8];  // (1, 1,-1), (-1, 1,-1), (-1,-1,-1), (1,-1,-1), (1, 1, 1), (-1, 1, 1), (-1,-1, 1), (1,-1, 1)  
-	double m_rad;
+	unsigned int m_children; // the pool index of the first child, the others follow it; 0 if there are no children. order as the child index bits, x y z
 	bool m_inside; // valid if there are no children
 	unsigned char m_color_r, m_color_g, m_color_b;
 	static int m_child_order[8][8]; // [ray_type][child]
 	static bool texture;
 	static bool add;
 
-	COctEle(const CBox& box, int level);
-	~COctEle();
+	COctEle():m_children(0), m_inside(false), m_color_r(0), m_color_g(0), m_color_b(0){}
+};
+
+// the boxes of the 8 children of an element, one array per coordinate, so a solid can classify them all at once
+class COctChildBoxes
+{
+public:
+	double m_min[3][8];
+	double m_max[3][8];
+
+	void GetBox(int child, CBox &box)const;
+};
+
+// the triangles of the surface inside one chunk of the octree, with their own vertex buffer
+class COctChunk
+{
+public:
+	std::vector<COctEle::VertexType> m_vertices;
+	unsigned int m_buffer_id; // 0 until the vertices are uploaded
 
-	void Split();
-	void DeleteChildren();
-	void AddRemoveSolid(const COctSolid& s);
-	virtual void Render(bool no_color);
+	COctChunk():m_buffer_id(0){}
+	COctChunk(const COctChunk& c):m_vertices(c.m_vertices), m_buffer_id(0){} // a copy makes its own buffer
+	const COctChunk& operator=(const COctChunk& c){ m_vertices = c.m_vertices; m_buffer_id = 0; return *this; }
 };
 
-class COctree: public COctEle
+class COctree
 {
-#ifdef OCTREE_USES_VERTEX_BUFFERS
-	int m_vertexCount, m_indexCount;
-	unsigned int m_vertexArrayId, m_vertexBufferId[10], m_indexBufferId[10];
-#else
+	CBox m_box;
+	int m_max_level;
+	std::vector<COctEle> m_eles; // the root, then blocks of 8 brothers
+	std::vector<unsigned int> m_free_blocks;
+	int m_chunk_level;
+	std::map<OctCode, COctChunk> m_chunks; // only the chunks with some surface in them
+	std::set<OctCode> m_dirty_chunks; // chunks to mesh again, because AddRemoveSolid changed them or their neighbours
+	std::vector<unsigned int> m_dead_buffers; // buffers of removed chunks, deleted next time it is rendered
+#ifndef OCTREE_USES_VERTEX_BUFFERS
 	int m_display_list;
 #endif
 
+	unsigned int AllocateBlock();
+	void Split(unsigned int ele);
+	void DeleteChildren(unsigned int ele);
+	void GetChildBoxes(int level, OctCode code, COctChildBoxes &boxes)const;
+	void AddRemoveSolid(unsigned int ele, int level, OctCode code, int inside, const COctSolid& s);
+
+	// the faces of a chunk in each direction and plane, as colours of the deepest level squares, 0 where there is no face
+	typedef std::map< std::pair<int, unsigned int>, std::vector<unsigned int> > FaceGrids;
+
+	void ElementChanged(int level, OctCode code);
+	void MarkChunks(const int* lo, const int* hi);
+	void RemoveChunk(std::map<OctCode, COctChunk>::iterator It);
+	void AddFace(int level, const unsigned int* ijk, int dir, unsigned int color, FaceGrids &grids, const unsigned int* origin)const;
+	void AddFaces(int level, OctCode code, int dir, const COctEle& e, FaceGrids &grids, const unsigned int* origin)const;
+	void AddExposedFaces(unsigned int ne, int level, OctCode ncode, int dir, unsigned int color, FaceGrids &grids, const unsigned int* origin)const;
+	void AddChunkFaces(unsigned int ele, int level, OctCode code, FaceGrids &grids, const unsigned int* origin)const;
+	void MeshChunk(OctCode chunk_code);
+
 public:
+	typedef COctEle::VertexType VertexType;
+
 	int m_triangle_count;
 
-	COctree(const CBox& box);
+	COctree(const CBox& box, int max_level = DEFAULT_OCTREE_LEVEL);
+	COctree(const COctree& o);
+	~COctree();
+
+	const COctree& operator=(const COctree& o);
+
+	int GetMaxLevel()const{ return m_max_level; }
+	unsigned int GetEleCount()const{ return m_eles.size() - m_free_blocks.size() * 8; }
+	void GetBox(int level, OctCode code, CBox &box)const;
 	void AddRemoveSolid(bool add_remove, const COctSolid& s);
+	void UpdateMesh(); // meshes the chunks which have changed since it was last called
 	void Render(bool no_color);
-#ifdef OCTREE_USES_VERTEX_BUFFERS
-	bool MakeBuffer();
-#endif
 };
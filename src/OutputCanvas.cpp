@@ -12,6 +12,9 @@
 BEGIN_EVENT_TABLE(COutputTextCtrl, wxTextCtrl)
     EVT_MOUSE_EVENTS(COutputTextCtrl::OnMouse)
 	EVT_PAINT(COutputTextCtrl::OnPaint)
+#ifndef WIN32
+	EVT_IDLE(COutputTextCtrl::OnIdle)
+#endif
 END_EVENT_TABLE()
 
 void COutputTextCtrl::OnMouse( wxMouseEvent& event )
@@ -32,17 +35,30 @@ void COutputTextCtrl::OnMouse( wxMouseEvent& event )
 bool painting = false;
 void COutputTextCtrl::OnPaint(wxPaintEvent& event)
 {
-	// this is here to Format the text ( which seems to be slow in Windows, if all done at once in CNCCode::SetTextCtrl )
-	// OnPaint doesn't seem to get called from Linux, though
+	// this is here to Format the text ( which is slow, if all done at once in CNCCode::SetTextCtrl )
 	wxPaintDC dc(this);
+	FormatVisibleBlocks();
+	event.Skip();
+}
+
+#ifndef WIN32
+void COutputTextCtrl::OnIdle(wxIdleEvent& event)
+{
+	// OnPaint doesn't seem to get called from Linux, so format the blocks scrolled into view here
+	FormatVisibleBlocks();
+	event.Skip();
+}
+#endif
 
+void COutputTextCtrl::FormatVisibleBlocks()
+{
+	// only the blocks in the window are formatted; blocks already formatted are skipped by CNCCodeBlock::FormatText
 	if (!painting && wxGetApp().m_nc_code)
 	{
 		painting = true;
 
 		wxSize size = GetClientSize();
 		int scrollpos = GetScrollPos(wxVERTICAL);
-		wxLogDebug(_T("%i"), scrollpos);
 
 		wxTextCoord col0, row0, col1, row1;
 		HitTest(wxPoint(0,0),      &col0, &row0);
@@ -50,6 +66,7 @@ void COutputTextCtrl::OnPaint(wxPaintEvent& event)
 
 		int pos0 = XYToPosition(0, row0);
 		int pos1 = XYToPosition(1, row1);
+		if(pos1 < 0)pos1 = GetLastPosition(); // the text ends before the bottom of the window
 
 		wxGetApp().m_nc_code->FormatBlocks(this, pos0, pos1);
 
@@ -57,7 +74,6 @@ void COutputTextCtrl::OnPaint(wxPaintEvent& event)
 
 		painting = false;
 	}
-	event.Skip();
 }
 
 BEGIN_EVENT_TABLE(COutputCanvas, wxScrolledWindow)
@@ -14,6 +14,10 @@ public:
 
     void OnMouse( wxMouseEvent& event );
 	void OnPaint(wxPaintEvent& event);
+#ifndef WIN32
+	void OnIdle(wxIdleEvent& event);
+#endif
+	void FormatVisibleBlocks();
 
     DECLARE_NO_COPY_CLASS(COutputTextCtrl)
     DECLARE_EVENT_TABLE()
@@ -0,0 +1,427 @@
+// PickTree.cpp
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+#include "stdafx.h"
+
+#include "PickTree.h"
+#include "HeeksObj.h"
+#include "MarkedList.h"
+
+// how many pixels to grow the picking window by, for things drawn at a fixed pixel size, like points and thick lines
+static const int pick_margin_pixels = 8;
+
+// the sum of the box's sides, used instead of volume or surface area, so flat drawings and points still have a sensible cost
+static double BoxCost(const CBox& box)
+{
+	if(!box.m_valid)return 0.0;
+	return box.Width() + box.Height() + box.Depth();
+}
+
+static CBox UnionBox(const CBox& b1, const CBox& b2)
+{
+	CBox box = b1;
+	box.Insert(b2);
+	return box;
+}
+
+CPickTree::CPickTree():m_root(-1), m_registered(false)
+{
+}
+
+CPickTree::~CPickTree()
+{
+	if(m_registered)wxGetApp().RemoveObserver(this);
+}
+
+int CPickTree::AllocateNode()
+{
+	if(m_free_nodes.size() > 0)
+	{
+		int node = m_free_nodes.back();
+		m_free_nodes.pop_back();
+		m_nodes[node] = CNode();
+		return node;
+	}
+	m_nodes.push_back(CNode());
+	return (int)(m_nodes.size()) - 1;
+}
+
+void CPickTree::FreeNode(int node)
+{
+	m_nodes[node].m_object = NULL;
+	m_free_nodes.push_back(node);
+}
+
+void CPickTree::InsertLeaf(int leaf)
+{
+	if(m_root == -1)
+	{
+		m_root = leaf;
+		m_nodes[leaf].m_parent = -1;
+		return;
+	}
+
+	// walk down to the best sibling, choosing the child which grows the least
+	CBox leaf_box = m_nodes[leaf].m_box;
+	int sibling = m_root;
+	while(!m_nodes[sibling].IsLeaf())
+	{
+		int c0 = m_nodes[sibling].m_child[0];
+		int c1 = m_nodes[sibling].m_child[1];
+		double cost0 = BoxCost(UnionBox(m_nodes[c0].m_box, leaf_box)) - BoxCost(m_nodes[c0].m_box);
+		double cost1 = BoxCost(UnionBox(m_nodes[c1].m_box, leaf_box)) - BoxCost(m_nodes[c1].m_box);
+		sibling = (cost0 <= cost1) ? c0 : c1;
+	}
+
+	// make a new parent for the sibling and the leaf
+	int old_parent = m_nodes[sibling].m_parent;
+	int new_parent = AllocateNode();
+	m_nodes[new_parent].m_parent = old_parent;
+	m_nodes[new_parent].m_child[0] = sibling;
+	m_nodes[new_parent].m_child[1] = leaf;
+	m_nodes[sibling].m_parent = new_parent;
+	m_nodes[leaf].m_parent = new_parent;
+
+	if(old_parent == -1)
+	{
+		m_root = new_parent;
+	}
+	else
+	{
+		if(m_nodes[old_parent].m_child[0] == sibling)m_nodes[old_parent].m_child[0] = new_parent;
+		else m_nodes[old_parent].m_child[1] = new_parent;
+	}
+
+	Refit(new_parent);
+}
+
+void CPickTree::RemoveLeaf(int leaf)
+{
+	if(leaf == m_root)
+	{
+		m_root = -1;
+		return;
+	}
+
+	// replace the parent with the leaf's sibling
+	int parent = m_nodes[leaf].m_parent;
+	int grand_parent = m_nodes[parent].m_parent;
+	int sibling = (m_nodes[parent].m_child[0] == leaf) ? m_nodes[parent].m_child[1] : m_nodes[parent].m_child[0];
+
+	if(grand_parent == -1)
+	{
+		m_root = sibling;
+		m_nodes[sibling].m_parent = -1;
+	}
+	else
+	{
+		if(m_nodes[grand_parent].m_child[0] == parent)m_nodes[grand_parent].m_child[0] = sibling;
+		else m_nodes[grand_parent].m_child[1] = sibling;
+		m_nodes[sibling].m_parent = grand_parent;
+		Refit(grand_parent);
+	}
+
+	FreeNode(parent);
+	m_nodes[leaf].m_parent = -1;
+}
+
+void CPickTree::Refit(int node)
+{
+	// recalculate the boxes from this node up to the root
+	while(node != -1)
+	{
+		CNode& n = m_nodes[node];
+		if(!n.IsLeaf())
+			n.m_box = UnionBox(m_nodes[n.m_child[0]].m_box, m_nodes[n.m_child[1]].m_box);
+		node = n.m_parent;
+	}
+}
+
+HeeksObj* CPickTree::TopLevelObject(HeeksObj* object)
+{
+	while(object && object->m_owner && object->m_owner != &(wxGetApp()))
+		object = object->m_owner;
+	if(object == NULL || object->m_owner != &(wxGetApp()))return NULL;
+	return object;
+}
+
+void CPickTree::Add(HeeksObj* object)
+{
+	if(m_leaf_map.find(object) != m_leaf_map.end() || m_unboxed.find(object) != m_unboxed.end())
+	{
+		// already added, the box may have changed though
+		Update(object);
+		return;
+	}
+
+	CBox box;
+	if(!object->PickWithoutBox())object->GetBox(box);
+	if(!box.m_valid)
+	{
+		m_unboxed.insert(object);
+		return;
+	}
+
+	int leaf = AllocateNode();
+	m_nodes[leaf].m_box = box;
+	m_nodes[leaf].m_object = object;
+	m_leaf_map.insert(std::make_pair(object, leaf));
+	InsertLeaf(leaf);
+}
+
+void CPickTree::Remove(HeeksObj* object)
+{
+	m_unboxed.erase(object);
+
+	std::map<HeeksObj*, int>::iterator FindIt = m_leaf_map.find(object);
+	if(FindIt == m_leaf_map.end())return;
+	int leaf = FindIt->second;
+	m_leaf_map.erase(FindIt);
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+}
+
+void CPickTree::Update(HeeksObj* object)
+{
+	std::map<HeeksObj*, int>::iterator FindIt = m_leaf_map.find(object);
+	if(FindIt == m_leaf_map.end())
+	{
+		if(m_unboxed.find(object) == m_unboxed.end())return;
+		if(object->PickWithoutBox())return;
+
+		// it might have a box now
+		m_unboxed.erase(object);
+		Add(object);
+		return;
+	}
+
+	int leaf = FindIt->second;
+	CBox box;
+	object->GetBox(box);
+	if(!box.m_valid)
+	{
+		Remove(object);
+		m_unboxed.insert(object);
+		return;
+	}
+
+	if(box == m_nodes[leaf].m_box)return;
+
+	// if it still fits inside its parent's box, only the boxes above need changing, otherwise reinsert it
+	int parent = m_nodes[leaf].m_parent;
+	if(parent != -1 && m_nodes[parent].m_box.Contains(box))
+	{
+		m_nodes[leaf].m_box = box;
+		Refit(parent);
+	}
+	else
+	{
+		RemoveLeaf(leaf);
+		m_nodes[leaf].m_box = box;
+		InsertLeaf(leaf);
+	}
+}
+
+void CPickTree::Rebuild()
+{
+	m_nodes.clear();
+	m_free_nodes.clear();
+	m_leaf_map.clear();
+	m_unboxed.clear();
+	m_root = -1;
+
+	for(HeeksObj* object = wxGetApp().GetFirstChild(); object; object = wxGetApp().GetNextChild())
+	{
+		Add(object);
+	}
+}
+
+class CPickFrustum
+{
+	// the four side planes of the picking window, with normals pointing inwards
+	gp_Pnt m_p[4];
+	gp_Vec m_n[4];
+
+public:
+	CPickFrustum(const CViewPoint& view_point, const wxRect& window)
+	{
+		double x[2] = {(double)(window.x - pick_margin_pixels), (double)(window.x + window.width + pick_margin_pixels)};
+		double y[2] = {(double)(window.y - pick_margin_pixels), (double)(window.y + window.height + pick_margin_pixels)};
+		gp_Pnt near_points[4], far_points[4];
+		for(int i = 0; i<4; i++)
+		{
+			double px = x[(i == 1 || i == 2) ? 1:0];
+			double py = y[(i >= 2) ? 1:0];
+			near_points[i] = view_point.glUnproject(gp_Pnt(px, py, 0));
+			far_points[i] = view_point.glUnproject(gp_Pnt(px, py, 1));
+		}
+
+		gp_Pnt centre(0, 0, 0);
+		for(int i = 0; i<4; i++)
+		{
+			centre.SetXYZ(centre.XYZ() + (near_points[i].XYZ() + far_points[i].XYZ()) * 0.125);
+		}
+
+		for(int i = 0; i<4; i++)
+		{
+			int next = (i + 1) % 4;
+			m_p[i] = near_points[i];
+			m_n[i] = gp_Vec(near_points[i], near_points[next]) ^ gp_Vec(near_points[i], far_points[i]);
+			if(m_n[i] * gp_Vec(m_p[i], centre) < 0)m_n[i].Reverse();
+		}
+	}
+
+	bool Intersects(const CBox& box)const
+	{
+		for(int i = 0; i<4; i++)
+		{
+			// the corner of the box furthest along the plane's normal
+			const gp_Vec &n = m_n[i];
+			gp_Pnt p(n.X() > 0 ? box.m_x[3] : box.m_x[0], n.Y() > 0 ? box.m_x[4] : box.m_x[1], n.Z() > 0 ? box.m_x[5] : box.m_x[2]);
+			if(n * gp_Vec(m_p[i], p) < 0)return false;
+		}
+		return true;
+	}
+};
+
+void CPickTree::Prepare()
+{
+	if(!m_registered)
+	{
+		// this adds all the existing objects
+		wxGetApp().RegisterObserver(this);
+		m_registered = true;
+	}
+
+	// in case objects were added or removed without telling the observers
+	if(m_leaf_map.size() + m_unboxed.size() != (unsigned int)(wxGetApp().GetNumChildren()))Rebuild();
+
+	// marked objects may be being dragged about
+	std::list<HeeksObj*> &marked = wxGetApp().m_marked_list->list();
+	for(std::list<HeeksObj*>::iterator It = marked.begin(); It != marked.end(); It++)
+	{
+		HeeksObj* object = TopLevelObject(*It);
+		if(object)Update(object);
+	}
+}
+
+void CPickTree::LeavesInWindow(const CViewPoint& view_point, const wxRect& window, std::vector<int> &leaves)
+{
+	if(m_root == -1)return;
+
+	CPickFrustum frustum(view_point, window);
+
+	std::vector<int> stack;
+	stack.push_back(m_root);
+	while(stack.size() > 0)
+	{
+		int node = stack.back();
+		stack.pop_back();
+		const CNode& n = m_nodes[node];
+		if(!frustum.Intersects(n.m_box))continue;
+		if(n.IsLeaf())
+		{
+			leaves.push_back(node);
+		}
+		else
+		{
+			stack.push_back(n.m_child[0]);
+			stack.push_back(n.m_child[1]);
+		}
+	}
+}
+
+void CPickTree::ObjectsInWindow(const CViewPoint& view_point, const wxRect& window, std::list<HeeksObj*> &objects)
+{
+	Prepare();
+
+	for(std::set<HeeksObj*>::iterator It = m_unboxed.begin(); It != m_unboxed.end(); It++)
+		objects.push_back(*It);
+
+	std::vector<int> leaves;
+	LeavesInWindow(view_point, window, leaves);
+	for(std::vector<int>::iterator It = leaves.begin(); It != leaves.end(); It++)
+		objects.push_back(m_nodes[*It].m_object);
+}
+
+void CPickTree::ObjectsInView(const CViewPoint& view_point, double min_pixels, std::set<HeeksObj*> &objects, unsigned int &num_too_small)
+{
+	Prepare();
+
+	objects.insert(m_unboxed.begin(), m_unboxed.end());
+
+	// the marked objects always get drawn, however small they are
+	std::list<HeeksObj*> &marked = wxGetApp().m_marked_list->list();
+	for(std::list<HeeksObj*>::iterator It = marked.begin(); It != marked.end(); It++)
+	{
+		HeeksObj* object = TopLevelObject(*It);
+		if(object)objects.insert(object);
+	}
+
+	std::vector<int> leaves;
+	LeavesInWindow(view_point, wxRect(0, 0, view_point.m_window_rect[2], view_point.m_window_rect[3]), leaves);
+
+	// the pixel scale only applies to an orthographic view
+	if(view_point.GetPerspective())min_pixels = 0.0;
+
+	for(std::vector<int>::iterator It = leaves.begin(); It != leaves.end(); It++)
+	{
+		const CNode& n = m_nodes[*It];
+		if(!n.m_object->OnVisibleLayer() || !n.m_object->m_visible)continue;
+
+		// leave out things too small to see, but not points, which get drawn the same size whatever the zoom
+		double radius = n.m_box.Radius();
+		if(radius > 0.0 && radius * 2 * view_point.m_pixel_scale < min_pixels && objects.find(n.m_object) == objects.end())
+		{
+			num_too_small++;
+			continue;
+		}
+
+		objects.insert(n.m_object);
+	}
+}
+
+void CPickTree::OnChanged(const std::list<HeeksObj*>* added, const std::list<HeeksObj*>* removed, const std::list<HeeksObj*>* modified)
+{
+	if(removed)
+	{
+		for(std::list<HeeksObj*>::const_iterator It = removed->begin(); It != removed->end(); It++)
+		{
+			HeeksObj* object = *It;
+			if(m_leaf_map.find(object) != m_leaf_map.end() || m_unboxed.find(object) != m_unboxed.end())Remove(object);
+			else
+			{
+				// a child was removed, so the top level object's box may have shrunk
+				HeeksObj* top = TopLevelObject(object->m_owner);
+				if(top)Update(top);
+			}
+		}
+	}
+
+	if(added)
+	{
+		for(std::list<HeeksObj*>::const_iterator It = added->begin(); It != added->end(); It++)
+		{
+			HeeksObj* object = TopLevelObject(*It);
+			if(object)Add(object);
+		}
+	}
+
+	if(modified)
+	{
+		for(std::list<HeeksObj*>::const_iterator It = modified->begin(); It != modified->end(); It++)
+		{
+			HeeksObj* object = TopLevelObject(*It);
+			if(object)Update(object);
+		}
+	}
+}
+
+void CPickTree::Clear()
+{
+	m_nodes.clear();
+	m_free_nodes.clear();
+	m_leaf_map.clear();
+	m_unboxed.clear();
+	m_root = -1;
+}
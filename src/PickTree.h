@@ -0,0 +1,65 @@
+// PickTree.h
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+
+#include "Observer.h"
+#include "Box.h"
+
+#include <vector>
+#include <map>
+#include <set>
+#include <list>
+
+class CViewPoint;
+
+// a bounding volume hierarchy of the boxes of the document's top level objects.
+// it is kept up to date from the observer callbacks and is used to find which objects could be inside a picking window,
+// so that only those need rendering for colour picking, instead of the whole document.
+// it is also used to find the objects which could be seen in the graphics window, so that only those get drawn.
+class CPickTree: public Observer
+{
+	class CNode
+	{
+	public:
+		CBox m_box;
+		int m_parent;
+		int m_child[2]; // -1 for a leaf
+		HeeksObj* m_object; // only set for a leaf
+
+		CNode():m_parent(-1), m_object(NULL){m_child[0] = -1; m_child[1] = -1;}
+		bool IsLeaf()const{return m_child[0] == -1;}
+	};
+
+	std::vector<CNode> m_nodes;
+	std::vector<int> m_free_nodes;
+	int m_root;
+	std::map<HeeksObj*, int> m_leaf_map;
+	std::set<HeeksObj*> m_unboxed; // objects without a box, or whose drawing depends on the view; always candidates
+	bool m_registered;
+
+	int AllocateNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	void Refit(int node);
+	HeeksObj* TopLevelObject(HeeksObj* object);
+	void Rebuild();
+	void Prepare();
+	void LeavesInWindow(const CViewPoint& view_point, const wxRect& window, std::vector<int> &leaves);
+
+public:
+	CPickTree();
+	~CPickTree();
+
+	void Add(HeeksObj* object);
+	void Remove(HeeksObj* object);
+	void Update(HeeksObj* object);
+	void ObjectsInWindow(const CViewPoint& view_point, const wxRect& window, std::list<HeeksObj*> &objects);
+	void ObjectsInView(const CViewPoint& view_point, double min_pixels, std::set<HeeksObj*> &objects, unsigned int &num_too_small);
+
+	// Observer's virtual functions
+	void OnChanged(const std::list<HeeksObj*>* added, const std::list<HeeksObj*>* removed, const std::list<HeeksObj*>* modified);
+	void Clear();
+};
@@ -16,3 +16,13 @@ double Point::normalize()
 		*this = (*this) / len;
 	return len;
 }
+
+Point CentreBetween(const Point& p0, const Point& p1, const Point& c)
+{
+	Point v = p1 - p0;
+	double length = v.length();
+	if(length < Point::tolerance)return c;
+	Point n = ~v / length;
+	Point mid = (p0 + p1) * 0.5;
+	return mid + n * ((c - mid) * n);
+}
@@ -49,3 +49,7 @@ public:
 };
 
 const Point operator*(const double &d, const Point &p);
+
+// the nearest point to c which is the same distance from p0 and p1
+// for an arc whose ends have been rounded, to give a centre which the geometry code, which checks the radii match, accepts
+Point CentreBetween(const Point& p0, const Point& p1, const Point& c);
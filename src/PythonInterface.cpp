@@ -18,6 +18,9 @@
 #include "StlSolid.h"
 #include "Property.h"
 #include "HXml.h"
+#ifdef WIN32
+#include "HOctree.h" // the octree is only in the Windows projects
+#endif
 #include <set>
 
 #ifdef _DEBUG
@@ -457,6 +460,14 @@ void AddObjectToPythonList(HeeksObj* object, boost::python::list& list)
 	case CircleType:
 		list.append(boost::python::pointer_wrapper<HCircle*>((HCircle*)object));
 		break;
+	case NCCodeType:
+		list.append(boost::python::pointer_wrapper<CNCCode*>((CNCCode*)object));
+		break;
+#ifdef WIN32
+	case OctreeType:
+		list.append(boost::python::pointer_wrapper<HOctree*>((HOctree*)object));
+		break;
+#endif
 	default:
 		list.append(boost::python::pointer_wrapper<HeeksObj*>((HeeksObj*)object));
 		break;
@@ -592,6 +603,36 @@ HeeksObj* NewPoint(double x, double y, double z)
 	return new_object;
 }
 
+double NCCodeGetCycleTime(CNCCode& nc_code)
+{
+	nc_code.CalculateStats();
+	return nc_code.m_stats.m_cycle_time;
+}
+
+boost::python::list NCCodeGetToolStats(CNCCode& nc_code)
+{
+	nc_code.CalculateStats();
+	boost::python::list slist;
+	for (std::vector<CNCStatsItem>::const_iterator It = nc_code.m_stats.m_tools.begin(); It != nc_code.m_stats.m_tools.end(); It++)
+	{
+		const CNCStatsItem &item = *It;
+		slist.append(bp::make_tuple(item.m_tool_number, item.m_cut_length, item.m_rapid_length, item.m_cut_time, item.m_rapid_time));
+	}
+	return slist;
+}
+
+boost::python::list NCCodeGetOperationStats(CNCCode& nc_code)
+{
+	nc_code.CalculateStats();
+	boost::python::list slist;
+	for (std::vector<CNCStatsItem>::const_iterator It = nc_code.m_stats.m_operations.begin(); It != nc_code.m_stats.m_operations.end(); It++)
+	{
+		const CNCStatsItem &item = *It;
+		slist.append(bp::make_tuple(std::wstring(item.m_title.c_str()), item.m_tool_number, item.m_cut_length, item.m_rapid_length, item.m_cut_time, item.m_rapid_time));
+	}
+	return slist;
+}
+
 bp::tuple CircleGetCentre(HCircle &circle)
 {
 	double c[3] = { 0.0, 0.0, 0.0 };
@@ -1272,6 +1313,26 @@ static boost::shared_ptr<CStlSolid> initStlSolid(const std::wstring& title, cons
 	return boost::shared_ptr<CStlSolid>(new CStlSolid(title.c_str(), color));
 }
 
+#ifdef WIN32
+static boost::shared_ptr<HOctree> initOctree(double xmin, double ymin, double zmin, double xmax, double ymax, double zmax, int level)
+{
+	return boost::shared_ptr<HOctree>(new HOctree(CBox(xmin, ymin, zmin, xmax, ymax, zmax), level));
+}
+
+void OctreeCutNCCode(HOctree& octree, CNCCode& nc_code, bp::list cutters, double diameter, double corner_radius, double length)
+{
+	// the tools are only known in python, so they come as a list of (tool number, diameter, corner radius, length)
+	std::map<int, COctCutter> cutter_map;
+	for (int i = 0; i < bp::len(cutters); i++)
+	{
+		bp::tuple t = bp::extract<bp::tuple>(cutters[i]);
+		cutter_map.insert(std::make_pair((int)bp::extract<int>(t[0]), COctCutter(bp::extract<double>(t[1]), bp::extract<double>(t[2]), bp::extract<double>(t[3]))));
+	}
+	octree.CutNCCode(&nc_code, cutter_map, COctCutter(diameter, corner_radius, length));
+	wxGetApp().Repaint();
+}
+#endif
+
 BOOST_PYTHON_MODULE(cad) {
 	bp::class_<BaseObject, boost::noncopyable >("Object")
 		.def("GetType", &BaseObjectGetType)
@@ -1353,8 +1414,18 @@ BOOST_PYTHON_MODULE(cad) {
 
 	bp::class_<CNCCode, bp::bases<HeeksObj>>("NCCode")
 		.def(bp::init<CNCCode>())
+		.def("GetCycleTime", &NCCodeGetCycleTime) ///function GetCycleTime///returns the estimated time to run the program, in seconds
+		.def("GetToolStats", &NCCodeGetToolStats) ///function GetToolStats///returns a list of (tool number, cut length, rapid length, cut time, rapid time) for each tool
+		.def("GetOperationStats", &NCCodeGetOperationStats) ///function GetOperationStats///returns a list of (title, tool number, cut length, rapid length, cut time, rapid time) for each operation
 		;
 
+#ifdef WIN32
+	bp::class_<HOctree, bp::bases<HeeksObj>>("Octree", bp::no_init)
+		.def("__init__", bp::make_constructor(&initOctree)) ///function Octree///params float xmin, float ymin, float zmin, float xmax, float ymax, float zmax, int level///makes stock in the box, with elements down to the given level
+		.def("CutNCCode", &OctreeCutNCCode) ///function CutNCCode///params NCCode nc_code, list cutters, float diameter, float corner_radius, float length///cuts the stock along the NC code's moves; cutters is a list of (tool number, diameter, corner radius, length), the others are for tools not in the list
+		;
+#endif
+
 	bp::class_<ObjList, bp::bases<HeeksObj>>("Patterns")
 		.def(bp::init<ObjList>())
 		;
@@ -1470,64 +1541,3 @@ void HeeksCADapp::PythonOnNewOrOpen(bool open, int res)
 		else PyErr_Print();
 	}
 }
-
-static void RunPythonCommand(const char* command)
-{
-	//PyObject *main_module, *globals;
-	BeforePythonCall(&main_module, &globals);
-
-	PyRun_String(command, Py_file_input, globals, globals);
-
-	AfterPythonCall(main_module);
-}
-
-
-static wxString GetBackplotFilePath() 
-{
-	// The xml file is created in the temporary folder
-#if wxCHECK_VERSION(3, 0, 0)
-	wxStandardPaths& standard_paths = wxStandardPaths::Get();
-#else
-	wxStandardPaths standard_paths;
-#endif
-	wxFileName file_str(standard_paths.GetTempDir().c_str(), _T("backplot.xml"));
-	return file_str.GetFullPath();
-}
-
-void HeeksCADapp::BackplotGCode(const wxString& output_file)
-{
-	wxBusyCursor busy_cursor();
-
-	if (m_machine.reader == _T("not found"))
-	{
-		wxMessageBox(_T("Machine reader name (defined in Program Properties) not found"));
-	} // End if - then
-	else
-	{
-		wxString output_filepath = output_file;
-		//wxString output_filepath = GetOutputFileName();
-		output_filepath.Replace('\\', '/');
-		wxString command = wxString::Format(_T("from nc.hxml_writer import HxmlWriter\nfrom nc.%s import Parser as Parser\nparser = Parser(HxmlWriter())\nparser.Parse('%s')\ndel parser"), m_machine.reader.c_str(), output_filepath.c_str());
-		RunPythonCommand(command);
-
-		// there should now be an xml file written
-		wxString xml_file_str = GetBackplotFilePath();
-		{
-			wxFile ofs(xml_file_str.c_str());
-			if (!ofs.IsOpened())
-			{
-				wxMessageBox(wxString(_("Couldn't open file")) + _T(" - ") + xml_file_str);
-				return;
-			}
-		}
-
-		xml_file_str.Replace('\\', '/');
-
-		// read the xml file, just like paste, into the top level
-		wxGetApp().OpenXMLFile(xml_file_str, &wxGetApp());
-		wxGetApp().Repaint();
-
-		// in Windows, at least, executing the bat file was making HeeksCAD change it's Z order
-		wxGetApp().m_frame->Raise();
-	} // End if - else
-}
@@ -7,6 +7,7 @@
 #include "Wire.h"
 #include "Group.h"
 #include "Face.h"
+#include "FaceTools.h"
 #include "Edge.h"
 #include "Vertex.h"
 #include "Loop.h"
@@ -22,44 +23,41 @@
 #include "PropertyDouble.h"
 #include "PropertyVertex.h"
 #include "PropertyCheck.h"
+#include "HeeksBinaryFile.h"
+#include "Instance.h"
 #include <locale.h>
 
 // static member variable
 bool CShape::m_solids_found = false;
 
 CShape::CShape()
-:m_face_gl_list(0),
-m_edge_gl_list(0),
-m_select_edge_gl_list(0),
- m_opacity(1.0),
+:m_opacity(1.0),
  m_volume_found(false),
  m_color(0, 0, 0),
  m_picked_face(NULL)
 {
+	InitGLLists();
 	Init();
 }
 
 CShape::CShape(const TopoDS_Shape &shape, const wxChar* title, const HeeksColor& col, float opacity)
 :IdNamedObjList(title),
- m_face_gl_list(0),
- m_edge_gl_list(0),
- m_select_edge_gl_list(0),
  m_shape(shape),
  m_opacity(opacity),
  m_volume_found(false),
  m_color(col),
  m_picked_face(NULL)
 {
+	InitGLLists();
 	Init();
 }
 
 CShape::CShape(const CShape& s)
-:m_face_gl_list(0),
- m_edge_gl_list(0),
- m_select_edge_gl_list(0),
- m_volume_found(false),
+:m_volume_found(false),
  m_picked_face(NULL)
 {
+	InitGLLists();
+
 	// the faces, edges, vertices children are not copied, because we don't need them for copies in the undo engine
 	m_faces = NULL;
 	m_edges = NULL;
@@ -118,27 +116,48 @@ void CShape::Init()
 	create_faces_and_edges();
 }
 
-void CShape::KillGLLists()
+void CShape::InitGLLists()
 {
-	if (m_face_gl_list)
+	for(int i = 0; i < SHAPE_MESH_LEVELS; i++)
 	{
-		glDeleteLists(m_face_gl_list, 1);
-		m_face_gl_list = 0;
+		m_face_gl_list[i] = 0;
+		m_edge_gl_list[i] = 0;
+		m_select_edge_gl_list[i] = 0;
 	}
+	m_picking_gl_list = 0;
+}
 
-	if (m_edge_gl_list)
+void CShape::KillGLLists()
+{
+	for(int i = 0; i < SHAPE_MESH_LEVELS; i++)
 	{
-		glDeleteLists(m_edge_gl_list, 1);
-		m_edge_gl_list = 0;
+		if (m_face_gl_list[i])
+		{
+			glDeleteLists(m_face_gl_list[i], 1);
+			m_face_gl_list[i] = 0;
+		}
+
+		if (m_edge_gl_list[i])
+		{
+			glDeleteLists(m_edge_gl_list[i], 1);
+			m_edge_gl_list[i] = 0;
+		}
+
+		if (m_select_edge_gl_list[i])
+		{
+			glDeleteLists(m_select_edge_gl_list[i], 1);
+			m_select_edge_gl_list[i] = 0;
+		}
 	}
 
-	if (m_select_edge_gl_list)
+	if (m_picking_gl_list)
 	{
-		glDeleteLists(m_select_edge_gl_list, 1);
-		m_select_edge_gl_list = 0;
+		glDeleteLists(m_picking_gl_list, 1);
+		m_picking_gl_list = 0;
 	}
 
 	m_box = CBox();
+	m_gl_lists_matrix = gp_Trsf();
 
 	if(m_faces)
 	{
@@ -172,19 +191,97 @@ void CShape::delete_faces_and_edges()
 	if(m_vertices)m_vertices->Clear();
 }
 
-void CShape::CallMesh()
+void CShape::move_faces_and_edges(const TopLoc_Location &loc)
 {
-	double pixels_per_mm = wxGetApp().GetPixelScale();
-	BRepTools::Clean(m_shape);
-	BRepMesh_IncrementalMesh(m_shape, 1 / pixels_per_mm);
+	// the same as making them again from the moved shape, but keeps them, and their ids
+	if(m_faces)
+	{
+		for(HeeksObj* object = m_faces->GetFirstChild(); object; object = m_faces->GetNextChild())
+			((CFace*)object)->MoveWithBody(loc);
+	}
+	if(m_edges)
+	{
+		for(HeeksObj* object = m_edges->GetFirstChild(); object; object = m_edges->GetNextChild())
+			((CEdge*)object)->MoveWithBody(loc);
+	}
+	if(m_vertices)
+	{
+		for(HeeksObj* object = m_vertices->GetFirstChild(); object; object = m_vertices->GetNextChild())
+			((HVertex*)object)->MoveWithBody(loc);
+	}
+}
+
+int CShape::ChooseLevel(int wanted_level, int meshed_level, bool draw_faces, bool draw_edges, const int* edge_gl_lists)const
+{
+	// the wanted level, if its display lists are made, otherwise the level of the mesh there is now, to make them from
+	// while a mesh is being made, the nearest level with display lists, finer ones first
+	// returns -1 if there is nothing to draw
+	if((!draw_faces || m_face_gl_list[wanted_level]) && (!draw_edges || edge_gl_lists[wanted_level]))return wanted_level;
+	if(meshed_level != -1)return meshed_level;
+
+	for(int i = wanted_level + 1; i < SHAPE_MESH_LEVELS; i++)
+	{
+		if((!draw_faces || m_face_gl_list[i]) && (!draw_edges || edge_gl_lists[i]))return i;
+	}
+	for(int i = wanted_level - 1; i >= 0; i--)
+	{
+		if((!draw_faces || m_face_gl_list[i]) && (!draw_edges || edge_gl_lists[i]))return i;
+	}
+	return -1;
+}
+
+static void DrawBoxEdges(const CBox& box)
+{
+	double x[8][3];
+	for(int i = 0; i < 8; i++)box.vert(i, x[i]);
+
+	// corners whose numbers differ by one bit are joined
+	glBegin(GL_LINES);
+	for(int i = 0; i < 8; i++)
+	{
+		for(int bit = 1; bit < 8; bit <<= 1)
+		{
+			if(i & bit)continue;
+			glVertex3dv(x[i]);
+			glVertex3dv(x[i | bit]);
+		}
+	}
+	glEnd();
+}
+
+static void glMultTrsf(const gp_Trsf& tr)
+{
+	double m[16];
+	extract_transposed(tr, m);
+	glMultMatrixd(m);
 }
 
 void CShape::glCommands(bool select, bool marked, bool no_color)
 {
-	bool mesh_called = false;
 	bool draw_faces = (wxGetApp().m_solid_view_mode == SolidViewFacesAndEdges || wxGetApp().m_solid_view_mode == SolidViewFacesOnly);
 	bool draw_edges = (wxGetApp().m_solid_view_mode == SolidViewFacesAndEdges || wxGetApp().m_solid_view_mode == SolidViewEdgesOnly);
 
+	// choose the level of detail from the size of the solid on the screen
+	CBox box;
+	GetBox(box);
+	if(!box.m_valid)return;
+	int wanted_level = CShapeMesher::LevelForView(box, wxGetApp().GetPixelScale());
+	int meshed_level = wxGetApp().GetShapeMesher()->Request(m_shape, box, wanted_level);
+
+	int *p_edge_gl_list = select ? m_select_edge_gl_list : m_edge_gl_list;
+	int level = ChooseLevel(wanted_level, meshed_level, draw_faces, draw_edges, p_edge_gl_list);
+
+	// display lists made after the shape has been moved are made where the others are, so they can all be drawn with m_gl_lists_matrix
+	bool moved = (m_gl_lists_matrix.Form() != gp_Identity);
+
+	if(level == -1)
+	{
+		// draw the box until the mesh is ready
+		if(!no_color)m_color.glColor();
+		DrawBoxEdges(box);
+		return;
+	}
+
 	if(draw_faces)
 	{
 		for(HeeksObj* object = m_faces->GetFirstChild(); object; object = m_faces->GetNextChild())
@@ -193,21 +290,21 @@ void CShape::glCommands(bool select, bool marked, bool no_color)
 			f->MakeSureMarkingGLListExists();
 		}
 
-		if(!m_face_gl_list)
+		if(!m_face_gl_list[level])
 		{
-			if(!mesh_called)
+			// make the display list
+			m_face_gl_list[level] = glGenLists(1);
+			glNewList(m_face_gl_list[level], GL_COMPILE);
+			if(moved)
 			{
-				CallMesh();
-				mesh_called = true;
+				glPushMatrix();
+				glMultTrsf(m_gl_lists_matrix.Inverted());
 			}
 
-			// make the display list
-			m_face_gl_list = glGenLists(1);
-			glNewList(m_face_gl_list, GL_COMPILE);
-
 			// render all the faces
 			m_faces->glCommands(true, false, true);
 
+			if(moved)glPopMatrix();
 			glEndList();
 		}
 
@@ -223,35 +320,39 @@ void CShape::glCommands(bool select, bool marked, bool no_color)
 		}
 	}
 
-	int *p_edge_gl_list = select ? &m_select_edge_gl_list : &m_edge_gl_list;
-
-	if (draw_edges && !*p_edge_gl_list)
+	if (draw_edges && !p_edge_gl_list[level])
 	{
-		if(!mesh_called)
+		// make the display list
+		p_edge_gl_list[level] = glGenLists(1);
+		glNewList(p_edge_gl_list[level], GL_COMPILE);
+		if(moved)
 		{
-			CallMesh();
-			mesh_called = true;
+			glPushMatrix();
+			glMultTrsf(m_gl_lists_matrix.Inverted());
 		}
 
-		// make the display list
-		*p_edge_gl_list = glGenLists(1);
-		glNewList(*p_edge_gl_list, GL_COMPILE);
-
 		// render all the edges
 		m_edges->glCommands(select, marked, no_color);
 
 		// render all the vertices
 		if (select)m_vertices->glCommands(true, false, false);
 
+		if(moved)glPopMatrix();
 		glEndList();
 	}
 
-	if(draw_faces && m_face_gl_list)
+	if(moved)
+	{
+		glPushMatrix();
+		glMultTrsf(m_gl_lists_matrix);
+	}
+
+	if(draw_faces && m_face_gl_list[level])
 	{
 		// draw the face display list
 		if(!select)glEnable(GL_LIGHTING);
 		if (!select)glShadeModel(GL_SMOOTH);
-		glCallList(m_face_gl_list);
+		glCallList(m_face_gl_list[level]);
 		if (!select)glDisable(GL_LIGHTING);
 		if (!select)glShadeModel(GL_FLAT);
 	}
@@ -262,21 +363,72 @@ void CShape::glCommands(bool select, bool marked, bool no_color)
 		glDepthMask(1);
 	}
 
-	if (draw_edges && *p_edge_gl_list)
+	if (draw_edges && p_edge_gl_list[level])
 	{
 		// draw the edge display list
-		glCallList(*p_edge_gl_list);
+		glCallList(p_edge_gl_list[level]);
+	}
+
+	if(moved)glPopMatrix();
+}
+
+void CShape::glFacesForPicking()
+{
+	CBox box;
+	GetBox(box);
+	if(!box.m_valid || m_faces == NULL)return;
+
+	bool moved = (m_gl_lists_matrix.Form() != gp_Identity);
+
+	if(!m_picking_gl_list)
+	{
+		// any mesh will do for picking, but it mustn't be read while it is being made
+		if(wxGetApp().GetShapeMesher()->Request(m_shape, box, 0) == -1)
+		{
+			DrawBoxEdges(box);
+			return;
+		}
+
+		m_picking_gl_list = glGenLists(1);
+		glNewList(m_picking_gl_list, GL_COMPILE);
+		if(moved)
+		{
+			glPushMatrix();
+			glMultTrsf(m_gl_lists_matrix.Inverted());
+		}
+
+		for(HeeksObj* object = m_faces->GetFirstChild(); object; object = m_faces->GetNextChild())
+		{
+			CFace* f = (CFace*)object;
+			DrawFaceWithCommands(f->Face());
+		}
+
+		if(moved)glPopMatrix();
+		glEndList();
+	}
+
+	if(moved)
+	{
+		glPushMatrix();
+		glMultTrsf(m_gl_lists_matrix);
 	}
+	glCallList(m_picking_gl_list);
+	if(moved)glPopMatrix();
 }
 
 void CShape::GetBox(CBox &box)
 {
 	if(!m_box.m_valid)
 	{
-		if(m_faces == NULL)create_faces_and_edges();
-		BRepTools::Clean(m_shape);
-		BRepMesh_IncrementalMesh(m_shape, 1.0);
-		if(m_faces)m_faces->GetBox(m_box);
+		// from the geometry, rather than from a mesh
+		Bnd_Box bnd_box;
+		BRepBndLib::Add(m_shape, bnd_box, Standard_False);
+		if(!bnd_box.IsVoid())
+		{
+			double x0, y0, z0, x1, y1, z1;
+			bnd_box.Get(x0, y0, z0, x1, y1, z1);
+			m_box = CBox(x0, y0, z0, x1, y1, z1);
+		}
 	}
 
 	box.Insert(m_box);
@@ -340,6 +492,22 @@ wxString CShape::StretchedName()
 void CShape::ModifyByMatrix(const double* m){
 	gp_Trsf mat = make_matrix(m);
 
+	if(IsMatrixRigid(mat))
+	{
+		// just change the shape's location, which keeps its TopoDS_TShape, and so its mesh
+		// the faces, edges and vertices are moved with it, and the display lists are drawn moved
+		TopLoc_Location loc(mat);
+		m_shape.Move(loc);
+		MoveParameters(mat);
+		if(m_faces == NULL)create_faces_and_edges(); // a copy, which hasn't got them yet
+		else move_faces_and_edges(loc);
+		m_gl_lists_matrix = mat * m_gl_lists_matrix;
+		m_box = CBox();
+		if(m_volume_found)m_centre_of_mass.Transform(mat);
+		m_creation_time = wxGetLocalTimeMillis();
+		return;
+	}
+
 	if(IsMatrixDifferentialScale(mat))
 	{
         gp_GTrsf gm(mat);
@@ -1041,6 +1209,12 @@ static void WriteShapeOrGroup(STEPControl_Writer &writer, HeeksObj* object, std:
 		writer.Transfer(((CSolid*)object)->Shape(), STEPControl_AsIs);
 	}
 
+	// a document's instances are written with their own shapes, not in its STEP file
+	if(object->GetType() == InstanceType && index_map == NULL)
+	{
+		writer.Transfer(((CInstance*)object)->PlacedShape(), STEPControl_AsIs);
+	}
+
 	if(object->GetType() == GroupType)
 	{
 		for(HeeksObj* o = object->GetFirstChild(); o; o = object->GetNextChild())
@@ -1096,6 +1270,9 @@ bool CShape::ExportSolidsFile(const std::list<HeeksObj*>& objects, const wxChar*
 			else if(object->GetType() == WireType){
 				writer.AddShape(((CWire*)object)->Shape());
 			}
+			else if(object->GetType() == InstanceType){
+				writer.AddShape(((CInstance*)object)->PlacedShape());
+			}
 		}
 		writer.Write(aFileName);
 
@@ -1116,15 +1293,102 @@ bool CShape::ExportSolidsFile(const std::list<HeeksObj*>& objects, const wxChar*
 			if(CShape::IsTypeAShape(object->GetType())){
 				BRepTools::Write(((CShape*)object)->Shape(), ofs);
 			}
+			else if(object->GetType() == InstanceType){
+				BRepTools::Write(((CInstance*)object)->PlacedShape(), ofs);
+			}
 		}
 	}
 
 	return false;
 }
 
+bool CShape::ImportSolidsBinary(const CHeeksBinaryReader& reader, bool undoably, std::map<int, CShapeData> *index_map, HeeksObj* paste_into)
+{
+	// only allow paste of solids at top level or to groups
+	if(paste_into && paste_into->GetType() != GroupType)return false;
+
+	HeeksObj* add_to = &wxGetApp();
+	if(paste_into)add_to = paste_into;
+
+	// each solid is in its own chunk, with the same index as in the index map
+	for(std::map<int, CShapeData>::iterator It = index_map->begin(); It != index_map->end(); It++)
+	{
+		const CHeeksBinaryReader::CChunk* chunk = reader.FindChunk("BREP", It->first);
+		if(chunk == NULL)continue;
+
+		TopoDS_Shape shape;
+		try
+		{
+			std::istringstream iss(std::string(chunk->m_data, chunk->m_size), ios::binary);
+			BinTools_ShapeSet shape_set;
+			shape_set.Read(iss);
+			shape_set.Read(shape, iss, shape_set.NbShapes());
+		}
+		catch(Standard_Failure)
+		{
+			continue;
+		}
+		if(shape.IsNull())continue;
+
+		CShapeData& shape_data = It->second;
+		HeeksObj* new_object = MakeObject(shape, _("Solid"), shape_data.m_solid_type, HeeksColor(191, 191, 191), 1.0f);
+		if(new_object)
+		{
+			if(undoably)wxGetApp().AddUndoably(new_object, add_to, NULL);
+			else add_to->Add(new_object, NULL);
+			shape_data.SetShape((CShape*)new_object, !wxGetApp().m_inPaste);
+		}
+	}
+
+	return true;
+}
+
+static void WriteShapeOrGroupBinary(CHeeksBinaryWriter &writer, HeeksObj* object, std::map<int, CShapeData> *index_map, int &i)
+{
+	if(CShape::IsTypeAShape(object->GetType())){
+		if(index_map)index_map->insert( std::pair<int, CShapeData>(i, CShapeData((CShape*)object)) );
+
+		// the same as BRepTools::Write, but in the binary format, which is much quicker to read back
+		const TopoDS_Shape &shape = ((CShape*)object)->Shape();
+		std::ostringstream oss(ios::binary);
+		BinTools_ShapeSet shape_set;
+		shape_set.Add(shape);
+		shape_set.Write(oss);
+		shape_set.Write(shape, oss);
+		writer.AddChunk("BREP", i, oss.str());
+		i++;
+	}
+
+	if(object->GetType() == GroupType)
+	{
+		for(HeeksObj* o = object->GetFirstChild(); o; o = object->GetNextChild())
+		{
+			WriteShapeOrGroupBinary(writer, o, index_map, i);
+		}
+	}
+}
+
+void CShape::ExportSolidsBinary(const std::list<HeeksObj*>& objects, CHeeksBinaryWriter& writer, std::map<int, CShapeData> *index_map)
+{
+	int i = 1;
+	for(std::list<HeeksObj*>::const_iterator It = objects.begin(); It != objects.end(); It++)
+	{
+		HeeksObj* object = *It;
+		WriteShapeOrGroupBinary(writer, object, index_map, i);
+	}
+}
+
+void CShape::WaitForMesh()
+{
+	wxGetApp().GetShapeMesher()->Wait(m_shape);
+}
+
 void CShape::GetTriangles(void(*callbackfunc)(const double* x, const double* n), double cusp, bool just_one_average_normal){
+	// the mesh for drawing is replaced with this one
+	wxGetApp().GetShapeMesher()->Wait(m_shape);
 	BRepTools::Clean(m_shape);
 	BRepMesh_IncrementalMesh(m_shape, cusp);
+	wxGetApp().GetShapeMesher()->MeshChanged(m_shape);
 
 	return IdNamedObjList::GetTriangles(callbackfunc, cusp, just_one_average_normal);
 }
@@ -1165,6 +1429,15 @@ bool CShape::IsMatrixDifferentialScale(const gp_Trsf& trsf)
 	return false;
 }
 
+bool CShape::IsMatrixRigid(const gp_Trsf& trsf)
+{
+	// no scaling and no mirroring, so it can be a TopLoc_Location
+	if(trsf.IsNegative())return false;
+	if(fabs(trsf.ScaleFactor() - 1.0) > 0.000000001)return false;
+	if(IsMatrixDifferentialScale(trsf))return false;
+	return true;
+}
+
 void CShape::CopyFrom(const HeeksObj* object)
 {
 	*this = *((CShape*)object);
@@ -8,12 +8,19 @@
 #include "ShapeData.h"
 #include "ShapeTools.h"
 #include "IdNamedObjList.h"
+#include "ShapeMesher.h"
+
+class CHeeksBinaryWriter;
+class CHeeksBinaryReader;
 
 class CShape:public IdNamedObjList{
 protected:
-	int m_face_gl_list;
-	int m_edge_gl_list;
-	int m_select_edge_gl_list;
+	// display lists for each level of detail
+	int m_face_gl_list[SHAPE_MESH_LEVELS];
+	int m_edge_gl_list[SHAPE_MESH_LEVELS];
+	int m_select_edge_gl_list[SHAPE_MESH_LEVELS];
+	int m_picking_gl_list; // for instances
+	gp_Trsf m_gl_lists_matrix; // how far the shape has been moved since the display lists were made; they are drawn with it
 	CBox m_box;
 	TopoDS_Shape m_shape;
 	wxLongLong m_creation_time;
@@ -24,8 +31,11 @@ protected:
 
 	void create_faces_and_edges();
 	void delete_faces_and_edges();
-	void CallMesh();
+	void move_faces_and_edges(const TopLoc_Location &loc);
+	void InitGLLists();
+	int ChooseLevel(int wanted_level, int meshed_level, bool draw_faces, bool draw_edges, const int* edge_gl_lists)const;
 	virtual void MakeTransformedShape(const gp_Trsf &mat);
+	virtual void MoveParameters(const gp_Trsf &mat){} // for shapes made from parameters, when the shape is moved by its location
 	virtual wxString StretchedName();
 
 public:
@@ -47,6 +57,8 @@ public:
 	bool IsDifferent(HeeksObj* obj);
 	int GetType()const{return SolidType;}
 	void glCommands(bool select, bool marked, bool no_color);
+	void WaitForMesh(); // before reading its faces' or edges' triangulation, which a mesher thread might be writing
+	void glFacesForPicking(); // for an instance of the shape; the faces in the instance's picking colour, rather than in their own
 	void GetBox(CBox &box);
 	void KillGLLists(void);
 	void ModifyByMatrix(const double* m);
@@ -78,9 +90,12 @@ public:
 	static void FilletOrChamferEdges(std::list<HeeksObj*> &list, double radius, bool chamfer_not_fillet = false);
 	static bool ImportSolidsFile(const wxChar* filepath, bool undoably,std::map<int, CShapeData> *index_map = NULL, HeeksObj* paste_into = NULL);
 	static bool ExportSolidsFile(const std::list<HeeksObj*>& objects, const wxChar* filepath, std::map<int, CShapeData> *index_map = NULL);
+	static bool ImportSolidsBinary(const CHeeksBinaryReader& reader, bool undoably, std::map<int, CShapeData> *index_map, HeeksObj* paste_into = NULL);
+	static void ExportSolidsBinary(const std::list<HeeksObj*>& objects, CHeeksBinaryWriter& writer, std::map<int, CShapeData> *index_map);
 	static HeeksObj* MakeObject(const TopoDS_Shape &shape, const wxChar* title, SolidTypeEnum solid_type, const HeeksColor& col, float opacity);
 	static bool IsTypeAShape(int t);
 	static bool IsMatrixDifferentialScale(const gp_Trsf& trsf);
+	static bool IsMatrixRigid(const gp_Trsf& trsf);
 
 	virtual void SetXMLElement(TiXmlElement* element){}
 	virtual void SetFromXMLElement(TiXmlElement* pElem){}
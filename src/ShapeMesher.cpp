@@ -0,0 +1,269 @@
+// ShapeMesher.cpp
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+#include "stdafx.h"
+
+#include "ShapeMesher.h"
+
+// how often to look for finished meshes, in milliseconds
+static const int poll_interval = 100;
+
+CShapeMesher::CShapeMesher():m_stopping(false)
+{
+}
+
+CShapeMesher::~CShapeMesher()
+{
+	Stop();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+		m_jobs.clear();
+	}
+	m_job_added.notify_all();
+
+	for(unsigned int i = 0; i < m_threads.size(); i++)
+		m_threads[i].join();
+}
+
+const Standard_Transient* CShapeMesher::Key(const TopoDS_Shape& shape)
+{
+	return shape.TShape().operator->();
+}
+
+void CShapeMesher::Mesh(TopoDS_Shape& shape, double deflection)
+{
+	try
+	{
+		BRepTools::Clean(shape);
+		BRepMesh_IncrementalMesh(shape, deflection);
+	}
+	catch(...)
+	{
+		// leave it without a mesh, it will be drawn as a box
+	}
+}
+
+double CShapeMesher::Deflection(const CBox& box, int level)
+{
+	// from a sixteenth of the size of the solid, down to a 4096th
+	double size = box.Radius() * 2;
+	if(size <= 0.0)size = 1.0;
+	return size / (double)(16 << (2 * level));
+}
+
+int CShapeMesher::LevelForView(const CBox& box, double pixels_per_mm)
+{
+	// the coarsest level which is within half a pixel
+	for(int level = 0; level < SHAPE_MESH_LEVELS; level++)
+	{
+		if(Deflection(box, level) * pixels_per_mm <= 0.5)return level;
+	}
+	return SHAPE_MESH_LEVELS - 1;
+}
+
+int CShapeMesher::Request(const TopoDS_Shape& shape, const CBox& box, int level)
+{
+	if(shape.IsNull())return -1;
+
+	const Standard_Transient* key = Key(shape);
+	std::map<const Standard_Transient*, CEntry>::iterator FindIt = m_entries.find(key);
+	if(FindIt == m_entries.end())
+	{
+		Prune();
+		FindIt = m_entries.insert(std::make_pair(key, CEntry())).first;
+		FindIt->second.m_shape = shape;
+	}
+	CEntry &entry = FindIt->second;
+
+	if(entry.m_pending != -1)return -1;
+	if(entry.m_level >= level)return entry.m_level;
+
+	if(!wxGetApp().m_mesh_solids_in_background)
+	{
+		Mesh(entry.m_shape, Deflection(box, level));
+		entry.m_level = level;
+		return level;
+	}
+
+	if(m_threads.size() == 0)
+	{
+		// leave a core for the user interface
+		unsigned int num_threads = std::thread::hardware_concurrency();
+		if(num_threads > 1)num_threads--;
+		if(num_threads < 1)num_threads = 1;
+		for(unsigned int i = 0; i < num_threads; i++)
+			m_threads.push_back(std::thread(RunWorker, this));
+	}
+
+	CJob job;
+	job.m_key = key;
+	job.m_shape = entry.m_shape;
+	job.m_deflection = Deflection(box, level);
+	job.m_level = level;
+	for(TopExp_Explorer ex(entry.m_shape, TopAbs_FACE); ex.More(); ex.Next())job.m_faces_and_edges.insert(Key(ex.Current()));
+	for(TopExp_Explorer ex(entry.m_shape, TopAbs_EDGE); ex.More(); ex.Next())job.m_faces_and_edges.insert(Key(ex.Current()));
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(job);
+	}
+	m_job_added.notify_one();
+
+	entry.m_pending = level;
+	if(!IsRunning())Start(poll_interval);
+
+	return -1;
+}
+
+void CShapeMesher::Wait(const TopoDS_Shape& shape)
+{
+	if(shape.IsNull())return;
+
+	const Standard_Transient* key = Key(shape);
+	std::map<const Standard_Transient*, CEntry>::iterator FindIt = m_entries.find(key);
+	if(FindIt == m_entries.end() || FindIt->second.m_pending == -1)return;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// take it off the queue, if it hasn't been started
+		for(std::list<CJob>::iterator It = m_jobs.begin(); It != m_jobs.end(); It++)
+		{
+			if(It->m_key == key)
+			{
+				m_jobs.erase(It);
+				FindIt->second.m_pending = -1;
+				return;
+			}
+		}
+
+		while(m_running.find(key) != m_running.end())
+			m_job_finished.wait(lock);
+	}
+
+	CollectFinished();
+}
+
+void CShapeMesher::MeshChanged(const TopoDS_Shape& shape)
+{
+	if(shape.IsNull())return;
+
+	std::map<const Standard_Transient*, CEntry>::iterator FindIt = m_entries.find(Key(shape));
+	if(FindIt != m_entries.end())FindIt->second.m_level = -1;
+}
+
+void CShapeMesher::RunWorker(CShapeMesher* mesher)
+{
+	mesher->Work();
+}
+
+std::list<CShapeMesher::CJob>::iterator CShapeMesher::NextJob()
+{
+	// the first job which shares no faces or edges with a running job, since the meshes would be written to the same faces
+	// m_mutex must be locked
+	for(std::list<CJob>::iterator It = m_jobs.begin(); It != m_jobs.end(); It++)
+	{
+		bool overlaps = false;
+		for(std::set<const Standard_Transient*>::const_iterator SubIt = It->m_faces_and_edges.begin(); SubIt != It->m_faces_and_edges.end(); SubIt++)
+		{
+			if(m_running_faces_and_edges.find(*SubIt) != m_running_faces_and_edges.end())
+			{
+				overlaps = true;
+				break;
+			}
+		}
+		if(!overlaps)return It;
+	}
+	return m_jobs.end();
+}
+
+void CShapeMesher::Work()
+{
+	while(1)
+	{
+		CJob job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			std::list<CJob>::iterator JobIt;
+			while(!m_stopping && (JobIt = NextJob()) == m_jobs.end())
+				m_job_added.wait(lock);
+			if(m_stopping)return;
+
+			job = *JobIt;
+			m_jobs.erase(JobIt);
+			m_running.insert(job.m_key);
+			m_running_faces_and_edges.insert(job.m_faces_and_edges.begin(), job.m_faces_and_edges.end());
+		}
+
+		Mesh(job.m_shape, job.m_deflection);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_running.erase(job.m_key);
+			for(std::set<const Standard_Transient*>::const_iterator It = job.m_faces_and_edges.begin(); It != job.m_faces_and_edges.end(); It++)
+				m_running_faces_and_edges.erase(*It);
+			m_finished.push_back(job);
+		}
+		m_job_finished.notify_all();
+
+		// jobs which were waiting for this one's faces can go now
+		m_job_added.notify_all();
+	}
+}
+
+bool CShapeMesher::CollectFinished()
+{
+	// returns true if any meshes were finished
+	std::list<CJob> finished;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		finished.swap(m_finished);
+	}
+
+	for(std::list<CJob>::iterator It = finished.begin(); It != finished.end(); It++)
+	{
+		std::map<const Standard_Transient*, CEntry>::iterator FindIt = m_entries.find(It->m_key);
+		if(FindIt == m_entries.end())continue;
+		FindIt->second.m_level = It->m_level;
+		FindIt->second.m_pending = -1;
+	}
+
+	return finished.size() > 0;
+}
+
+void CShapeMesher::Prune()
+{
+	// forget shapes which nothing else is using
+	for(std::map<const Standard_Transient*, CEntry>::iterator It = m_entries.begin(); It != m_entries.end();)
+	{
+		if(It->second.m_pending == -1 && It->second.m_shape.TShape()->GetRefCount() <= 1)
+			m_entries.erase(It++);
+		else
+			It++;
+	}
+}
+
+void CShapeMesher::Notify()
+{
+	bool finished = CollectFinished();
+
+	bool any_pending = false;
+	for(std::map<const Standard_Transient*, CEntry>::iterator It = m_entries.begin(); It != m_entries.end(); It++)
+	{
+		if(It->second.m_pending != -1)
+		{
+			any_pending = true;
+			break;
+		}
+	}
+
+	if(!any_pending)
+	{
+		Stop();
+		Prune();
+	}
+
+	// draw the new meshes
+	if(finished)wxGetApp().Repaint();
+}
@@ -0,0 +1,82 @@
+// ShapeMesher.h
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+
+#include <wx/timer.h>
+#include <map>
+#include <set>
+#include <list>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define SHAPE_MESH_LEVELS 5 // levels of detail, each with a quarter of the deflection of the one before
+
+// makes the meshes for drawing solids on worker threads, at a few levels of detail relative to the size of each solid.
+// OpenCASCADE keeps the mesh on the shape's TopoDS_TShape, which copies of the shape share, so the meshes are looked up by that.
+// a mesh mustn't be read while it is being made, so CShape draws its display lists from before, or its box, until it is ready.
+// it is a wxTimer, so that finished meshes are noticed on the main thread, like CAutoSave does.
+class CShapeMesher: public wxTimer
+{
+	class CEntry
+	{
+	public:
+		TopoDS_Shape m_shape; // keeps the TShape while it is in the map
+		int m_level; // the level of the mesh on the shape now, -1 for none
+		int m_pending; // the level being made, -1 for none
+
+		CEntry():m_level(-1), m_pending(-1){}
+	};
+
+	class CJob
+	{
+	public:
+		const Standard_Transient* m_key;
+		TopoDS_Shape m_shape;
+		double m_deflection;
+		int m_level;
+		std::set<const Standard_Transient*> m_faces_and_edges; // the TShapes the mesh is written to, which other solids' shapes may share
+	};
+
+	std::map<const Standard_Transient*, CEntry> m_entries; // only used on the main thread
+
+	// shared with the worker threads
+	std::mutex m_mutex;
+	std::condition_variable m_job_added;
+	std::condition_variable m_job_finished;
+	std::list<CJob> m_jobs;
+	std::list<CJob> m_finished;
+	std::set<const Standard_Transient*> m_running;
+	std::set<const Standard_Transient*> m_running_faces_and_edges; // a job waits while any of its faces or edges are being meshed for another
+	bool m_stopping;
+
+	std::vector<std::thread> m_threads;
+
+	static const Standard_Transient* Key(const TopoDS_Shape& shape);
+	static void Mesh(TopoDS_Shape& shape, double deflection);
+	static void RunWorker(CShapeMesher* mesher);
+	void Work();
+	std::list<CJob>::iterator NextJob();
+	bool CollectFinished();
+	void Prune();
+
+public:
+	CShapeMesher();
+	~CShapeMesher();
+
+	static double Deflection(const CBox& box, int level);
+	static int LevelForView(const CBox& box, double pixels_per_mm);
+
+	// asks for the given level of mesh, if there isn't one as fine already
+	// returns the level of the mesh which can be drawn from now, or -1 if there isn't one, or it is being remade
+	int Request(const TopoDS_Shape& shape, const CBox& box, int level);
+
+	void Wait(const TopoDS_Shape& shape); // for code which is about to mesh the shape itself
+	void MeshChanged(const TopoDS_Shape& shape); // when the shape has been meshed by other code
+
+	// wxTimer's virtual function
+	void Notify();
+};
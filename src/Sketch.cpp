@@ -730,6 +730,37 @@ void CSketch::ReLinkSketch()
 	}
 }
 
+void CSketch::ReLinkSketches(const std::list<CSketch*> &sketches)
+{
+	for(std::list<CSketch*>::const_iterator It = sketches.begin(); It != sketches.end(); It++)
+	{
+		CSketch* sketch = *It;
+
+		CSketchRelinker relinker(sketch->m_objects);
+
+		relinker.Do();
+
+		std::list<HeeksObj*> new_list;
+
+		for(std::list< std::list<HeeksObj*> >::iterator It2 = relinker.m_new_lists.begin(); It2 != relinker.m_new_lists.end(); It2++)
+		{
+			new_list.splice(new_list.end(), *It2);
+		}
+
+		sketch->m_objects = new_list;
+		sketch->m_index_list_valid = false;
+
+		if(relinker.m_new_lists.size() > 1)
+		{
+			sketch->m_order = SketchOrderTypeMultipleCurves;
+		}
+		else
+		{
+			sketch->CalculateSketchOrder();
+		}
+	}
+}
+
 void CSketch::ReverseSketch()
 {
 	if(m_objects.size() == 0)return;
@@ -865,33 +896,117 @@ void CSketch::Remove(HeeksObj* object)
 	IdNamedObjList::Remove(object);
 }
 
-bool CSketchRelinker::TryAdd(HeeksObj* object)
+unsigned int CSketchRelinker::Bucket(long long cx, long long cy, long long cz)const
+{
+	unsigned long long h = ((unsigned long long)cx * 73856093) ^ ((unsigned long long)cy * 19349663) ^ ((unsigned long long)cz * 83492791);
+	h ^= (h >> 32);
+	return (unsigned int)h & (unsigned int)(m_bucket_start.size() - 2); // there are a power of two buckets, and one more start, for the end of the last bucket
+}
+
+void CSketchRelinker::MakeHash()
+{
+	// any two points within the tolerance are in the same cell, or next to each other
+	// the cells mustn't be so small that the cell numbers get too big
+	m_cell_size = (m_tol > 0.000001) ? m_tol : 0.000001;
+
+	unsigned int num_buckets = 1;
+	while(num_buckets < m_old_objects.size() * 2)num_buckets *= 2;
+	m_bucket_start.assign(num_buckets + 1, 0);
+
+	m_end_points.resize(m_old_objects.size() * 2);
+	std::vector<unsigned int> end_buckets(m_old_objects.size() * 2, num_buckets);
+	for(unsigned int i = 0; i < m_old_objects.size(); i++)
+	{
+		double p[3];
+		if(m_old_objects[i]->GetStartPoint(p))
+		{
+			m_end_points[i * 2] = make_point(p);
+			end_buckets[i * 2] = Bucket((long long)floor(p[0] / m_cell_size), (long long)floor(p[1] / m_cell_size), (long long)floor(p[2] / m_cell_size));
+		}
+		if(m_old_objects[i]->GetEndPoint(p))
+		{
+			m_end_points[i * 2 + 1] = make_point(p);
+			end_buckets[i * 2 + 1] = Bucket((long long)floor(p[0] / m_cell_size), (long long)floor(p[1] / m_cell_size), (long long)floor(p[2] / m_cell_size));
+		}
+	}
+
+	// count the ends in each bucket, then put them in order of bucket
+	for(unsigned int i = 0; i < end_buckets.size(); i++)
+	{
+		if(end_buckets[i] < num_buckets)m_bucket_start[end_buckets[i] + 1]++;
+	}
+	for(unsigned int b = 0; b < num_buckets; b++)m_bucket_start[b + 1] += m_bucket_start[b];
+	m_ends.resize(m_bucket_start[num_buckets]);
+	std::vector<unsigned int> next(m_bucket_start.begin(), m_bucket_start.end() - 1);
+	for(unsigned int i = 0; i < end_buckets.size(); i++)
+	{
+		if(end_buckets[i] < num_buckets)m_ends[next[end_buckets[i]]++] = i;
+	}
+}
+
+void CSketchRelinker::GetObjectsNear(const gp_Pnt &p, std::vector<unsigned int> &objects)const
+{
+	// adds the objects, not yet added to the new lists, with an end within the tolerance of p
+	long long cx = (long long)floor(p.X() / m_cell_size);
+	long long cy = (long long)floor(p.Y() / m_cell_size);
+	long long cz = (long long)floor(p.Z() / m_cell_size);
+	for(long long x = cx - 1; x <= cx + 1; x++)
+	{
+		for(long long y = cy - 1; y <= cy + 1; y++)
+		{
+			for(long long z = cz - 1; z <= cz + 1; z++)
+			{
+				unsigned int b = Bucket(x, y, z);
+				for(unsigned int i = m_bucket_start[b]; i < m_bucket_start[b + 1]; i++)
+				{
+					unsigned int end = m_ends[i];
+					if(m_added[end / 2])continue;
+					if(m_end_points[end].IsEqual(p, m_tol))objects.push_back(end / 2);
+				}
+			}
+		}
+	}
+}
+
+void CSketchRelinker::StartNewList(unsigned int index)
+{
+	std::list<HeeksObj*> empty_list;
+	m_new_lists.push_back(empty_list);
+	m_new_lists.back().push_back(m_old_objects[index]);
+	m_added[index] = true;
+	m_old_front = index;
+	m_new_back = m_old_objects[index];
+	m_new_front = m_old_objects[index];
+}
+
+bool CSketchRelinker::TryAdd(unsigned int index)
 {
 	// if the object is not already added
-	if(m_added_from_old_set.find(object) == m_added_from_old_set.end())
+	if(!m_added[index])
 	{
+		HeeksObj* object = m_old_objects[index];
 		double old_point[3];
 		double new_point[3];
 		m_new_back->GetEndPoint(old_point);
 
 		// try the object, the right way round
 		object->GetStartPoint(new_point);
-		if(make_point(old_point).IsEqual(make_point(new_point), wxGetApp().m_sketch_reorder_tol))
+		if(make_point(old_point).IsEqual(make_point(new_point), m_tol))
 		{
 			m_new_lists.back().push_back(object);
 			m_new_back = object;
-			m_added_from_old_set.insert(object);
+			m_added[index] = true;
 			return true;
 		}
 
 		// try the object, the wrong way round
 		object->GetEndPoint(new_point);
-		if(make_point(old_point).IsEqual(make_point(new_point), wxGetApp().m_sketch_reorder_tol))
+		if(make_point(old_point).IsEqual(make_point(new_point), m_tol))
 		{
 			CSketch::ReverseObject(object);
 			m_new_lists.back().push_back(object);
 			m_new_back = object;
-			m_added_from_old_set.insert(object);
+			m_added[index] = true;
 			return true;
 		}
 
@@ -900,22 +1015,22 @@ bool CSketchRelinker::TryAdd(HeeksObj* object)
 
 		// try the object, the right way round
 		object->GetEndPoint(new_point);
-		if(make_point(old_point).IsEqual(make_point(new_point), wxGetApp().m_sketch_reorder_tol))
+		if(make_point(old_point).IsEqual(make_point(new_point), m_tol))
 		{
 			m_new_lists.back().push_front(object);
 			m_new_front = object;
-			m_added_from_old_set.insert(object);
+			m_added[index] = true;
 			return true;
 		}
 
 		// try the object, the wrong way round
 		object->GetStartPoint(new_point);
-		if(make_point(old_point).IsEqual(make_point(new_point), wxGetApp().m_sketch_reorder_tol))
+		if(make_point(old_point).IsEqual(make_point(new_point), m_tol))
 		{
 			CSketch::ReverseObject(object);
 			m_new_lists.back().push_front(object);
 			m_new_front = object;
-			m_added_from_old_set.insert(object);
+			m_added[index] = true;
 			return true;
 		}
 	}
@@ -929,44 +1044,37 @@ bool CSketchRelinker::AddNext()
 
 	if(m_new_back)
 	{
-		bool added = false;
-
-		// look through all of the old list, starting at m_old_front
-		std::list<HeeksObj*>::const_iterator It = m_old_front;
-		do{
-			It++;
-			if(It == m_old_list.end())It = m_old_list.begin();
-			HeeksObj* object = *It;
-
-			added = TryAdd(object);
-
-		}while(It != m_old_front && !added);
-
-		if(added)return true;
+		// find the objects with an end at either end of the current new list
+		std::vector<unsigned int> near_objects;
+		double p[3];
+		m_new_back->GetEndPoint(p);
+		GetObjectsNear(make_point(p), near_objects);
+		m_new_front->GetStartPoint(p);
+		GetObjectsNear(make_point(p), near_objects);
+
+		// try them in the order of the old list, going round from m_old_front
+		unsigned int n = m_old_objects.size();
+		std::map<unsigned int, unsigned int> in_order;
+		for(std::vector<unsigned int>::iterator It = near_objects.begin(); It != near_objects.end(); It++)
+		{
+			in_order.insert(std::make_pair((*It + n - m_old_front - 1) % n, *It));
+		}
+		for(std::map<unsigned int, unsigned int>::iterator It = in_order.begin(); It != in_order.end(); It++)
+		{
+			if(TryAdd(It->second))return true;
+		}
 
 		// nothing fits the current new list
 
 		m_new_back = NULL;
 		m_new_front = NULL;
 
-		if(m_old_list.size() > m_added_from_old_set.size())
+		// start a new list with the first unused object
+		while(m_first_not_added < n && m_added[m_first_not_added])m_first_not_added++;
+		if(m_first_not_added < n)
 		{
-			// there are still some to add, find a unused object
-			for(std::list<HeeksObj*>::const_iterator It = m_old_list.begin(); It != m_old_list.end(); It++)
-			{
-				HeeksObj* object = *It;
-				if(m_added_from_old_set.find(object) == m_added_from_old_set.end())
-				{
-					std::list<HeeksObj*> empty_list;
-					m_new_lists.push_back(empty_list);
-					m_new_lists.back().push_back(object);
-					m_added_from_old_set.insert(object);
-					m_old_front = It;
-					m_new_back = object;
-					m_new_front = object;
-					return true;
-				}
-			}
+			StartNewList(m_first_not_added);
+			return true;
 		}
 	}
 
@@ -977,14 +1085,12 @@ bool CSketchRelinker::Do()
 {
 	if(m_old_list.size() > 0)
 	{
-		HeeksObj* new_object = m_old_list.front();
-		std::list<HeeksObj*> empty_list;
-		m_new_lists.push_back(empty_list);
-		m_new_lists.back().push_back(new_object);
-		m_added_from_old_set.insert(m_old_list.front());
-		m_old_front = m_old_list.begin();
-		m_new_back = new_object;
-		m_new_front = new_object;
+		m_old_objects.assign(m_old_list.begin(), m_old_list.end());
+		m_added.assign(m_old_objects.size(), false);
+		m_tol = wxGetApp().m_sketch_reorder_tol;
+		MakeHash();
+
+		StartNewList(0);
 
 		while(AddNext()){}
 	}
@@ -993,22 +1099,125 @@ bool CSketchRelinker::Do()
 }
 
 
+class CSketchSweepItem
+{
+public:
+	CBox m_box;
+	HeeksObj* m_object;
+	bool m_in_other;
+};
+
+static bool LessMinX(const CSketchSweepItem& i1, const CSketchSweepItem& i2)
+{
+	return i1.m_box.m_x[0] < i2.m_box.m_x[0];
+}
+
+static void AddSweepItems(const std::list<HeeksObj*> &objects, bool in_other, std::vector<CSketchSweepItem> &items, std::vector<CSketchSweepItem> &unbounded)
+{
+	for (std::list<HeeksObj *>::const_iterator l_itObject = objects.begin(); l_itObject != objects.end(); l_itObject++)
+	{
+		CSketchSweepItem item;
+		item.m_object = *l_itObject;
+		item.m_in_other = in_other;
+		item.m_object->GetBox(item.m_box);
+		if(item.m_box.m_valid)items.push_back(item);
+		else unbounded.push_back(item);
+	}
+}
+
+static bool BoxesOverlap(const CBox& b1, const CBox& b2)
+{
+	double tol = wxGetApp().m_geom_tol;
+	for(int i = 0; i<3; i++)
+	{
+		if(b1.m_x[i] > b2.m_x[i+3] + tol)return false;
+		if(b2.m_x[i] > b1.m_x[i+3] + tol)return false;
+	}
+	return true;
+}
+
+static int IntersectObjectLists(const std::list<HeeksObj*> &objects, const std::list<HeeksObj*> &other_objects, std::list< double > *rl)
+{
+	// sweep across the boxes of both lists from left to right, only intersecting objects whose boxes overlap
+	std::vector<CSketchSweepItem> items;
+	std::vector<CSketchSweepItem> unbounded;
+	AddSweepItems(objects, false, items, unbounded);
+	AddSweepItems(other_objects, true, items, unbounded);
+	std::sort(items.begin(), items.end(), LessMinX);
+
+	int number_of_intersections = 0;
+
+	// the boxes of each list which reach the sweep position
+	std::vector<const CSketchSweepItem*> active[2];
+
+	for(std::vector<CSketchSweepItem>::const_iterator It = items.begin(); It != items.end(); It++)
+	{
+		const CSketchSweepItem &item = *It;
+		std::vector<const CSketchSweepItem*> &others = active[item.m_in_other ? 0 : 1];
+		for(unsigned int i = 0; i < others.size();)
+		{
+			const CSketchSweepItem* other = others[i];
+			if(other->m_box.m_x[3] + wxGetApp().m_geom_tol < item.m_box.m_x[0])
+			{
+				// the sweep has passed it
+				others[i] = others.back();
+				others.pop_back();
+				continue;
+			}
+			i++;
+
+			if(!BoxesOverlap(item.m_box, other->m_box))continue;
+
+			// our object is asked, as before
+			if(item.m_in_other)number_of_intersections += other->m_object->Intersects(item.m_object, rl);
+			else number_of_intersections += item.m_object->Intersects(other->m_object, rl);
+		}
+		active[item.m_in_other ? 1 : 0].push_back(&item);
+	}
+
+	// objects without a box are intersected with everything in the other list
+	for(std::vector<CSketchSweepItem>::const_iterator It = unbounded.begin(); It != unbounded.end(); It++)
+	{
+		if(It->m_in_other)
+		{
+			// with our bounded objects, our unbounded ones are done below
+			for(std::vector<CSketchSweepItem>::const_iterator It2 = items.begin(); It2 != items.end(); It2++)
+			{
+				if(!It2->m_in_other)number_of_intersections += It2->m_object->Intersects(It->m_object, rl);
+			}
+		}
+		else
+		{
+			for (std::list<HeeksObj *>::const_iterator l_itObject = other_objects.begin(); l_itObject != other_objects.end(); l_itObject++)
+			{
+				number_of_intersections += It->m_object->Intersects(*l_itObject, rl);
+			}
+		}
+	}
+
+	return number_of_intersections;
+}
+
 /**
 	The Intersects() method is included in the heeks CAD interface as well as being
 	a virtual method in the HeeksObj base class.  Since this Sketch object is, itself,
 	simply a list of HeeksObj objects, we should be able to simply aggregate the
 	intersection of the specified HeeksObj with all of 'our' HeeksObj objects.
+	Another sketch's objects, and a single object, are swept against ours, so only objects whose boxes overlap are intersected.
  */
 int CSketch::Intersects(const HeeksObj *object, std::list< double > *rl) const
 {
-	int number_of_intersections = 0;
-
-	for (std::list<HeeksObj *>::const_iterator l_itObject = m_objects.begin(); l_itObject != m_objects.end(); l_itObject++)
+	std::list<HeeksObj*> other_objects;
+	if(object->GetType() == SketchType)
 	{
-		number_of_intersections += (*l_itObject)->Intersects( object, rl );
-	} // End for
+		other_objects = ((const CSketch*)object)->m_objects;
+	}
+	else
+	{
+		other_objects.push_back((HeeksObj*)object);
+	}
 
-	return(number_of_intersections);
+	return IntersectObjectLists(m_objects, other_objects, rl);
 } // End Intersects() method
 
 bool CSketch::operator==( const CSketch & rhs ) const
@@ -52,6 +52,7 @@ public:
 	SketchOrderType GetSketchOrder();
 	bool ReOrderSketch(SketchOrderType new_order); // returns true if done
 	void ReLinkSketch();
+	static void ReLinkSketches(const std::list<CSketch*> &sketches); // for sketches which aren't in the document yet, like ones just read from a file; not undoable
 	void ReverseSketch();
 	void ExtractSeparateSketches(std::list<HeeksObj*> &new_separate_sketches, const bool allow_individual_objects = false);
 	int Intersects(const HeeksObj *object, std::list< double > *rl) const;
@@ -65,19 +66,36 @@ public:
 	bool HasMultipleSketches();
 };
 
+// links the objects end to end, into as few lists as possible, reversing objects where needed.
+// the ends of the objects are put in a hash table of cells the size of the tolerance, so only the ends in the cells around a point are compared with it,
+// but the objects are chosen in the same order as looking through the whole list would choose them.
 class CSketchRelinker{
 	const std::list<HeeksObj*> &m_old_list;
-	std::set<HeeksObj*> m_added_from_old_set;
-	std::list<HeeksObj*>::const_iterator m_old_front;
+	std::vector<HeeksObj*> m_old_objects; // the old list, by index
+	std::vector<bool> m_added;
+	unsigned int m_first_not_added;
+	unsigned int m_old_front; // the index of the object which the current new list was started with
 	HeeksObj* m_new_back;
 	HeeksObj* m_new_front;
+	double m_tol;
+
+	// the hash table; the ends in bucket b are m_ends[m_bucket_start[b]] to m_ends[m_bucket_start[b + 1] - 1]
+	double m_cell_size;
+	std::vector<unsigned int> m_bucket_start;
+	std::vector<unsigned int> m_ends; // object index * 2, + 1 for the end point
+	std::vector<gp_Pnt> m_end_points; // object index * 2, + 1 for the end point
+
+	unsigned int Bucket(long long cx, long long cy, long long cz)const;
+	void MakeHash();
+	void GetObjectsNear(const gp_Pnt &p, std::vector<unsigned int> &objects)const;
+	void StartNewList(unsigned int index);
 	bool AddNext();
-	bool TryAdd(HeeksObj* object);
+	bool TryAdd(unsigned int index);
 
 public:
 	std::list< std::list<HeeksObj*> > m_new_lists;
 
-	CSketchRelinker(const std::list<HeeksObj*>& old_list):m_old_list(old_list), m_new_back(NULL), m_new_front(NULL){}
+	CSketchRelinker(const std::list<HeeksObj*>& old_list):m_old_list(old_list), m_first_not_added(0), m_old_front(0), m_new_back(NULL), m_new_front(NULL), m_tol(0.0), m_cell_size(1.0){}
 
 	bool Do(); // makes m_new_lists
 };
@@ -0,0 +1,437 @@
+// SnapCache.cpp
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+#include "stdafx.h"
+
+#include "SnapCache.h"
+#include "DigitizeMode.h"
+#include "MarkedList.h"
+#include "GripData.h"
+
+static const int screen_cell_size = 32; // pixels
+static const int max_screen_cells = 256; // objects covering more cells than this go in the oversized list
+static const int screen_margin = 16; // objects further off the screen than this aren't indexed
+
+static HeeksObj* TopLevelObject(HeeksObj* object)
+{
+	while(object && object->m_owner && object->m_owner != &(wxGetApp()))
+		object = object->m_owner;
+	if(object == NULL || object->m_owner != &(wxGetApp()))return NULL;
+	return object;
+}
+
+static bool CanIntersect(HeeksObj* object)
+{
+	// only these types implement HeeksObj::Intersects
+	switch(object->GetType())
+	{
+	case LineType:
+	case ArcType:
+	case ILineType:
+	case CircleType:
+	case EllipseType:
+	case SplineType:
+		return true;
+	default:
+		return false;
+	}
+}
+
+CSnapObject::CSnapObject(HeeksObj* object, HeeksObj* top):m_object(object), m_top(top)
+{
+	object->GetBox(m_box);
+	m_unbounded = object->PickWithoutBox() || !m_box.m_valid;
+	m_can_intersect = CanIntersect(object);
+	m_screen_box[0] = m_screen_box[1] = m_screen_box[2] = m_screen_box[3] = 0;
+
+	std::list<GripData> vl;
+	object->GetGripperPositionsTransformed(&vl, true);
+	convert_gripdata_to_pnts(vl, m_ends);
+
+	double p[3], p2[3];
+	if(object->GetMidPoint(p))m_mids.push_back(make_point(p));
+
+	int num = object->GetCentrePoints(p, p2);
+	if(num > 0)m_centres.push_back(make_point(p));
+	if(num > 1)m_centres.push_back(make_point(p2));
+}
+
+CSnapCache::CSnapCache():m_registered(false), m_screen_index_valid(false)
+{
+}
+
+CSnapCache::~CSnapCache()
+{
+	Clear();
+	if(m_registered)wxGetApp().RemoveObserver(this);
+}
+
+void CSnapCache::RemoveTop(HeeksObj* top)
+{
+	std::map<HeeksObj*, std::list<CSnapObject*> >::iterator FindIt = m_top_map.find(top);
+	if(FindIt == m_top_map.end())return;
+
+	std::list<CSnapObject*> &snap_objects = FindIt->second;
+	for(std::list<CSnapObject*>::iterator It = snap_objects.begin(); It != snap_objects.end(); It++)
+	{
+		CSnapObject* snap_object = *It;
+
+		// remove the intersections from the objects it crossed
+		for(std::list<CSnapIntersection>::iterator It2 = snap_object->m_intersections.begin(); It2 != snap_object->m_intersections.end(); It2++)
+		{
+			std::list<CSnapIntersection> &other_list = It2->m_other->m_intersections;
+			for(std::list<CSnapIntersection>::iterator It3 = other_list.begin(); It3 != other_list.end();)
+			{
+				if(It3->m_other == snap_object)It3 = other_list.erase(It3);
+				else It3++;
+			}
+		}
+		delete snap_object;
+	}
+
+	m_top_map.erase(FindIt);
+	m_screen_index_valid = false;
+}
+
+void CSnapCache::AddObject(HeeksObj* object, HeeksObj* top, std::list<CSnapObject*> &snap_objects)
+{
+	std::list<HeeksObj*> children;
+	for(HeeksObj* child = object->GetFirstChild(); child; child = object->GetNextChild())
+		children.push_back(child);
+
+	if(children.size() == 0)
+	{
+		// only the bottom level objects are snapped to
+		snap_objects.push_back(new CSnapObject(object, top));
+		return;
+	}
+
+	for(std::list<HeeksObj*>::iterator It = children.begin(); It != children.end(); It++)
+		AddObject(*It, top, snap_objects);
+}
+
+static bool BoxesOverlap(const CSnapObject* s1, const CSnapObject* s2)
+{
+	if(s1->m_unbounded || s2->m_unbounded)return true;
+	double tol = wxGetApp().m_geom_tol;
+	for(int i = 0; i<3; i++)
+	{
+		if(s1->m_box.m_x[i] > s2->m_box.m_x[i+3] + tol)return false;
+		if(s2->m_box.m_x[i] > s1->m_box.m_x[i+3] + tol)return false;
+	}
+	return true;
+}
+
+static void IntersectPair(CSnapObject* s1, CSnapObject* s2)
+{
+	if(!BoxesOverlap(s1, s2))return;
+	std::list<double> rl;
+	if(s1->m_object->Intersects(s2->m_object, &rl))
+	{
+		std::list<gp_Pnt> plist;
+		convert_doubles_to_pnts(rl, plist);
+		for(std::list<gp_Pnt>::iterator It = plist.begin(); It != plist.end(); It++)
+		{
+			s1->m_intersections.push_back(CSnapIntersection(*It, s2));
+			s2->m_intersections.push_back(CSnapIntersection(*It, s1));
+		}
+	}
+}
+
+static bool LessMinX(const CSnapObject* s1, const CSnapObject* s2)
+{
+	return s1->m_box.m_x[0] < s2->m_box.m_x[0];
+}
+
+void CSnapCache::FindIntersections(const std::list<CSnapObject*> &new_objects)
+{
+	std::set<CSnapObject*> new_set;
+	for(std::list<CSnapObject*>::const_iterator It = new_objects.begin(); It != new_objects.end(); It++)
+	{
+		if((*It)->m_can_intersect)new_set.insert(*It);
+	}
+	if(new_set.size() == 0)return;
+
+	std::vector<CSnapObject*> bounded;
+	std::vector<CSnapObject*> unbounded;
+	for(std::map<HeeksObj*, std::list<CSnapObject*> >::iterator It = m_top_map.begin(); It != m_top_map.end(); It++)
+	{
+		std::list<CSnapObject*> &snap_objects = It->second;
+		for(std::list<CSnapObject*>::iterator It2 = snap_objects.begin(); It2 != snap_objects.end(); It2++)
+		{
+			CSnapObject* s = *It2;
+			if(!s->m_can_intersect)continue;
+			if(s->m_unbounded)unbounded.push_back(s);
+			else bounded.push_back(s);
+		}
+	}
+
+	// unbounded objects could cross anything
+	for(std::vector<CSnapObject*>::iterator It = unbounded.begin(); It != unbounded.end(); It++)
+	{
+		CSnapObject* s1 = *It;
+		bool s1_new = (new_set.find(s1) != new_set.end());
+		for(std::vector<CSnapObject*>::iterator It2 = bounded.begin(); It2 != bounded.end(); It2++)
+		{
+			CSnapObject* s2 = *It2;
+			if(s1_new || new_set.find(s2) != new_set.end())IntersectPair(s1, s2);
+		}
+		for(std::vector<CSnapObject*>::iterator It2 = It + 1; It2 != unbounded.end(); It2++)
+		{
+			CSnapObject* s2 = *It2;
+			if(s1_new || new_set.find(s2) != new_set.end())IntersectPair(s1, s2);
+		}
+	}
+
+	if(new_set.size() * 64 < bounded.size())
+	{
+		// just a few changed objects, so test them against everything
+		for(std::set<CSnapObject*>::iterator It = new_set.begin(); It != new_set.end(); It++)
+		{
+			CSnapObject* s1 = *It;
+			if(s1->m_unbounded)continue;
+			for(std::vector<CSnapObject*>::iterator It2 = bounded.begin(); It2 != bounded.end(); It2++)
+			{
+				CSnapObject* s2 = *It2;
+				if(s2 == s1)continue;
+				bool s2_new = (new_set.find(s2) != new_set.end());
+				if(s2_new && s2 < s1)continue; // done the other way round
+				IntersectPair(s1, s2);
+			}
+		}
+		return;
+	}
+
+	// sweep along x, only testing pairs whose x ranges overlap
+	std::sort(bounded.begin(), bounded.end(), LessMinX);
+	std::list<CSnapObject*> active;
+	for(std::vector<CSnapObject*>::iterator It = bounded.begin(); It != bounded.end(); It++)
+	{
+		CSnapObject* s1 = *It;
+		bool s1_new = (new_set.find(s1) != new_set.end());
+		for(std::list<CSnapObject*>::iterator It2 = active.begin(); It2 != active.end();)
+		{
+			CSnapObject* s2 = *It2;
+			if(s2->m_box.m_x[3] + wxGetApp().m_geom_tol < s1->m_box.m_x[0])
+			{
+				It2 = active.erase(It2);
+				continue;
+			}
+			if(s1_new || new_set.find(s2) != new_set.end())IntersectPair(s1, s2);
+			It2++;
+		}
+		active.push_back(s1);
+	}
+}
+
+void CSnapCache::Flush()
+{
+	if(m_dirty.size() == 0)return;
+
+	std::list<CSnapObject*> new_objects;
+	for(std::set<HeeksObj*>::iterator It = m_dirty.begin(); It != m_dirty.end(); It++)
+	{
+		HeeksObj* top = *It;
+		RemoveTop(top);
+		if(top->m_owner != &(wxGetApp()))continue;
+		std::list<CSnapObject*> &snap_objects = m_top_map[top];
+		AddObject(top, top, snap_objects);
+		new_objects.insert(new_objects.end(), snap_objects.begin(), snap_objects.end());
+	}
+	m_dirty.clear();
+
+	FindIntersections(new_objects);
+	m_screen_index_valid = false;
+}
+
+bool CSnapCache::ViewChanged(const CViewPoint &view_point)const
+{
+	if(memcmp(m_modelm, view_point.m_modelm, 16 * sizeof(double)))return true;
+	if(memcmp(m_projm, view_point.m_projm, 16 * sizeof(double)))return true;
+	if(memcmp(m_window_rect, view_point.m_window_rect, 4 * sizeof(int)))return true;
+	return false;
+}
+
+void CSnapCache::MakeScreenIndex(const CViewPoint &view_point)
+{
+	m_screen_cells.clear();
+	m_screen_oversized.clear();
+	memcpy(m_modelm, view_point.m_modelm, 16 * sizeof(double));
+	memcpy(m_projm, view_point.m_projm, 16 * sizeof(double));
+	memcpy(m_window_rect, view_point.m_window_rect, 4 * sizeof(int));
+
+	for(std::map<HeeksObj*, std::list<CSnapObject*> >::iterator It = m_top_map.begin(); It != m_top_map.end(); It++)
+	{
+		std::list<CSnapObject*> &snap_objects = It->second;
+		for(std::list<CSnapObject*>::iterator It2 = snap_objects.begin(); It2 != snap_objects.end(); It2++)
+		{
+			CSnapObject* s = *It2;
+			if(s->m_unbounded)
+			{
+				m_screen_oversized.push_back(s);
+				continue;
+			}
+
+			// find the box on the screen
+			CBox screen_box;
+			for(int i = 0; i<8; i++)
+			{
+				double p[3];
+				s->m_box.vert(i, p);
+				gp_Pnt sp = view_point.glProject(make_point(p));
+				screen_box.Insert(sp.X(), sp.Y(), 0.0);
+			}
+			s->m_screen_box[0] = (int)floor(screen_box.MinX());
+			s->m_screen_box[1] = (int)floor(screen_box.MinY());
+			s->m_screen_box[2] = (int)ceil(screen_box.MaxX());
+			s->m_screen_box[3] = (int)ceil(screen_box.MaxY());
+
+			// leave out anything off the screen
+			if(s->m_screen_box[2] < m_window_rect[0] - screen_margin)continue;
+			if(s->m_screen_box[3] < m_window_rect[1] - screen_margin)continue;
+			if(s->m_screen_box[0] > m_window_rect[0] + m_window_rect[2] + screen_margin)continue;
+			if(s->m_screen_box[1] > m_window_rect[1] + m_window_rect[3] + screen_margin)continue;
+
+			int cx0 = s->m_screen_box[0] / screen_cell_size;
+			int cy0 = s->m_screen_box[1] / screen_cell_size;
+			int cx1 = s->m_screen_box[2] / screen_cell_size;
+			int cy1 = s->m_screen_box[3] / screen_cell_size;
+			if((cx1 - cx0 + 1) * (cy1 - cy0 + 1) > max_screen_cells)
+			{
+				m_screen_oversized.push_back(s);
+				continue;
+			}
+
+			for(int cx = cx0; cx <= cx1; cx++)
+			{
+				for(int cy = cy0; cy <= cy1; cy++)
+				{
+					m_screen_cells[std::make_pair(cx, cy)].push_back(s);
+				}
+			}
+		}
+	}
+
+	m_screen_index_valid = true;
+}
+
+bool CSnapCache::Ignore(const CSnapObject* snap_object)const
+{
+	if(!snap_object->m_top->OnVisibleLayer())return true;
+	for(HeeksObj* object = snap_object->m_object; object && object != &(wxGetApp()); object = object->m_owner)
+	{
+		if(!object->m_visible)return true;
+		if(wxGetApp().m_digitizing->OnlyCoords(object))return true;
+		if(wxGetApp().m_marked_list->get_ignore(object))return true; // being dragged
+	}
+	return false;
+}
+
+void CSnapCache::GetObjectsNear(const CViewPoint &view_point, const wxPoint &point, int pixels, std::list<CSnapObject*> &objects)
+{
+	// point is in OpenGL window coordinates
+	if(!m_registered)
+	{
+		// this adds all the existing objects
+		wxGetApp().RegisterObserver(this);
+		m_registered = true;
+	}
+
+	Flush();
+
+	// in case objects were added or removed without telling the observers
+	if(m_top_map.size() != (unsigned int)(wxGetApp().GetNumChildren()))
+	{
+		Clear();
+		for(HeeksObj* object = wxGetApp().GetFirstChild(); object; object = wxGetApp().GetNextChild())
+			m_dirty.insert(object);
+		Flush();
+	}
+
+	if(!m_screen_index_valid || ViewChanged(view_point))MakeScreenIndex(view_point);
+
+	std::set<CSnapObject*> found;
+	int cx0 = (point.x - pixels) / screen_cell_size;
+	int cy0 = (point.y - pixels) / screen_cell_size;
+	int cx1 = (point.x + pixels) / screen_cell_size;
+	int cy1 = (point.y + pixels) / screen_cell_size;
+	for(int cx = cx0; cx <= cx1; cx++)
+	{
+		for(int cy = cy0; cy <= cy1; cy++)
+		{
+			std::map< std::pair<int, int>, std::list<CSnapObject*> >::iterator FindIt = m_screen_cells.find(std::make_pair(cx, cy));
+			if(FindIt == m_screen_cells.end())continue;
+			std::list<CSnapObject*> &cell = FindIt->second;
+			for(std::list<CSnapObject*>::iterator It = cell.begin(); It != cell.end(); It++)
+				found.insert(*It);
+		}
+	}
+	for(std::list<CSnapObject*>::iterator It = m_screen_oversized.begin(); It != m_screen_oversized.end(); It++)
+		found.insert(*It);
+
+	for(std::set<CSnapObject*>::iterator It = found.begin(); It != found.end(); It++)
+	{
+		CSnapObject* s = *It;
+		if(!s->m_unbounded)
+		{
+			if(point.x + pixels < s->m_screen_box[0] || point.x - pixels > s->m_screen_box[2])continue;
+			if(point.y + pixels < s->m_screen_box[1] || point.y - pixels > s->m_screen_box[3])continue;
+		}
+		if(Ignore(s))continue;
+		objects.push_back(s);
+	}
+}
+
+void CSnapCache::OnChanged(const std::list<HeeksObj*>* added, const std::list<HeeksObj*>* removed, const std::list<HeeksObj*>* modified)
+{
+	if(removed)
+	{
+		for(std::list<HeeksObj*>::const_iterator It = removed->begin(); It != removed->end(); It++)
+		{
+			HeeksObj* object = *It;
+			if(m_top_map.find(object) != m_top_map.end())
+			{
+				RemoveTop(object);
+				m_dirty.erase(object);
+			}
+			else
+			{
+				HeeksObj* top = TopLevelObject(object->m_owner);
+				if(top)m_dirty.insert(top);
+			}
+		}
+	}
+
+	if(added)
+	{
+		for(std::list<HeeksObj*>::const_iterator It = added->begin(); It != added->end(); It++)
+		{
+			HeeksObj* top = TopLevelObject(*It);
+			if(top)m_dirty.insert(top);
+		}
+	}
+
+	if(modified)
+	{
+		for(std::list<HeeksObj*>::const_iterator It = modified->begin(); It != modified->end(); It++)
+		{
+			HeeksObj* top = TopLevelObject(*It);
+			if(top)m_dirty.insert(top);
+		}
+	}
+}
+
+void CSnapCache::Clear()
+{
+	for(std::map<HeeksObj*, std::list<CSnapObject*> >::iterator It = m_top_map.begin(); It != m_top_map.end(); It++)
+	{
+		std::list<CSnapObject*> &snap_objects = It->second;
+		for(std::list<CSnapObject*>::iterator It2 = snap_objects.begin(); It2 != snap_objects.end(); It2++)
+			delete *It2;
+	}
+	m_top_map.clear();
+	m_dirty.clear();
+	m_screen_cells.clear();
+	m_screen_oversized.clear();
+	m_screen_index_valid = false;
+}
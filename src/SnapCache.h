@@ -0,0 +1,74 @@
+// SnapCache.h
+// Copyright (c) 2009, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+
+#include "Observer.h"
+
+class CViewPoint;
+class CSnapObject;
+
+class CSnapIntersection
+{
+public:
+	gp_Pnt m_point;
+	CSnapObject* m_other;
+
+	CSnapIntersection(const gp_Pnt& point, CSnapObject* other):m_point(point), m_other(other){}
+};
+
+// the snap points of one bottom level object, like a line in a sketch or an edge of a solid
+class CSnapObject
+{
+public:
+	HeeksObj* m_object;
+	HeeksObj* m_top; // the object in the document which owns it
+	CBox m_box;
+	bool m_unbounded; // drawn beyond its box, like an infinite line
+	bool m_can_intersect;
+	std::list<gp_Pnt> m_ends;
+	std::list<gp_Pnt> m_mids;
+	std::list<gp_Pnt> m_centres;
+	std::list<CSnapIntersection> m_intersections;
+	int m_screen_box[4]; // in pixels, x0, y0, x1, y1
+
+	CSnapObject(HeeksObj* object, HeeksObj* top);
+};
+
+// keeps the end, mid and centre points of all the objects in the document, and the intersections between them,
+// so that digitizing doesn't have to render the scene and recalculate them for every mouse movement.
+// objects are recalculated when the observer callbacks say they have changed.
+// the objects are indexed by their box on the screen, which is remade when the view changes.
+class CSnapCache: public Observer
+{
+	std::map<HeeksObj*, std::list<CSnapObject*> > m_top_map;
+	std::set<HeeksObj*> m_dirty;
+	bool m_registered;
+
+	// screen index
+	bool m_screen_index_valid;
+	double m_modelm[16];
+	double m_projm[16];
+	int m_window_rect[4];
+	std::map< std::pair<int, int>, std::list<CSnapObject*> > m_screen_cells;
+	std::list<CSnapObject*> m_screen_oversized; // too big for the cells, always tested
+
+	void RemoveTop(HeeksObj* top);
+	void AddObject(HeeksObj* object, HeeksObj* top, std::list<CSnapObject*> &snap_objects);
+	void FindIntersections(const std::list<CSnapObject*> &new_objects);
+	void Flush();
+	void MakeScreenIndex(const CViewPoint &view_point);
+	bool ViewChanged(const CViewPoint &view_point)const;
+	bool Ignore(const CSnapObject* snap_object)const;
+
+public:
+	CSnapCache();
+	~CSnapCache();
+
+	void GetObjectsNear(const CViewPoint &view_point, const wxPoint &point, int pixels, std::list<CSnapObject*> &objects);
+
+	// Observer's virtual functions
+	void OnChanged(const std::list<HeeksObj*>* added, const std::list<HeeksObj*>* removed, const std::list<HeeksObj*>* modified);
+	void Clear();
+};
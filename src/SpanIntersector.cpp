@@ -0,0 +1,87 @@
+// SpanIntersector.cpp
+// Copyright 2011, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "SpanIntersector.h"
+
+#include <algorithm>
+
+class CSweepItem
+{
+public:
+	CBox2D m_box;
+	int m_index;
+	bool m_in_b;
+};
+
+static bool LessMinX(const CSweepItem* i1, const CSweepItem* i2)
+{
+	return i1->m_box.m_minxy.x < i2->m_box.m_minxy.x;
+}
+
+static void AddSweepItems(const std::vector<Span> &spans, bool in_b, std::vector<CSweepItem> &items)
+{
+	for(unsigned int i = 0; i < spans.size(); i++)
+	{
+		CSweepItem item;
+		spans[i].GetBox(item.m_box);
+
+		// so spans which only touch are still intersected
+		item.m_box.m_minxy = item.m_box.m_minxy - Point(Point::tolerance, Point::tolerance);
+		item.m_box.m_maxxy = item.m_box.m_maxxy + Point(Point::tolerance, Point::tolerance);
+
+		item.m_index = i;
+		item.m_in_b = in_b;
+		items.push_back(item);
+	}
+}
+
+void IntersectSpans(const std::vector<Span> &spans_a, const std::vector<Span> &spans_b, std::vector<CSpanIntersection> &intersections)
+{
+	if(spans_a.size() == 0 || spans_b.size() == 0)return;
+
+	std::vector<CSweepItem> items;
+	items.reserve(spans_a.size() + spans_b.size());
+	AddSweepItems(spans_a, false, items);
+	AddSweepItems(spans_b, true, items);
+
+	std::vector<const CSweepItem*> sorted(items.size());
+	for(unsigned int i = 0; i < items.size(); i++)sorted[i] = &items[i];
+	std::sort(sorted.begin(), sorted.end(), LessMinX);
+
+	// the boxes of each list which reach the sweep position
+	std::vector<const CSweepItem*> active[2];
+
+	for(std::vector<const CSweepItem*>::iterator It = sorted.begin(); It != sorted.end(); It++)
+	{
+		const CSweepItem* item = *It;
+		double x = item->m_box.m_minxy.x;
+		std::vector<const CSweepItem*> &others = active[item->m_in_b ? 0 : 1];
+
+		for(unsigned int i = 0; i < others.size();)
+		{
+			const CSweepItem* other = others[i];
+			if(other->m_box.m_maxxy.x < x)
+			{
+				// the sweep has passed it
+				others[i] = others.back();
+				others.pop_back();
+				continue;
+			}
+			i++;
+
+			if(other->m_box.m_minxy.y > item->m_box.m_maxxy.y || item->m_box.m_minxy.y > other->m_box.m_maxxy.y)continue;
+
+			int a = item->m_in_b ? other->m_index : item->m_index;
+			int b = item->m_in_b ? item->m_index : other->m_index;
+			std::list<Point> pts;
+			spans_a[a].Intersect(spans_b[b], pts);
+			for(std::list<Point>::iterator It2 = pts.begin(); It2 != pts.end(); It2++)
+			{
+				intersections.push_back(CSpanIntersection(a, b, *It2));
+			}
+		}
+
+		active[item->m_in_b ? 1 : 0].push_back(item);
+	}
+}
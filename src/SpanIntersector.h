@@ -0,0 +1,22 @@
+// SpanIntersector.h
+// Copyright 2011, Dan Heeks
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+#include <vector>
+#include "Curve.h"
+
+class CSpanIntersection
+{
+public:
+	int m_a; // the index of the span in the first list
+	int m_b; // the index of the span in the second list
+	Point m_p;
+
+	CSpanIntersection(int a, int b, const Point& p):m_a(a), m_b(b), m_p(p){}
+};
+
+// finds all the intersections between the spans in one list and the spans in another.
+// the boxes of the spans are swept from left to right, keeping a list of the boxes which the sweep is in for each list,
+// so only spans whose boxes overlap are intersected, instead of every span with every other span.
+void IntersectSpans(const std::vector<Span> &spans_a, const std::vector<Span> &spans_b, std::vector<CSpanIntersection> &intersections);
@@ -65,6 +65,11 @@ void CSphere::MakeTransformedShape(const gp_Trsf &mat)
 	m_shape = BRepPrimAPI_MakeSphere(m_pos, m_radius).Shape();
 }
 
+void CSphere::MoveParameters(const gp_Trsf &mat)
+{
+	m_pos.Transform(mat);
+}
+
 wxString CSphere::StretchedName(){ return _("Ellipsoid");}
 
 void CSphere::GetProperties(std::list<Property *> *list)
@@ -10,6 +10,7 @@ class CSphere: public CSolid{
 protected:
 	// CShape's virtual functions
 	void MakeTransformedShape(const gp_Trsf &mat);
+	void MoveParameters(const gp_Trsf &mat);
 	wxString StretchedName();
 
 public:
@@ -6,6 +6,7 @@
 #include "PropertyInt.h"
 #include "MarkedObject.h"
 #include "Picking.h"
+#include "MappedFile.h"
 
 using namespace std;
 
@@ -58,148 +59,173 @@ CStlSolid::CStlSolid(const wxChar* filepath, const HeeksColor* col) :m_color(*co
 	}
 }
 
-bool IsAsciiStlFile(ifstream *ifs)
+static bool IsAsciiStl(const char* data, size_t size)
 {
-	char solid_string[6] = "aaaaa";
-	ifs->read(solid_string, 5);
-	if (ifs->eof())return false;
+	// an ascii file starts with "solid" and has "endsolid" on its last line, but some binary files start with "solid" too
+	if (size < 5 || strncmp(data, "solid", 5))return false;
 
-	bool ascii = false;
+	const char* end = data + size;
+	while (end > data && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t' || end[-1] == 0))end--;
+	const char* line = end;
+	while (line > data && line[-1] != '\n' && end - line < 512)line--;
 
-	if (!strcmp(solid_string, "solid"))
-	{
-		ifs->seekg(-1, ios_base::end);
+	return std::string(line, end).find("endsolid") != std::string::npos;
+}
 
-		bool found = false;
-		bool started = false;
-		int i = 0;
-		while (!found && i < 512)
-		{
-			char c = ifs->get();
+static double PowerOfTen(int e)
+{
+	// exact for the exponents that floats in stl files use
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	if (e <= 22)return powers[e];
+	return pow(10.0, e);
+}
 
+static const char* ReadFloat(const char* p, const char* end, float &value)
+{
+	// reads a number like "-1.5e+002", without sscanf or streams, which are slow and depend on the locale
+	// returns the character after the number, or NULL if there isn't one
+	while (p < end && (*p == ' ' || *p == '\t'))p++;
 
-			if ((int)ifs->tellg() <= 1)
-			{
-				ifs->seekg(0);
-				found = true;
-			}
-			else if (c == '\n')
-			{
-				if (started)
-					found = true;
-				else
-				{
-					ifs->seekg(-2, ios_base::cur);
-				}
-			}
-			else
-			{
-				ifs->seekg(-2, ios_base::cur);
-				i++;
-				started = true;
-			}
-		}
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
 
-		if (found)
+	double mantissa = 0.0;
+	int exponent = 0;
+	bool digits = false;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+	{
+		mantissa = mantissa * 10 + (*p - '0');
+		digits = true;
+	}
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++)
 		{
-			char str[1024];
-			ifs->getline(str, 1024);
+			mantissa = mantissa * 10 + (*p - '0');
+			exponent--;
+			digits = true;
+		}
+	}
+	if (!digits)return NULL;
 
-			wxString wstr(str);
-			if (wstr.Contains("endsolid"))
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* q = p + 1;
+		bool negative_exponent = false;
+		if (q < end && (*q == '-' || *q == '+'))
+		{
+			negative_exponent = (*q == '-');
+			q++;
+		}
+		if (q < end && *q >= '0' && *q <= '9')
+		{
+			int e = 0;
+			for (; q < end && *q >= '0' && *q <= '9'; q++)
 			{
-				ascii = true;
+				if (e < 10000)e = e * 10 + (*q - '0');
 			}
+			exponent += negative_exponent ? -e : e;
+			p = q;
 		}
 	}
 
-	ifs->seekg(0);
-
-	return ascii;
+	double d = (exponent < 0) ? (mantissa / PowerOfTen(-exponent)) : (mantissa * PowerOfTen(exponent));
+	value = (float)(negative ? -d : d);
+	return p;
 }
 
 void CStlSolid::read_from_file(const wxChar* filepath)
 {
-	// read the stl file
-	ifstream ifs(Ttc(filepath), ios::binary);
-	if(!ifs)return;
+	// read the stl file straight out of memory
+	CMappedFile file(filepath);
+	if (!file.IsOk())return;
 
+	if (IsAsciiStl(file.Data(), file.Size()))
+		read_ascii(file.Data(), file.Size());
+	else
+		read_binary(file.Data(), file.Size());
+}
 
-	if (!IsAsciiStlFile(&ifs))
-	{
-		// try binary file read
+void CStlSolid::read_binary(const char* data, size_t size)
+{
+	// an 80 byte header, the number of facets, then 50 bytes for each facet
+	if (size < 84)return;
 
-		// read the header
-		char header[81];
-		header[80] = 0;
-		ifs.read(header, 80);
+	unsigned int num_facets = 0;
+	memcpy(&num_facets, data + 80, 4);
 
-		unsigned int num_facets = 0;
-		ifs.read((char*)(&num_facets), 4);
+	// don't believe a number of facets which goes past the end of the file
+	size_t facets_in_file = (size - 84) / 50;
+	if (num_facets > facets_in_file)num_facets = (unsigned int)facets_in_file;
 
-		for (unsigned int i = 0; i<num_facets; i++)
-		{
-			CStlTri tri;
-			float n[3];
-			ifs.read((char*)(n), 12);
-			ifs.read((char*)(tri.x[0]), 36);
-			short attr;
-			ifs.read((char*)(&attr), 2);
-			m_list.push_back(tri);
-		}
-}
-	else
+	m_list.resize(num_facets);
+	const char* facet = data + 84;
+	for (unsigned int i = 0; i<num_facets; i++, facet += 50)
 	{
-		// first 5 chars will be "solid"
-		char str[1024] = "solid";
-		ifs.getline(str, 1024);
-		m_title.assign(Ctt(&(str[6])));
+		// skip the normal, then the three vertices, ignore the attribute
+		memcpy(m_list[i].x[0], facet + 12, 36);
+	}
+}
 
-		CStlTri t;
-		char five_chars[6] = "aaaaa";
+void CStlSolid::read_ascii(const char* data, size_t size)
+{
+	const char* end = data + size;
 
-		int vertex = 0;
+	// the title is the rest of the first line, after "solid"
+	const char* p = data + 5;
+	const char* line_end = p;
+	while (line_end < end && *line_end != '\n' && *line_end != '\r')line_end++;
+	while (p < line_end && (*p == ' ' || *p == '\t'))p++;
+	if (p < line_end)m_title.assign(Ctt(std::string(p, line_end).c_str()));
+	p = line_end;
 
-		while (!ifs.eof() && !ifs.fail())
-		{
-			ifs.getline(str, 1024);
+	// a facet takes about 250 characters
+	m_list.reserve(size / 250);
 
-			int i = 0, j = 0;
-			for (; i<5; i++, j++)
-			{
-				if (str[j] == 0)break;
-				while (str[j] == ' ' || str[j] == '\t')j++;
-				five_chars[i] = str[j];
-			}
-			if (i == 5)
+	CStlTri t;
+	int vertex = 0;
+
+	while (p < end)
+	{
+		while (p < end && (*p == '\n' || *p == '\r' || *p == ' ' || *p == '\t'))p++;
+		size_t left = end - p;
+
+		if (left >= 6 && !memcmp(p, "vertex", 6))
+		{
+			if (vertex < 3)
 			{
-				if (!strcmp(five_chars, "verte"))
+				const char* q = p + 6;
+				for (int i = 0; i < 3 && q; i++)q = ReadFloat(q, end, t.x[vertex][i]);
+				if (q)
 				{
-#ifdef WIN32
-					sscanf(str, " vertex %f %f %f", &(t.x[vertex][0]), &(t.x[vertex][1]), &(t.x[vertex][2]));
-#else
-					std::istringstream ss(str);
-					ss.imbue(std::locale("C"));
-					while (ss.peek() == ' ') ss.seekg(1, ios_base::cur);
-					ss.seekg(std::string("vertex").size(), ios_base::cur);
-					ss >> t.x[vertex][0] >> t.x[vertex][1] >> t.x[vertex][2];
-#endif
+					p = q;
 					vertex++;
-					if (vertex > 2)vertex = 2;
-				}
-				else if (!strcmp(five_chars, "facet"))
-				{
-					vertex = 0;
-				}
-				else if (!strcmp(five_chars, "endfa"))
-				{
-					if (vertex == 2)
-					{
-						m_list.push_back(t);
-					}
 				}
+				else
+					vertex = 4; // lose the facet with the bad vertex
+			}
+			else
+				vertex = 4;
+		}
+		else if (left >= 5 && !memcmp(p, "facet", 5))
+		{
+			vertex = 0;
+		}
+		else if (left >= 8 && !memcmp(p, "endfacet", 8))
+		{
+			if (vertex == 3)
+			{
+				m_list.push_back(t);
 			}
+			vertex = 0;
 		}
+
+		// go to the next line
+		while (p < end && *p != '\n')p++;
 	}
 }
 
@@ -218,8 +244,7 @@ const CStlSolid& CStlSolid::operator=(const CStlSolid& s)
 
 	m_color = s.m_color;
 
-	m_list.clear();
-	std::copy( s.m_list.begin(), s.m_list.end(), std::inserter( m_list, m_list.begin() ));
+	m_list = s.m_list;
 
 	return *this;
 }
@@ -264,6 +289,23 @@ void CStlSolid::GetProperties(std::list<Property *> *list)
 	HeeksObj::GetProperties(list);
 }
 
+static void TriangleNormal(const CStlTri &t, float* n)
+{
+	// the unit normal of the triangle, or zero if it has no area
+	float v1[3] = { t.x[1][0] - t.x[0][0], t.x[1][1] - t.x[0][1], t.x[1][2] - t.x[0][2] };
+	float v2[3] = { t.x[2][0] - t.x[0][0], t.x[2][1] - t.x[0][1], t.x[2][2] - t.x[0][2] };
+	n[0] = v1[1] * v2[2] - v1[2] * v2[1];
+	n[1] = v1[2] * v2[0] - v1[0] * v2[2];
+	n[2] = v1[0] * v2[1] - v1[1] * v2[0];
+	float len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (len > 0.0f)
+	{
+		n[0] /= len;
+		n[1] /= len;
+		n[2] /= len;
+	}
+}
+
 void CStlSolid::glCommands(bool select, bool marked, bool no_color){
 	bool draw_faces = (wxGetApp().m_solid_view_mode == SolidViewFacesAndEdges || wxGetApp().m_solid_view_mode == SolidViewFacesOnly);
 	bool draw_edges = (wxGetApp().m_solid_view_mode == SolidViewFacesAndEdges || wxGetApp().m_solid_view_mode == SolidViewEdgesOnly);
@@ -283,39 +325,43 @@ void CStlSolid::glCommands(bool select, bool marked, bool no_color){
 			m_gl_list = glGenLists(1);
 			glNewList(m_gl_list, GL_COMPILE_AND_EXECUTE);
 
-			// render all the triangles
-			int i = 0;
-			for (std::list<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++, i++)
+			if (wxGetApp().m_stl_solid_random_colors)
 			{
-				CStlTri &t = *It;
-				//SetPickingColor(i);
-				if (wxGetApp().m_stl_solid_random_colors)
+				// each triangle has its own material, so render them one at a time
+				for (std::vector<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
 				{
+					CStlTri &t = *It;
 					HeeksColor col(rand() >> 7, rand() >> 7, rand() >> 7);
 					Material(col).glMaterial(1.0);
-				}
-				gp_Pnt p0(t.x[0][0], t.x[0][1], t.x[0][2]);
-				gp_Pnt p1(t.x[1][0], t.x[1][1], t.x[1][2]);
-				gp_Pnt p2(t.x[2][0], t.x[2][1], t.x[2][2]);
-				gp_Vec v1(p0, p1);
-				gp_Vec v2(p0, p2);
-				try
-				{
-					gp_Vec norm = (v1 ^ v2).Normalized();
 					float n[3];
-					n[0] = (float)(norm.X());
-					n[1] = (float)(norm.Y());
-					n[2] = (float)(norm.Z());
+					TriangleNormal(t, n);
 					glBegin(GL_TRIANGLES);
 					glNormal3fv(n);
 					glVertex3fv(t.x[0]);
 					glVertex3fv(t.x[1]);
 					glVertex3fv(t.x[2]);
-			glEnd();
+					glEnd();
 				}
-				catch (...)
+			}
+			else if (m_list.size() > 0)
+			{
+				// render all the triangles from arrays, the vertices straight from m_list and a normal for each of them
+				std::vector<float> normals(m_list.size() * 9);
+				float* n = &normals[0];
+				for (std::vector<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++, n += 9)
 				{
+					TriangleNormal(*It, n);
+					memcpy(n + 3, n, 3 * sizeof(float));
+					memcpy(n + 6, n, 3 * sizeof(float));
 				}
+
+				glEnableClientState(GL_VERTEX_ARRAY);
+				glEnableClientState(GL_NORMAL_ARRAY);
+				glVertexPointer(3, GL_FLOAT, 0, m_list[0].x[0]);
+				glNormalPointer(GL_FLOAT, 0, &normals[0]);
+				glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(m_list.size() * 3));
+				glDisableClientState(GL_NORMAL_ARRAY);
+				glDisableClientState(GL_VERTEX_ARRAY);
 			}
 
 			glEndList();
@@ -336,7 +382,7 @@ void CStlSolid::glCommands(bool select, bool marked, bool no_color){
 
 			glBegin(GL_LINES);
 			glColor3ub(0, 0, 0);
-			for (std::list<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
+			for (std::vector<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
 			{
 				CStlTri &t = *It;
 				glVertex3fv(t.x[0]);
@@ -357,7 +403,7 @@ void CStlSolid::GetGripperPositions(std::list<GripData> *list, bool just_for_end
 {
 	if (just_for_endof && wxGetApp().m_stl_solid_random_colors)
 	{
-		for (std::list<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
+		for (std::vector<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
 		{
 			CStlTri &t = *It;
 			list->push_back(GripData(GripperTypeTranslate, t.x[0][0], t.x[0][1], t.x[0][2]));
@@ -377,16 +423,12 @@ class MakeSingleTriangleTool :public Tool{
 public:
 	// Tool's virtual functions
 	void Run(){
-		int i = 0;
-		for (std::list<CStlTri>::iterator It = object_for_tool->m_list.begin(); It != object_for_tool->m_list.end(); It++, i++)
+		int i = object_for_tool->m_clicked_triangle;
+		if (i >= 0 && i < (int)(object_for_tool->m_list.size()))
 		{
-			if (i == object_for_tool->m_clicked_triangle)
-			{
-				CStlTri &t = *It;
-				CStlSolid* new_object = new CStlSolid;
-				new_object->m_list.push_back(t);
-				wxGetApp().AddUndoably(new_object, NULL);
-			}
+			CStlSolid* new_object = new CStlSolid;
+			new_object->m_list.push_back(object_for_tool->m_list[i]);
+			wxGetApp().AddUndoably(new_object, NULL);
 		}
 	}
 	const wxChar* GetTitle(){ return _("Make Single Triangle"); }
@@ -402,33 +444,44 @@ void CStlSolid::GetTools(std::list<Tool*>* t_list, const wxPoint* p)
 }
 
 void CStlSolid::GetBox(CBox &box){
-	if(!m_box.m_valid)
+	if(!m_box.m_valid && m_list.size() > 0)
 	{
-		// calculate the box for all the triangles
-		for(std::list<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
+		// calculate the box for all the triangles, going through their vertices as one array of floats
+		const float* x = m_list[0].x[0];
+		size_t num_vertices = m_list.size() * 3;
+		float mn[3] = { x[0], x[1], x[2] };
+		float mx[3] = { x[0], x[1], x[2] };
+		for(size_t i = 0; i<num_vertices; i++, x += 3)
 		{
-			CStlTri &t = *It;
-			m_box.Insert(t.x[0][0], t.x[0][1], t.x[0][2]);
-			m_box.Insert(t.x[1][0], t.x[1][1], t.x[1][2]);
-			m_box.Insert(t.x[2][0], t.x[2][1], t.x[2][2]);
+			for(int j = 0; j<3; j++)
+			{
+				if(x[j] < mn[j])mn[j] = x[j];
+				if(x[j] > mx[j])mx[j] = x[j];
+			}
 		}
+		m_box.Insert(mn[0], mn[1], mn[2]);
+		m_box.Insert(mx[0], mx[1], mx[2]);
 	}
 
 	box.Insert(m_box);
 }
 
 void CStlSolid::ModifyByMatrix(const double* m){
-	gp_Trsf mat = make_matrix(m);
-	for(std::list<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
+	if(m_list.size() > 0)
 	{
-		CStlTri &t = *It;
-		for(int i = 0; i<3; i++){
-			gp_Pnt vx;
-			vx = gp_Pnt(t.x[i][0], t.x[i][1], t.x[i][2]);
-			vx.Transform(mat);
-			t.x[i][0] = (float)vx.X();
-			t.x[i][1] = (float)vx.Y();
-			t.x[i][2] = (float)vx.Z();
+		// transform all the vertices as one array of floats
+		gp_Trsf mat = make_matrix(m);
+		double r[3][4];
+		for(int i = 0; i<3; i++)for(int j = 0; j<4; j++)r[i][j] = mat.Value(i + 1, j + 1);
+
+		float* x = m_list[0].x[0];
+		size_t num_vertices = m_list.size() * 3;
+		for(size_t i = 0; i<num_vertices; i++, x += 3)
+		{
+			double px = x[0], py = x[1], pz = x[2];
+			x[0] = (float)(r[0][0] * px + r[0][1] * py + r[0][2] * pz + r[0][3]);
+			x[1] = (float)(r[1][0] * px + r[1][1] * py + r[1][2] * pz + r[1][3]);
+			x[2] = (float)(r[2][0] * px + r[2][1] * py + r[2][2] * pz + r[2][3]);
 		}
 	}
 
@@ -458,7 +511,7 @@ void CStlSolid::OnEditString(const wxChar* str){
 void CStlSolid::GetTriangles(void(*callbackfunc)(const double* x, const double* n), double cusp, bool just_one_average_normal){
 	double x[9];
 	double n[9];
-	for(std::list<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
+	for(std::vector<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
 	{
 		CStlTri &t = *It;
 		x[0] = t.x[0][0];
@@ -505,7 +558,7 @@ void CStlSolid::WriteXML(TiXmlNode *root)
 	root->LinkEndChild( element );
 	element->SetAttribute("col", m_color.COLORREF_color());
 
-	for(std::list<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
+	for(std::vector<CStlTri>::iterator It = m_list.begin(); It != m_list.end(); It++)
 	{
 		CStlTri &t = *It;
 		TiXmlElement * child_element;
@@ -21,9 +21,11 @@ private:
 	wxString m_title;
 
 	void read_from_file(const wxChar* filepath);
+	void read_binary(const char* data, size_t size);
+	void read_ascii(const char* data, size_t size);
 
 public:
-	std::list<CStlTri> m_list;
+	std::vector<CStlTri> m_list; // contiguous, so they can be drawn and transformed as arrays of floats
 	int m_clicked_triangle;
 
 	CStlSolid();
@@ -11,6 +11,7 @@
 #include "HLine.h"
 #include "HILine.h"
 #include "HeeksConfig.h"
+#include "Instance.h"
 
 //static double from[3];
 static double centre[3];
@@ -27,6 +28,33 @@ void TransformTools::RemoveUncopyable()
 	if(uncopyable_objects.size() > 0)wxGetApp().m_marked_list->Remove(uncopyable_objects, true);
 }
 
+//static
+void TransformTools::AddCopy(HeeksObj* object, const gp_Trsf &mat, std::map< HeeksObj*, std::list<HeeksObj*> > &instances)
+{
+	if(CInstance::CanInstance(object))
+	{
+		// solids are copied as instances, which draw the solid's display lists, rather than copying and meshing the solid again
+		// they are added by AddInstances, all at once for each owner
+		instances[object->m_owner].push_back(CInstance::MakeInstance(object, mat));
+		return;
+	}
+
+	HeeksObj* new_object = object->MakeACopy();
+	wxGetApp().AddUndoably(new_object, object->m_owner, NULL);
+	double m[16];
+	extract(mat, m);
+	wxGetApp().TransformUndoably(new_object, m);
+}
+
+//static
+void TransformTools::AddInstances(const std::map< HeeksObj*, std::list<HeeksObj*> > &instances)
+{
+	for(std::map< HeeksObj*, std::list<HeeksObj*> >::const_iterator It = instances.begin(); It != instances.end(); It++)
+	{
+		wxGetApp().AddUndoably(It->second, It->first);
+	}
+}
+
 //static
 void TransformTools::Translate(bool copy)
 {
@@ -78,20 +106,18 @@ void TransformTools::Translate(bool copy)
 	// transform the objects
 	if(copy)
 	{
+		std::map< HeeksObj*, std::list<HeeksObj*> > instances;
 		for(int i = 0; i<ncopies; i++)
 		{
 			gp_Trsf mat;
 			mat.SetTranslationPart(make_vector(make_point(from), make_point(to)) * (i + 1));
-			double m[16];
-			extract(mat, m);
 			for(std::list<HeeksObj*>::iterator It = selected_items.begin(); It != selected_items.end(); It++)
 			{
 				HeeksObj* object = *It;
-				HeeksObj* new_object = object->MakeACopy();
-				object->m_owner->Add(new_object, NULL);
-				wxGetApp().TransformUndoably(new_object, m);
+				AddCopy(object, mat, instances);
 			}
 		}
+		AddInstances(instances);
 		wxGetApp().m_marked_list->Clear(true);
 	}
 	else
@@ -171,6 +197,7 @@ void TransformTools::Rotate(bool copy)
 	wxGetApp().StartHistory();
 	if(copy)
 	{
+		std::map< HeeksObj*, std::list<HeeksObj*> > instances;
 		for(int i = 0; i<ncopies; i++)
 		{
 			gp_Trsf mat;
@@ -178,16 +205,13 @@ void TransformTools::Rotate(bool copy)
 			gp_Trsf tmat;
 			tmat.SetTranslation(gp_Vec(axis_Dir.XYZ() * (axial_shift * ((double)(i+1)) / ncopies)));
 			mat = tmat * mat;
-			double m[16];
-			extract(mat, m);
 			for(std::list<HeeksObj*>::iterator It = selected_items.begin(); It != selected_items.end(); It++)
 			{
 				HeeksObj* object = *It;
-				HeeksObj* new_object = object->MakeACopy();
-				wxGetApp().TransformUndoably(new_object, m);             // Rotate the duplicate object.
-				wxGetApp().AddUndoably(new_object, object->m_owner, NULL);// And add it to this object's owner
+				AddCopy(object, mat, instances);
 			}
 		}
+		AddInstances(instances);
 		wxGetApp().m_marked_list->Clear(true);
 	}
 	else
@@ -255,13 +279,13 @@ void TransformTools::Mirror(bool copy)
 
 	if(copy)
 	{
+		std::map< HeeksObj*, std::list<HeeksObj*> > instances;
 		for(std::list<HeeksObj*>::iterator It = selected_items.begin(); It != selected_items.end(); It++)
 		{
 			HeeksObj* object = *It;
-			HeeksObj* new_object = object->MakeACopy();
-			wxGetApp().AddUndoably(new_object, object->m_owner, NULL);
-			wxGetApp().TransformUndoably(new_object, m);
+			AddCopy(object, mat, instances);
 		}
+		AddInstances(instances);
 		wxGetApp().m_marked_list->Clear(true);
 	}
 	else
@@ -6,6 +6,8 @@
 
 class TransformTools{
 	static void RemoveUncopyable();
+	static void AddCopy(HeeksObj* object, const gp_Trsf &mat, std::map< HeeksObj*, std::list<HeeksObj*> > &instances);
+	static void AddInstances(const std::map< HeeksObj*, std::list<HeeksObj*> > &instances);
 
 public:
 	static void Translate(bool copy);
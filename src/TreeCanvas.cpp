@@ -28,7 +28,7 @@ static wxBitmap* bmp_branch_trunk = NULL;
 
 CTreeCanvas::CTreeCanvas(wxWindow* parent)
         : wxScrolledWindow(parent),m_frozen(false), m_refresh_wanted_on_thaw(false),
-		width(0), height(0), textureWidth(0), textureHeight(0), m_dragging(false), m_waiting_until_left_up(false), m_xpos(0), m_ypos(0), m_max_xpos(0)
+		width(0), height(0), textureWidth(0), textureHeight(0), m_dragging(false), m_waiting_until_left_up(false), m_xpos(0), m_ypos(0), m_max_xpos(0), m_render_top(0), m_render_bottom(0)
 {
 	wxGetApp().RegisterObserver(this);
 
@@ -360,6 +360,37 @@ void CTreeCanvas::OnMenuEvent(wxCommandEvent& event)
 
 void CTreeCanvas::OnChanged(const std::list<HeeksObj*>* added, const std::list<HeeksObj*>* removed, const std::list<HeeksObj*>* modified)
 {
+	if(added)
+	{
+		for(std::list<HeeksObj*>::const_iterator It = added->begin(); It != added->end(); It++)ForgetNodes(*It);
+	}
+
+	if(removed)
+	{
+		// the removed objects may have been deleted, so use the owners they had when they were measured
+		std::set<HeeksObj*> removed_set(removed->begin(), removed->end());
+		std::list<HeeksObj*> owners;
+		for(std::list<HeeksObj*>::const_iterator It = removed->begin(); It != removed->end(); It++)
+		{
+			std::map<HeeksObj*, CTreeNode>::iterator FindIt = m_nodes.find(*It);
+			if(FindIt != m_nodes.end() && FindIt->second.owner && !IsInRemoved(FindIt->second.owner, removed_set))owners.push_back(FindIt->second.owner);
+		}
+
+		// forget the objects which were inside them too, whose addresses could be used again for new objects
+		for(std::map<HeeksObj*, CTreeNode>::iterator It = m_nodes.begin(); It != m_nodes.end();)
+		{
+			if(IsInRemoved(It->first, removed_set))m_nodes.erase(It++);
+			else It++;
+		}
+
+		for(std::list<HeeksObj*>::iterator It = owners.begin(); It != owners.end(); It++)ForgetNode(*It);
+	}
+
+	if(modified)
+	{
+		for(std::list<HeeksObj*>::const_iterator It = modified->begin(); It != modified->end(); It++)ForgetNodes(*It);
+	}
+
 	SetVirtualSize(GetRenderSize());
 	Refresh();
 }
@@ -371,6 +402,7 @@ void CTreeCanvas::WhenMarkedListChanges(bool selection_cleared, const std::list<
 
 void CTreeCanvas::Clear()
 {
+	m_nodes.clear();
 	Refresh();
 }
 
@@ -424,8 +456,64 @@ bool CTreeCanvas::IsExpanded(HeeksObj* object)
 	return m_expanded.find(object) != m_expanded.end();
 }
 
+const CTreeCanvas::CTreeNode& CTreeCanvas::GetNode(HeeksObj* object, HeeksObj* owner)
+{
+	std::map<HeeksObj*, CTreeNode>::iterator FindIt = m_nodes.find(object);
+	if(FindIt != m_nodes.end())return FindIt->second;
+
+	// measure it, the same way as Render(true) does
+	CTreeNode node;
+	node.owner = owner;
+	node.rows = 1;
+	node.width = 16 + 16 + 8 + 10 * wxString(object->GetShortStringOrTypeString()).Len();
+	if(IsExpanded(object))
+	{
+		for(HeeksObj* child = object->GetFirstChild(); child; child = object->GetNextChild())
+		{
+			const CTreeNode& child_node = GetNode(child, object);
+			node.rows += child_node.rows;
+			if(child_node.width + 16 > node.width)node.width = child_node.width + 16;
+		}
+	}
+
+	return m_nodes.insert(std::make_pair(object, node)).first->second;
+}
+
+void CTreeCanvas::ForgetNode(HeeksObj* object)
+{
+	for(HeeksObj* o = object; o && o != &wxGetApp(); o = o->m_owner)
+	{
+		m_nodes.erase(o);
+	}
+}
+
+bool CTreeCanvas::IsInRemoved(HeeksObj* object, const std::set<HeeksObj*> &removed)const
+{
+	// follows the recorded owners, not m_owner, because the removed objects may have been deleted
+	for(HeeksObj* o = object; o;)
+	{
+		if(removed.find(o) != removed.end())return true;
+		std::map<HeeksObj*, CTreeNode>::const_iterator FindIt = m_nodes.find(o);
+		if(FindIt == m_nodes.end())return false;
+		o = FindIt->second.owner;
+	}
+	return false;
+}
+
+void CTreeCanvas::ForgetNodes(HeeksObj* object)
+{
+	// objects can be made where deleted ones were, so forget all of the ones inside it
+	for(HeeksObj* child = object->GetFirstChild(); child; child = object->GetNextChild())
+	{
+		ForgetNodes(child);
+	}
+	ForgetNode(object);
+}
+
 void CTreeCanvas::SetExpanded(HeeksObj* object, bool bExpanded)
 {
+	ForgetNode(object);
+
 	if(bExpanded)
 	{
 		m_expanded.insert(object);
@@ -695,59 +783,63 @@ void CTreeCanvas::RenderBranchIcons(HeeksObj* object, HeeksObj* next_object, boo
 
 void CTreeCanvas::RenderObject(bool expanded, HeeksObj* prev_object, bool prev_object_expanded, HeeksObj* object, HeeksObj* next_object, int level)
 {
-	int save_x = m_xpos;
+	// only draw the row if it is in the window
+	if(render_just_for_calculation || (m_ypos + 18 > m_render_top && m_ypos < m_render_bottom))
+	{
+		int save_x = m_xpos;
 
-	RenderBranchIcons(object, next_object, expanded, level);
+		RenderBranchIcons(object, next_object, expanded, level);
 
-	int label_start_x = m_xpos;
-	// find icon info
-	if (!render_just_for_calculation)
-	{
-		m_dc->DrawBitmap(object->GetIcon(), m_xpos, m_ypos);
-	}
-	m_xpos += 16;
+		int label_start_x = m_xpos;
+		// find icon info
+		if (!render_just_for_calculation)
+		{
+			m_dc->DrawBitmap(object->GetIcon(), m_xpos, m_ypos);
+		}
+		m_xpos += 16;
 
-	wxString str(object->GetShortStringOrTypeString());
-	if(!render_just_for_calculation)
-	{
-		if(render_labels && wxGetApp().m_marked_list->ObjectMarked(object))
+		wxString str(object->GetShortStringOrTypeString());
+		if(!render_just_for_calculation)
 		{
-			m_dc->SetBackgroundMode(wxSOLID);
-			m_dc->SetTextBackground(*wxBLUE);
-			m_dc->SetTextForeground(*wxWHITE);
+			if(render_labels && wxGetApp().m_marked_list->ObjectMarked(object))
+			{
+				m_dc->SetBackgroundMode(wxSOLID);
+				m_dc->SetTextBackground(*wxBLUE);
+				m_dc->SetTextForeground(*wxWHITE);
+			}
+			else
+			{
+				m_dc->SetBackgroundMode(wxTRANSPARENT);
+				m_dc->SetTextForeground(*wxBLACK);
+			}
+			m_dc->DrawText(str, m_xpos, m_ypos);
+		}
+		int text_width = 0;
+		if(render_just_for_calculation || !render_labels)
+		{
+			// just make a guess, we don't have a valid m_dc
+			text_width = 10 * str.Len();
 		}
 		else
 		{
-			m_dc->SetBackgroundMode(wxTRANSPARENT);
-			m_dc->SetTextForeground(*wxBLACK);
+			wxSize text_size = m_dc->GetTextExtent(str);
+			text_width = text_size.GetWidth();
 		}
-		m_dc->DrawText(str, m_xpos, m_ypos);
-	}
-	int text_width = 0;
-	if(render_just_for_calculation || !render_labels)
-	{
-		// just make a guess, we don't have a valid m_dc
-		text_width = 10 * str.Len();
-	}
-	else
-	{
-		wxSize text_size = m_dc->GetTextExtent(str);
-		text_width = text_size.GetWidth();
-	}
-	int label_end_x = m_xpos + 8 + text_width;
-	if(!render_just_for_calculation && render_labels)
-	{
-		AddLabelButton(expanded, prev_object, prev_object_expanded, object, next_object, label_start_x, label_end_x);
+		int label_end_x = m_xpos + 8 + text_width;
+		if(!render_just_for_calculation && render_labels)
+		{
+			AddLabelButton(expanded, prev_object, prev_object_expanded, object, next_object, label_start_x, label_end_x);
+		}
+		if(label_end_x > m_max_xpos)m_max_xpos = label_end_x;
+
+		m_xpos = save_x;
 	}
-	if(label_end_x > m_max_xpos)m_max_xpos = label_end_x;
 
 	m_ypos += 18;
 
 	bool end_object = (next_object == NULL);
 	end_child_list.push_back(end_object);
 
-	m_xpos = save_x;
-
 	if(expanded)
 	{
 		HeeksObj* prev_child = NULL;
@@ -756,9 +848,20 @@ void CTreeCanvas::RenderObject(bool expanded, HeeksObj* prev_object, bool prev_o
 
 		while(child)
 		{
+			// stop at the bottom of the window
+			if(!render_just_for_calculation && m_ypos >= m_render_bottom)break;
+
 			HeeksObj* next_child = object->GetNextChild();
 			bool expanded = IsExpanded(child);
-			RenderObject(expanded, prev_child, prev_child_expanded, child, next_child, level + 1);
+			if(!render_just_for_calculation && m_ypos + GetNode(child, object).rows * 18 <= m_render_top)
+			{
+				// skip over the child, and its children, which are all above the window
+				m_ypos += GetNode(child, object).rows * 18;
+			}
+			else
+			{
+				RenderObject(expanded, prev_child, prev_child_expanded, child, next_child, level + 1);
+			}
 			prev_child = child;
 			prev_child_expanded = expanded;
 			child = next_child;
@@ -793,6 +896,11 @@ void CTreeCanvas::Render(bool just_for_calculation)
 		m_dc->Clear();
 
 		m_tree_buttons.clear();
+
+		int w, h;
+		GetClientSize(&w, &h);
+		m_render_top = CalcUnscrolledPosition(wxPoint(0, 0)).y;
+		m_render_bottom = m_render_top + h;
 	}
 
 	m_xpos = 0; // start at the left
@@ -805,9 +913,20 @@ void CTreeCanvas::Render(bool just_for_calculation)
 
 	while(object)
 	{
+		// stop at the bottom of the window
+		if(!just_for_calculation && m_ypos >= m_render_bottom)break;
+
 		HeeksObj* next_object = wxGetApp().GetNextChild();
 		bool expanded = IsExpanded(object);
-		RenderObject(expanded, prev_object, prev_object_expanded, object, next_object, 0);
+		if(!just_for_calculation && m_ypos + GetNode(object, NULL).rows * 18 <= m_render_top)
+		{
+			// skip over the object, and its children, which are all above the window
+			m_ypos += GetNode(object, NULL).rows * 18;
+		}
+		else
+		{
+			RenderObject(expanded, prev_object, prev_object_expanded, object, next_object, 0);
+		}
 		prev_object = object;
 		prev_object_expanded = expanded;
 		object = next_object;
@@ -832,9 +951,16 @@ void CTreeCanvas::Render(bool just_for_calculation)
 
 wxSize CTreeCanvas::GetRenderSize()
 {
-	bool just_for_calculation = true;
-	Render(just_for_calculation);
-	return wxSize(m_max_xpos, m_ypos);
+	// from the measured objects, instead of Render(true), which would go through all the expanded objects
+	int rows = 0;
+	int max_x = 0;
+	for(HeeksObj* object = wxGetApp().GetFirstChild(); object; object = wxGetApp().GetNextChild())
+	{
+		const CTreeNode& node = GetNode(object, NULL);
+		rows += node.rows;
+		if(node.width > max_x)max_x = node.width;
+	}
+	return wxSize(max_x, rows * 18);
 }
 
 void CTreeCanvas::RenderDraggedList(bool just_for_calculation)
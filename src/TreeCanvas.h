@@ -34,6 +34,17 @@ private:
 	class CTreeButton{public:	TreeButtonType type; wxRect rect; HeeksObj* obj; HeeksObj* paste_into; HeeksObj* paste_before;};
 	std::list<CTreeButton> m_tree_buttons;
 
+	// the number of rows each object takes, with its children if it is expanded, and the width of the widest of them, from the object's level
+	// they are only measured again when the object, or something inside it, changes, and they are used to skip over the objects which aren't in the window
+	class CTreeNode{public: int rows; int width; HeeksObj* owner; CTreeNode():rows(0), width(0), owner(NULL){}};
+	std::map<HeeksObj*, CTreeNode> m_nodes;
+	int m_render_top, m_render_bottom; // the part of the tree in the window
+
+	const CTreeNode& GetNode(HeeksObj* object, HeeksObj* owner);
+	void ForgetNode(HeeksObj* object); // it and the objects which it is in
+	void ForgetNodes(HeeksObj* object); // it and the objects in it, and the objects which it is in
+	bool IsInRemoved(HeeksObj* object, const std::set<HeeksObj*> &removed)const; // if it, or an object which it was measured in, is removed
+
 	bool IsExpanded(HeeksObj* object);
 	void SetExpanded(HeeksObj* object, bool bExpanded);
 	void RenderBranchIcon(HeeksObj* object, HeeksObj* next_object, bool expanded, int level);
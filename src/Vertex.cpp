@@ -16,6 +16,13 @@ HVertex::HVertex(const TopoDS_Vertex &vertex):m_topods_vertex(vertex){
 HVertex::~HVertex(){
 }
 
+void HVertex::MoveWithBody(const TopLoc_Location &loc){
+	// the parent body has been moved by its location
+	m_topods_vertex.Move(loc);
+	gp_Pnt pos = BRep_Tool::Pnt(m_topods_vertex);
+	extract(pos, m_point);
+}
+
 void HVertex::FindEdges()
 {
 	CShape* body = GetParentBody();
@@ -33,6 +33,7 @@ public:
 	const wxChar* GetTypeString(void)const{return _("Vertex");}
 	bool UsesID(){return true;}
 	void ModifyByMatrix(const double* m);
+	void MoveWithBody(const TopLoc_Location &loc);
 
 	const TopoDS_Vertex &Vertex(){ return m_topods_vertex; }
 	CEdge* GetFirstEdge();
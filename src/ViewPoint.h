@@ -64,5 +64,5 @@ public:
 	int GetTwoAxes(gp_Vec& vx, gp_Vec& vy, bool flattened_onto_screen, int plane)const;
 	void Set90PlaneDrawMatrix(gp_Trsf &mat)const;
 	void SetPerspective(bool perspective);
-	bool GetPerspective(){return m_perspective;}
+	bool GetPerspective()const{return m_perspective;}
 };
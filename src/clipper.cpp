@@ -38,6 +38,9 @@
 *                                                                              *
 *******************************************************************************/
 
+// libarea's AreaClipper.cpp marks points with the arcs they are on, in Z, so clipper is built with use_xyz
+// this and AreaClipper.cpp are the only files which include clipper.hpp; any other must define it too
+#define use_xyz
 #include "clipper.hpp"
 #include <cmath>
 #include <vector>